@@ -509,7 +509,7 @@ void Enviro::SetupTerrain(vtTerrain *pTerr)
 			SetMessage("", pTerr->GetLastError());	// Don't try to translate error
 			return;
 		}
-		SetMessage(_("Loading/Coloring/Prelighting Textures"));
+		SetMessage(_("Creating Terrain"));
 		UpdateProgress(m_strMessage1, m_strMessage2, m_iInitStep * 100 / 16, 0);
 	}
 	else if (m_iInitStep == 4)
@@ -525,83 +525,16 @@ void Enviro::SetupTerrain(vtTerrain *pTerr)
 			m_pSkyDome->SetTime(pTerr->GetInitialTime());
 		}
 
-		if (!pTerr->CreateStep3(GetSunLightTransform(), GetSunLightSource()))
+		// Build the rest of the terrain; the textures and culture files are
+		//  prepared in parallel
+		if (!pTerr->CreateParallel(GetSunLightTransform(), GetSunLightSource(),
+			CreateProgress))
 		{
 			SetState(AS_Error);
 			SetMessage("", pTerr->GetLastError());
 			return;
 		}
-		SetMessage(_("Processing Elevation"));
-		UpdateProgress(m_strMessage1, m_strMessage2, m_iInitStep * 100 / 16, 0);
-	}
-	else if (m_iInitStep == 5)
-	{
-		if (!pTerr->CreateStep4())
-		{
-			SetState(AS_Error);
-			SetMessage("", pTerr->GetLastError());
-			return;
-		}
-		SetMessage(_("Building CLOD"));
-		UpdateProgress(m_strMessage1, m_strMessage2, 25, 0);
-	}
-	else if (m_iInitStep == 6)
-	{
-		if (!pTerr->CreateStep5())
-		{
-			SetState(AS_Error);
-			SetMessage("", pTerr->GetLastError());
-			return;
-		}
-		SetMessage(_("Creating Structures"));
-		UpdateProgress(m_strMessage1, m_strMessage2, m_iInitStep * 100 / 16, 0);
-	}
-	else if (m_iInitStep == 7)
-	{
-		pTerr->CreateStep6();
-
-		SetMessage(_("Creating Roads"));
-		UpdateProgress(m_strMessage1, m_strMessage2, m_iInitStep * 100 / 16, 0);
-	}
-	else if (m_iInitStep == 8)
-	{
-		pTerr->CreateStep7();
-
-		SetMessage(_("Creating Vegetation"));
-		UpdateProgress(m_strMessage1, m_strMessage2, m_iInitStep * 100 / 16, 0);
-	}
-	else if (m_iInitStep == 9)
-	{
-		pTerr->CreateStep8();
-
-		SetMessage(_("Creating Water, UtilityMaps, HUD"));
-		UpdateProgress(m_strMessage1, m_strMessage2, m_iInitStep * 100 / 16, 0);
-	}
-	else if (m_iInitStep == 10)
-	{
-		pTerr->CreateStep9();
-
-		SetMessage(_("Creating Abstract Layers"));
-		UpdateProgress(m_strMessage1, m_strMessage2, m_iInitStep * 100 / 16, 0);
-	}
-	else if (m_iInitStep == 11)
-	{
-		pTerr->CreateStep10();
-
-		SetMessage(_("Creating Image Layers"));
-		UpdateProgress(m_strMessage1, m_strMessage2, m_iInitStep * 100 / 16, 0);
-	}
-	else if (m_iInitStep == 12)
-	{
-		pTerr->CreateStep11();
-
-		SetMessage(_("Creating Elevation Layers"));
-		UpdateProgress(m_strMessage1, m_strMessage2, m_iInitStep * 100 / 16, 0);
-	}
-	else if (m_iInitStep == 13)
-	{
-		pTerr->CreateStep12();
-
+		m_iInitStep = 13;	// all built, skip ahead
 		SetMessage(_("Setting Camera"));
 		UpdateProgress(m_strMessage1, m_strMessage2, m_iInitStep * 100 / 16, 0);
 	}
@@ -652,6 +585,37 @@ void Enviro::SetupTerrain(vtTerrain *pTerr)
 	}
 }
 
+/**
+ * Show the progress of vtTerrain::CreateParallel, with a message for the
+ * step it is working on, as SetupTerrain does for the steps before it.
+ */
+bool Enviro::CreateProgress(int amount)
+{
+	static const char *messages[10] =
+	{
+		_("Loading/Coloring/Prelighting Textures"),
+		_("Processing Elevation"),
+		_("Building CLOD"),
+		_("Creating Structures"),
+		_("Creating Roads"),
+		_("Creating Vegetation"),
+		_("Creating Water, UtilityMaps, HUD"),
+		_("Creating Abstract Layers"),
+		_("Creating Image Layers"),
+		_("Creating Elevation Layers")
+	};
+	Enviro *env = static_cast<Enviro *>(vtGetTS());
+	if (!env->m_pTargetTerrain)
+		return false;
+
+	// The step which is next to finish
+	const int step = env->m_pTargetTerrain->GetCreateStep() + 1;
+	if (step >= 3 && step <= 12)
+		env->SetMessage(messages[step - 3]);
+	env->UpdateProgress(env->m_strMessage1, env->m_strMessage2, (step + 1) * 100 / 16, amount);
+	return false;
+}
+
 void Enviro::FormatCoordString(vtString &str, const DPoint3 &coord, LinearUnits units, bool seconds)
 {
 	DPoint3 pos = coord;
@@ -1695,7 +1659,6 @@ void Enviro::OnMouseSelectCursorPick(vtMouseEvent &event)
 	{
 		// If the current layer is abstract, only pick within it.
 		vtFeatureSet *fset = ab_layer->GetFeatureSet();
-		vtFeatureSetPoint2D *pset2 = dynamic_cast<vtFeatureSetPoint2D*>(fset);
 
 		// Control key extends selection, otherwise deselect all.
 		if (!(event.flags & VT_CONTROL))
@@ -1709,13 +1672,11 @@ void Enviro::OnMouseSelectCursorPick(vtMouseEvent &event)
 			}
 		}
 
-		int index = -1;
 		double dist;
-		if (pset2)
-			index = pset2->FindClosestPoint(gpos, epsilon, &dist);
+		int index = ab_layer->PickFeature(gpos, epsilon, &dist);
 		if (index >= 0)
 		{
-			VTLOG("abstract feature at dist.\n", dist);
+			VTLOG("abstract feature at dist %lf.\n", dist);
 			fset->Select(index, true);
 		}
 			
@@ -321,6 +321,7 @@ protected:
 	void SetupGlobe();
 	void LookUpTerrainLocations();
 	void SetupTerrain(vtTerrain *pTerr);
+	static bool CreateProgress(int amount);
 	void SetupArcMaterials();
 	void SetupArcMesh();
 	void FreeArc();
@@ -613,11 +613,10 @@ void EnviroFrame::OnChar(wxKeyEvent& event)
 					clock_t t2 = clock();
 					VTLOG(" Modify1: %.3f sec\n", (float)(t2-t1)/CLOCKS_PER_SEC);
 
-					// Update the shading and culture
+					// Update the shading, and the culture on the raised area
 					pTerr->ReshadeTexture(vtGetTS()->GetSunLightTransform());
-					DRECT area;
-					area.SetToZero();
-					pTerr->RedrapeCulture(area);
+					pTerr->RedrapeCulture(IPoint2(cols / 4, rows / 4),
+						IPoint2(cols / 2 - 1, rows / 2 - 1));
 				}
 			}
 		}
@@ -644,11 +643,10 @@ void EnviroFrame::OnChar(wxKeyEvent& event)
 					clock_t t2 = clock();
 					VTLOG(" Modify2: %.3f sec\n", (float)(t2-t1)/CLOCKS_PER_SEC);
 
-					// Update the shading and culture
+					// Update the shading, and the culture on the raised area
 					pTerr->ReshadeTexture(vtGetTS()->GetSunLightTransform());
-					DRECT area;
-					area.SetToZero();
-					pTerr->RedrapeCulture(area);
+					pTerr->RedrapeCulture(IPoint2(cols / 4, rows / 4),
+						IPoint2(cols / 2 - 1, rows / 2 - 1));
 				}
 			}
 		}
@@ -659,26 +657,19 @@ void EnviroFrame::OnChar(wxKeyEvent& event)
 			vtTerrain *pTerr = g_App.GetCurrentTerrain();
 			if (pTerr)
 			{
-				vtDynTerrainGeom *dyn = pTerr->GetDynTerrain();
-				if (dyn)
+				// Raise the ground under the mouse pointer with a brush.  Only
+				//  the area under the brush is updated: level of detail,
+				//  shading, and the culture standing on it.
+				DPoint3 epos;
+				if (pTerr->GetDynTerrain() &&
+					g_App.m_pTerrainPicker->GetCurrentEarthPos(epos))
 				{
-					// Get 3D cursor location in grid coordinates
-					FPoint3 fpos;
-					g_App.m_pTerrainPicker->GetCurrentPoint(fpos);
-					IPoint2 ipos;
-					dyn->WorldToGrid(fpos, ipos);
-					for (int x  = -4; x < 4; x++)
-						for (int y = -4; y < 4; y++)
-						{
-							float val = dyn->GetElevation(ipos.x + x, ipos.y + y);
-							dyn->SetElevation(ipos.x + x, ipos.y + y, val + 40);
-						}
-
-					// Update the (entire) shading and culture
-					pTerr->ReshadeTexture(vtGetTS()->GetSunLightTransform());
-					DRECT area;
-					area.SetToZero();
-					pTerr->RedrapeCulture(area);
+					vtTerrainBrush brush;
+					brush.m_eMode = vtTerrainBrush::RAISE;
+					brush.m_Center.Set(epos.x, epos.y);
+					brush.m_dRadius = 5 * pTerr->GetDynTerrain()->GetSpacing().x;
+					brush.m_fStrength = 40;
+					pTerr->ApplyBrush(brush, vtGetTS()->GetSunLightTransform());
 				}
 			}
 		}
@@ -1561,6 +1552,12 @@ void EnviroFrame::CarveTerrainToFitNode(osg::Node *node)
 	dyn->GetDimensions(cols, rows);
 	const FPoint3 yvec(0,100,0);
 
+	// Keep track of the area which changes, to re-drape only the culture there
+	const DRECT &ext = dyn->GetEarthExtents();
+	const DPoint2 &spacing = dyn->GetSpacing();
+	DRECT area;
+	area.SetInsideOut();
+
 	for (int c = 0; c < cols; c++)
 	{
 		for (int r = 0; r < rows; r++)
@@ -1585,6 +1582,8 @@ void EnviroFrame::CarveTerrainToFitNode(osg::Node *node)
 				FPoint3 pos = HitList.front().point;
 
 				dyn->SetElevation(c, r, pos.y);
+				area.GrowToContainPoint(DPoint2(ext.left + c * spacing.x,
+					ext.bottom + r * spacing.y));
 				changed++;
 			}
 		}
@@ -1597,13 +1596,12 @@ void EnviroFrame::CarveTerrainToFitNode(osg::Node *node)
 
 		if (res == wxYES)
 		{
-			// Update the (entire) shading and culture
+			// Update the (entire) shading, and the culture in the area
 			EnableContinuousRendering(false);
 			OpenProgressDialog(_("Recalculating Shading"), _T(""), false, this);
 
 			terr->ReshadeTexture(vtGetTS()->GetSunLightTransform(), progress_callback);
-			DRECT area;
-			area.SetToZero();
+			area.Grow(spacing.x, spacing.y);
 			terr->RedrapeCulture(area);
 
 			CloseProgressDialog();
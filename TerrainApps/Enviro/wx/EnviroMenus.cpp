@@ -26,6 +26,7 @@
 #include "vtlib/vtosg/SaveImageOSG.h"
 
 #include "vtdata/vtLog.h"
+#include "vtdata/ContourGenerator.h"
 #include "vtdata/FileFilters.h"
 #include "vtdata/TripDub.h"
 #include "vtdata/Version.h"	// for About box
@@ -1769,7 +1770,6 @@ void EnviroFrame::OnTerrainWriteElevation(wxCommandEvent& event)
 
 void EnviroFrame::OnTerrainAddContour(wxCommandEvent& event)
 {
-#if SUPPORT_QUIKGRID
 	vtTerrain *pTerr = g_App.GetCurrentTerrain();
 	if (!pTerr)
 		return;
@@ -1811,22 +1811,38 @@ void EnviroFrame::OnTerrainAddContour(wxCommandEvent& event)
 	if (!alay) return;
 	vtFeatureSetLineString *pSet = (vtFeatureSetLineString *) alay->GetFeatureSet();
 
-	vtContourConverter cc;
-	if (!cc.Setup(pTerr, pSet))
-		return;
-
-	if (dlg.m_bSingle)
-		cc.GenerateContour(dlg.m_fElevSingle);
+	vtHeightFieldGrid3d *pGrid = pTerr->GetHeightFieldGrid3d();
+	if (pGrid)
+	{
+		vtContourGenerator gen;
+		if (dlg.m_bSingle)
+			gen.GenerateContour(pGrid, dlg.m_fElevSingle, pSet);
+		else
+			gen.GenerateContours(pGrid, dlg.m_fElevEvery, pSet);
+	}
 	else
-		cc.GenerateContours(dlg.m_fElevEvery);
-	cc.Finish();
+	{
+#if SUPPORT_QUIKGRID
+		// Tiled terrain has no single grid, so use the QuikGrid converter
+		vtContourConverter cc;
+		if (!cc.Setup(pTerr, pSet))
+			return;
+
+		if (dlg.m_bSingle)
+			cc.GenerateContour(dlg.m_fElevSingle);
+		else
+			cc.GenerateContours(dlg.m_fElevEvery);
+		cc.Finish();
+#else
+		return;
+#endif
+	}
 
 	// show the geometry
 	pTerr->CreateAbstractLayerVisuals(alay);
 
 	// and show it in the layers dialog
 	m_pLayerDlg->RefreshTreeContents();	// full refresh
-#endif
 }
 
 void EnviroFrame::OnUpdateIsDynTerrain(wxUpdateUIEvent& event)
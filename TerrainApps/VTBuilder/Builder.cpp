@@ -18,6 +18,8 @@
 #include "vtdata/DataPath.h"
 #include "vtdata/GDALWrapper.h"
 #include "vtdata/MaterialDescriptor.h"
+#include "vtdata/Parallel.h"
+#include "vtdata/RasterAlgebra.h"
 #include <float.h>	// for FLT_MIN
 
 #include "Builder.h"
@@ -677,6 +679,7 @@ void Builder::SetOptionDefaults()
 	g_Options.SetValueInt(TAG_MAX_MEGAPIXELS, 16, true);
 	g_Options.SetValueBool(TAG_BLACK_TRANSP, false, true);
 	g_Options.SetValueBool(TAG_TIFF_COMPRESS, false, true);
+	g_Options.SetValueString(TAG_TILE_COMPRESSION, "None", true);
 	g_Options.SetValueBool(TAG_DEFAULT_GZIP_BT, false, true);
 	g_Options.SetValueBool(TAG_DELAY_LOAD_GRID, false, true);
 	g_Options.SetValueInt(TAG_MAX_MEM_GRID, 128, true);
@@ -949,6 +952,9 @@ bool Builder::FillElevGaps(vtElevLayer *el, DRECT *area, int iMethod)
 		int result = el->GetGrid()->FillGapsByRegionGrowing(2, 5, progress_callback);
 		bGood = (result != -1);
 	}
+	else if (iMethod == 4)
+		// multigrid
+		bGood = el->GetGrid()->FillGapsMultigrid(area, progress_callback);
 
 	CloseProgressDialog();
 	return bGood;
@@ -976,49 +982,83 @@ void Builder::FlagStickyLayers(const std::vector<vtElevLayer*> &elevs)
 vtElevLayer *Builder::ElevationMath(vtElevLayer *pElev1, vtElevLayer *pElev2,
 									const DRECT &extent, const DPoint2 &spacing, bool plus)
 {
-	// Consider sampling.
-	IPoint2 grid_size;
-	grid_size.x = extent.Width() / spacing.x;
-	grid_size.y = extent.Height() / spacing.y;
+	std::vector<vtElevLayer*> inputs;
+	inputs.push_back(pElev1);
+	inputs.push_back(pElev2);
 
-	vtElevationGrid *grid = new vtElevationGrid;
-	vtElevError err;
-	grid->Create(extent, grid_size, true, m_crs, &err);
+	vtElevLayer *pNewLayer = ElevationExpression(inputs, plus ? "A + B" : "A - B",
+		extent, spacing);
+	if (!pNewLayer)
+		return NULL;
 
-	OpenProgressDialog(_("Comparing Elevation Layers"), _T(""), false);
+	if (plus)
+		pNewLayer->SetLayerFilename(_("sum"));
+	else
+		pNewLayer->SetLayerFilename(_("difference"));
+	return pNewLayer;
+}
 
-	DPoint2 p;
-	for (int j = 0; j < grid_size.y; j++)
-	{
-		UpdateProgressDialog(j * 100 / grid_size.y);
+/**
+ Evaluate a raster algebra expression (see vtRasterExpr::Parse) over any
+ number of elevation layers, to produce a new grid layer.  The layers are
+ named A, B, C.. in the expression, in the order given, and are sampled at
+ the heixels of the new grid.
 
-		for (int i = 0; i < grid_size.x; i++)
+ \return The new layer, or NULL if the expression could not be evaluated,
+	in which case pError receives the reason.
+ */
+vtElevLayer *Builder::ElevationExpression(const std::vector<vtElevLayer*> &inputs,
+	const char *szExpr, const DRECT &extent, const DPoint2 &spacing, vtString *pError)
+{
+	vtRasterAlgebra algebra;
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		vtElevLayer *pEL = inputs[i];
+		if (pEL->IsGrid())
+			algebra.AddInput(pEL->GetGrid());
+		else if (pEL->GetTin())
+		{
+			pEL->SetupTinTriangleBins(50);	// target 50 tris per bin
+			algebra.AddInput(pEL->GetTin());
+		}
+		else
 		{
-			p.Set(extent.left + i * spacing.x, extent.bottom + j * spacing.y);
+			if (pError)
+				pError->Format("Layer %d has no elevation data", (int) i + 1);
+			return NULL;
+		}
+	}
 
-			const float val1 = pElev1->GetElevation(p);
-			const float val2 = pElev2->GetElevation(p);
-			float val;
+	IPoint2 grid_size;
+	grid_size.x = (int) (extent.Width() / spacing.x + 0.5) + 1;
+	grid_size.y = (int) (extent.Height() / spacing.y + 0.5) + 1;
 
-			if (val1 == INVALID_ELEVATION || val2 == INVALID_ELEVATION)
-				val = INVALID_ELEVATION;
-			else
-			{
-				if (plus)
-					val = val1 + val2;
-				else
-					val = val1 - val2;
-			}
-			grid->SetFValue(i, j, val);
-		}
+	vtElevationGrid *grid = new vtElevationGrid;
+	vtElevError err;
+	if (!grid->Create(extent, grid_size, true, m_crs, &err))
+	{
+		if (pError)
+			*pError = err.message;
+		delete grid;
+		return NULL;
 	}
+
+	OpenProgressDialog(_("Evaluating Elevation Expression"), _T(""), false);
+	bool bSuccess = algebra.Evaluate(szExpr, grid, progress_callback);
 	CloseProgressDialog();
 
+	if (!bSuccess)
+	{
+		VTLOG("ElevationExpression '%s' failed: %s\n", szExpr,
+			(const char *) algebra.GetError());
+		if (pError)
+			*pError = algebra.GetError();
+		delete grid;
+		return NULL;
+	}
+
 	vtElevLayer *pNewLayer = new vtElevLayer(grid);
-	if (plus)
-		pNewLayer->SetLayerFilename(_("sum"));
-	else
-		pNewLayer->SetLayerFilename(_("difference"));
+	pNewLayer->SetLayerFilename(_("expression"));
 	AddLayer(pNewLayer);
 	return pNewLayer;
 }
@@ -1571,6 +1611,16 @@ void Builder::AreaSampleImages(BuilderView *pView)
 //////////////////////////
 // Vegetation ops
 
+static int VegIndexSize(vtVegLayer *pLayer)
+{
+	int size = (int) sqrt((double) pLayer->GetFeatureSet()->NumEntities());
+	if (size < 10)
+		size = 10;
+	if (size > 256)
+		size = 256;
+	return size;
+}
+
 /**
  * Generate vegetation in a given area, and writes it to a VF file.
  * All options are given in the VegGenOptions object passed in.
@@ -1592,11 +1642,12 @@ void Builder::GenerateVegetation(const char *vf_file, DRECT area,
 		opt.m_iSingleBiotype = m_BioRegion.AddType(&SingleBiotype);
 	}
 
-	// Create some optimization indices to speed it up
+	// Create some optimization indices to speed it up.  Scale the index
+	//  grid with the number of polygons, so each cell holds only a few.
 	if (opt.m_pBiotypeLayer)
-		opt.m_pBiotypeLayer->CreateIndex(10);
+		opt.m_pBiotypeLayer->CreateIndex(VegIndexSize(opt.m_pBiotypeLayer));
 	if (opt.m_pDensityLayer)
-		opt.m_pDensityLayer->CreateIndex(10);
+		opt.m_pDensityLayer->CreateIndex(VegIndexSize(opt.m_pDensityLayer));
 
 	GenerateVegetationPhase2(vf_file, area, opt);
 
@@ -1617,25 +1668,37 @@ void Builder::GenerateVegetation(const char *vf_file, DRECT area,
 	VTLOG("GenerateVegetation: %.3f seconds.\n", time);
 }
 
+// Vegetation is generated in square tiles of sample points.  Each tile is
+//  independent, with its own random seed and its own running amounts for
+//  each plant density, so the result does not depend on how many threads
+//  are used or the order in which tiles are finished.
+#define VEG_TILE_SAMPLES	64
+
+struct VegTileResult
+{
+	std::vector<DPoint2> m_pos;
+	std::vector<float> m_size;
+	std::vector<short> m_species;
+
+	// for each biotype, for each plant density: amount and number planted
+	std::vector<std::vector<float> > m_amount;
+	std::vector<std::vector<int> > m_planted;
+};
+
 void Builder::GenerateVegetationPhase2(const char *vf_file, DRECT area,
 	VegGenOptions &opt)
 {
 	// Avoid trouble with '.' and ',' in Europe
 	ScopedLocale normal_numbers(LC_NUMERIC, "C");
 
-	uint i, j, k;
-	DPoint2 p, p2;
+	uint i, k;
 
 	uint x_trees = (uint)(area.Width() / opt.m_fSampling);
 	uint y_trees = (uint)(area.Height() / opt.m_fSampling);
 
-	int bio_type=0;
-	float density_scale;
-
 	vtPlantInstanceArray pia;
 	vtPlantDensity *pd;
 	vtBioType *bio;
-	vtPlantSpecies *ps;
 
 	// inherit CRS from the main frame
 	vtCRS crs;
@@ -1645,101 +1708,171 @@ void Builder::GenerateVegetationPhase2(const char *vf_file, DRECT area,
 	m_BioRegion.ResetAmounts();
 	pia.SetSpeciesList(&m_SpeciesList);
 
-	// Iterate over the whole area, creating plant instances
-	for (i = 0; i < x_trees; i ++)
+	const uint num_types = m_BioRegion.m_Types.GetSize();
+	const uint x_tiles = (x_trees + VEG_TILE_SAMPLES - 1) / VEG_TILE_SAMPLES;
+	const uint y_tiles = (y_trees + VEG_TILE_SAMPLES - 1) / VEG_TILE_SAMPLES;
+	std::vector<VegTileResult> results(x_tiles * y_tiles);
+
+	const float square_meters = opt.m_fSampling * opt.m_fSampling;
+
+	auto generate_tile = [&](int tile)
 	{
-		wxString str;
-		str.Printf(_("column %d/%d, plants: %d"), i, x_trees, pia.NumEntities());
-		if (UpdateProgressDialog(i * 100 / x_trees, str))
+		VegTileResult &res = results[tile];
+		vtRandomGen rng(tile + 1);
+
+		// Start each density with a random fraction of a plant, so that the
+		//  leftovers at tile edges don't bias the overall distribution.
+		res.m_amount.resize(num_types);
+		res.m_planted.resize(num_types);
+		for (uint b = 0; b < num_types; b++)
 		{
-			// user cancel
-			CloseProgressDialog();
-			return;
+			const uint num_densities = m_BioRegion.m_Types[b]->m_Densities.GetSize();
+			res.m_amount[b].resize(num_densities);
+			res.m_planted[b].resize(num_densities, 0);
+			for (uint d = 0; d < num_densities; d++)
+				res.m_amount[b][d] = rng.Random(1.0f);
 		}
 
-		p.x = area.left + (i * opt.m_fSampling);
-		for (j = 0; j < y_trees; j ++)
-		{
-			p.y = area.bottom + (j * opt.m_fSampling);
+		// Search hints, so each thread can use the polygon indices
+		int iDensityHint = -1, iBiotypeHint = -1;
 
-			// randomize the position slightly
-			p2.x = p.x + random_offset(opt.m_fSampling * 0.5f);
-			p2.y = p.y + random_offset(opt.m_fSampling * 0.5f);
+		const uint i1 = (tile % x_tiles) * VEG_TILE_SAMPLES;
+		const uint j1 = (tile / x_tiles) * VEG_TILE_SAMPLES;
+		const uint i2 = std::min(i1 + VEG_TILE_SAMPLES, x_trees);
+		const uint j2 = std::min(j1 + VEG_TILE_SAMPLES, y_trees);
+		DPoint2 p, p2;
 
-			// Density
-			if (opt.m_pDensityLayer)
+		for (uint ti = i1; ti < i2; ti++)
+		{
+			p.x = area.left + (ti * opt.m_fSampling);
+			for (uint tj = j1; tj < j2; tj++)
 			{
-				density_scale = opt.m_pDensityLayer->FindDensity(p2);
-				if (density_scale <= 0.0f)
-					continue;
-			}
-			else
-				density_scale = 1.0f;
+				p.y = area.bottom + (tj * opt.m_fSampling);
 
-			// Species
-			if (opt.m_iSingleSpecies != -1)
-			{
-				// use our single species biotype
-				bio_type = opt.m_iSingleBiotype;
-			}
-			else
-			{
-				if (opt.m_iSingleBiotype != -1)
+				// randomize the position slightly
+				p2.x = p.x + rng.RandomOffset(opt.m_fSampling * 0.5f);
+				p2.y = p.y + rng.RandomOffset(opt.m_fSampling * 0.5f);
+
+				// Density
+				float density_scale;
+				if (opt.m_pDensityLayer)
 				{
+					density_scale = opt.m_pDensityLayer->FindDensity(p2, iDensityHint);
+					if (density_scale <= 0.0f)
+						continue;
+				}
+				else
+					density_scale = 1.0f;
+
+				// Species
+				int bio_type = 0;
+				if (opt.m_iSingleSpecies != -1)
+				{
+					// use our single species biotype
 					bio_type = opt.m_iSingleBiotype;
 				}
-				else if (opt.m_pBiotypeLayer != NULL)
+				else
 				{
-					bio_type = opt.m_pBiotypeLayer->FindBiotype(p2);
-					if (bio_type == -1)
-						continue;
+					if (opt.m_iSingleBiotype != -1)
+					{
+						bio_type = opt.m_iSingleBiotype;
+					}
+					else if (opt.m_pBiotypeLayer != NULL)
+					{
+						bio_type = opt.m_pBiotypeLayer->FindBiotype(p2, iBiotypeHint);
+						if (bio_type < 0 || bio_type >= (int) num_types)
+							continue;
+					}
 				}
-			}
-			// look at veg_type to decide which BioType to use
-			bio = m_BioRegion.m_Types[bio_type];
+				// look at veg_type to decide which BioType to use
+				const vtBioType *tile_bio = m_BioRegion.m_Types[bio_type];
+				std::vector<float> &amount = res.m_amount[bio_type];
 
-			float square_meters = opt.m_fSampling * opt.m_fSampling;
-			float factor = density_scale * square_meters * opt.m_fScarcity;
+				float factor = density_scale * square_meters * opt.m_fScarcity;
 
-			// the amount of each species present accumulates until it
-			//  exceeds 1, at which time we produce a plant instance
-			for (k = 0; k < bio->m_Densities.GetSize(); k++)
-			{
-				pd = bio->m_Densities[k];
+				// the amount of each species present accumulates until it
+				//  exceeds 1, at which time we produce a plant instance
+				const uint num_densities = tile_bio->m_Densities.GetSize();
+				for (uint d = 0; d < num_densities; d++)
+					amount[d] += (tile_bio->m_Densities[d]->m_plant_per_m2 * factor);
 
-				pd->m_amount += (pd->m_plant_per_m2 * factor);
-			}
+				vtPlantSpecies *ps = NULL;
+				for (uint d = 0; d < num_densities; d++)
+				{
+					if (amount[d] > 1.0f)	// time to plant
+					{
+						amount[d] -= 1.0f;
+						res.m_planted[bio_type][d]++;
+						ps = tile_bio->m_Densities[d]->m_pSpecies;
+						break;
+					}
+				}
+				if (ps == NULL)
+					continue;
 
-			ps = NULL;
-			for (k = 0; k < bio->m_Densities.GetSize(); k++)
-			{
-				pd = bio->m_Densities[k];
-				if (pd->m_amount > 1.0f)	// time to plant
+				short species_id = m_SpeciesList.FindSpeciesId(ps);
+				if (species_id == -1)
+					continue;
+
+				// Now determine size
+				float size;
+				if (opt.m_fFixedSize != -1.0f)
 				{
-					pd->m_amount -= 1.0f;
-					pd->m_iNumPlanted++;
-					ps = pd->m_pSpecies;
-					break;
+					size = opt.m_fFixedSize;
 				}
+				else
+				{
+					float range = opt.m_fRandomTo - opt.m_fRandomFrom;
+					size = (opt.m_fRandomFrom + rng.Random(range)) * ps->GetMaxHeight();
+				}
+				res.m_pos.push_back(p2);
+				res.m_size.push_back(size);
+				res.m_species.push_back(species_id);
 			}
-			if (ps == NULL)
-				continue;
+		}
+	};
 
-			// Now determine size
-			float size;
-			if (opt.m_fFixedSize != -1.0f)
-			{
-				size = opt.m_fFixedSize;
-			}
-			else
+	VTLOG("GenerateVegetation: %d x %d samples in %d tiles, %d threads\n",
+		x_trees, y_trees, (int) results.size(), vtGetNumThreads());
+	if (!vtParallelFor((int) results.size(), generate_tile, progress_callback))
+	{
+		// user cancel
+		CloseProgressDialog();
+		return;
+	}
+
+	// Gather the results, in tile order, into one instance array which is
+	//  allocated just once.
+	uint total = 0;
+	for (i = 0; i < results.size(); i++)
+		total += results[i].m_pos.size();
+	pia.SetNumEntities(total);
+
+	uint index = 0;
+	for (i = 0; i < results.size(); i++)
+	{
+		VegTileResult &res = results[i];
+		for (k = 0; k < res.m_pos.size(); k++, index++)
+		{
+			pia.SetPoint(index, res.m_pos[k]);
+			pia.SetPlant(index, res.m_size[k], res.m_species[k]);
+		}
+		for (uint b = 0; b < num_types; b++)
+		{
+			bio = m_BioRegion.m_Types[b];
+			for (uint d = 0; d < bio->m_Densities.GetSize(); d++)
 			{
-				float range = opt.m_fRandomTo - opt.m_fRandomFrom;
-				size = (opt.m_fRandomFrom + random(range)) * ps->GetMaxHeight();
-			}
+				pd = bio->m_Densities[d];
+				pd->m_iNumPlanted += res.m_planted[b][d];
 
-			// Finally, add the plant
-			pia.AddPlant(p2, size, ps);
+				// Whole plants left over could not be placed
+				pd->m_amount += (int) res.m_amount[b][d];
+			}
 		}
+		// free as we go
+		std::vector<DPoint2>().swap(res.m_pos);
+		std::vector<float>().swap(res.m_size);
+		std::vector<short>().swap(res.m_species);
 	}
 	pia.WriteVF(vf_file);
 	CloseProgressDialog();
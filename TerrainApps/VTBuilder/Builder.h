@@ -148,6 +148,9 @@ public:
 	void FlagStickyLayers(const std::vector<vtElevLayer*> &elevs);
 	vtElevLayer *ElevationMath(vtElevLayer *pElev1, vtElevLayer *pElev2,
 							   const DRECT &extent, const DPoint2 &spacing, bool plus);
+	vtElevLayer *ElevationExpression(const std::vector<vtElevLayer*> &inputs,
+		const char *szExpr, const DRECT &extent, const DPoint2 &spacing,
+		vtString *pError = NULL);
 	void CarveWithCulture(class vtElevLayer *pElev, float margin);
 
 	// Images
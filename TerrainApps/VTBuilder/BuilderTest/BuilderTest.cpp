@@ -211,7 +211,7 @@ void TestDEMToTileset(Builder &bld)
 	tileopts.draw.m_fAmbient = 0.2f;
 	tileopts.bOmitFlatTiles = false;
 	tileopts.bUseTextureCompression = true;
-	tileopts.eCompressionType = TC_SQUISH_FAST;		// Must be Squish; no OpenGL.
+	tileopts.eCompressionType = TC_DXT_FAST;		// Must be done on the CPU; no OpenGL.
 	tileopts.iNoDataFilled = 0;
 
 	// Now start the sampling
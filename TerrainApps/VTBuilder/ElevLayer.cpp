@@ -18,11 +18,13 @@
 #include "vtdata/ElevationGrid.h"
 #include "vtdata/FileFilters.h"
 #include "vtdata/FilePath.h"
+#include "vtdata/Unarchive.h"
 #include "vtdata/vtDIB.h"
 #include "vtdata/vtLog.h"
 #include "vtui/Helper.h"	// for FormatCoord
 
 #include "minidata/LocalDatabuf.h"
+#include "minidata/TileCodec.h"
 
 #include "Builder.h"
 #include "BuilderView.h"	// For grid marks
@@ -725,11 +727,18 @@ bool vtElevLayer::ImportFromFile(const wxString &strFileName,
 		strExt = dropped.AfterLast('.');
 	}
 
+	// A file inside an archive can only be read in place by GDAL
+	const bool bInArchive = vtArchive::IsVirtualPath(fname);
+
 	// The first character in the file is useful for telling which format
 	// the file really is.
-	FILE *fp = vtFileOpen(fname, "rb");
-	char first = fgetc(fp);
-	fclose(fp);
+	char first = 0;
+	FILE *fp = bInArchive ? NULL : vtFileOpen(fname, "rb");
+	if (fp)
+	{
+		first = fgetc(fp);
+		fclose(fp);
+	}
 
 	bool success = false;
 
@@ -762,7 +771,12 @@ bool vtElevLayer::ImportFromFile(const wxString &strFileName,
 			m_pGrid = new vtElevationGrid;
 	}
 
-	if (!strExt.CmpNoCase(_T("3tx")))
+	if (bInArchive)
+	{
+		if (m_pGrid)
+			success = m_pGrid->LoadWithGDAL(fname, progress_callback, err);
+	}
+	else if (!strExt.CmpNoCase(_T("3tx")))
 	{
 		success = m_pGrid->LoadFrom3TX(fname, progress_callback);
 	}
@@ -1427,6 +1441,9 @@ bool vtElevLayer::WriteElevationTileset(TilingOptions &opts, BuilderView *pView)
 	bool bFloat = m_pGrid->IsFloatMode();
 	bool bJPEG = (opts.bUseTextureCompression && opts.eCompressionType == TC_JPEG);
 
+	// The elevation tiles of each row are encoded and written together
+	vtTileCodec codec(opts.eElevCompression);
+
 	int i, j, lod;
 	int total = opts.rows * opts.cols, done = 0;
 	for (j = 0; j < opts.rows; j++)
@@ -1514,6 +1531,8 @@ bool vtElevLayer::WriteElevationTileset(TilingOptions &opts, BuilderView *pView)
 					bGood = base_lod.FillGapsSmooth(NULL, progress_callback_minor);
 				else if (method == 3)
 					bGood = (base_lod.FillGapsByRegionGrowing(2, 5, progress_callback_minor) != -1);
+				else if (method == 4)
+					bGood = base_lod.FillGapsMultigrid(NULL, progress_callback_minor);
 				if (!bGood)
 					return false;
 
@@ -1642,17 +1661,17 @@ bool vtElevLayer::WriteElevationTileset(TilingOptions &opts, BuilderView *pView)
 						}
 					}
 				}
-				if (buf.savedata(fname) == 0)
-				{
-					// what should we do if writing a tile fails?
-				}
+				codec.AddTile(buf, fname);
 			}
 		}
+		if (!codec.WriteTiles())
+			VTLOG("  %d tiles could not be written.\n", codec.NumFailed());
 	}
 
 	// Write .ini file
 	if (!WriteTilesetHeader(opts.fname, opts.cols, opts.rows, opts.lod0size,
-		area, crs, minheight, maxheight, &lod_existence_map, false))
+		area, crs, minheight, maxheight, &lod_existence_map, false,
+		opts.eElevCompression))
 	{
 		vtDestroyDir(dirname);
 		return false;
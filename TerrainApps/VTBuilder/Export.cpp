@@ -40,6 +40,7 @@
 #include "TileDlg.h"
 
 #include "minidata/LocalDatabuf.h"
+#include "minidata/TileCodec.h"
 
 #if USE_OPENGL
 	#include "wx/glcanvas.h"	// needed for writing pre-compressed textures
@@ -115,7 +116,8 @@ void Builder::ExportTIN()
 	const vtString fname = GetActiveLayer()->GetExportFilename(FSTRING_TIN);
 	if (fname == "")
 		return;
-	vtTin2d *tin = new vtTin2d(GetActiveElevLayer()->GetGrid());
+	// Match the grid exactly, but merge triangles where it is planar
+	vtTin2d *tin = new vtTin2d(GetActiveElevLayer()->GetGrid(), 0.0f);
 	bool success = tin->Write(fname);
 	if (success)
 		DisplayAndLog("Successfully wrote file '%s'", (const char *) fname);
@@ -380,6 +382,9 @@ void Builder::ElevExportTiles(BuilderView *pView)
 	else
 		tileopts.bCreateDerivedImages = false;
 
+	tileopts.eElevCompression =
+		TileCompressionFromName(g_Options.GetValueString(TAG_TILE_COMPRESSION));
+
 	OpenProgressDialog2(_("Writing tiles"), true);
 	bool success = pEL->WriteElevationTileset(tileopts, pView);
 	if (pView)
@@ -614,6 +619,9 @@ void Builder::AreaSampleElevTileset(BuilderView *pView)
 	else
 		m_tileopts.bCreateDerivedImages = false;
 
+	m_tileopts.eElevCompression =
+		TileCompressionFromName(g_Options.GetValueString(TAG_TILE_COMPRESSION));
+
 	bool success = DoSampleElevationToTileset(pView, m_tileopts, bFloat);
 	if (success)
 		DisplayAndLog("Successfully wrote to '%s'", (const char *) m_tileopts.fname);
@@ -779,6 +787,9 @@ bool Builder::SampleElevationToTileset(BuilderView *pView, TilingOptions &opts,
 	// Time the operation
 	clock_t tm1 = clock();
 
+	// The elevation tiles of each row are encoded and written together
+	vtTileCodec codec(opts.eElevCompression);
+
 	int total = opts.rows * opts.cols, done = 0;
 	bool bCancelled = false;
 	for (int j = 0; j < opts.rows && !bCancelled; j++)
@@ -933,6 +944,8 @@ bool Builder::SampleElevationToTileset(BuilderView *pView, TilingOptions &opts,
 					bGood = base_lod.FillGapsSmooth(NULL, progress_callback_minor);
 				else if (method == 3)
 					bGood = (base_lod.FillGapsByRegionGrowing(2, 5, progress_callback_minor) != -1);
+				else if (method == 4)
+					bGood = base_lod.FillGapsMultigrid(NULL, progress_callback_minor);
 				if (!bGood)
 				{
 					bCancelled = true;
@@ -1070,17 +1083,16 @@ bool Builder::SampleElevationToTileset(BuilderView *pView, TilingOptions &opts,
 				}
 
 #if USE_LIBMINI_DATABUF
-				bool saveasPNG=false;
 				// libMini can't handle utf8
-				vtString fname_local = UTF8ToLocal(fname);
-				buf.savedata(fname_local, saveasPNG?2:0); // external format 2=PNG
+				codec.AddTile(buf, UTF8ToLocal(fname));
 #else
 				buf.savedata(fname);
-#endif
-
 				buf.release();
+#endif
 			}
 		}
+		if (!bCancelled && !codec.WriteTiles())
+			VTLOG("  %d tiles could not be written.\n", codec.NumFailed());
 	}
 
 #if USE_OPENGL
@@ -1093,7 +1105,8 @@ bool Builder::SampleElevationToTileset(BuilderView *pView, TilingOptions &opts,
 
 	// Write .ini file
 	if (!WriteTilesetHeader(opts.fname, opts.cols, opts.rows, opts.lod0size,
-		m_area, m_crs, minheight, maxheight, &lod_existence_map, false))
+		m_area, m_crs, minheight, maxheight, &lod_existence_map, false,
+		opts.eElevCompression))
 	{
 		vtDestroyDir(dirname);
 		return false;
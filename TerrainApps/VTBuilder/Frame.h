@@ -178,10 +178,12 @@ protected:
 	void OnElevSelect(wxCommandEvent& event);
 	void OnElevRemoveRange(wxCommandEvent& event);
 	void OnElevArithmetic(wxCommandEvent& event);
+	void OnElevExpression(wxCommandEvent& event);
 	void OnElevSetUnknown(wxCommandEvent& event);
 	void OnFillFast(wxCommandEvent& event);
 	void OnFillSlow(wxCommandEvent& event);
 	void OnFillRegions(wxCommandEvent& event);
+	void OnFillMultigrid(wxCommandEvent& event);
 	void OnElevScale(wxCommandEvent& event);
 	void OnElevVertOffset(wxCommandEvent& event);
 	void OnElevExport(wxCommandEvent& event);
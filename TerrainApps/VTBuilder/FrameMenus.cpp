@@ -19,11 +19,11 @@
 
 #include "vtdata/config_vtdata.h"
 #include "vtdata/ChunkLOD.h"
+#include "vtdata/ContourGenerator.h"
 #include "vtdata/DataPath.h"
 #include "vtdata/ElevationGrid.h"
 #include "vtdata/FileFilters.h"
 #include "vtdata/Icosa.h"
-#include "vtdata/QuikGrid.h"
 #include "vtdata/TripDub.h"
 #include "vtdata/Version.h"
 #include "vtdata/vtDIB.h"
@@ -181,10 +181,12 @@ EVT_UPDATE_UI(ID_ROAD_SHOWNODES,	MainFrame::OnUpdateRoadShowNodes)
 EVT_MENU(ID_ELEV_SELECT,			MainFrame::OnElevSelect)
 EVT_MENU(ID_ELEV_REMOVERANGE,		MainFrame::OnElevRemoveRange)
 EVT_MENU(ID_ELEV_ARITHMETIC,		MainFrame::OnElevArithmetic)
+EVT_MENU(ID_ELEV_EXPRESSION,		MainFrame::OnElevExpression)
 EVT_MENU(ID_ELEV_SETUNKNOWN,		MainFrame::OnElevSetUnknown)
 EVT_MENU(ID_ELEV_FILL_FAST,			MainFrame::OnFillFast)
 EVT_MENU(ID_ELEV_FILL_SLOW,			MainFrame::OnFillSlow)
 EVT_MENU(ID_ELEV_FILL_REGIONS,		MainFrame::OnFillRegions)
+EVT_MENU(ID_ELEV_FILL_MULTIGRID,	MainFrame::OnFillMultigrid)
 EVT_MENU(ID_ELEV_SCALE,				MainFrame::OnElevScale)
 EVT_MENU(ID_ELEV_VERT_OFFSET,		MainFrame::OnElevVertOffset)
 EVT_MENU(ID_ELEV_EXPORT,			MainFrame::OnElevExport)
@@ -201,10 +203,12 @@ EVT_MENU(ID_ELEV_TRIMTIN,			MainFrame::OnElevTrimTin)
 EVT_UPDATE_UI(ID_ELEV_SELECT,		MainFrame::OnUpdateElevSelect)
 EVT_UPDATE_UI(ID_ELEV_REMOVERANGE,	MainFrame::OnUpdateIsGrid)
 EVT_UPDATE_UI(ID_ELEV_ARITHMETIC,	MainFrame::OnUpdateArithmetic)
+EVT_UPDATE_UI(ID_ELEV_EXPRESSION,	MainFrame::OnUpdateIsElevation)
 EVT_UPDATE_UI(ID_ELEV_SETUNKNOWN,	MainFrame::OnUpdateIsGrid)
 EVT_UPDATE_UI(ID_ELEV_FILL_FAST,	MainFrame::OnUpdateIsGrid)
 EVT_UPDATE_UI(ID_ELEV_FILL_SLOW,	MainFrame::OnUpdateIsGrid)
 EVT_UPDATE_UI(ID_ELEV_FILL_REGIONS,	MainFrame::OnUpdateIsGrid)
+EVT_UPDATE_UI(ID_ELEV_FILL_MULTIGRID,	MainFrame::OnUpdateIsGrid)
 EVT_UPDATE_UI(ID_ELEV_SCALE,		MainFrame::OnUpdateIsElevation)
 EVT_UPDATE_UI(ID_ELEV_VERT_OFFSET,	MainFrame::OnUpdateIsElevation)
 EVT_UPDATE_UI(ID_ELEV_EXPORT,		MainFrame::OnUpdateIsElevation)
@@ -518,11 +522,13 @@ void MainFrame::CreateMenus()
 	elevMenu->Append(ID_ELEV_VERT_OFFSET, _("Offset Elevation Vertically"));
 	elevMenu->Append(ID_ELEV_REMOVERANGE, _("&Remove Elevation Range..."));
 	elevMenu->Append(ID_ELEV_ARITHMETIC, _("&Create Layer from Arithmetic"));
+	elevMenu->Append(ID_ELEV_EXPRESSION, _("Create Layer from &Expression..."));
 
 	wxMenu *fillMenu = new wxMenu;
 	fillMenu->Append(ID_ELEV_FILL_FAST, _("Fast"));
 	fillMenu->Append(ID_ELEV_FILL_SLOW, _("Slow and smooth"));
 	fillMenu->Append(ID_ELEV_FILL_REGIONS, _("Extrapolation via partial derivatives"));
+	fillMenu->Append(ID_ELEV_FILL_MULTIGRID, _("Multigrid (fast and smooth)"));
 
 	elevMenu->Append(0, _("&Fill In Unknown Areas"), fillMenu);
 
@@ -753,6 +759,7 @@ void MainFrame::OnProjectPrefs(wxCommandEvent &event)
 	dlg.b9 =  (g_Options.GetValueInt(TAG_GAP_FILL_METHOD) == 1);
 	dlg.b10 = (g_Options.GetValueInt(TAG_GAP_FILL_METHOD) == 2);
 	dlg.b11 = (g_Options.GetValueInt(TAG_GAP_FILL_METHOD) == 3);
+	dlg.b16 = (g_Options.GetValueInt(TAG_GAP_FILL_METHOD) == 4);
 
 	dlg.b12 = g_Options.GetValueBool(TAG_BLACK_TRANSP);
 	dlg.b13 = g_Options.GetValueBool(TAG_TIFF_COMPRESS);
@@ -779,6 +786,7 @@ void MainFrame::OnProjectPrefs(wxCommandEvent &event)
 		if (dlg.b9)  g_Options.SetValueInt(TAG_GAP_FILL_METHOD, 1);
 		if (dlg.b10) g_Options.SetValueInt(TAG_GAP_FILL_METHOD, 2);
 		if (dlg.b11) g_Options.SetValueInt(TAG_GAP_FILL_METHOD, 3);
+		if (dlg.b16) g_Options.SetValueInt(TAG_GAP_FILL_METHOD, 4);
 
 		g_Options.SetValueBool(TAG_BLACK_TRANSP, dlg.b12);
 		g_Options.SetValueBool(TAG_TIFF_COMPRESS, dlg.b13);
@@ -2030,6 +2038,63 @@ void MainFrame::OnElevArithmetic(wxCommandEvent &event)
 	}
 }
 
+void MainFrame::OnElevExpression(wxCommandEvent &event)
+{
+	std::vector<vtElevLayer*> elevs;
+	const uint num = ElevLayerArray(elevs);
+	if (num > 26)
+		elevs.resize(26);
+
+	// The layers are named by letter in the expression
+	wxString msg = _("Expression, using these layers:\n");
+	DRECT extent, layer_extent;
+	extent.SetInsideOut();
+	DPoint2 spacing(0, 0);
+	for (uint i = 0; i < elevs.size(); i++)
+	{
+		msg += wxString::Format(_T("  %c: "), (char) ('A' + i));
+		msg += StartOfFilenameWX(elevs[i]->GetLayerFilename());
+		msg += _T("\n");
+
+		elevs[i]->GetExtent(layer_extent);
+		extent.GrowToContainRect(layer_extent);
+
+		// Use the finest spacing of any of the grids
+		if (elevs[i]->IsGrid())
+		{
+			const DPoint2 &s = elevs[i]->GetGrid()->GetSpacing();
+			if (spacing.x == 0 || s.x < spacing.x) spacing.x = s.x;
+			if (spacing.y == 0 || s.y < spacing.y) spacing.y = s.y;
+		}
+	}
+	msg += _("For example: max(A, B) - 10, or if(slope(A) > 30, A, nodata)\n");
+	msg += _("The area tool, if it is defined, limits the result.");
+
+	static wxString str = _T("A - B");
+	str = wxGetTextFromUser(msg, _("Create Layer from Expression"), str, this);
+	if (str == _T(""))
+		return;
+
+	if (!m_area.IsEmpty())
+		extent = m_area;
+	if (spacing.x == 0)
+		spacing.Set(extent.Width() / 1023, extent.Height() / 1023);
+
+	vtString err;
+	vtElevLayer *result = ElevationExpression(elevs, str.mb_str(wxConvUTF8),
+		extent, spacing, &err);
+	if (!result)
+	{
+		wxMessageBox(wxString(err, wxConvUTF8), _("Error"));
+		return;
+	}
+	SetActiveLayer(result);
+	m_pView->SetActiveLayer(result);
+	RefreshTreeView();
+	RefreshToolbars();
+	RefreshView();
+}
+
 void MainFrame::OnElevSetUnknown(wxCommandEvent &event)
 {
 	vtElevLayer *t = GetActiveElevLayer();
@@ -2084,6 +2149,11 @@ void MainFrame::OnFillRegions(wxCommandEvent &event)
 	OnFillIn(3);
 }
 
+void MainFrame::OnFillMultigrid(wxCommandEvent &event)
+{
+	OnFillIn(4);
+}
+
 void MainFrame::OnElevScale(wxCommandEvent &event)
 {
 	vtElevLayer *el = GetActiveElevLayer();
@@ -2309,7 +2379,15 @@ void MainFrame::OnElevToTin(wxCommandEvent& event)
 	vtElevLayer *pEL1 = GetActiveElevLayer();
 	vtElevationGrid *grid = pEL1->GetGrid();
 
-	vtTin2d *tin = new vtTin2d(grid);
+	wxString str = wxGetTextFromUser(_("Maximum vertical error, in meters?\n(Use 0 to match every heixel exactly)"),
+		_("Convert Grid to TIN"), _T("1"), this);
+	if (str == _T(""))
+		return;
+	const float fMaxError = atof(str.mb_str(wxConvUTF8));
+
+	OpenProgressDialog(_("Creating TIN"), _T(""), false, this);
+	vtTin2d *tin = new vtTin2d(grid, fMaxError, 0, progress_callback);
+	CloseProgressDialog();
 	vtElevLayer *pEL = new vtElevLayer;
 	pEL->SetTin(tin);
 
@@ -2335,7 +2413,6 @@ void MainFrame::OnElevContours(wxCommandEvent& event)
 	VTLOG("OnElevContours: using grid of size %d x %d, spacing %lf * %lf\n",
 		size.x, size.y, grid->GetSpacing().x, grid->GetSpacing().y);
 
-#if SUPPORT_QUIKGRID
 	ContourDlg dlg(this, -1, _("Add Contours"));
 
 	// Put any existing raw polyline layers in the drop-down choice
@@ -2384,17 +2461,14 @@ void MainFrame::OnElevContours(wxCommandEvent& event)
 
 	vtFeatureSetLineString *fsls = (vtFeatureSetLineString *) raw->GetFeatureSet();
 
-	VTLOG1(" Setting up ContourConverter\n");
-	ContourConverter cc;
-	if (!cc.Setup(grid, fsls))
-		return;
-
-	VTLOG1(" GenerateContour\n");
+	VTLOG1(" Generating contours\n");
+	OpenProgressDialog(_("Generating Contours"), _T(""), false, this);
+	vtContourGenerator gen;
 	if (dlg.m_bSingle)
-		cc.GenerateContour(dlg.m_fElevSingle);
+		gen.GenerateContour(grid, dlg.m_fElevSingle, fsls, progress_callback);
 	else
-		cc.GenerateContours(dlg.m_fElevEvery);
-	cc.Finish();
+		gen.GenerateContours(grid, dlg.m_fElevEvery, fsls, progress_callback);
+	CloseProgressDialog();
 
 	// The contour generator tends to make a lot of extra points. Clean them up.
 	// Use an epsilon based on the grid's spacing; anything smaller than that is
@@ -2405,7 +2479,6 @@ void MainFrame::OnElevContours(wxCommandEvent& event)
 	VTLOG(" Removed %d points, done\n", removed);
 
 	m_pView->Refresh();
-#endif // SUPPORT_QUIKGRID
 }
 
 void MainFrame::OnElevCarve(wxCommandEvent &event)
@@ -3252,7 +3325,7 @@ void MainFrame::OnStructureSelectUsingPolygons(wxCommandEvent &event)
 					if (pFeatureSetPolygon->IsSelected(iIndex))
 					{
 						uint iIndex2;
-						const DPolygon2 Polygon = pFeatureSetPolygon->GetPolygon(iIndex);
+						const DPolygon2View Polygon = pFeatureSetPolygon->GetPolygonView(iIndex);
 						uint iNumStructures = pStructureLayer->size();
 						for (iIndex2 = 0; iIndex2 < iNumStructures; iIndex2++)
 						{
@@ -3708,12 +3781,13 @@ void MainFrame::OnRawConvertToPolygons(wxCommandEvent& event)
 
 		for (uint i = 0; i < setls2->NumEntities(); i++)
 		{
-			const DLine2 &polyline = setls2->GetPolyLine(i);
+			const DLine2View polyline = setls2->GetPolyLineView(i);
 			int npoints = polyline.GetSize();
 			if (polyline[0] == polyline[npoints-1])
 			{
 				DPolygon2 dpoly;
-				dpoly.push_back(polyline);
+				dpoly.resize(1);
+				polyline.ToDLine2(dpoly[0]);
 
 				// Omit the first/last point (duplicate)
 				dpoly[0].RemoveAt(npoints-1);
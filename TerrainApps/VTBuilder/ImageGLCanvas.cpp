@@ -13,18 +13,11 @@
 
 #include "Builder.h"
 #include "ImageGLCanvas.h"
+#include "vtdata/DxtCompressor.h"
 #include "vtdata/vtLog.h"
 #include "minidata/LocalDatabuf.h"
 #include "TilingOptions.h"
 
-#if SUPPORT_SQUISH
-#include "squish.h"
-#ifdef _MSC_VER
-	#pragma message( "Adding link with squish.lib" )
-	#pragma comment( lib, "squish.lib" )
-#endif
-#endif
-
 void WriteMiniImage(const vtString &fname, const TilingOptions &opts,
 					uchar *rgb_bytes, vtMiniDatabuf &output_buf,
 					int iUncompressedSize, ImageGLCanvas *pCanvas)
@@ -52,14 +45,13 @@ void WriteMiniImage(const vtString &fname, const TilingOptions &opts,
 				pCanvas->Refresh(false);
 #endif
 		}
-		else if (opts.eCompressionType == TC_SQUISH_FAST ||
-			opts.eCompressionType == TC_SQUISH_SLOW)
+		else if (opts.eCompressionType == TC_DXT_FAST ||
+			opts.eCompressionType == TC_DXT_HIGH)
 		{
-#if SUPPORT_SQUISH
-			DoTextureSquish(rgb_bytes, output_buf, opts.eCompressionType == TC_SQUISH_FAST);
+			DoTextureDxt(rgb_bytes, output_buf, opts.eCompressionType == TC_DXT_HIGH,
+				opts.bImageAlpha);
 			output_buf.savedata(fname);
 			output_buf.release();
-#endif
 		}
 		else if (opts.eCompressionType == TC_JPEG)
 		{
@@ -95,26 +87,10 @@ void WriteMiniImage(const vtString &fname, const TilingOptions &opts,
 void CheckCompressionMethod(TilingOptions &opts)
 {
 #if !USE_OPENGL
-	// Check if they asked for OpenGL, but it's not available
+	// Check if they asked for OpenGL, but it's not available; the CPU
+	//  produces the same format.
 	if (opts.eCompressionType == TC_OPENGL)
-	{
-#if SUPPORT_SQUISH
-		opts.eCompressionType = TC_SQUISH_FAST;
-#else
-		opts.bUseTextureCompression = false;
-#endif
-	}
-#endif
-#if !SUPPORT_SQUISH
-	// Check if they asked for Squish, but it's not available
-	if (opts.eCompressionType == TC_SQUISH_FAST || opts.eCompressionType == TC_SQUISH_SLOW)
-	{
-#if USE_OPENGL
-		opts.eCompressionType = TC_OPENGL;
-#else
-		opts.bUseTextureCompression = false;
-#endif
-	}
+		opts.eCompressionType = TC_DXT_FAST;
 #endif
 }
 
@@ -319,65 +295,22 @@ void ImageGLCanvas::OnSize(wxSizeEvent& event)
 
 
 ///////////////////////////////////////////////////////////////////////
-// As an alternative to using OpenGL for texture compression, use the
-//  Squish library if available.
+// As an alternative to using OpenGL for texture compression, which needs
+//  a window and a context, compress on the CPU.
 //
-#if SUPPORT_SQUISH
-using namespace squish;
-
-void DoTextureSquish(uchar *rgb_bytes, vtMiniDatabuf &output_buf, bool bFast)
+void DoTextureDxt(uchar *rgb_bytes, vtMiniDatabuf &output_buf, bool bHighQuality,
+				  bool bAlpha)
 {
-	int flags = kDxt1;
-
-	if (bFast)
-	{
-		//! Use a fast but low quality colour compressor.
-		flags |= kColourRangeFit;
-	}
-	else
-	{
-		//! Use a slow but very high quality colour compressor.
-		flags |= kColourClusterFit;
-	}
-
-	int bytesPerBlock = ( ( flags & kDxt1 ) != 0 ) ? 8 : 16;
-	int targetDataSize = bytesPerBlock*output_buf.xsize*output_buf.ysize/16;
-	int stride = output_buf.xsize * 3;
-
-	output_buf.type = 5;	// compressed RGB
-	output_buf.bytes = targetDataSize;
-	output_buf.data = malloc(targetDataSize);
-
-	// loop over blocks and compress them
-	u8* targetBlock = (u8 *) output_buf.data;
-	for( uint y = 0; y < output_buf.ysize; y += 4 )
-	{
-		// process a row of blocks
-		for( uint x = 0; x < output_buf.xsize; x += 4 )
-		{
-			// get the block data
-			u8 sourceRgba[16*4];
-
-			for( int py = 0, i = 0; py < 4; ++py )
-			{
-				u8 const *row = rgb_bytes + (y + py)*stride + (x*3);
-				for( int px = 0; px < 4; ++px, ++i )
-				{
-					// get the pixel colour
-					for( int j = 0; j < 3; ++j )
-						sourceRgba[4*i + j] = *row++;
-
-					// skip alpha for now
-					sourceRgba[4*i + 3] = 255;
-				}
-			}
-
-			// compress this block
-			Compress( sourceRgba, targetBlock, flags );
-
-			// advance
-			targetBlock += bytesPerBlock;
-		}
-	}
+	// libMini's compressed RGBA is DXT1 with 1-bit alpha, like OpenGL's
+	vtDxtCompressor dxt(bAlpha ? vtDxtCompressor::BC1A : vtDxtCompressor::BC1,
+		bHighQuality);
+	const int components = bAlpha ? 4 : 3;
+	const size_t size = dxt.CompressedSize(output_buf.xsize, output_buf.ysize);
+
+	output_buf.type = bAlpha ? 6 : 5;	// compressed RGBA or RGB
+	output_buf.bytes = (uint) size;
+	output_buf.data = malloc(size);
+
+	dxt.Compress(rgb_bytes, output_buf.xsize, output_buf.ysize, components,
+		output_buf.xsize * components, (uchar *) output_buf.data);
 }
-#endif	// SUPPORT_SQUISH
@@ -52,6 +52,5 @@ protected:
 
 #endif	// USE_OPENGL
 
-#if SUPPORT_SQUISH
-void DoTextureSquish(uchar *rgb_bytes, vtMiniDatabuf &output_buf, bool bFast);
-#endif
+void DoTextureDxt(uchar *rgb_bytes, vtMiniDatabuf &output_buf, bool bHighQuality,
+				  bool bAlpha);
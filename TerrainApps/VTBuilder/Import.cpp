@@ -79,6 +79,172 @@ wxString GetTempFolderName(const char *base)
 	return wxString(path, wxConvUTF8);
 }
 
+// The extensions of files which are read through GDAL, hence can be read
+//  in place from inside an archive.
+static const char *s_InPlaceExtensions[] = {
+	"asc", "bil", "bt", "dem", "dt0", "dt1", "dt2", "dte", "ecw", "hgt",
+	"img", "jp2", "jpg", "png", "ter", "tif", "tiff", NULL
+};
+
+static bool CanReadInPlace(const vtString &fname)
+{
+	vtString ext = GetExtension(fname, false);
+	for (int i = 0; s_InPlaceExtensions[i]; i++)
+		if (!ext.CompareNoCase(vtString(".") + s_InPlaceExtensions[i]))
+			return true;
+	return false;
+}
+
+// A path in an archive can be extracted if it stays inside the folder it is
+//  extracted to.
+static bool IsSafeArchivePath(const vtString &name)
+{
+	if (name.IsEmpty() || name[0] == '/' || name.Find(':') != -1)
+		return false;
+	return (vtString("/") + name + "/").Find("/../") == -1;
+}
+
+/**
+ * Makes the files in an archive available to the importers.  A file which is
+ * read through GDAL is read in place, with a virtual path.  Any other file
+ * is extracted to a temporary folder, along with the files beside it which
+ * share its name, such as the .prj, .dbf and .shx of a .shp.  Files keep
+ * their path within the archive, so that files of the same name in
+ * different folders don't overwrite each other.  The folder is removed again
+ * when the extractor is destroyed.
+ */
+class ArchiveExtractor
+{
+public:
+	ArchiveExtractor(const vtArchive &archive, const wxString &folder)
+		: m_archive(archive), m_folder(folder), m_bCreated(false),
+		m_extracted(archive.NumEntries(), false) {}
+	~ArchiveExtractor() { Cleanup(); }
+
+	wxString GetFile(uint index);
+	bool ExtractPrefix(const vtString &prefix);
+	bool IsInPlace(const wxString &fname) const
+	{
+		return vtArchive::IsVirtualPath(fname.mb_str(wxConvUTF8));
+	}
+	void Cleanup();
+
+protected:
+	vtString RelativePath(uint index) const;
+	bool CreateFolders(const vtString &path);
+	bool Extract(uint index);
+
+	const vtArchive &m_archive;
+	wxString m_folder;
+	bool m_bCreated;
+	std::vector<bool> m_extracted;
+	vtStringArray m_subfolders;		// relative, in the order they were created
+};
+
+/**
+ * Get a filename for one file in the archive, which the importers can open.
+ * \return The filename, or an empty string if it could not be extracted.
+ */
+wxString ArchiveExtractor::GetFile(uint index)
+{
+	const vtString &name = m_archive.GetEntry(index).m_strName;
+	if (CanReadInPlace(name))
+		return wxString((const char *) m_archive.GetVirtualPath(index), wxConvUTF8);
+
+	vtString base = name;
+	RemoveFileExtensions(base, false);
+	if (!ExtractPrefix(base + ".") || !Extract(index))
+		return _T("");
+	return m_folder + _T("/") + wxString((const char *) RelativePath(index), wxConvUTF8);
+}
+
+/**
+ * Extract every file whose path in the archive starts with the given prefix.
+ */
+bool ArchiveExtractor::ExtractPrefix(const vtString &prefix)
+{
+	const int len = prefix.GetLength();
+	bool bOK = true;
+	for (uint i = 0; i < m_archive.NumEntries(); i++)
+	{
+		const vtArchiveEntry &entry = m_archive.GetEntry(i);
+		if (!entry.m_bDirectory && !entry.m_strName.Left(len).CompareNoCase(prefix))
+			bOK = Extract(i) && bOK;
+	}
+	return bOK;
+}
+
+/**
+ * The path of a file within the archive, with forward slashes.
+ */
+vtString ArchiveExtractor::RelativePath(uint index) const
+{
+	vtString path = m_archive.GetEntry(index).m_strName;
+	path.Replace('\\', '/');
+	return path;
+}
+
+/**
+ * Create the folders, within the temporary folder, which a file needs.
+ */
+bool ArchiveExtractor::CreateFolders(const vtString &path)
+{
+	if (!m_bCreated)
+	{
+		VTLOG("Creating temp dir at '%s'\n", (const char *)m_folder.mb_str(wxConvUTF8));
+		bool created = vtCreateDir(m_folder.mb_str(wxConvUTF8));
+		if (!created && errno != EEXIST)
+		{
+			DisplayAndLog("Couldn't create temporary directory to hold contents of archive.");
+			return false;
+		}
+		m_bCreated = true;
+	}
+	const vtString base = (const char *) m_folder.mb_str(wxConvUTF8);
+	for (int slash = path.Find('/'); slash != -1; slash = path.Find('/', slash + 1))
+	{
+		const vtString sub = path.Left(slash);
+		if (vtFindString(m_subfolders, sub) != -1)
+			continue;
+		if (!vtCreateDir(base + "/" + sub) && errno != EEXIST)
+			return false;
+		m_subfolders.push_back(sub);
+	}
+	return true;
+}
+
+bool ArchiveExtractor::Extract(uint index)
+{
+	if (m_extracted[index])
+		return true;
+	const vtString path = RelativePath(index);
+	if (!IsSafeArchivePath(path))
+	{
+		VTLOG(" Not extracting '%s', it would be outside the folder\n", (const char *) path);
+		return false;
+	}
+	if (!CreateFolders(path))
+		return false;
+	wxString dest = m_folder + _T("/") + wxString((const char *) path, wxConvUTF8);
+	VTLOG(" Extracting '%s'\n", (const char *) path);
+	m_extracted[index] = m_archive.ExtractEntry(index, dest.mb_str(wxConvUTF8));
+	return m_extracted[index];
+}
+
+void ArchiveExtractor::Cleanup()
+{
+	// Folders are emptied deepest first, since each was created after its
+	//  parent.
+	const vtString base = (const char *) m_folder.mb_str(wxConvUTF8);
+	for (int i = (int) m_subfolders.size() - 1; i >= 0; i--)
+		vtDestroyDir(base + "/" + m_subfolders[i]);
+	m_subfolders.clear();
+
+	if (m_bCreated)
+		vtDestroyDir(m_folder.mb_str(wxConvUTF8));
+	m_bCreated = false;
+}
+
 
 //
 // Ask the user for a filename, and import data from it.
@@ -119,8 +285,9 @@ void Builder::ImportData(LayerType ltype)
 
 /**
  * Import data of a given type from a file, which can potentially be an
- * archive file.  If it's an archive, it will be unarchived to a temporary
- * folder, and the contents will be imported.
+ * archive file.  If it's an archive, the contents will be imported: files
+ * which GDAL can read are read in place, and any others are extracted to a
+ * temporary folder.
  *
  * \return Number of layers created during the import.
  */
@@ -171,58 +338,44 @@ int Builder::ImportDataFromArchive(LayerType ltype, const wxString &fname_in,
 		return num_imported;
 	}
 
-	// try to uncompress
-	wxString path, prepend_path;
-	path = GetTempFolderName(fname_in.mb_str(wxConvUTF8));
-
-	VTLOG("Creating temp dir at '%s'\n", (const char *)path.mb_str(wxConvUTF8));
-	bool created = vtCreateDir(path.mb_str(wxConvUTF8));
-	if (!created && errno != EEXIST)
-	{
-		DisplayAndLog("Couldn't create temporary directory to hold contents of archive.");
-		return 0;	// no layers created
-	}
-	prepend_path = path + _T("/");
-
+	// Read the index of the archive.  Files which are read through GDAL are
+	//  then read in place, and only the files which other readers need are
+	//  extracted, to a temporary folder.
 	vtString str1 = (const char *) fname_in.mb_str(wxConvUTF8);
-	vtString str2 = (const char *) prepend_path.mb_str(wxConvUTF8);
-
-	OpenProgressDialog(_("Expanding archive"), wxString::FromUTF8((const char *) str1),
+	vtArchive archive;
+	OpenProgressDialog(_("Reading archive"), wxString::FromUTF8((const char *) str1),
 		false, m_pParentWindow);
-	int num_files;
-	if (bTGZip)
-		num_files = ExpandTGZ(str1, str2);
-	if (bZip)
-		num_files = ExpandZip(str1, str2, progress_callback);
+	bool bOpened = archive.Open(str1);
 	CloseProgressDialog();
 
+	std::vector<uint> files;
+	for (uint i = 0; i < archive.NumEntries(); i++)
+		if (!archive.GetEntry(i).m_bDirectory)
+			files.push_back(i);
+
+	ArchiveExtractor extractor(archive, GetTempFolderName(fname_in.mb_str(wxConvUTF8)));
+
 	int layer_count = 0;
-	VTLOG(" Unarchived %d files.\n", num_files);
-	if (num_files < 1)
+	int num_files = (int) files.size();
+	VTLOG(" Archive contains %d files.\n", num_files);
+	if (!bOpened || num_files < 1)
 	{
-		DisplayAndLog("Couldn't expand archive.");
+		DisplayAndLog("Couldn't read archive.");
 	}
 	else if (num_files == 1)
 	{
 		// the archive contained a single file
-		std::string pathname = (const char *) prepend_path.mb_str(wxConvUTF8);
-		wxString internal_name;
-		for (dir_iter it(pathname); it != dir_iter(); ++it)
-		{
-			if (it.is_directory())
-				continue;
-			std::string name1 = it.filename();
-			fname = prepend_path;
-			internal_name = wxString(name1.c_str(), wxConvUTF8);
-			fname += internal_name;
-			break;
-		}
+		const vtString &entry_name = archive.GetEntry(files[0]).m_strName;
+		wxString internal_name(StartOfFilename(entry_name), wxConvUTF8);
+		fname = extractor.GetFile(files[0]);
 
 		// try to load, or import it
-		Builder::LoadResult result = LoadLayer(fname);
+		Builder::LoadResult result = Builder::NOT_NATIVE;
+		if (fname != _T("") && !extractor.IsInPlace(fname))
+			result = LoadLayer(fname);
 		if (result == Builder::LOADED)
 			layer_count = 1;
-		else if (result == Builder::NOT_NATIVE)
+		else if (result == Builder::NOT_NATIVE && fname != _T(""))
 		{
 			// Otherwise, try importing
 			LayerArray layers;
@@ -265,51 +418,52 @@ int Builder::ImportDataFromArchive(LayerType ltype, const wxString &fname_in,
 			ltype = LT_STRUCTURE;
 
 		// look for an SDTS catalog file
-		wxString fname_cat;
-		wxString fname_hdr;
-		bool found_cat = false;
-		bool found_hdr = false;
-		bool found_rt1 = false;
-		bool found_dem = false;
-		bool found_bil = false;
+		int cat_index = -1;
+		int hdr_index = -1;
+		int dem_index = -1;
+		int bil_index = -1;
+		int rt1_index = -1;
 
-		std::string pathname = (const char *) path.mb_str(wxConvUTF8);
-		VTLOG(" Looking at contents of folder: '%s'\n", pathname.c_str());
+		VTLOG(" Looking at contents of archive: '%s'\n", (const char *) str1);
 
-		for (dir_iter it(pathname); it != dir_iter(); ++it)
+		for (uint k = 0; k < files.size(); k++)
 		{
-			if (it.is_directory()) continue;
-			wxString fname2 = wxString(it.filename().c_str(), wxConvUTF8);
+			wxString fname2(StartOfFilename(archive.GetEntry(files[k]).m_strName), wxConvUTF8);
 
 			if (fname2.Right(8).CmpNoCase(_T("catd.ddf")) == 0)
 			{
-				fname_cat = prepend_path;
-				fname_cat += fname2;
-				found_cat = true;
+				cat_index = files[k];
 				break;
 			}
 			if (fname2.Right(4).CmpNoCase(_T(".hdr")) == 0)
 			{
 				ltype = LT_ELEVATION;
-				fname_hdr = prepend_path;
-				fname_hdr += fname2;
-				found_hdr = true;
-				break;
+				hdr_index = files[k];
 			}
 			if (fname2.Right(4).CmpNoCase(_T(".dem")) == 0)
-				found_dem = true;
+				dem_index = files[k];
 			if (fname2.Right(4).CmpNoCase(_T(".bil")) == 0)
-				found_bil = true;
+				bil_index = files[k];
 			if (fname2.Right(4).CmpNoCase(_T(".rt1")) == 0)
-				found_rt1 = true;
+				rt1_index = files[k];
 		}
 		wxString single_file_import;
-		if (found_cat)
-			single_file_import = fname_cat;
-		if (found_hdr && found_dem)
-			single_file_import = fname_hdr;
-		if (found_hdr && found_bil)
-			single_file_import = fname_hdr;
+		if (cat_index != -1)
+		{
+			// An SDTS transfer is a set of files which share a prefix
+			const vtString &cat_name = archive.GetEntry(cat_index).m_strName;
+			extractor.ExtractPrefix(cat_name.Left(cat_name.GetLength() - 8));
+			single_file_import = extractor.GetFile(cat_index);
+		}
+		else if (hdr_index != -1 && (dem_index != -1 || bil_index != -1))
+		{
+			// GTOPO30 or BIL: GDAL reads the data file, and finds the header
+			//  beside it
+			int data_index = (dem_index != -1) ? dem_index : bil_index;
+			single_file_import = extractor.GetFile(data_index);
+			if (!extractor.IsInPlace(single_file_import))
+				single_file_import = extractor.GetFile(hdr_index);
+		}
 		if (single_file_import != _T(""))
 		{
 			// We expect a single layer from SDTS or BIL/HDR or DEM/HDR (GTOPO30)
@@ -327,21 +481,24 @@ int Builder::ImportDataFromArchive(LayerType ltype, const wxString &fname_in,
 				layer_count++;
 			}
 		}
-		else if (found_rt1)
+		else if (rt1_index != -1)
 		{
-			layer_count = ImportDataFromTIGER(path);
+			// The TIGER reader takes the whole folder which holds the files
+			extractor.ExtractPrefix("");
+			wxString rt1 = extractor.GetFile(rt1_index);
+			if (rt1 != _T(""))
+				layer_count = ImportDataFromTIGER(rt1.BeforeLast('/'));
 		}
 		else
 		{
 			// Look through archive for individual files (like .dem)
-			std::string path = (const char *) prepend_path.mb_str(wxConvUTF8);
-			for (dir_iter it(path); it != dir_iter(); ++it)
+			for (uint k = 0; k < files.size(); k++)
 			{
-				if (it.is_directory()) continue;
-				wxString fname2 = wxString(it.filename().c_str(), wxConvUTF8);
+				wxString fname2(StartOfFilename(archive.GetEntry(files[k]).m_strName), wxConvUTF8);
 
-				fname = prepend_path;
-				fname += fname2;
+				fname = extractor.GetFile(files[k]);
+				if (fname == _T(""))
+					continue;
 
 				// Try importing w/o warning on failure, since it could just
 				// be some harmless files in there.
@@ -369,8 +526,7 @@ int Builder::ImportDataFromArchive(LayerType ltype, const wxString &fname_in,
 	}
 
 	// clean up after ourselves
-	prepend_path = GetTempFolderName(fname_in.mb_str(wxConvUTF8));
-	vtDestroyDir(prepend_path.mb_str(wxConvUTF8));
+	extractor.Cleanup();
 
 	return layer_count;
 }
@@ -437,17 +593,19 @@ vtLayer *Builder::ImportLayerFromFile(LayerType ltype, const wxString &strFileNa
 	// check the file extension
 	wxString strExt = strFileName.AfterLast('.');
 
-	// check to see if the file is readable
+	// check to see if the file is readable.  A file inside an archive can
+	//  only be opened by GDAL, so leave that check to the reader.
 	vtString fname = (const char *) strFileName.mb_str(wxConvUTF8);
-	FILE *fp = vtFileOpen(fname, "rb");
-	if (!fp)
+	const bool bInArchive = vtArchive::IsVirtualPath(fname);
+	FILE *fp = bInArchive ? NULL : vtFileOpen(fname, "rb");
+	if (!fp && !bInArchive)
 	{
 		// Cannot Open File
 		VTLOG("Couldn't open file %s\n", (const char *) fname);
 		return NULL;
 	}
 	bool bIsDB = (strExt.Len() == 2 && !strExt.Left(2).CmpNoCase(_T("db")));
-	if (bIsDB)
+	if (bIsDB && fp)
 	{
 		// Get type from DB file
 		for (int i = 0; i < 10; i++)
@@ -471,7 +629,8 @@ vtLayer *Builder::ImportLayerFromFile(LayerType ltype, const wxString &strFileNa
 			}
 		}
 	}
-	fclose(fp);
+	if (fp)
+		fclose(fp);
 
 	if (m_pParentWindow)
 		OpenProgressDialog(_("Importing Data"), strFileName, true, m_pParentWindow);
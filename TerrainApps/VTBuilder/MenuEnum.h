@@ -89,10 +89,12 @@ enum
 	ID_ELEV_VERT_OFFSET,
 	ID_ELEV_REMOVERANGE,
 	ID_ELEV_ARITHMETIC,
+	ID_ELEV_EXPRESSION,
 	ID_ELEV_SETUNKNOWN,
 	ID_ELEV_FILL_FAST,
 	ID_ELEV_FILL_SLOW,
 	ID_ELEV_FILL_REGIONS,
+	ID_ELEV_FILL_MULTIGRID,
 	ID_ELEV_EXPORT,
 	ID_ELEV_EXPORT_TILES,
 	ID_ELEV_COPY,
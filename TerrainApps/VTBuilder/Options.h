@@ -21,6 +21,7 @@
 #define TAG_MAX_MEGAPIXELS "MaxMegapixels"
 #define TAG_BLACK_TRANSP "BlackAsTransparent"
 #define TAG_TIFF_COMPRESS "TiffCompressDeflate"
+#define TAG_TILE_COMPRESSION "TileCompression"	// None, Fast or Best, for elevation tilesets
 #define TAG_DEFAULT_GZIP_BT "DefaultGzipBT"
 #define TAG_DELAY_LOAD_GRID "ElevDelayLoadGrid"
 #define TAG_MAX_MEM_GRID "ElevMaxMemGrid"
@@ -28,7 +29,7 @@
 #define TAG_DRAW_TIN_SIMPLE "DrawSimpleTinLayers"
 
 #define TAG_SLOW_FILL_GAPS "SlowFillGaps"	// deprecated
-#define TAG_GAP_FILL_METHOD "GapFillMethod"		// 1 fast, 2 slow, 3 region-growing
+#define TAG_GAP_FILL_METHOD "GapFillMethod"		// 1 fast, 2 slow, 3 region-growing, 4 multigrid
 
 // status bar options
 #define TAG_SHOW_MINUTES "ShowMinutes"
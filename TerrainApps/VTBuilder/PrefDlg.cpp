@@ -53,6 +53,7 @@ PrefDlg::PrefDlg( wxWindow *parent, wxWindowID id, const wxString &title,
 	AddValidator(this, ID_RADIO9, &b9);
 	AddValidator(this, ID_RADIO10, &b10);
 	AddValidator(this, ID_RADIO11, &b11);
+	AddValidator(this, ID_RADIO12, &b16);
 	AddValidator(this, ID_BLACK_TRANSP, &b12);
 	AddValidator(this, ID_DEFLATE_TIFF, &b13);
 	AddValidator(this, ID_BT_GZIP, &b14);
@@ -30,7 +30,7 @@ public:
 
 public:
 	// WDR: member variable declarations for PrefDlg
-	bool b1, b2, b3, b4, b5, b6, b7, b8, b9, b10, b11, b12, b13, b14, b15;
+	bool b1, b2, b3, b4, b5, b6, b7, b8, b9, b10, b11, b12, b13, b14, b15, b16;
 	int i1, i2, i3, i4;
 
 private:
@@ -193,7 +193,7 @@ void vtRawLayer::DrawLayer(vtScaledView *pView, UIContext &ui)
 				if (pen == 1) { pView->SetColor(DefPen); pen = 0; }
 			}
 			bool bClosed = false;
-			pView->DrawPolyLine(pSetLine->GetPolyLine(i), bClosed);
+			pView->DrawPolyLine(pSetLine->GetPolyLineView(i), bClosed);
 		}
 	}
 	if (type == wkbLineString25D)
@@ -234,7 +234,7 @@ void vtRawLayer::DrawLayer(vtScaledView *pView, UIContext &ui)
 					if (pen == 1) { pView->SetColor(DefPen); pen = 0; }
 				}
 			}
-			DPolygon2 &dpoly = pSetPoly->GetPolygon(i);
+			DPolygon2View dpoly = pSetPoly->GetPolygonView(i);
 			pView->DrawPolygon(dpoly, bFill);
 
 			if (bFill)
@@ -463,12 +463,13 @@ void vtRawLayer::OnLeftDown(BuilderView *pView, UIContext &ui)
 		pView->Refresh();
 		break;
 	case LB_FeatInfo:
-		if (type == wkbPoint)
+		if (type == wkbPoint || type == wkbPolygon)
 		{
-			iEnt = pSetP2->FindClosestPoint(ui.m_DownLocation, epsilon.x);
+			// Closest point, or the polygon under the cursor
+			iEnt = m_pSet->FindClosestFeature(ui.m_DownLocation, epsilon.x);
 			if (iEnt != -1)
 			{
-				g_bld->UpdateFeatureDialog(this, pSetP2, iEnt);
+				g_bld->UpdateFeatureDialog(this, m_pSet, iEnt);
 			}
 		}
 		//if (type == wkbPoint25D)
@@ -583,6 +584,8 @@ void vtRawLayer::ScaleHorizontally(double factor)
 		for (i = 0; i < entities; i++)
 			pSetPoly->GetPolygon(i).Mult(factor);
 	}
+	// geometry was changed directly, so the spatial index is stale
+	m_pSet->FreeRTree();
 	SetModified(true);
 	m_bExtentComputed = false;
 }
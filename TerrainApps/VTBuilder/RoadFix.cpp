@@ -16,6 +16,11 @@
 
 #include "vtdata/vtLog.h"
 
+#include <algorithm>
+#include <stdint.h>
+#include <unordered_map>
+#include <unordered_set>
+
 #include "RoadMapEdit.h"
 #include "assert.h"
 
@@ -55,28 +60,82 @@ void NodeEdit::EnforceLinkEndpoints()
 #define TOLERANCE_METERS (8.0f)
 #define TOLERANCE_DEGREES (TOLERANCE_METERS/110000)
 
+//
+// A hash of node positions on a grid, with cells the size of the merge
+// tolerance, so that all the nodes near a point are found by looking in
+// the 3x3 cells around it.
+//
+class NodeGrid
+{
+public:
+	NodeGrid(double dCellSize) : m_dCellSize(dCellSize) {}
+
+	void Add(int index, const DPoint2 &p)
+	{
+		m_Cells[Key(CellX(p), CellY(p))].push_back(index);
+	}
+	void Remove(int index, const DPoint2 &p)
+	{
+		std::vector<int> &cell = m_Cells[Key(CellX(p), CellY(p))];
+		std::vector<int>::iterator it = std::find(cell.begin(), cell.end(), index);
+		if (it != cell.end())
+			cell.erase(it);
+	}
+
+	// Find the lowest index greater than iAfter, of a node within tolerance
+	int FindNear(const DPoint2 &p, int iAfter, double tolerance_squared,
+		const std::vector<NodeEdit*> &nodes) const
+	{
+		int found = -1;
+		const int64_t cx = CellX(p), cy = CellY(p);
+		for (int64_t x = cx - 1; x <= cx + 1; x++)
+		for (int64_t y = cy - 1; y <= cy + 1; y++)
+		{
+			std::unordered_map<int64_t, std::vector<int> >::const_iterator it =
+				m_Cells.find(Key(x, y));
+			if (it == m_Cells.end())
+				continue;
+			const std::vector<int> &cell = it->second;
+			for (size_t i = 0; i < cell.size(); i++)
+			{
+				const int index = cell[i];
+				if (index <= iAfter || (found != -1 && index >= found))
+					continue;
+				DPoint2 diff = nodes[index]->Pos() - p;
+				if (diff.LengthSquared() < tolerance_squared)
+					found = index;
+			}
+		}
+		return found;
+	}
+
+protected:
+	int64_t CellX(const DPoint2 &p) const { return (int64_t) floor(p.x / m_dCellSize); }
+	int64_t CellY(const DPoint2 &p) const { return (int64_t) floor(p.y / m_dCellSize); }
+	static int64_t Key(int64_t x, int64_t y) { return (x << 32) ^ (y & 0xffffffff); }
+
+	double m_dCellSize;
+	std::unordered_map<int64_t, std::vector<int> > m_Cells;
+};
+
 //
 // Since the original data is scattered over many source files,
 // any road which crosses a DLG file boundary will be split
 // by two nodes, one on each edge of the two files.
 //
 // This routine will merge any two nodes which are sufficiently
-// close together.
+// close together.  Each node is merged into the first node after
+// it in the list which is within the tolerance.  The nodes are
+// hashed on a grid, so only nearby nodes are compared.
 //
 // Warning: some degerate roads may result.
 //
 // Return the number removed.
 //
-int RoadMapEdit::MergeRedundantNodes(bool bDegrees, bool progress_callback(int))
+int RoadMapEdit::MergeRedundantNodes(bool bDegrees,
+	const std::function<bool(int)> &progress_callback)
 {
-	NodeEdit *prev = NULL, *next;
-	DPoint2 diff;
 	int removed = 0;
-
-	int nodes = NumNodes();
-	float total = (float)nodes * nodes / 2;
-	int count1 = 0, count = 0, count_tick, count_last_tick = 0;
-	float tick_size = (float)total / 100;
 	double tolerance, tolerance_squared;
 
 	if (bDegrees)
@@ -85,52 +144,55 @@ int RoadMapEdit::MergeRedundantNodes(bool bDegrees, bool progress_callback(int))
 		tolerance = TOLERANCE_METERS;
 	tolerance_squared = tolerance * tolerance;
 
-	NodeEdit *pN, *pN2;
+	// Number the nodes in list order, and hash them
+	std::vector<NodeEdit*> nodes;
+	nodes.reserve(NumNodes());
+	for (NodeEdit *pN = GetFirstNode(); pN; pN = pN->GetNext())
+		nodes.push_back(pN);
+	const int num = (int) nodes.size();
 
-	for (pN = GetFirstNode(); pN && pN->GetNext(); pN = next)
+	NodeGrid grid(tolerance);
+	for (int i = 0; i < num; i++)
+		grid.Add(i, nodes[i]->Pos());
+
+	NodeEdit *prev = NULL;
+	for (int i = 0; i < num; i++)
 	{
-		count1++;
-		next = pN->GetNext();
-		bool remove = false;
-		for (pN2 = next; pN2; pN2 = pN2->GetNext())
-		{
-			diff = pN2->Pos() - pN->Pos();
-			if (diff.LengthSquared() < tolerance_squared)
-			{
-				remove = true;
-				break;
-			}
-		}
-		count += (nodes - count1);
-		count_tick = (int) (count / tick_size);
-		if (count_tick > count_last_tick)
+		if (progress_callback && (i % 1024) == 0)
+			progress_callback(i * 100 / num);
+
+		NodeEdit *pN = nodes[i];
+		NodeEdit *next = pN->GetNext();
+		const int j = grid.FindNear(pN->Pos(), i, tolerance_squared, nodes);
+		if (j == -1)
 		{
-			count_last_tick = count_tick;
-			progress_callback(count_tick);
+			prev = pN;
+			continue;
 		}
-		if (remove)
-		{
-			// we've got a pair that need to be merged
-			//new point is placed between the 2 original points
-			pN2->SetPos((pN2->Pos() + pN->Pos()) / 2.0f);
 
-			// we're going to remove the "pN" node
-			// inform any roads which may have referenced it
-			ReplaceNode(pN, pN2);
-
-			// to remove pN, link around it
-			if (prev)
-				prev->SetNext(next);
-			else
-				m_pFirstNode = next;
-			delete pN;
-
-			// for the roads that now end in pN2, move their end points
-			pN2->EnforceLinkEndpoints();
-			removed++;
-		}
+		// we've got a pair that need to be merged
+		//new point is placed between the 2 original points
+		NodeEdit *pN2 = nodes[j];
+		grid.Remove(i, pN->Pos());
+		grid.Remove(j, pN2->Pos());
+		pN2->SetPos((pN2->Pos() + pN->Pos()) / 2.0f);
+		grid.Add(j, pN2->Pos());
+
+		// we're going to remove the "pN" node
+		// inform any roads which may have referenced it
+		ReplaceNode(pN, pN2);
+
+		// to remove pN, link around it
+		if (prev)
+			prev->SetNext(next);
 		else
-			prev = pN;
+			m_pFirstNode = next;
+		delete pN;
+		nodes[i] = NULL;
+
+		// for the roads that now end in pN2, move their end points
+		pN2->EnforceLinkEndpoints();
+		removed++;
 	}
 	VTLOG(" Removed %i nodes\n", removed);
 	return removed;
@@ -315,7 +377,7 @@ int RoadMapEdit::FixOverlappedLinks(bool bDegrees)
 
 				p1 = pN->GetAdjacentLinkPoint2d(j);
 				diff = (p1 - p0);
-				if (fabs(diff.x) < 1.0f && fabs(diff.y) < 1.0f)
+				if (fabs(diff.x) < tolerance && fabs(diff.y) < tolerance)
 				{
 					bad = true;
 					break;
@@ -335,8 +397,10 @@ int RoadMapEdit::FixOverlappedLinks(bool bDegrees)
 		else
 			pR2->RemovePoint(pR2->GetSize()-2);	// road ends here
 		fixed++;
-		((LinkEdit*)pR1)->m_fLength = pR1->Length();
-		((LinkEdit*)pR2)->m_fLength = pR2->Length();
+		pR1->m_fLength = pR1->Length();
+		pR2->m_fLength = pR2->Length();
+		pR1->Dirtied();
+		pR2->Dirtied();
 
 	}
 	return fixed;
@@ -362,10 +426,15 @@ float angle_diff(float a1, float a2)
 //
 // deletes really close parallel (roughly) roads, where one of the roads go nowhere.
 //
+// Each road to delete is detached from its nodes right away, so that the
+// following nodes see the network as it will be, but the roads are only
+// removed from the list at the end, in one pass.
+//
 int RoadMapEdit::FixExtraneousParallels()
 {
 	int removed = 0, i, j, roads;
 	LinkEdit *pR1=NULL, *pR2=NULL;
+	std::unordered_set<LinkEdit*> to_delete;
 
 	for (NodeEdit *pN = GetFirstNode(); pN && pN->GetNext(); pN = pN->GetNext())
 	{
@@ -402,16 +471,16 @@ int RoadMapEdit::FixExtraneousParallels()
 				leads_to[1] = pR2->GetNode(1)->NumLinks();
 			else
 				leads_to[1] = pR2->GetNode(0)->NumLinks();
+			LinkEdit *pDelete = NULL;
 			if (leads_to[0] == 1 && leads_to[1] > 1)
-			{
-				// delete R1
-				DeleteSingleLink(pR1);
-				removed++;
-			}
+				pDelete = pR1;		// delete R1
 			else if (leads_to[0] > 1 && leads_to[1] == 1)
+				pDelete = pR2;		// delete R2
+			if (pDelete)
 			{
-				// delete R2;
-				DeleteSingleLink(pR2);
+				pDelete->GetNode(0)->DetachLink(pDelete);
+				pDelete->GetNode(1)->DetachLink(pDelete);
+				to_delete.insert(pDelete);
 				removed++;
 			}
 			else
@@ -422,6 +491,68 @@ int RoadMapEdit::FixExtraneousParallels()
 			}
 		}
 	}
+	if (to_delete.empty())
+		return removed;
+
+	LinkEdit *prev = NULL, *next;
+	for (LinkEdit *pL = GetFirstLink(); pL; pL = next)
+	{
+		next = pL->GetNext();
+		if (to_delete.count(pL))
+		{
+			if (prev)
+				prev->SetNext(next);
+			else
+				m_pFirstLink = next;
+			delete pL;
+		}
+		else
+			prev = pL;
+	}
 	return removed;
 }
 
+/**
+ * Run the cleaning passes over the whole network, one after another, and
+ * report what each did.  Merging nodes is the only pass that needs to
+ * compare nodes with each other, and it uses a spatial hash, so the whole
+ * sweep is fast even for very large networks.
+ *
+ * Fixing overlapped links and extraneous parallels is optional, since
+ * those passes are not yet proven safe on all data.
+ */
+void RoadMapEdit::CleanNetwork(bool bDegrees, double epsilon, RoadCleanReport &report,
+	bool bFixOverlaps, bool progress_callback(int))
+{
+	report = RoadCleanReport();
+
+	report.m_iUnusedNodes = RemoveUnusedNodes();
+	if (progress_callback) progress_callback(5);
+
+	// Merging nodes takes from 5% to 85% of the whole
+	std::function<bool(int)> merge_progress;
+	if (progress_callback)
+	{
+		merge_progress = [progress_callback](int amount)
+			{ return progress_callback(5 + amount * 80 / 100); };
+	}
+	report.m_iMergedNodes = MergeRedundantNodes(bDegrees, merge_progress);
+	report.m_iLinkPoints = CleanLinkPoints(epsilon);
+	if (progress_callback) progress_callback(90);
+
+	report.m_iDegenerateLinks = RemoveDegenerateLinks();
+	if (bFixOverlaps)
+	{
+		report.m_iOverlappedLinks = FixOverlappedLinks(bDegrees);
+		report.m_iParallelLinks = FixExtraneousParallels();
+		report.m_iDanglingLinks = DeleteDanglingLinks();
+	}
+	if (progress_callback) progress_callback(100);
+
+	VTLOG("CleanNetwork: %d unused nodes, %d merged nodes, %d link points, "
+		"%d degenerate links, %d overlapped, %d parallel, %d dangling\n",
+		report.m_iUnusedNodes, report.m_iMergedNodes, report.m_iLinkPoints,
+		report.m_iDegenerateLinks, report.m_iOverlappedLinks,
+		report.m_iParallelLinks, report.m_iDanglingLinks);
+}
+
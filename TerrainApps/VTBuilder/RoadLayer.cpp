@@ -64,6 +64,11 @@ bool vtRoadLayer::OnLoad()
 	if (!success)
 		return false;
 
+	// Older files are upgraded to the current, faster format when saved
+	if (GetFileVersion() < RMFVERSION_CURRENT)
+		VTLOG("RMF version %.1f will be upgraded to %.1f when saved.\n",
+			GetFileVersion(), RMFVERSION_CURRENT);
+
 	// Set visual properties
 	for (NodeEdit *pN = GetFirstNode(); pN; pN = pN->GetNext())
 	{
@@ -556,41 +561,21 @@ void vtRoadLayer::DoClean(double epsilon)
 	GetCRS(crs);
 	bool bDegrees = (crs.IsGeographic() != 0);
 
-	int count;
 	OpenProgressDialog(_("Cleaning RoadMap"), _T(""));
 
-	UpdateProgressDialog(10, _("Removing unused nodes"));
-	count = RemoveUnusedNodes();
-	if (count)
-	{
-		DisplayAndLog("Removed %i nodes", count);
-		SetModified(true);
-	}
-
-	UpdateProgressDialog(20, _("Merging redundant nodes"));
 	// potentially takes a long time...
-	count = MergeRedundantNodes(bDegrees, progress_callback);
-	if (count)
-	{
-		DisplayAndLog("Merged %d redundant roads", count);
+	RoadCleanReport report;
+	CleanNetwork(bDegrees, epsilon, report, false, progress_callback);
+	if (report.m_iUnusedNodes)
+		DisplayAndLog("Removed %i nodes", report.m_iUnusedNodes);
+	if (report.m_iMergedNodes)
+		DisplayAndLog("Merged %d redundant roads", report.m_iMergedNodes);
+	if (report.m_iLinkPoints)
+		DisplayAndLog("Cleaned %d link points", report.m_iLinkPoints);
+	if (report.m_iDegenerateLinks)
+		DisplayAndLog("Removed %d degenerate links", report.m_iDegenerateLinks);
+	if (report.Total() > 0)
 		SetModified(true);
-	}
-
-	UpdateProgressDialog(30, _("Cleaning link points"));
-	count = CleanLinkPoints(epsilon);
-	if (count)
-	{
-		DisplayAndLog("Cleaned %d link points", count);
-		SetModified(true);
-	}
-
-	UpdateProgressDialog(40, _T("Removing degenerate links"));
-	count = RemoveDegenerateLinks();
-	if (count)
-	{
-		DisplayAndLog("Removed %d degenerate links", count);
-		SetModified(true);
-	}
 
 #if 0
 	// The following cleanup operations are disabled until they are proven safe!
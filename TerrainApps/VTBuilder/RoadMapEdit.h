@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <functional>
+
 #include "vtdata/RoadMap.h"
 #include "vtdata/Selectable.h"
 
@@ -115,6 +117,27 @@ protected:
 	void ComputeExtent();
 };
 
+/** The number of changes made by each pass of RoadMapEdit::CleanNetwork. */
+struct RoadCleanReport
+{
+	RoadCleanReport() : m_iUnusedNodes(0), m_iMergedNodes(0), m_iLinkPoints(0),
+		m_iDegenerateLinks(0), m_iOverlappedLinks(0), m_iParallelLinks(0),
+		m_iDanglingLinks(0) {}
+	int Total() const
+	{
+		return m_iUnusedNodes + m_iMergedNodes + m_iLinkPoints + m_iDegenerateLinks +
+			m_iOverlappedLinks + m_iParallelLinks + m_iDanglingLinks;
+	}
+
+	int m_iUnusedNodes;
+	int m_iMergedNodes;
+	int m_iLinkPoints;
+	int m_iDegenerateLinks;
+	int m_iOverlappedLinks;
+	int m_iParallelLinks;
+	int m_iDanglingLinks;
+};
+
 class RoadMapEdit : public vtRoadMap
 {
 public:
@@ -158,7 +181,8 @@ public:
 
 	//cleaning functions-------------------------
 	// merge nodes that are near each other
-	int MergeRedundantNodes(bool bDegrees, bool progress_callback(int) = NULL);
+	int MergeRedundantNodes(bool bDegrees,
+		const std::function<bool(int)> &progress_callback = std::function<bool(int)>());
 	// remove BAD roads
 	int RemoveDegenerateLinks();
 	// remove nodes and merge roads if 2 adjacent roads have the same properties and the node is uncontrolled.
@@ -173,6 +197,9 @@ public:
 	int FixOverlappedLinks(bool bDegrees);
 	// delete roads that are really close to another road, but go nowhere coming out of a node
 	int FixExtraneousParallels();
+	// run all the cleaning passes in one sweep
+	void CleanNetwork(bool bDegrees, double epsilon, RoadCleanReport &report,
+		bool bFixOverlaps = false, bool progress_callback(int) = NULL);
 	//----------------------------------------------
 
 	// draw the road network in window, given size of drawing area
@@ -169,7 +169,7 @@ void vtScaledView::DrawRectangle(const DPoint2 &p0, const DPoint2 &p1)
 	glEnd();
 }
 
-void vtScaledView::DrawPolyLine(const DLine2 &dline, bool bClose)
+void vtScaledView::DrawPolyLine(const DLine2View &dline, bool bClose)
 {
 	glBegin(GL_LINE_STRIP);
 	for (uint i = 0; i < dline.GetSize(); i++)
@@ -179,7 +179,7 @@ void vtScaledView::DrawPolyLine(const DLine2 &dline, bool bClose)
 	glEnd();
 }
 
-void vtScaledView::DrawPolygon(const DPolygon2 &poly, bool bFill)
+void vtScaledView::DrawPolygon(const DPolygon2View &poly, bool bFill)
 {
 	// just draw each ring
 	for (uint ring = 0; ring < poly.size(); ring++)
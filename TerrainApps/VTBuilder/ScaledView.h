@@ -8,6 +8,7 @@
 #pragma once
 
 #include "vtdata/MathTypes.h"
+#include "vtdata/GeomStore.h"
 #include "ogr_geometry.h"
 #include "wx/glcanvas.h"
 
@@ -39,8 +40,8 @@ public:
 	void DrawXHair(const DPoint2 &p, int pixelSize);
 	void DrawRectangle(const DRECT &rect);
 	void DrawRectangle(const DPoint2 &p0, const DPoint2 &p1);
-	void DrawPolyLine(const DLine2 &line, bool bClose);
-	void DrawPolygon(const DPolygon2 &poly, bool bFill);
+	void DrawPolyLine(const DLine2View &line, bool bClose);
+	void DrawPolygon(const DPolygon2View &poly, bool bFill);
 
 	void DrawOGRLinearRing(const OGRLinearRing *line, bool bCircles);
 	void DrawOGRPolygon(const OGRPolygon &poly, bool bFill, bool bCircles);
@@ -50,8 +50,8 @@ TileDlg::TileDlg( wxWindow *parent, wxWindowID id, const wxString &title,
 
 	m_bCompressNone = true;
 	m_bCompressOGL = false;
-	m_bCompressSquishFast = false;
-	m_bCompressSquishSlow = false;
+	m_bCompressDxtFast = false;
+	m_bCompressDxtHigh = false;
 	m_bCompressJPEG = false;
 
 	AddValidator(this, ID_TEXT_TO_FOLDER, &m_strToFile);
@@ -79,8 +79,8 @@ TileDlg::TileDlg( wxWindow *parent, wxWindowID id, const wxString &title,
 
 	AddValidator(this, ID_TC_NONE, &m_bCompressNone);
 	AddValidator(this, ID_TC_OGL, &m_bCompressOGL);
-	AddValidator(this, ID_TC_SQUISH_FAST, &m_bCompressSquishFast);
-	AddValidator(this, ID_TC_SQUISH_SLOW, &m_bCompressSquishSlow);
+	AddValidator(this, ID_TC_DXT_FAST, &m_bCompressDxtFast);
+	AddValidator(this, ID_TC_DXT_HIGH, &m_bCompressDxtHigh);
 	AddValidator(this, ID_TC_JPEG, &m_bCompressJPEG);
 
 	UpdateEnables();
@@ -135,8 +135,8 @@ void TileDlg::SetTilingOptions(TilingOptions &opt)
 	if (opt.bUseTextureCompression)
 	{
 		m_bCompressOGL = (opt.eCompressionType == TC_OPENGL);
-		m_bCompressSquishFast = (opt.eCompressionType == TC_SQUISH_FAST);
-		m_bCompressSquishSlow = (opt.eCompressionType == TC_SQUISH_SLOW);
+		m_bCompressDxtFast = (opt.eCompressionType == TC_DXT_FAST);
+		m_bCompressDxtHigh = (opt.eCompressionType == TC_DXT_HIGH);
 		m_bCompressJPEG = (opt.eCompressionType == TC_JPEG);
 	}
 
@@ -158,8 +158,8 @@ void TileDlg::GetTilingOptions(TilingOptions &opt) const
 
 	opt.bUseTextureCompression = !m_bCompressNone;
 	if (m_bCompressOGL) opt.eCompressionType = TC_OPENGL;
-	if (m_bCompressSquishFast) opt.eCompressionType = TC_SQUISH_FAST;
-	if (m_bCompressSquishSlow) opt.eCompressionType = TC_SQUISH_SLOW;
+	if (m_bCompressDxtFast) opt.eCompressionType = TC_DXT_FAST;
+	if (m_bCompressDxtHigh) opt.eCompressionType = TC_DXT_HIGH;
 	if (m_bCompressJPEG) opt.eCompressionType = TC_JPEG;
 }
 
@@ -220,13 +220,8 @@ void TileDlg::UpdateEnables()
 	FindWindow(ID_TC_OGL)->Enable(false);
 #endif
 
-#if SUPPORT_SQUISH
-	FindWindow(ID_TC_SQUISH_FAST)->Enable(true);
-	FindWindow(ID_TC_SQUISH_SLOW)->Enable(true);
-#else
-	FindWindow(ID_TC_SQUISH_FAST)->Enable(false);
-	FindWindow(ID_TC_SQUISH_SLOW)->Enable(false);
-#endif
+	FindWindow(ID_TC_DXT_FAST)->Enable(true);
+	FindWindow(ID_TC_DXT_HIGH)->Enable(true);
 }
 
 // WDR: handler implementations for TileDlg
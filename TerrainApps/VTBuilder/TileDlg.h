@@ -65,8 +65,8 @@ public:
 	bool m_bImageAlpha;
 	bool m_bCompressNone;
 	bool m_bCompressOGL;
-	bool m_bCompressSquishFast;
-	bool m_bCompressSquishSlow;
+	bool m_bCompressDxtFast;
+	bool m_bCompressDxtHigh;
 	bool m_bCompressJPEG;
 
 	DRECT m_area;
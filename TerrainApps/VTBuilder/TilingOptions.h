@@ -9,8 +9,11 @@
 #define TilingOptions_H
 
 #include "ElevDrawOptions.h"
+#include "minidata/MiniDatabuf.h"	// for vtTileCompression
 
-enum TextureCompressionType { TC_OPENGL, TC_SQUISH_FAST, TC_SQUISH_SLOW, TC_JPEG };
+// TC_OPENGL has the driver compress to DXT1, which needs an OpenGL context;
+//  TC_DXT_FAST and TC_DXT_HIGH compress to the same format on the CPU.
+enum TextureCompressionType { TC_OPENGL, TC_DXT_FAST, TC_DXT_HIGH, TC_JPEG };
 
 /**
  * All the options needed to describe how to create a tileset.
@@ -26,6 +29,7 @@ public:
 		bOmitFlatTiles = false;
 		bUseTextureCompression = false;
 		eCompressionType = TC_OPENGL;
+		eElevCompression = TILECOMP_NONE;
 		iNoDataFilled = 0;
 		iMinCol = -1;
 		iMaxCol = -1;
@@ -59,6 +63,9 @@ public:
 	bool bUseTextureCompression;
 	TextureCompressionType eCompressionType;
 
+	// If elevation, the tiles can be compressed losslessly
+	vtTileCompression eElevCompression;
+
 	// These can be set to restrict the output to certain (tile) rows only
 	int iMinCol, iMaxCol;
 	int iMinRow, iMaxRow;
@@ -63,7 +63,8 @@ public:
 	vtTin2d();
 	~vtTin2d();
 
-	vtTin2d(vtElevationGrid *grid);
+	vtTin2d(vtElevationGrid *grid, float fMaxError, int iMaxTriangles = 0,
+		bool progress_callback(int) = NULL);
 	vtTin2d(vtFeatureSetPoint3D *set);
 	vtTin2d(vtFeatureSetPolygon *set, int iFieldNum, float fHeight = 0.0f);
 
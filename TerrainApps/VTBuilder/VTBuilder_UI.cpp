@@ -2015,6 +2015,10 @@ PrefDlgBase::PrefDlgBase( wxWindow* parent, wxWindowID id, const wxString& title
 	m_radio11->SetValue( true ); 
 	sbSizer39->Add( m_radio11, 0, wxALIGN_CENTER_VERTICAL|wxALL, 5 );
 	
+	m_radio12 = new wxRadioButton( sbSizer39->GetStaticBox(), ID_RADIO12, _("Multigrid (fast and smooth)"), wxDefaultPosition, wxDefaultSize, 0 );
+	m_radio12->SetValue( true ); 
+	sbSizer39->Add( m_radio12, 0, wxALIGN_CENTER_VERTICAL|wxALL, 5 );
+	
 	
 	bSizer172->Add( sbSizer39, 0, wxEXPAND|wxALIGN_CENTER_VERTICAL|wxALL, 5 );
 	
@@ -3372,13 +3376,13 @@ TileDlgBase::TileDlgBase( wxWindow* parent, wxWindowID id, const wxString& title
 	m_tc_ogl->SetValue( true ); 
 	sbSizer32->Add( m_tc_ogl, 0, wxALIGN_CENTER_VERTICAL|wxALL, 5 );
 	
-	m_tc_squish_fast = new wxRadioButton( sbSizer32->GetStaticBox(), ID_TC_SQUISH_FAST, _("Squish fast"), wxDefaultPosition, wxDefaultSize, 0 );
-	m_tc_squish_fast->SetValue( true ); 
-	sbSizer32->Add( m_tc_squish_fast, 0, wxALIGN_CENTER_VERTICAL|wxALL, 5 );
+	m_tc_dxt_fast = new wxRadioButton( sbSizer32->GetStaticBox(), ID_TC_DXT_FAST, _("DXT fast"), wxDefaultPosition, wxDefaultSize, 0 );
+	m_tc_dxt_fast->SetValue( true ); 
+	sbSizer32->Add( m_tc_dxt_fast, 0, wxALIGN_CENTER_VERTICAL|wxALL, 5 );
 	
-	m_tc_squish_slow = new wxRadioButton( sbSizer32->GetStaticBox(), ID_TC_SQUISH_SLOW, _("Squish slow (6x slower, slightly fewer artifacts)"), wxDefaultPosition, wxDefaultSize, 0 );
-	m_tc_squish_slow->SetValue( true ); 
-	sbSizer32->Add( m_tc_squish_slow, 0, wxALIGN_CENTER_VERTICAL|wxALL, 5 );
+	m_tc_dxt_high = new wxRadioButton( sbSizer32->GetStaticBox(), ID_TC_DXT_HIGH, _("DXT high quality (2x slower, slightly fewer artifacts)"), wxDefaultPosition, wxDefaultSize, 0 );
+	m_tc_dxt_high->SetValue( true ); 
+	sbSizer32->Add( m_tc_dxt_high, 0, wxALIGN_CENTER_VERTICAL|wxALL, 5 );
 	
 	m_tc_jpeg = new wxRadioButton( sbSizer32->GetStaticBox(), ID_TC_JPEG, _("JPEG"), wxDefaultPosition, wxDefaultSize, 0 );
 	m_tc_jpeg->SetValue( true ); 
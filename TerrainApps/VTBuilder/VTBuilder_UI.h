@@ -181,6 +181,7 @@
 #define ID_RADIO9 1138
 #define ID_RADIO10 1139
 #define ID_RADIO11 1140
+#define ID_RADIO12 1234
 #define ID_ELEV_MAX_SIZE 1141
 #define ID_BT_GZIP 1142
 #define ID_DELAY_LOAD 1143
@@ -250,8 +251,8 @@
 #define ID_TEXTURE_ALPHA 1207
 #define ID_TC_NONE 1208
 #define ID_TC_OGL 1209
-#define ID_TC_SQUISH_FAST 1210
-#define ID_TC_SQUISH_SLOW 1211
+#define ID_TC_DXT_FAST 1210
+#define ID_TC_DXT_HIGH 1211
 #define ID_TC_JPEG 1212
 #define ID_USE_SPECIES 1213
 #define ID_SPECIES_CHOICE 1214
@@ -781,6 +782,7 @@ class PrefDlgBase : public wxDialog
 		wxRadioButton* m_radio9;
 		wxRadioButton* m_radio10;
 		wxRadioButton* m_radio11;
+		wxRadioButton* m_radio12;
 		wxStaticText* m_text62;
 		wxTextCtrl* m_elev_max_size;
 		wxCheckBox* m_bt_gzip;
@@ -1111,8 +1113,8 @@ class TileDlgBase : public wxDialog
 		wxCheckBox* m_texture_alpha;
 		wxRadioButton* m_tc_none;
 		wxRadioButton* m_tc_ogl;
-		wxRadioButton* m_tc_squish_fast;
-		wxRadioButton* m_tc_squish_slow;
+		wxRadioButton* m_tc_dxt_fast;
+		wxRadioButton* m_tc_dxt_high;
 		wxRadioButton* m_tc_jpeg;
 		wxButton* m_ok;
 		wxButton* m_cancel;
@@ -581,6 +581,30 @@ int vtVegLayer::FindBiotype(const DPoint2 &p)
 		return -1;
 }
 
+float vtVegLayer::FindDensity(const DPoint2 &p, int &iHint) const
+{
+	if (m_VLType != VLT_Density)
+		return -1;
+
+	int poly = ((const vtFeatureSetPolygon*)m_pSet)->FindPolygon(p, iHint);
+	if (poly != -1)
+		return m_pSet->GetFloatValue(poly, m_field_density);
+	else
+		return -1;
+}
+
+int vtVegLayer::FindBiotype(const DPoint2 &p, int &iHint) const
+{
+	if (m_VLType != VLT_BioMap)
+		return -1;
+
+	int poly = ((const vtFeatureSetPolygon*)m_pSet)->FindPolygon(p, iHint);
+	if (poly != -1)
+		return m_pSet->GetIntegerValue(poly, m_field_biotype);
+	else
+		return -1;
+}
+
 bool vtVegLayer::ExportToSHP(const char *fname)
 {
 	if (m_VLType != VLT_Instances)
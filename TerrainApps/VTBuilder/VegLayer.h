@@ -59,6 +59,9 @@ public:
 	// Search functionality
 	float FindDensity(const DPoint2 &p);
 	int   FindBiotype(const DPoint2 &p);
+	// Thread-safe versions, with a search hint kept by the caller
+	float FindDensity(const DPoint2 &p, int &iHint) const;
+	int   FindBiotype(const DPoint2 &p, int &iHint) const;
 
 	// Exporting data
 	bool ExportToSHP(const char *fname);
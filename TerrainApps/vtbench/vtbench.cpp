@@ -0,0 +1,599 @@
+//
+// vtbench.cpp
+//
+// A command-line tool which times the core operations of vtdata and vtlib
+// on synthetic data, without a display, and writes the results as JSON or
+// CSV so that they can be compared from one release to the next.
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include "vtlib/vtlib.h"
+#include "vtlib/core/Building3d.h"
+#include "vtlib/core/Contours.h"
+#include "vtlib/core/Structure3d.h"
+#include "vtlib/core/Terrain.h"
+
+#include "vtdata/DataPath.h"
+#include "vtdata/ElevationGrid.h"
+#include "vtdata/Features.h"
+#include "vtdata/FilePath.h"
+#include "vtdata/Parallel.h"
+#include "vtdata/RoadGraph.h"
+#include "vtdata/StructArray.h"
+#include "vtdata/vtDIB.h"
+#include "vtdata/vtLog.h"
+#include "vtdata/vtTin.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// The size of the synthetic area, in meters
+#define AREA_SIZE		10000.0
+// How many random queries the point and ray benchmarks make
+#define QUERY_COUNT		200000
+#define RAY_COUNT		20000
+
+void print_help()
+{
+	printf("vtbench, a headless benchmark of the VTP libraries.\n");
+	printf(" Build: ");
+#if VTDEBUG
+	printf("Debug");
+#else
+	printf("Release");
+#endif
+	printf(", date: %s\n\n", __DATE__);
+
+	printf("Command-line options:\n");
+	printf("  -size n          Size of the synthetic grid, in samples (default 1025).\n");
+	printf("  -buildings n     Number of synthetic buildings (default 2000).\n");
+	printf("  -roads n         Size of the synthetic road network, in nodes\n");
+	printf("                   along each side (default 200).\n");
+	printf("  -iterations n    How many times to run each benchmark (default 5).\n");
+	printf("  -threads n       Number of threads to use for parallel code.\n");
+	printf("  -filter text     Only run the benchmarks whose name contains text.\n");
+	printf("  -tempdir dir     Directory for temporary files (default: current).\n");
+	printf("  -datapath dir    Add a data path, for building materials.\n");
+	printf("  -out file        Write the results to a file instead of stdout.\n");
+	printf("  -csv             Write CSV instead of JSON.\n");
+	printf("  -list            List the benchmarks and exit.\n");
+	printf("\n");
+	printf("Times are in milliseconds.  Each benchmark reports the number of\n"
+		" items it processes per iteration, so results from runs with\n"
+		" different sizes can still be compared.\n");
+	printf("\n");
+}
+
+/**
+ * One benchmark.  Setup runs before each iteration and is not timed.
+ */
+struct Benchmark
+{
+	const char *m_szName;
+	std::function<void()> m_Setup;
+	std::function<void()> m_Run;
+	double m_dItems;		// items processed per iteration
+};
+
+struct BenchResult
+{
+	vtString m_Name;
+	int m_iIterations;
+	double m_dItems;
+	double m_dMin, m_dMean, m_dMedian, m_dMax;	// milliseconds
+};
+
+typedef std::chrono::steady_clock BenchClock;
+
+double ElapsedMS(const BenchClock::time_point &start)
+{
+	return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+}
+
+bool RunBenchmark(const Benchmark &bench, int iIterations, BenchResult &result)
+{
+	std::vector<double> times;
+
+	// One untimed run first, to warm up the caches and the thread pool
+	for (int i = -1; i < iIterations; i++)
+	{
+		if (bench.m_Setup)
+			bench.m_Setup();
+		BenchClock::time_point start = BenchClock::now();
+		bench.m_Run();
+		if (i >= 0)
+			times.push_back(ElapsedMS(start));
+	}
+	if (times.empty())
+		return false;
+
+	std::sort(times.begin(), times.end());
+	double sum = 0.0;
+	for (size_t i = 0; i < times.size(); i++)
+		sum += times[i];
+
+	result.m_Name = bench.m_szName;
+	result.m_iIterations = iIterations;
+	result.m_dItems = bench.m_dItems;
+	result.m_dMin = times.front();
+	result.m_dMax = times.back();
+	result.m_dMean = sum / times.size();
+	result.m_dMedian = times[times.size() / 2];
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Synthetic data
+
+void MakeGrid(vtElevationGrid &grid, int iSize)
+{
+	vtCRS crs;
+	crs.SetSimple(true, 10, EPSG_DATUM_WGS84);
+
+	const DRECT area(500000, 4100000 + AREA_SIZE, 500000 + AREA_SIZE, 4100000);
+	grid.Create(area, IPoint2(iSize, iSize), true, crs);
+
+	// Rolling hills with some finer detail, so that every operation has
+	//  some work to do.
+	for (int i = 0; i < iSize; i++)
+	{
+		const double x = (double) i / (iSize - 1);
+		for (int j = 0; j < iSize; j++)
+		{
+			const double y = (double) j / (iSize - 1);
+			const double h = 400 * sin(x * 7.1) * cos(y * 5.3) +
+				120 * sin(x * 31.0 + y * 17.0) + 25 * cos(x * 97.0 - y * 113.0);
+			grid.SetFValue(i, j, (float) (500 + h));
+		}
+	}
+	grid.ComputeHeightExtents();
+	grid.SetupLocalCS(1.0f);
+}
+
+// A planar grid, one tile in size, must reduce to the tile's two triangles
+//  even when the TIN has to match every heixel exactly.
+bool CheckPlanarTin()
+{
+	vtCRS crs;
+	crs.SetSimple(true, 10, EPSG_DATUM_WGS84);
+
+	const int iSize = 129;
+	const DRECT area(500000, 4100000 + AREA_SIZE, 500000 + AREA_SIZE, 4100000);
+	vtElevationGrid grid;
+	grid.Create(area, IPoint2(iSize, iSize), true, crs);
+	for (int i = 0; i < iSize; i++)
+		for (int j = 0; j < iSize; j++)
+			grid.SetFValue(i, j, (float) (100 + 2 * i + j));
+
+	vtTin tin;
+	return tin.CreateFromGrid(&grid, 0.0f) && tin.NumTris() == 2;
+}
+
+// A TIN with every triangle having its own three vertices, as read from a
+//  format such as DXF, which MergeSharedVerts can then merge.
+void MakeUnsharedTin(const vtTin &source, vtTin &tin)
+{
+	tin.FreeData();
+	tin.m_crs = source.m_crs;
+	const uint tris = source.NumTris();
+	DPoint2 p;
+	float z;
+	for (uint i = 0; i < tris; i++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			source.GetVert(source.GetAtTri(i)[k], p, z);
+			tin.AddVert(p, z);
+		}
+		tin.AddTri(i*3, i*3+1, i*3+2);
+	}
+	tin.ComputeExtents();
+}
+
+void MakeBuildings(vtStructureArray &sa, const vtCRS &crs, int iCount)
+{
+	sa.m_crs = crs;
+	vtRandomGen random(1234);
+
+	const RoofType roofs[4] = { ROOF_FLAT, ROOF_SHED, ROOF_GABLE, ROOF_HIP };
+	for (int i = 0; i < iCount; i++)
+	{
+		vtBuilding *bld = sa.AddNewBuilding();
+		const DPoint2 center(500000 + 100 + random.Random(1.0f) * (AREA_SIZE - 200),
+			4100000 + 100 + random.Random(1.0f) * (AREA_SIZE - 200));
+		bld->SetRectangle(center, 10 + random.Random(1.0f) * 30,
+			10 + random.Random(1.0f) * 30, random.Random(1.0f) * PI2f);
+		bld->SetNumStories(1 + (int) (random.Random(1.0f) * 6));
+		bld->SetRoofType(roofs[i % 4], 20);
+	}
+}
+
+// A square lattice of roads, iSize nodes on each side
+void MakeRoads(vtRoadMap &map, int iSize)
+{
+	std::vector<TNode*> nodes(iSize * iSize);
+	const double spacing = AREA_SIZE / (iSize - 1);
+	for (int j = 0; j < iSize; j++)
+	{
+		for (int i = 0; i < iSize; i++)
+		{
+			TNode *node = map.AddNewNode();
+			node->m_id = j * iSize + i;
+			node->SetPos(500000 + i * spacing, 4100000 + j * spacing);
+			nodes[j * iSize + i] = node;
+		}
+	}
+	for (int j = 0; j < iSize; j++)
+	{
+		for (int i = 0; i < iSize; i++)
+		{
+			TNode *node = nodes[j * iSize + i];
+			for (int dir = 0; dir < 2; dir++)
+			{
+				if ((dir == 0 && i == iSize - 1) || (dir == 1 && j == iSize - 1))
+					continue;
+				TNode *other = nodes[dir == 0 ? j * iSize + i + 1 : (j + 1) * iSize + i];
+				TLink *link = map.AddNewLink();
+				link->Append(node->Pos());
+				link->Append(other->Pos());
+				link->m_iLanes = 2;
+				link->m_Surface = ((i + j) % 7 == 0) ? SURFT_GRAVEL : SURFT_PAVED;
+				link->ConnectNodes(node, other);
+			}
+		}
+	}
+	map.ComputeExtents();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Output
+
+void WriteJSON(FILE *fp, const std::vector<BenchResult> &results, int iSize)
+{
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"program\": \"vtbench\",\n");
+#if VTDEBUG
+	fprintf(fp, "  \"build\": \"Debug\",\n");
+#else
+	fprintf(fp, "  \"build\": \"Release\",\n");
+#endif
+	fprintf(fp, "  \"date\": \"%s\",\n", __DATE__);
+	fprintf(fp, "  \"threads\": %d,\n", vtGetNumThreads());
+	fprintf(fp, "  \"grid_size\": %d,\n", iSize);
+	fprintf(fp, "  \"results\": [\n");
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult &r = results[i];
+		fprintf(fp, "    { \"name\": \"%s\", \"iterations\": %d, \"items\": %.0f, "
+			"\"min_ms\": %.4f, \"mean_ms\": %.4f, \"median_ms\": %.4f, \"max_ms\": %.4f }%s\n",
+			(const char *) r.m_Name, r.m_iIterations, r.m_dItems, r.m_dMin,
+			r.m_dMean, r.m_dMedian, r.m_dMax, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(fp, "  ]\n}\n");
+}
+
+void WriteCSV(FILE *fp, const std::vector<BenchResult> &results)
+{
+	fprintf(fp, "name,iterations,items,min_ms,mean_ms,median_ms,max_ms\n");
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult &r = results[i];
+		fprintf(fp, "%s,%d,%.0f,%.4f,%.4f,%.4f,%.4f\n", (const char *) r.m_Name,
+			r.m_iIterations, r.m_dItems, r.m_dMin, r.m_dMean, r.m_dMedian, r.m_dMax);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv)
+{
+	int iSize = 1025;
+	int iBuildings = 2000;
+	int iRoads = 200;
+	int iIterations = 5;
+	bool bCSV = false, bList = false;
+	vtString filter, tempdir = ".", fname_out;
+
+	for (int i = 1; i < argc; i++)
+	{
+		vtString str = argv[i];
+		const bool bHasArg = (i + 1 < argc);
+		if (str == "-h" || str == "-help" || str == "--help")
+		{
+			print_help();
+			return 0;
+		}
+		else if (str == "-size" && bHasArg)
+			iSize = std::max(atoi(argv[++i]), 17);
+		else if (str == "-buildings" && bHasArg)
+			iBuildings = std::max(atoi(argv[++i]), 1);
+		else if (str == "-roads" && bHasArg)
+			iRoads = std::max(atoi(argv[++i]), 2);
+		else if (str == "-iterations" && bHasArg)
+			iIterations = std::max(atoi(argv[++i]), 1);
+		else if (str == "-threads" && bHasArg)
+			vtSetNumThreads(atoi(argv[++i]));
+		else if (str == "-filter" && bHasArg)
+			filter = argv[++i];
+		else if (str == "-tempdir" && bHasArg)
+			tempdir = argv[++i];
+		else if (str == "-datapath" && bHasArg)
+			vtGetDataPath().push_back(vtString(argv[++i]));
+		else if (str == "-out" && bHasArg)
+			fname_out = argv[++i];
+		else if (str == "-csv")
+			bCSV = true;
+		else if (str == "-list")
+			bList = true;
+		else
+		{
+			fprintf(stderr, "Unrecognized option '%s', try -help\n", argv[i]);
+			return 1;
+		}
+	}
+	VTSTARTLOG("vtbench_log.txt");
+
+	if (tempdir.Right(1) != "/" && tempdir.Right(1) != "\\")
+		tempdir += "/";
+	const vtString fname_bt = tempdir + "vtbench_temp.bt";
+	const vtString fname_vtst = tempdir + "vtbench_temp.vtst";
+
+	// Synthetic data shared by the benchmarks
+	vtElevationGrid grid;
+	MakeGrid(grid, iSize);
+	const double dSamples = (double) iSize * iSize;
+
+	vtTin tin;
+	tin.CreateFromGrid(&grid, 2.0f);
+	vtTin unshared;
+	const bool bTinOK = CheckPlanarTin();
+
+	vtStructureArray structures;
+	MakeBuildings(structures, grid.GetCRS(), iBuildings);
+	structures.WriteXML(fname_vtst);
+	std::unique_ptr<vtStructureArray> read_structures;
+
+	vtStructure3d::InitializeMaterialArrays();
+	vtStructureArray3d structures3d;
+	MakeBuildings(structures3d, grid.GetCRS(), iBuildings);
+
+	vtRoadMap roads;
+	MakeRoads(roads, iRoads);
+	vtRoadGraph graph;
+	graph.Build(roads);
+
+	// A terrain around the grid, without any scene graph, for the vtlib code
+	//  which needs one.  It is told to preserve the grid, so it won't delete it.
+	vtTerrain terrain;
+	terrain.SetLocalGrid(&grid, true);
+	terrain.CreateStep1();
+	terrain.CreateStep2();
+
+	// Random queries, the same every run
+	vtRandomGen random(42);
+	std::vector<DPoint2> points(QUERY_COUNT);
+	const DRECT &ext = grid.GetEarthExtents();
+	for (size_t i = 0; i < points.size(); i++)
+		points[i].Set(ext.left + random.Random(1.0f) * ext.Width(),
+			ext.bottom + random.Random(1.0f) * ext.Height());
+
+	float fMinHeight, fMaxHeight;
+	grid.GetHeightExtents(fMinHeight, fMaxHeight);
+	std::vector<FPoint3> ray_start(RAY_COUNT), ray_dir(RAY_COUNT);
+	const FRECT &wext = grid.m_WorldExtents;
+	for (int i = 0; i < RAY_COUNT; i++)
+	{
+		ray_start[i].Set(wext.left + random.Random(1.0f) * wext.Width(),
+			fMaxHeight + 100.0f,
+			wext.bottom + random.Random(1.0f) * (wext.top - wext.bottom));
+		ray_dir[i].Set(random.Random(1.0f) * 2 - 1, -1.0f, random.Random(1.0f) * 2 - 1);
+		ray_dir[i].Normalize();
+	}
+
+	vtDIB dib;
+	dib.Allocate(IPoint2(iSize - 1, iSize - 1), 24);
+	FPoint3 light_dir(-1.0f, -1.0f, -1.0f);
+	light_dir.Normalize();
+
+	float fSink = 0.0f;	// so that the compiler can't discard any work
+	std::vector<Benchmark> benchmarks;
+	Benchmark b;
+
+	b.m_szName = "bt_save";
+	b.m_Setup = nullptr;
+	b.m_Run = [&]() { grid.SaveToBT(fname_bt); };
+	b.m_dItems = dSamples;
+	benchmarks.push_back(b);
+
+	// Write the file to load here, in case bt_save was filtered out
+	bool bWroteBT = false;
+	b.m_szName = "bt_load";
+	b.m_Setup = [&]() { if (!bWroteBT) bWroteBT = grid.SaveToBT(fname_bt); };
+	b.m_Run = [&]() { vtElevationGrid loaded; loaded.LoadFromBT(fname_bt); };
+	b.m_dItems = dSamples;
+	benchmarks.push_back(b);
+
+	b.m_szName = "grid_filtered_value";
+	b.m_Setup = nullptr;
+	b.m_Run = [&]() {
+		for (size_t i = 0; i < points.size(); i++)
+			fSink += grid.GetFilteredValue(points[i]);
+	};
+	b.m_dItems = QUERY_COUNT;
+	benchmarks.push_back(b);
+
+	b.m_szName = "grid_cast_ray";
+	b.m_Setup = nullptr;
+	b.m_Run = [&]() {
+		FPoint3 result;
+		for (int i = 0; i < RAY_COUNT; i++)
+			if (grid.CastRayToSurface(ray_start[i], ray_dir[i], result))
+				fSink += result.y;
+	};
+	b.m_dItems = RAY_COUNT;
+	benchmarks.push_back(b);
+
+	b.m_szName = "grid_shade_dib";
+	b.m_Setup = nullptr;
+	b.m_Run = [&]() { grid.ShadeDibFromElevation(&dib, light_dir, 1.0f); };
+	b.m_dItems = dSamples;
+	benchmarks.push_back(b);
+
+	b.m_szName = "tin_from_grid";
+	b.m_Setup = nullptr;
+	b.m_Run = [&]() { vtTin t; t.CreateFromGrid(&grid, 2.0f); };
+	b.m_dItems = dSamples;
+	benchmarks.push_back(b);
+
+	b.m_szName = "tin_merge_shared_verts";
+	b.m_Setup = [&]() { MakeUnsharedTin(tin, unshared); };
+	b.m_Run = [&]() { unshared.MergeSharedVerts(); };
+	b.m_dItems = tin.NumTris() * 3.0;
+	benchmarks.push_back(b);
+
+	b.m_szName = "structures_read_xml";
+	b.m_Setup = [&]() { read_structures.reset(new vtStructureArray); };
+	b.m_Run = [&]() { read_structures->ReadXML(fname_vtst); };
+	b.m_dItems = iBuildings;
+	benchmarks.push_back(b);
+
+	b.m_szName = "building_geometry";
+	b.m_Setup = nullptr;
+	b.m_Run = [&]() {
+		for (int i = 0; i < iBuildings; i++)
+			structures3d.GetBuilding(i)->CreateNode(&terrain);
+	};
+	b.m_dItems = iBuildings;
+	benchmarks.push_back(b);
+
+#if SUPPORT_QUIKGRID
+	b.m_szName = "contours";
+	b.m_Setup = nullptr;
+	b.m_Run = [&]() {
+		vtFeatureSetLineString lines;
+		vtContourConverter cc;
+		if (cc.Setup(&terrain, &lines))
+		{
+			cc.GenerateContours(25);
+			cc.Finish();
+		}
+	};
+	b.m_dItems = dSamples;
+	benchmarks.push_back(b);
+#endif
+
+	b.m_szName = "road_route";
+	b.m_Setup = nullptr;
+	b.m_Run = [&]() {
+		vtRoadGraph::Route route;
+		vtRoadGraph::Search search;
+		const uint last = graph.NumNodes() - 1;
+		for (uint i = 0; i < 20; i++)
+		{
+			// corner to corner, and across the middle
+			graph.FindRoute(i, last - i, route, vtRoadGraph::ROUTE_ASTAR, search);
+			fSink += (float) route.m_dTime;
+		}
+	};
+	b.m_dItems = 20;
+	benchmarks.push_back(b);
+
+	// A task graph whose tasks use vtParallelFor themselves, both on the
+	//  graph's threads and on this thread, as vtTerrain::CreateParallel does.
+	//  The count is checked, so this is also a test that nesting works.  With
+	//  more than one thread, the read tasks must run off this thread, and the
+	//  attach task's loop, which runs once they are all done, must get help
+	//  from the pool.
+	std::atomic<int> iGraphItems(0), iReadsElsewhere(0), iAttachHelped(0);
+	bool bGraphOK = true;
+	b.m_szName = "task_graph_nested";
+	b.m_Setup = [&]() { iGraphItems = 0; iReadsElsewhere = 0; iAttachHelped = 0; };
+	b.m_Run = [&]() {
+		const std::thread::id main_id = std::this_thread::get_id();
+		vtTaskGraph tasks;
+		const int attach = tasks.AddTask("attach", [&]() {
+			vtParallelFor(1000, [&](int) {
+				iGraphItems++;
+				if (std::this_thread::get_id() != main_id)
+					iAttachHelped++;
+				// long enough that the pool's threads have time to join in
+				std::this_thread::sleep_for(std::chrono::microseconds(10));
+			});
+		}, true);
+		for (int i = 0; i < 8; i++)
+		{
+			const int read = tasks.AddTask("read", [&]() {
+				if (std::this_thread::get_id() != main_id)
+					iReadsElsewhere++;
+				vtParallelFor(1000, [&](int) { iGraphItems++; });
+			});
+			tasks.AddDependency(attach, read);
+		}
+		if (!tasks.Run() || iGraphItems != 9000)
+			bGraphOK = false;
+		if (vtGetNumThreads() > 1 && (iReadsElsewhere == 0 || iAttachHelped == 0))
+			bGraphOK = false;
+	};
+	b.m_dItems = 9000;
+	benchmarks.push_back(b);
+
+	if (bList)
+	{
+		for (size_t i = 0; i < benchmarks.size(); i++)
+			printf("%s\n", benchmarks[i].m_szName);
+		return 0;
+	}
+
+	std::vector<BenchResult> results;
+	for (size_t i = 0; i < benchmarks.size(); i++)
+	{
+		const Benchmark &bench = benchmarks[i];
+		if (filter != "" && vtString(bench.m_szName).Find(filter) == -1)
+			continue;
+
+		fprintf(stderr, "%s...\n", bench.m_szName);
+		BenchResult result;
+		if (RunBenchmark(bench, iIterations, result))
+			results.push_back(result);
+	}
+	VTLOG("vtbench: %d benchmarks run (%f)\n", (int) results.size(), fSink);
+
+	vtDeleteFile(fname_bt);
+	vtDeleteFile(fname_vtst);
+
+	FILE *fp = stdout;
+	if (fname_out != "")
+	{
+		fp = vtFileOpen(fname_out, "wb");
+		if (!fp)
+		{
+			fprintf(stderr, "Couldn't open output file '%s'\n", (const char *) fname_out);
+			return 1;
+		}
+	}
+	if (bCSV)
+		WriteCSV(fp, results);
+	else
+		WriteJSON(fp, results, iSize);
+	if (fp != stdout)
+		fclose(fp);
+
+	if (!bTinOK)
+	{
+		fprintf(stderr, "tin_from_grid: a planar grid did not reduce to two triangles\n");
+		return 1;
+	}
+	if (!bGraphOK)
+	{
+		fprintf(stderr, "task_graph_nested: the tasks did not all run, or ran without help\n");
+		return 1;
+	}
+	return 0;
+}
@@ -385,10 +385,31 @@ int mapEPSG2MINI(int epsgdatum)
 	return(SPHERE);
 }
 
+const char *TileCompressionName(vtTileCompression eComp)
+{
+	switch (eComp)
+	{
+	case TILECOMP_FAST: return "Fast";
+	case TILECOMP_BEST: return "Best";
+	default: return "None";
+	}
+}
+
+vtTileCompression TileCompressionFromName(const char *szName)
+{
+	vtString name = szName;
+	name.TrimRight();
+	if (name.CompareNoCase("Fast") == 0)
+		return TILECOMP_FAST;
+	if (name.CompareNoCase("Best") == 0)
+		return TILECOMP_BEST;
+	return TILECOMP_NONE;
+}
+
 bool WriteTilesetHeader(const char *filename, int cols, int rows, int lod0size,
 						const DRECT &area, const vtCRS &crs,
 						float minheight, float maxheight,
-						LODMap *lodmap, bool bJPEG)
+						LODMap *lodmap, bool bJPEG, vtTileCompression eCompression)
 {
 	FILE *fp = vtFileOpen(filename, "wb");
 	if (!fp)
@@ -469,6 +490,9 @@ bool WriteTilesetHeader(const char *filename, int cols, int rows, int lod0size,
 	else
 		fprintf(fp, "Format=DB\n");
 
+	if (eCompression != TILECOMP_NONE)
+		fprintf(fp, "Compression=%s\n", TileCompressionName(eCompression));
+
 	fclose(fp);
 
 	return true;
@@ -134,9 +134,25 @@ public:
 	int *m_min, *m_max;
 };
 
+/**
+ * How the tiles of an elevation tileset are compressed.  The choice is
+ * recorded in the tileset .ini as "Compression=", and each tile is also
+ * marked in its own header, so libMini decodes the tiles without being told.
+ */
+enum vtTileCompression
+{
+	TILECOMP_NONE,	///< Raw samples, as tilesets have always been written.
+	TILECOMP_FAST,	///< zlib at its fastest level; lossless, and cheap to encode.
+	TILECOMP_BEST	///< zlib at its best level; smaller, but much slower to encode.
+};
+
+const char *TileCompressionName(vtTileCompression eComp);
+vtTileCompression TileCompressionFromName(const char *szName);
+
 bool WriteTilesetHeader(const char *filename, int cols, int rows, int lod0size,
 						const DRECT &area, const vtCRS &crs,
 						float minheight=INVALID_ELEVATION, float maxheight=INVALID_ELEVATION,
-						LODMap *lodmap = NULL, bool bJPEG = false);
+						LODMap *lodmap = NULL, bool bJPEG = false,
+						vtTileCompression eCompression = TILECOMP_NONE);
 
 #endif
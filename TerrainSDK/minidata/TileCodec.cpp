@@ -0,0 +1,215 @@
+//
+// TileCodec.cpp
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+
+extern "C"
+{
+#include <zlib.h>
+}
+
+#include "TileCodec.h"
+#include "zlibbase.h"
+#include "vtdata/Parallel.h"
+#include "vtdata/vtLog.h"
+
+// zlib streams are costly to set up (deflate allocates a few hundred KB), so
+//  each thread keeps one of each and resets it between tiles.
+struct ZStreams
+{
+	ZStreams() : m_bDeflate(false), m_bInflate(false), m_iLevel(-1) {}
+	~ZStreams()
+	{
+		if (m_bDeflate)
+			deflateEnd(&m_deflate);
+		if (m_bInflate)
+			inflateEnd(&m_inflate);
+	}
+	z_stream m_deflate, m_inflate;
+	bool m_bDeflate, m_bInflate;
+	int m_iLevel;
+};
+static thread_local ZStreams s_zstreams;
+
+// The zlib level for tiles encoded on this thread, or -1 for the default.
+static thread_local int s_iZlibLevel = -1;
+
+static int ZlibLevelFor(vtTileCompression eComp)
+{
+	return (eComp == TILECOMP_FAST) ? Z_BEST_SPEED : Z_BEST_COMPRESSION;
+}
+
+
+///////////////////////////////////////////////////////////////////////
+
+vtTileCodec::vtTileCodec(vtTileCompression eComp)
+{
+	m_eCompression = eComp;
+	m_iFailed = 0;
+}
+
+vtTileCodec::~vtTileCodec()
+{
+	Clear();
+}
+
+/**
+ * Add a tile to be written by WriteTiles.  The codec takes over the tile's
+ * data, and frees it once the tile is written, so the caller should not
+ * release the buffer.
+ */
+void vtTileCodec::AddTile(const databuf &buf, const char *szFileName)
+{
+	Tile tile;
+	tile.m_buf = buf;
+	tile.m_strFileName = szFileName;
+	m_Tiles.push_back(tile);
+}
+
+/**
+ * Write all the tiles which have been added, in parallel, compressing them
+ * as set by SetCompression.  The tiles are then freed and the list cleared.
+ *
+ * \return false if the operation was cancelled, or any tile could not be
+ *	written; see NumFailed.
+ */
+bool vtTileCodec::WriteTiles(bool progress_callback(int))
+{
+	const int iLevel = ZlibLevelFor(m_eCompression);
+	const unsigned int extformat = (m_eCompression == TILECOMP_NONE) ?
+		databuf::DATABUF_EXTFMT_PLAIN : databuf::DATABUF_EXTFMT_Z;
+
+	std::atomic<uint> failed(0);
+	bool bCompleted = vtParallelFor((int) m_Tiles.size(), [&](int i)
+	{
+		Tile &tile = m_Tiles[i];
+		s_iZlibLevel = iLevel;
+		if (tile.m_buf.savedata(tile.m_strFileName, extformat) == 0)
+		{
+			VTLOG("Couldn't write tile '%s'\n", (const char *) tile.m_strFileName);
+			failed++;
+		}
+		s_iZlibLevel = -1;
+		tile.m_buf.release();
+	}, progress_callback);
+
+	m_iFailed = failed;
+	Clear();
+	return bCompleted && m_iFailed == 0;
+}
+
+/**
+ * Free any tiles which were added but not written.
+ */
+void vtTileCodec::Clear()
+{
+	for (size_t i = 0; i < m_Tiles.size(); i++)
+		m_Tiles[i].m_buf.release();
+	m_Tiles.clear();
+}
+
+/**
+ * The zlib level the conversion hook should use on the calling thread:
+ * the level of the vtTileCodec writing on this thread, if any, otherwise
+ * the given default.
+ */
+int vtTileCodec::ThreadZlibLevel(int iDefault)
+{
+	return (s_iZlibLevel >= 0) ? s_iZlibLevel : iDefault;
+}
+
+/**
+ * Compress a block of data to zlib format, using this thread's reusable
+ * stream.  The result is allocated with malloc(), as libMini expects.
+ */
+bool vtTileCodec::CompressZ(const uchar *data, uint bytes, int level,
+	uchar **chunk, uint *chunklen)
+{
+	*chunk = NULL;
+	*chunklen = 0;
+
+	ZStreams &zs = s_zstreams;
+	if (zs.m_bDeflate && zs.m_iLevel != level)
+	{
+		deflateEnd(&zs.m_deflate);
+		zs.m_bDeflate = false;
+	}
+	if (zs.m_bDeflate)
+		deflateReset(&zs.m_deflate);
+	else
+	{
+		memset(&zs.m_deflate, 0, sizeof(z_stream));
+		if (deflateInit(&zs.m_deflate, level) != Z_OK)
+			return false;
+		zs.m_bDeflate = true;
+		zs.m_iLevel = level;
+	}
+
+	// deflateBound is a guaranteed upper limit, so one pass always suffices
+	uLong bound = deflateBound(&zs.m_deflate, bytes);
+	uchar *mem = (uchar *) malloc(bound);
+	if (!mem)
+		return false;
+
+	zs.m_deflate.next_in = (Bytef *) data;
+	zs.m_deflate.avail_in = bytes;
+	zs.m_deflate.next_out = mem;
+	zs.m_deflate.avail_out = (uInt) bound;
+	if (deflate(&zs.m_deflate, Z_FINISH) != Z_STREAM_END)
+	{
+		free(mem);
+		return false;
+	}
+	uint len = (uint) (bound - zs.m_deflate.avail_out);
+
+	// give back the unused tail; shrinking in place is cheap
+	uchar *shrunk = (uchar *) realloc(mem, len);
+	*chunk = shrunk ? shrunk : mem;
+	*chunklen = len;
+	return true;
+}
+
+/**
+ * Decompress a block of zlib data, using this thread's reusable stream.
+ * If the size of the result is known, pass it as 'expected' so the output
+ * is allocated once, at the right size; otherwise pass 0.  The result is
+ * allocated with malloc(), as libMini expects.
+ */
+uchar *vtTileCodec::DecompressZ(const uchar *chunk, uint chunklen,
+	uint expected, uint *bytes)
+{
+	if (expected != 0)
+	{
+		ZStreams &zs = s_zstreams;
+		bool bReady = true;
+		if (zs.m_bInflate)
+			inflateReset(&zs.m_inflate);
+		else
+		{
+			memset(&zs.m_inflate, 0, sizeof(z_stream));
+			bReady = zs.m_bInflate = (inflateInit(&zs.m_inflate) == Z_OK);
+		}
+		uchar *mem = bReady ? (uchar *) malloc(expected) : NULL;
+		if (mem)
+		{
+			zs.m_inflate.next_in = (Bytef *) chunk;
+			zs.m_inflate.avail_in = chunklen;
+			zs.m_inflate.next_out = mem;
+			zs.m_inflate.avail_out = expected;
+			if (inflate(&zs.m_inflate, Z_FINISH) == Z_STREAM_END)
+			{
+				*bytes = expected - zs.m_inflate.avail_out;
+				return mem;
+			}
+			free(mem);
+		}
+	}
+	// The size was unknown or wrong; fall back to guessing
+	return zlibbase::decompressZLIB((uchar *) chunk, chunklen, bytes);
+}
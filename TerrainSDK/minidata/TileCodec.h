@@ -0,0 +1,71 @@
+//
+// TileCodec.h
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef TileCodec_H
+#define TileCodec_H
+
+#include <vector>
+#include "vtdata/vtString.h"
+#include "MiniDatabuf.h"
+
+#include <mini/database.h> // part of libMini
+
+/**
+ * Writes many libMini elevation tiles (.db files) at once, spreading the
+ * encoding across worker threads.
+ *
+ * The zlib streams used to (de)compress are kept per thread and reused from
+ * one tile to the next, and the compressed output is sized exactly, rather
+ * than guessed at and retried, so a batch does only one allocation per tile.
+ *
+ \code
+	vtTileCodec codec(TILECOMP_FAST);
+	for (each tile)
+	{
+		vtMiniDatabuf buf;
+		buf.alloc(...);
+		codec.AddTile(buf, fname);	// the codec now owns the data
+	}
+	codec.WriteTiles();
+ \endcode
+ */
+class vtTileCodec
+{
+public:
+	vtTileCodec(vtTileCompression eComp = TILECOMP_NONE);
+	~vtTileCodec();
+
+	void SetCompression(vtTileCompression eComp) { m_eCompression = eComp; }
+	vtTileCompression GetCompression() const { return m_eCompression; }
+
+	void AddTile(const databuf &buf, const char *szFileName);
+	uint NumTiles() const { return (uint) m_Tiles.size(); }
+	bool WriteTiles(bool progress_callback(int) = NULL);
+	void Clear();
+
+	/// The number of tiles which could not be written by the last WriteTiles.
+	uint NumFailed() const { return m_iFailed; }
+
+	// Used by the libMini conversion hook.
+	static int ThreadZlibLevel(int iDefault);
+	static bool CompressZ(const uchar *data, uint bytes, int level,
+		uchar **chunk, uint *chunklen);
+	static uchar *DecompressZ(const uchar *chunk, uint chunklen,
+		uint expected, uint *bytes);
+
+protected:
+	struct Tile
+	{
+		databuf m_buf;
+		vtString m_strFileName;
+	};
+	std::vector<Tile> m_Tiles;
+	vtTileCompression m_eCompression;
+	uint m_iFailed;
+};
+
+#endif // TileCodec_H
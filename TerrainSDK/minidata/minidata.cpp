@@ -10,6 +10,7 @@
 #include "jpegbase.h"
 #include "pngbase.h"
 #include "zlibbase.h"
+#include "TileCodec.h"
 
 #include <mini/database.h> // for databuf
 
@@ -24,6 +25,24 @@ struct MINI_CONVERSION_HOOK_STRUCT
 
 typedef MINI_CONVERSION_HOOK_STRUCT MINI_CONVERSION_PARAMS;
 
+// the number of bytes of raw data in an uncompressed databuf, or 0 if unknown
+static unsigned int rawbytes(const databuf *obj)
+{
+	unsigned int cell;
+
+	switch (obj->type)
+	{
+	case 0: cell=1; break;
+	case 1: cell=2; break;
+	case 2: cell=4; break;
+	case 3: cell=3; break;
+	case 4: cell=4; break;
+	default: return(0);
+	}
+
+	return(obj->xsize*obj->ysize*obj->zsize*obj->tsteps*cell);
+}
+
 // libMini conversion hook for external formats (JPEG/PNG/Z)
 int conversionhook(int israwdata,unsigned char *srcdata, long long bytes,unsigned int extformat,
                    unsigned char **newdata,long long *newbytes,
@@ -126,7 +145,7 @@ int conversionhook(int israwdata,unsigned char *srcdata, long long bytes,unsigne
 
 		if (israwdata==0)
 		{
-			*newdata=zlibbase::decompressZLIB(srcdata, (unsigned int)bytes,&nbytes);
+			*newdata=vtTileCodec::DecompressZ(srcdata, (unsigned int)bytes,rawbytes(obj),&nbytes);
 
 			if (*newdata==NULL) return(0); // return failure
 
@@ -134,7 +153,8 @@ int conversionhook(int israwdata,unsigned char *srcdata, long long bytes,unsigne
 		}
 		else
 		{
-			zlibbase::compressZLIB(srcdata, (unsigned int)bytes,newdata,&nbytes,conversion_params->zlib_level);
+			vtTileCodec::CompressZ(srcdata, (unsigned int)bytes,
+				vtTileCodec::ThreadZlibLevel(conversion_params->zlib_level),newdata,&nbytes);
 
 			if (*newdata==NULL) return(0); // return failure
 
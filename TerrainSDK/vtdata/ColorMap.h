@@ -32,7 +32,12 @@ public:
 	void GenerateColorTable(int iTableSize, float fMin, float fMax);
 	const RGBi &ColorFromTable(float fElev) const
 	{
-		return m_table[(uint)((fElev - m_fMin) / m_fRange * m_iTableSize)];
+		// Elevations outside the range of the table, for example after the
+		//  terrain has been edited, get the color at its ends.
+		int index = (int)((fElev - m_fMin) / m_fRange * m_iTableSize);
+		if (index < 0) index = 0;
+		if (index > m_iTableSize) index = m_iTableSize;
+		return m_table[index];
 	}
 
 	// Fast lookup
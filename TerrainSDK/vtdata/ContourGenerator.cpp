@@ -0,0 +1,399 @@
+//
+// ContourGenerator.cpp
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "ContourGenerator.h"
+#include "Parallel.h"
+#include "vtLog.h"
+
+typedef vtContourGenerator::Piece Piece;
+
+// Every edge of the grid has an ID: the edge from (i,j) to (i+1,j) is
+//  2*(j*nx+i), and the edge from (i,j) to (i,j+1) is one more.
+static inline int64_t HorizEdge(int i, int j, int nx) { return ((int64_t) j * nx + i) * 2; }
+static inline int64_t VertEdge(int i, int j, int nx) { return ((int64_t) j * nx + i) * 2 + 1; }
+
+// For each case of marching squares, the pairs of cell edges (0 bottom,
+//  1 right, 2 top, 3 left) which contour segments connect.  The corners are
+//  numbered 0 (i,j), 1 (i+1,j), 2 (i+1,j+1), 3 (i,j+1), and bit n of the
+//  case is set when corner n is at or above the level.  The saddles, 5 and
+//  10, are decided by the center value, so they aren't in the table.
+static const int s_CaseSegments[16][4] =
+{
+	{ -1, -1, -1, -1 },	// 0
+	{ 3, 0, -1, -1 },	// 1
+	{ 0, 1, -1, -1 },	// 2
+	{ 3, 1, -1, -1 },	// 3
+	{ 1, 2, -1, -1 },	// 4
+	{ -1, -1, -1, -1 },	// 5, saddle
+	{ 0, 2, -1, -1 },	// 6
+	{ 3, 2, -1, -1 },	// 7
+	{ 2, 3, -1, -1 },	// 8
+	{ 0, 2, -1, -1 },	// 9
+	{ -1, -1, -1, -1 },	// 10, saddle
+	{ 1, 2, -1, -1 },	// 11
+	{ 1, 3, -1, -1 },	// 12
+	{ 0, 1, -1, -1 },	// 13
+	{ 3, 0, -1, -1 },	// 14
+	{ -1, -1, -1, -1 }	// 15
+};
+
+/**
+ * Join pieces end to end wherever they share an edge.  Each edge is shared
+ * by at most two pieces, so the pieces form simple chains and loops.
+ */
+static void JoinPieces(const std::vector<Piece> &in, std::vector<Piece> &out)
+{
+	const int num = (int) in.size();
+
+	// Where each end of each open piece is; the value is piece*2+end
+	std::unordered_map<int64_t, std::vector<int> > ends;
+	ends.reserve(num * 2);
+	for (int p = 0; p < num; p++)
+	{
+		if (in[p].m_bClosed)
+			continue;
+		ends[in[p].m_iStart].push_back(p * 2);
+		ends[in[p].m_iEnd].push_back(p * 2 + 1);
+	}
+
+	std::vector<bool> used(num, false);
+	std::vector<std::pair<int, bool> > chain;	// piece, reversed
+	for (int p = 0; p < num; p++)
+	{
+		if (used[p])
+			continue;
+		used[p] = true;
+		if (in[p].m_bClosed)
+		{
+			out.push_back(in[p]);
+			continue;
+		}
+
+		// Follow the chain forward from the end of this piece, then back
+		//  from its start.
+		std::vector<std::pair<int, bool> > forward, backward;
+		for (int dir = 0; dir < 2; dir++)
+		{
+			std::vector<std::pair<int, bool> > &list = dir ? backward : forward;
+			int cur = p;
+			bool rev = (dir == 1);	// going backward, leave by the start
+			while (true)
+			{
+				const int64_t exit = rev ? in[cur].m_iStart : in[cur].m_iEnd;
+				const std::vector<int> &at = ends[exit];
+				int next = -1, next_end = 0;
+				for (size_t k = 0; k < at.size(); k++)
+				{
+					const int q = at[k] / 2;
+					if (q != cur && !used[q])
+					{
+						next = q;
+						next_end = at[k] % 2;
+						break;
+					}
+				}
+				if (next == -1)
+					break;
+				used[next] = true;
+				// We arrive at one end, and leave by the other
+				cur = next;
+				rev = (next_end == 1);
+				list.push_back(std::make_pair(cur, rev));
+			}
+		}
+
+		// The whole chain, in order
+		chain.clear();
+		for (int k = (int) backward.size() - 1; k >= 0; k--)
+			chain.push_back(std::make_pair(backward[k].first, !backward[k].second));
+		chain.push_back(std::make_pair(p, false));
+		chain.insert(chain.end(), forward.begin(), forward.end());
+
+		Piece joined;
+		for (size_t k = 0; k < chain.size(); k++)
+		{
+			const DLine2 &line = in[chain[k].first].m_line;
+			const int size = (int) line.GetSize();
+			// Consecutive pieces share a point, so skip it
+			const int skip = (k == 0) ? 0 : 1;
+			if (chain[k].second)
+			{
+				for (int i = size - 1 - skip; i >= 0; i--)
+					joined.m_line.Append(line[i]);
+			}
+			else
+			{
+				for (int i = skip; i < size; i++)
+					joined.m_line.Append(line[i]);
+			}
+		}
+		const Piece &first = in[chain.front().first];
+		const Piece &last = in[chain.back().first];
+		joined.m_iStart = chain.front().second ? first.m_iEnd : first.m_iStart;
+		joined.m_iEnd = chain.back().second ? last.m_iStart : last.m_iEnd;
+		joined.m_bClosed = (joined.m_iStart == joined.m_iEnd);
+		out.push_back(joined);
+	}
+}
+
+vtContourGenerator::vtContourGenerator()
+{
+	m_iTileSize = 256;
+	m_iLines = 0;
+}
+
+/**
+ * Generate a contour line at one elevation.
+ *
+ * \param pGrid The heightfield.  True elevations are used, without any
+ *		vertical exaggeration.
+ * \param fAlt The elevation of the line.
+ * \param pLS The featureset to receive the polylines.  If it has any
+ *		fields, the elevation is written to the first one.
+ * \param progress_callback If supplied, this is called with the percentage
+ *		done; if it returns true, generation is cancelled.
+ * \return false if there is no grid or it was cancelled.
+ */
+bool vtContourGenerator::GenerateContour(const vtHeightFieldGrid3d *pGrid,
+	float fAlt, vtFeatureSetLineString *pLS, bool progress_callback(int))
+{
+	std::vector<float> levels(1, fAlt);
+	return Generate(pGrid, levels, pLS, progress_callback);
+}
+
+/**
+ * Generate a set of contour lines at a regular interval.
+ *
+ * \param fInterval  The vertical spacing between the contours.  For example,
+ *		if the elevation range of your data is from 50 to 350 meters, then
+ *		an fIterval of 100 will place contour bands at 100,200,300 meters.
+ */
+bool vtContourGenerator::GenerateContours(const vtHeightFieldGrid3d *pGrid,
+	float fInterval, vtFeatureSetLineString *pLS, bool progress_callback(int))
+{
+	if (!pGrid || fInterval <= 0.0f)
+		return false;
+
+	float fMin, fMax;
+	pGrid->GetHeightExtents(fMin, fMax);
+	const int start = (int) (fMin / fInterval) + 1;
+	const int stop = (int) (fMax / fInterval);
+
+	std::vector<float> levels;
+	for (int i = start; i <= stop; i++)
+		levels.push_back(i * fInterval);
+	return Generate(pGrid, levels, pLS, progress_callback);
+}
+
+/**
+ * Generate contour lines at any set of elevations.  The lines are added to
+ * the featureset in the order of the levels.
+ */
+bool vtContourGenerator::Generate(const vtHeightFieldGrid3d *pGrid,
+	const std::vector<float> &levels, vtFeatureSetLineString *pLS,
+	bool progress_callback(int))
+{
+	m_iLines = 0;
+	if (!pGrid || !pLS)
+		return false;
+
+	const IPoint2 size = pGrid->GetDimensions();
+	const int iLevels = (int) levels.size();
+	if (size.x < 2 || size.y < 2 || iLevels == 0)
+		return true;
+
+	const int tiles_x = (size.x - 2) / m_iTileSize + 1;
+	const int tiles_y = (size.y - 2) / m_iTileSize + 1;
+	const int iTiles = tiles_x * tiles_y;
+
+	// If there are fewer tiles than threads, give each tile's levels to
+	//  several tasks, so that all the threads have work.
+	int iChunks = std::max(1, std::min(iLevels, (vtGetNumThreads() * 4 + iTiles - 1) / iTiles));
+	const int iPerChunk = (iLevels + iChunks - 1) / iChunks;
+	iChunks = (iLevels + iPerChunk - 1) / iPerChunk;
+
+	// The pieces found in each tile, for each level
+	std::vector<std::vector<std::vector<Piece> > > pieces(iTiles);
+	for (int t = 0; t < iTiles; t++)
+		pieces[t].resize(iLevels);
+
+	bool bOK = vtParallelFor(iTiles * iChunks, [&](int task)
+	{
+		const int tile = task / iChunks;
+		const int first = (task % iChunks) * iPerChunk;
+		TraceTile(pGrid, tile, levels, first, std::min(iPerChunk, iLevels - first),
+			pieces[tile]);
+	}, progress_callback);
+	if (!bOK)
+		return false;
+
+	// Join the pieces of each level across the tile seams
+	std::vector<std::vector<Piece> > lines(iLevels);
+	vtParallelFor(iLevels, [&](int lev)
+	{
+		std::vector<Piece> all;
+		for (int t = 0; t < iTiles; t++)
+		{
+			std::vector<Piece> &tp = pieces[t][lev];
+			all.insert(all.end(), tp.begin(), tp.end());
+			std::vector<Piece>().swap(tp);
+		}
+		JoinPieces(all, lines[lev]);
+	});
+
+	// Featuresets aren't thread-safe, so add the results here
+	const bool bField = (pLS->NumFields() > 0);
+	for (int lev = 0; lev < iLevels; lev++)
+	{
+		for (size_t k = 0; k < lines[lev].size(); k++)
+		{
+			DLine2 &line = lines[lev][k].m_line;
+			if (line.GetSize() < 2)
+				continue;
+			int record = pLS->AddPolyLine(line);
+			if (bField)
+				pLS->SetValue(record, 0, (double) levels[lev]);
+			m_iLines++;
+		}
+	}
+	VTLOG("vtContourGenerator: %d levels, %d tiles, %d lines\n", iLevels, iTiles, m_iLines);
+	return true;
+}
+
+/**
+ * Trace some of the levels through one tile, and join the segments into
+ * pieces as far as possible within the tile.
+ */
+void vtContourGenerator::TraceTile(const vtHeightFieldGrid3d *pGrid, int iTile,
+	const std::vector<float> &levels, int iFirstLevel, int iNumLevels,
+	std::vector<std::vector<Piece> > &pieces) const
+{
+	const IPoint2 size = pGrid->GetDimensions();
+	const int tiles_x = (size.x - 2) / m_iTileSize + 1;
+
+	// The cells of this tile, and the samples at their corners
+	const int ci0 = (iTile % tiles_x) * m_iTileSize;
+	const int cj0 = (iTile / tiles_x) * m_iTileSize;
+	const int ci1 = std::min(ci0 + m_iTileSize, size.x - 1);
+	const int cj1 = std::min(cj0 + m_iTileSize, size.y - 1);
+	const int w = ci1 - ci0 + 1, h = cj1 - cj0 + 1;
+
+	// Copy the samples, and find their range
+	std::vector<float> block(w * h);
+	float fMin = 1E9f, fMax = -1E9f;
+	for (int j = 0; j < h; j++)
+	{
+		for (int i = 0; i < w; i++)
+		{
+			const float f = pGrid->GetElevation(ci0 + i, cj0 + j, true);
+			block[j * w + i] = f;
+			if (f == INVALID_ELEVATION)
+				continue;
+			fMin = std::min(fMin, f);
+			fMax = std::max(fMax, f);
+		}
+	}
+
+	const DRECT &ext = pGrid->GetEarthExtents();
+	const DPoint2 &spacing = pGrid->GetSpacing();
+
+	// The point where the contour crosses an edge, from corner a to corner b
+	//  of the cell.  It is computed from the lower-indexed end of the edge,
+	//  so that neighboring tiles agree exactly.
+	auto crossing = [&](float level, int i, int j, int edge) -> DPoint2
+	{
+		int ia = i, ja = j, ib = i, jb = j;
+		switch (edge)
+		{
+		case 0: ib = i + 1; break;
+		case 1: ia = ib = i + 1; jb = j + 1; break;
+		case 2: ja = jb = j + 1; ib = i + 1; break;
+		case 3: jb = j + 1; break;
+		}
+		const float a = block[(ja - cj0) * w + (ia - ci0)];
+		const float b = block[(jb - cj0) * w + (ib - ci0)];
+		const double t = (level - a) / (b - a);
+		return DPoint2(ext.left + (ia + t * (ib - ia)) * spacing.x,
+			ext.bottom + (ja + t * (jb - ja)) * spacing.y);
+	};
+	auto edge_id = [&](int i, int j, int edge) -> int64_t
+	{
+		switch (edge)
+		{
+		case 0: return HorizEdge(i, j, size.x);
+		case 1: return VertEdge(i + 1, j, size.x);
+		case 2: return HorizEdge(i, j + 1, size.x);
+		default: return VertEdge(i, j, size.x);
+		}
+	};
+
+	std::vector<Piece> segments;
+	for (int lev = iFirstLevel; lev < iFirstLevel + iNumLevels; lev++)
+	{
+		const float level = levels[lev];
+		if (level < fMin || level > fMax)
+			continue;
+
+		segments.clear();
+		for (int j = cj0; j < cj1; j++)
+		{
+			const float *row0 = &block[(j - cj0) * w];
+			const float *row1 = row0 + w;
+			for (int i = ci0; i < ci1; i++)
+			{
+				const int x = i - ci0;
+				const float v0 = row0[x], v1 = row0[x+1], v2 = row1[x+1], v3 = row1[x];
+				if (v0 == INVALID_ELEVATION || v1 == INVALID_ELEVATION ||
+					v2 == INVALID_ELEVATION || v3 == INVALID_ELEVATION)
+					continue;
+
+				const int c = (v0 >= level ? 1 : 0) | (v1 >= level ? 2 : 0) |
+					(v2 >= level ? 4 : 0) | (v3 >= level ? 8 : 0);
+				if (c == 0 || c == 15)
+					continue;
+
+				int seg[4];
+				if (c == 5 || c == 10)
+				{
+					// A saddle.  If the center is above, the high corners
+					//  are connected, and the lines cut off the low ones.
+					const bool bCenterAbove = ((v0 + v1 + v2 + v3) * 0.25f >= level);
+					const bool bCutOdd = (c == 5) == bCenterAbove;
+					if (bCutOdd)
+					{
+						// cut off corners 1 and 3
+						seg[0] = 0; seg[1] = 1; seg[2] = 2; seg[3] = 3;
+					}
+					else
+					{
+						// cut off corners 0 and 2
+						seg[0] = 3; seg[1] = 0; seg[2] = 1; seg[3] = 2;
+					}
+				}
+				else
+				{
+					for (int k = 0; k < 4; k++)
+						seg[k] = s_CaseSegments[c][k];
+				}
+				for (int k = 0; k < 4 && seg[k] != -1; k += 2)
+				{
+					Piece p;
+					p.m_line.Append(crossing(level, i, j, seg[k]));
+					p.m_line.Append(crossing(level, i, j, seg[k+1]));
+					p.m_iStart = edge_id(i, j, seg[k]);
+					p.m_iEnd = edge_id(i, j, seg[k+1]);
+					p.m_bClosed = false;
+					segments.push_back(p);
+				}
+			}
+		}
+		JoinPieces(segments, pieces[lev]);
+	}
+}
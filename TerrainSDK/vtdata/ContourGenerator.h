@@ -0,0 +1,71 @@
+//
+// ContourGenerator.h
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef VTDATA_CONTOURGENERATOR_H
+#define VTDATA_CONTOURGENERATOR_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "HeightField.h"
+#include "Features.h"
+
+/**
+ * Generates contour lines from a grid of elevation, with marching squares.
+ *
+ * Unlike ContourConverter, this works directly on the heightfield, needs
+ * no copy of the whole grid and no global callback, and any number of
+ * generators may run at once.  The grid is divided into tiles, and the
+ * tiles and contour levels are traced in parallel.  The pieces of each
+ * contour are then joined across the seams between tiles, so each contour
+ * comes out as one polyline, closed where it forms a loop.
+ *
+ * The results are the same for any number of threads.
+ *
+ \code
+	vtContourGenerator gen;
+	gen.GenerateContours(pGrid, 10.0f, pLineFeatures);
+ \endcode
+ */
+class vtContourGenerator
+{
+public:
+	vtContourGenerator();
+
+	/// Set the size of the tiles, in grid cells.  The default is 256.
+	void SetTileSize(int iCells) { m_iTileSize = iCells > 1 ? iCells : 2; }
+	int GetTileSize() const { return m_iTileSize; }
+
+	bool GenerateContour(const vtHeightFieldGrid3d *pGrid, float fAlt,
+		vtFeatureSetLineString *pLS, bool progress_callback(int) = NULL);
+	bool GenerateContours(const vtHeightFieldGrid3d *pGrid, float fInterval,
+		vtFeatureSetLineString *pLS, bool progress_callback(int) = NULL);
+	bool Generate(const vtHeightFieldGrid3d *pGrid, const std::vector<float> &levels,
+		vtFeatureSetLineString *pLS, bool progress_callback(int) = NULL);
+
+	/// The number of polylines added by the last call.
+	uint NumLines() const { return m_iLines; }
+
+	/// A piece of a contour line.  The ends are identified by the grid edges
+	///  they lie on, so pieces from different tiles can be joined.
+	struct Piece
+	{
+		DLine2 m_line;
+		int64_t m_iStart, m_iEnd;
+		bool m_bClosed;
+	};
+
+protected:
+	void TraceTile(const vtHeightFieldGrid3d *pGrid, int iTile,
+		const std::vector<float> &levels, int iFirstLevel, int iNumLevels,
+		std::vector<std::vector<Piece> > &pieces) const;
+
+	int m_iTileSize;
+	uint m_iLines;
+};
+
+#endif // VTDATA_CONTOURGENERATOR_H
@@ -0,0 +1,213 @@
+//
+// DBFSource.cpp
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include <locale.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_map>
+
+#include "DBFSource.h"
+#include "Features.h"
+#include "vtLog.h"
+
+// Above this many distinct strings, a column is not worth dictionary-encoding
+#define MAX_DICTIONARY	65536
+
+static uint GetLE16(const uchar *p) { return p[0] | (p[1] << 8); }
+static uint GetLE32(const uchar *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint) p[3] << 24); }
+
+vtDBFSource::vtDBFSource()
+{
+	m_iNumRecords = 0;
+	m_iHeaderLength = 0;
+	m_iRecordLength = 0;
+}
+
+/**
+ * Open a DBF file and read its header.  The field layout is read the same
+ * way Shapelib reads it, so field numbers correspond to those of DBFOpen.
+ *
+ * \param fname_utf8 The filename of the .dbf file, in UTF-8.
+ * \return true if successful.
+ */
+bool vtDBFSource::Open(const char *fname_utf8)
+{
+	if (!m_File.Open(fname_utf8))
+		return false;
+
+	const uchar *data = m_File.GetData();
+	const size_t size = m_File.GetSize();
+	if (size < 32)
+		return false;
+
+	m_iNumRecords = GetLE32(data + 4);
+	m_iHeaderLength = GetLE16(data + 8);
+	m_iRecordLength = GetLE16(data + 10);
+	if (m_iHeaderLength < 32 || m_iHeaderLength > size || m_iRecordLength < 1)
+		return false;
+
+	// Field descriptors follow the header, 32 bytes each, until a terminator
+	int offset = 1;		// skip the deletion flag at the start of each record
+	for (uint pos = 32; pos + 32 <= m_iHeaderLength && data[pos] != 0x0D; pos += 32)
+	{
+		const uchar *desc = data + pos;
+		Column col;
+		col.m_cType = (char) desc[11];
+		col.m_iOffset = offset;
+		if (col.m_cType == 'N' || col.m_cType == 'F')
+			col.m_iWidth = desc[16];
+		else
+			col.m_iWidth = desc[16] + desc[17] * 256;
+		offset += col.m_iWidth;
+		m_Columns.push_back(col);
+	}
+	if (offset > (int) m_iRecordLength)
+	{
+		VTLOG("vtDBFSource: fields (%d bytes) don't fit in records (%d bytes)\n",
+			offset, m_iRecordLength);
+		return false;
+	}
+
+	// Don't trust a record count which runs past the end of a truncated file
+	const size_t available = (size - m_iHeaderLength) / m_iRecordLength;
+	if (m_iNumRecords > available)
+	{
+		VTLOG("vtDBFSource: header claims %d records, file holds only %d\n",
+			m_iNumRecords, (int) available);
+		m_iNumRecords = (uint) available;
+	}
+	return true;
+}
+
+/**
+ * Provide only some of the records of the file, or provide them in a
+ * different order.  After this, record i refers to record map[i] of the file.
+ * This is useful when only some of the records of a Shapefile were loaded.
+ */
+void vtDBFSource::SetRecordMap(const std::vector<uint> &map)
+{
+	m_RecordMap = map;
+}
+
+// Trim the blanks which pad DBF values, as Shapelib does.
+static void TrimCell(const char *&str, int &len)
+{
+	while (len > 0 && str[0] == ' ')
+	{
+		str++;
+		len--;
+	}
+	while (len > 0 && (str[len-1] == ' ' || str[len-1] == '\0'))
+		len--;
+}
+
+// Parse a DBF number.  DBF files always use '.' as the decimal separator,
+//  so this must not depend on the current numeric locale.
+static double ParseNumber(const char *str, int len, char cDecimalPoint)
+{
+	char buf[256];
+	if (len > 255)
+		len = 255;
+	for (int i = 0; i < len; i++)
+		buf[i] = (str[i] == '.') ? cDecimalPoint : str[i];
+	buf[len] = 0;
+	return strtod(buf, NULL);
+}
+
+// A quick hash (FNV-1a) of the raw bytes of a cell
+static uint64_t HashCell(const char *str, int len)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (int i = 0; i < len; i++)
+	{
+		hash ^= (uchar) str[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+/**
+ * Decode one column of the file into a field's array of values.  The field
+ * must already be sized to hold at least iNumRecords values.
+ *
+ * String columns are dictionary-encoded: repeated values share a single
+ * (reference-counted) vtString buffer, which greatly reduces memory for the
+ * typical attribute column with a few distinct values.
+ */
+bool vtDBFSource::ReadColumn(uint iField, Field &field, uint iNumRecords) const
+{
+	if (iField >= m_Columns.size())
+		return false;
+	if (iNumRecords > NumRecords())
+		iNumRecords = NumRecords();
+	const uint *map = m_RecordMap.empty() ? NULL : &m_RecordMap[0];
+
+	const char cDecimalPoint = *(localeconv()->decimal_point);
+	const int width = m_Columns[iField].m_iWidth;
+
+	if (field.m_type == FT_String)
+	{
+		std::unordered_map<uint64_t, vtString> dictionary;
+		for (uint i = 0; i < iNumRecords; i++)
+		{
+			const uint record = map ? map[i] : i;
+			if (record >= m_iNumRecords)
+				continue;
+			const char *str = GetCell(record, iField);
+			int len = width;
+			TrimCell(str, len);
+
+			const uint64_t hash = HashCell(str, len);
+			auto it = dictionary.find(hash);
+			if (it != dictionary.end() && it->second.GetLength() == len &&
+				!memcmp((const char *) it->second, str, len))
+			{
+				field.m_string[i] = it->second;
+				continue;
+			}
+			field.m_string[i] = vtString(str, len);
+			if (it == dictionary.end() && dictionary.size() < MAX_DICTIONARY)
+				dictionary[hash] = field.m_string[i];
+		}
+		return true;
+	}
+
+	for (uint i = 0; i < iNumRecords; i++)
+	{
+		const uint record = map ? map[i] : i;
+		if (record >= m_iNumRecords)
+			continue;
+		const char *str = GetCell(record, iField);
+		int len = width;
+		TrimCell(str, len);
+
+		switch (field.m_type)
+		{
+		case FT_Boolean:
+			field.m_bool[i] = (len > 0 && (*str == 'T' || *str == 't' ||
+				*str == 'Y' || *str == 'y'));
+			break;
+		case FT_Short:
+			field.m_short[i] = (short) ParseNumber(str, len, cDecimalPoint);
+			break;
+		case FT_Integer:
+			field.m_int[i] = (int) ParseNumber(str, len, cDecimalPoint);
+			break;
+		case FT_Float:
+			field.m_float[i] = (float) ParseNumber(str, len, cDecimalPoint);
+			break;
+		case FT_Double:
+			field.m_double[i] = ParseNumber(str, len, cDecimalPoint);
+			break;
+		case FT_String:
+		case FT_Unknown:
+			break;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,73 @@
+//
+// DBFSource.h
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef VTDATA_DBFSOURCE_H
+#define VTDATA_DBFSOURCE_H
+
+#include <mutex>
+#include <vector>
+
+#include "MappedFile.h"
+
+class Field;
+
+/**
+ * Direct, column-at-a-time access to the records of a DBF file.
+ *
+ * The file is memory-mapped, so reading a column only touches the parts of
+ * the file which hold that column, and columns which are never read cost
+ * nothing.  This is used by vtFeatureSet to load fields lazily: each Field
+ * keeps a reference to the source, and decodes its column on first access.
+ */
+class vtDBFSource
+{
+public:
+	vtDBFSource();
+
+	bool Open(const char *fname_utf8);
+
+	void SetRecordMap(const std::vector<uint> &map);
+
+	/// Number of records in the file, or in the record map if there is one.
+	uint NumRecords() const
+	{
+		return m_RecordMap.empty() ? m_iNumRecords : (uint) m_RecordMap.size();
+	}
+	/// Number of fields (columns) in the file.
+	uint NumFields() const { return (uint) m_Columns.size(); }
+
+	bool ReadColumn(uint iField, Field &field, uint iNumRecords) const;
+
+	/// Fields lock this while they load, so they may be touched from any thread.
+	std::mutex &GetMutex() { return m_Mutex; }
+
+protected:
+	const char *GetCell(uint iRecord, uint iField) const
+	{
+		return (const char *) m_File.GetData() + m_iHeaderLength +
+			(size_t) iRecord * m_iRecordLength + m_Columns[iField].m_iOffset;
+	}
+
+	struct Column
+	{
+		char m_cType;
+		int m_iOffset;		// bytes from the start of the record
+		int m_iWidth;
+	};
+	std::vector<Column> m_Columns;
+
+	vtMappedFile m_File;
+	uint m_iNumRecords;
+	uint m_iHeaderLength;
+	uint m_iRecordLength;
+
+	// If not empty, the record in the file for each record we provide
+	std::vector<uint> m_RecordMap;
+	std::mutex m_Mutex;
+};
+
+#endif // VTDATA_DBFSOURCE_H
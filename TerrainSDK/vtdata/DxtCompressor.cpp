@@ -0,0 +1,567 @@
+//
+// DxtCompressor.cpp
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "DxtCompressor.h"
+#include "Parallel.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DXT_USE_SSE2 1
+#include <emmintrin.h>
+#else
+#define DXT_USE_SSE2 0
+#endif
+
+// The pixels of one block, with the colors split into planes for matching.
+struct DxtBlock
+{
+	int16_t r[16], g[16], b[16];
+	bool opaque[16];
+	int iOpaque;
+};
+
+// Scale an 8-bit value to 'bits' levels with correct rounding.
+static inline int Quantize(int value, int levels)
+{
+	int t = value * levels + 128;
+	return (t + (t >> 8)) >> 8;
+}
+
+static inline uint16_t Pack565(const int *rgb)
+{
+	return (uint16_t) ((Quantize(rgb[0], 31) << 11) |
+		(Quantize(rgb[1], 63) << 5) | Quantize(rgb[2], 31));
+}
+
+static inline void Unpack565(uint16_t c, int *rgb)
+{
+	int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+// The colors a decoder derives from two endpoints.
+static void MakePalette(uint16_t c0, uint16_t c1, bool b3Color, int pal[4][3])
+{
+	Unpack565(c0, pal[0]);
+	Unpack565(c1, pal[1]);
+	for (int ch = 0; ch < 3; ch++)
+	{
+		if (b3Color)
+		{
+			pal[2][ch] = (pal[0][ch] + pal[1][ch]) / 2;
+			pal[3][ch] = 0;
+		}
+		else
+		{
+			pal[2][ch] = (2 * pal[0][ch] + pal[1][ch]) / 3;
+			pal[3][ch] = (pal[0][ch] + 2 * pal[1][ch]) / 3;
+		}
+	}
+}
+
+// Choose the nearest of the first iColors palette entries for each opaque
+//  pixel; transparent pixels get index 3.  Returns the total squared error.
+static uint MatchColors(const DxtBlock &blk, const int pal[4][3], int iColors,
+	uint32_t &bits)
+{
+	int32_t err[16], idx[16];
+#if DXT_USE_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	__m128i best[4], best_idx[4];
+	for (int q = 0; q < 4; q++)
+	{
+		best[q] = _mm_set1_epi32(0x7fffffff);
+		best_idx[q] = zero;
+	}
+	for (int k = 0; k < iColors; k++)
+	{
+		const __m128i pr = _mm_set1_epi16((short) pal[k][0]);
+		const __m128i pg = _mm_set1_epi16((short) pal[k][1]);
+		const __m128i pb = _mm_set1_epi16((short) pal[k][2]);
+		const __m128i kk = _mm_set1_epi32(k);
+		for (int h = 0; h < 2; h++)
+		{
+			__m128i dr = _mm_sub_epi16(_mm_loadu_si128((const __m128i *) (blk.r + 8*h)), pr);
+			__m128i dg = _mm_sub_epi16(_mm_loadu_si128((const __m128i *) (blk.g + 8*h)), pg);
+			__m128i db = _mm_sub_epi16(_mm_loadu_si128((const __m128i *) (blk.b + 8*h)), pb);
+
+			// dr*dr + dg*dg and db*db for each pixel, as 32-bit sums
+			__m128i rg_lo = _mm_unpacklo_epi16(dr, dg), rg_hi = _mm_unpackhi_epi16(dr, dg);
+			__m128i b_lo = _mm_unpacklo_epi16(db, zero), b_hi = _mm_unpackhi_epi16(db, zero);
+			__m128i d[2];
+			d[0] = _mm_add_epi32(_mm_madd_epi16(rg_lo, rg_lo), _mm_madd_epi16(b_lo, b_lo));
+			d[1] = _mm_add_epi32(_mm_madd_epi16(rg_hi, rg_hi), _mm_madd_epi16(b_hi, b_hi));
+
+			for (int q = 0; q < 2; q++)
+			{
+				__m128i &bd = best[h*2 + q];
+				__m128i &bi = best_idx[h*2 + q];
+				__m128i lt = _mm_cmplt_epi32(d[q], bd);
+				bd = _mm_or_si128(_mm_and_si128(lt, d[q]), _mm_andnot_si128(lt, bd));
+				bi = _mm_or_si128(_mm_and_si128(lt, kk), _mm_andnot_si128(lt, bi));
+			}
+		}
+	}
+	for (int q = 0; q < 4; q++)
+	{
+		_mm_storeu_si128((__m128i *) (err + q*4), best[q]);
+		_mm_storeu_si128((__m128i *) (idx + q*4), best_idx[q]);
+	}
+#else
+	for (int i = 0; i < 16; i++)
+	{
+		err[i] = 0x7fffffff;
+		idx[i] = 0;
+		for (int k = 0; k < iColors; k++)
+		{
+			int dr = blk.r[i] - pal[k][0];
+			int dg = blk.g[i] - pal[k][1];
+			int db = blk.b[i] - pal[k][2];
+			int d = dr*dr + dg*dg + db*db;
+			if (d < err[i])
+			{
+				err[i] = d;
+				idx[i] = k;
+			}
+		}
+	}
+#endif
+	uint total = 0;
+	bits = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		if (blk.opaque[i])
+		{
+			total += err[i];
+			bits |= (uint32_t) idx[i] << (2*i);
+		}
+		else
+			bits |= 3u << (2*i);
+	}
+	return total;
+}
+
+static inline void Put16(uchar *p, uint16_t v)
+{
+	p[0] = (uchar) v;
+	p[1] = (uchar) (v >> 8);
+}
+
+static inline void Put32(uchar *p, uint32_t v)
+{
+	for (int i = 0; i < 4; i++)
+		p[i] = (uchar) (v >> (8*i));
+}
+
+// Encode a color block from a pair of endpoints, in the mode required:
+//  four colors needs c0 > c1, three colors plus transparent needs c0 <= c1.
+static uint EncodeColors(const DxtBlock &blk, uint16_t ca, uint16_t cb,
+	bool b3Color, uchar *out)
+{
+	uint16_t c0 = ca, c1 = cb;
+	if (b3Color ? (c0 > c1) : (c0 < c1))
+	{
+		c0 = cb;
+		c1 = ca;
+	}
+	int pal[4][3];
+	MakePalette(c0, c1, b3Color, pal);
+
+	// With equal endpoints, a four-color block can only use the first color
+	const int iColors = b3Color ? 3 : (c0 == c1 ? 1 : 4);
+	uint32_t bits;
+	uint err = MatchColors(blk, pal, iColors, bits);
+
+	Put16(out, c0);
+	Put16(out + 2, c1);
+	Put32(out + 4, bits);
+	return err;
+}
+
+// Endpoints from the bounding box of the colors, inset slightly, on the
+//  diagonal which best follows the colors.
+static void BoxEndpoints(const DxtBlock &blk, int *hi, int *lo)
+{
+	int mn[3] = { 255, 255, 255 }, mx[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++)
+	{
+		if (!blk.opaque[i])
+			continue;
+		const int c[3] = { blk.r[i], blk.g[i], blk.b[i] };
+		for (int ch = 0; ch < 3; ch++)
+		{
+			if (c[ch] < mn[ch]) mn[ch] = c[ch];
+			if (c[ch] > mx[ch]) mx[ch] = c[ch];
+		}
+	}
+	int center[3];
+	for (int ch = 0; ch < 3; ch++)
+	{
+		int inset = (mx[ch] - mn[ch]) >> 4;
+		mx[ch] -= inset;
+		mn[ch] += inset;
+		center[ch] = (mx[ch] + mn[ch]) / 2;
+	}
+
+	// The box's main diagonal runs from min to max; flip red or blue when
+	//  they vary against green (or, if green is flat, blue against red).
+	int cov_rg = 0, cov_bg = 0, cov_rb = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		if (!blk.opaque[i])
+			continue;
+		int r = blk.r[i] - center[0], g = blk.g[i] - center[1], b = blk.b[i] - center[2];
+		cov_rg += r * g;
+		cov_bg += b * g;
+		cov_rb += r * b;
+	}
+	if (mx[1] == mn[1])
+	{
+		if (cov_rb < 0)
+		{
+			int t = mx[2]; mx[2] = mn[2]; mn[2] = t;
+		}
+	}
+	else
+	{
+		if (cov_rg < 0)
+		{
+			int t = mx[0]; mx[0] = mn[0]; mn[0] = t;
+		}
+		if (cov_bg < 0)
+		{
+			int t = mx[2]; mx[2] = mn[2]; mn[2] = t;
+		}
+	}
+	for (int ch = 0; ch < 3; ch++)
+	{
+		hi[ch] = mx[ch];
+		lo[ch] = mn[ch];
+	}
+}
+
+// Endpoints from the two colors at the ends of the principal axis.
+static void PrincipalEndpoints(const DxtBlock &blk, int *hi, int *lo)
+{
+	float mean[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++)
+	{
+		if (!blk.opaque[i])
+			continue;
+		mean[0] += blk.r[i];
+		mean[1] += blk.g[i];
+		mean[2] += blk.b[i];
+	}
+	for (int ch = 0; ch < 3; ch++)
+		mean[ch] /= blk.iOpaque;
+
+	// covariance matrix: xx xy xz yy yz zz
+	float cov[6] = { 0, 0, 0, 0, 0, 0 };
+	for (int i = 0; i < 16; i++)
+	{
+		if (!blk.opaque[i])
+			continue;
+		float r = blk.r[i] - mean[0], g = blk.g[i] - mean[1], b = blk.b[i] - mean[2];
+		cov[0] += r*r; cov[1] += r*g; cov[2] += r*b;
+		cov[3] += g*g; cov[4] += g*b; cov[5] += b*b;
+	}
+
+	// power iteration for the dominant eigenvector, starting from the axis
+	//  of the bounding box
+	int bhi[3], blo[3];
+	BoxEndpoints(blk, bhi, blo);
+	float v[3] = { (float) (bhi[0] - blo[0]), (float) (bhi[1] - blo[1]),
+		(float) (bhi[2] - blo[2]) };
+	if (v[0] == 0 && v[1] == 0 && v[2] == 0)
+		v[0] = v[1] = v[2] = 1;
+	for (int iter = 0; iter < 4; iter++)
+	{
+		float w[3];
+		w[0] = cov[0]*v[0] + cov[1]*v[1] + cov[2]*v[2];
+		w[1] = cov[1]*v[0] + cov[3]*v[1] + cov[4]*v[2];
+		w[2] = cov[2]*v[0] + cov[4]*v[1] + cov[5]*v[2];
+		float m = fabsf(w[0]);
+		if (fabsf(w[1]) > m) m = fabsf(w[1]);
+		if (fabsf(w[2]) > m) m = fabsf(w[2]);
+		if (m < 1e-6f)
+			break;
+		for (int ch = 0; ch < 3; ch++)
+			v[ch] = w[ch] / m;
+	}
+
+	float dmin = 1e30f, dmax = -1e30f;
+	int imin = 0, imax = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		if (!blk.opaque[i])
+			continue;
+		float d = blk.r[i]*v[0] + blk.g[i]*v[1] + blk.b[i]*v[2];
+		if (d < dmin) { dmin = d; imin = i; }
+		if (d > dmax) { dmax = d; imax = i; }
+	}
+	hi[0] = blk.r[imax]; hi[1] = blk.g[imax]; hi[2] = blk.b[imax];
+	lo[0] = blk.r[imin]; lo[1] = blk.g[imin]; lo[2] = blk.b[imin];
+}
+
+// Given the indices chosen for each pixel, find the endpoints which
+//  minimize the squared error, by least squares.
+static bool RefineEndpoints(const DxtBlock &blk, uint32_t bits, bool b3Color,
+	int *e0, int *e1)
+{
+	static const float w4[4] = { 1.0f, 0.0f, 2.0f/3.0f, 1.0f/3.0f };
+	static const float w3[4] = { 1.0f, 0.0f, 0.5f, 0.0f };
+	const float *weight = b3Color ? w3 : w4;
+
+	float aa = 0, bb = 0, ab = 0;
+	float ax[3] = { 0, 0, 0 }, bx[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++)
+	{
+		if (!blk.opaque[i])
+			continue;
+		float a = weight[(bits >> (2*i)) & 3], b = 1.0f - a;
+		aa += a*a;
+		bb += b*b;
+		ab += a*b;
+		const float c[3] = { (float) blk.r[i], (float) blk.g[i], (float) blk.b[i] };
+		for (int ch = 0; ch < 3; ch++)
+		{
+			ax[ch] += a * c[ch];
+			bx[ch] += b * c[ch];
+		}
+	}
+	float det = aa*bb - ab*ab;
+	if (fabsf(det) < 1e-6f)
+		return false;
+	for (int ch = 0; ch < 3; ch++)
+	{
+		float v0 = (ax[ch]*bb - bx[ch]*ab) / det;
+		float v1 = (bx[ch]*aa - ax[ch]*ab) / det;
+		e0[ch] = v0 < 0 ? 0 : v0 > 255 ? 255 : (int) (v0 + 0.5f);
+		e1[ch] = v1 < 0 ? 0 : v1 > 255 ? 255 : (int) (v1 + 0.5f);
+	}
+	return true;
+}
+
+static void CompressColorBlock(const DxtBlock &blk, bool b3Color, bool bHigh,
+	uchar *out)
+{
+	if (blk.iOpaque == 0)
+	{
+		// entirely transparent
+		Put16(out, 0);
+		Put16(out + 2, 0);
+		Put32(out + 4, 0xffffffff);
+		return;
+	}
+	int hi[3], lo[3];
+	if (bHigh)
+		PrincipalEndpoints(blk, hi, lo);
+	else
+		BoxEndpoints(blk, hi, lo);
+	uint err = EncodeColors(blk, Pack565(hi), Pack565(lo), b3Color, out);
+
+	if (bHigh)
+	{
+		uchar trial[8];
+		for (int iter = 0; iter < 2 && err > 0; iter++)
+		{
+			const uint32_t bits = out[4] | (out[5] << 8) | (out[6] << 16) | ((uint32_t) out[7] << 24);
+			if (!RefineEndpoints(blk, bits, b3Color, hi, lo))
+				break;
+			uint trial_err = EncodeColors(blk, Pack565(hi), Pack565(lo), b3Color, trial);
+			if (trial_err >= err)
+				break;
+			memcpy(out, trial, 8);
+			err = trial_err;
+		}
+	}
+}
+
+// The interpolated alpha block of BC3, using the eight-value mode.
+static void CompressAlphaBlock(const uchar *rgba, uchar *out)
+{
+	int amin = 255, amax = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		int a = rgba[i*4 + 3];
+		if (a < amin) amin = a;
+		if (a > amax) amax = a;
+	}
+	out[0] = (uchar) amax;
+	out[1] = (uchar) amin;
+
+	uint64_t bits = 0;
+	const int range = amax - amin;
+	if (range > 0)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			// position from amax (0) to amin (7), then to the index order
+			//  of the palette: amax, amin, then the six steps between
+			int t = ((amax - rgba[i*4 + 3]) * 7 + range / 2) / range;
+			int idx = (t == 0) ? 0 : (t == 7) ? 1 : t + 1;
+			bits |= (uint64_t) idx << (3*i);
+		}
+	}
+	for (int i = 0; i < 6; i++)
+		out[2 + i] = (uchar) (bits >> (8*i));
+}
+
+
+///////////////////////////////////////////////////////////////////////
+
+vtDxtCompressor::vtDxtCompressor(Format eFormat, bool bHighQuality)
+{
+	m_eFormat = eFormat;
+	m_bHighQuality = bHighQuality;
+}
+
+/**
+ * The number of bytes needed for an image of the given size.  Partial
+ * blocks at the right and top edges count as whole blocks.
+ */
+size_t vtDxtCompressor::CompressedSize(int iWidth, int iHeight) const
+{
+	return (size_t) ((iWidth + 3) / 4) * ((iHeight + 3) / 4) * BlockBytes();
+}
+
+/**
+ * Compress one block of 4x4 pixels.
+ *
+ * \param pRGBA The 16 pixels, as 4 bytes each, in rows.
+ * \param pOutput Receives BlockBytes() bytes.
+ */
+void vtDxtCompressor::CompressBlock(const uchar *pRGBA, uchar *pOutput) const
+{
+	DxtBlock blk;
+	blk.iOpaque = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		blk.r[i] = pRGBA[i*4];
+		blk.g[i] = pRGBA[i*4 + 1];
+		blk.b[i] = pRGBA[i*4 + 2];
+		blk.opaque[i] = (m_eFormat != BC1A || pRGBA[i*4 + 3] >= 128);
+		if (blk.opaque[i])
+			blk.iOpaque++;
+	}
+	if (m_eFormat == BC3)
+	{
+		CompressAlphaBlock(pRGBA, pOutput);
+		pOutput += 8;
+	}
+	// Only BC1A with some transparent pixels needs the three-color mode
+	const bool b3Color = (blk.iOpaque < 16);
+	CompressColorBlock(blk, b3Color, m_bHighQuality, pOutput);
+}
+
+/**
+ * Compress an image.  Rows of blocks are compressed in parallel.
+ *
+ * \param pPixels The image, with iComponents (3 or 4) bytes per pixel.
+ * \param iWidth, iHeight The size of the image, which need not be a
+ *		multiple of 4; the edge pixels are repeated to fill partial blocks.
+ * \param iComponents 3 for RGB, or 4 for RGBA.  For RGB input, alpha is
+ *		taken to be opaque.
+ * \param iStride The number of bytes from the start of one row to the next.
+ * \param pOutput Receives CompressedSize() bytes, with the blocks in the
+ *		same row order as the input.
+ * \param progress_callback If supplied, this function will be called back
+ *		with a value of 0 to 100 as the operation progresses.
+ *
+ * \return false if the operation was cancelled or the input is unsupported.
+ */
+bool vtDxtCompressor::Compress(const uchar *pPixels, int iWidth, int iHeight,
+	int iComponents, int iStride, uchar *pOutput,
+	bool progress_callback(int)) const
+{
+	if ((iComponents != 3 && iComponents != 4) || iWidth < 1 || iHeight < 1)
+		return false;
+
+	const int iBlocksX = (iWidth + 3) / 4;
+	const int iBlocksY = (iHeight + 3) / 4;
+	const int iBlockBytes = BlockBytes();
+
+	return vtParallelFor(iBlocksY, [&](int by)
+	{
+		uchar rgba[64];
+		uchar *dst = pOutput + (size_t) by * iBlocksX * iBlockBytes;
+		for (int bx = 0; bx < iBlocksX; bx++)
+		{
+			for (int y = 0; y < 4; y++)
+			{
+				const int sy = (by*4 + y < iHeight) ? by*4 + y : iHeight - 1;
+				const uchar *row = pPixels + (size_t) sy * iStride;
+				for (int x = 0; x < 4; x++)
+				{
+					const int sx = (bx*4 + x < iWidth) ? bx*4 + x : iWidth - 1;
+					const uchar *src = row + sx * iComponents;
+					uchar *p = rgba + (y*4 + x) * 4;
+					p[0] = src[0];
+					p[1] = src[1];
+					p[2] = src[2];
+					p[3] = (iComponents == 4) ? src[3] : 255;
+				}
+			}
+			CompressBlock(rgba, dst);
+			dst += iBlockBytes;
+		}
+	}, progress_callback);
+}
+
+/**
+ * Decode one compressed block back to 16 RGBA pixels, in rows.
+ */
+void vtDxtCompressor::DecompressBlock(Format eFormat, const uchar *pBlock, uchar *pRGBA)
+{
+	if (eFormat == BC3)
+	{
+		int a[8];
+		a[0] = pBlock[0];
+		a[1] = pBlock[1];
+		if (a[0] > a[1])
+		{
+			for (int i = 2; i < 8; i++)
+				a[i] = ((8 - i) * a[0] + (i - 1) * a[1]) / 7;
+		}
+		else
+		{
+			for (int i = 2; i < 6; i++)
+				a[i] = ((6 - i) * a[0] + (i - 1) * a[1]) / 5;
+			a[6] = 0;
+			a[7] = 255;
+		}
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; i++)
+			bits |= (uint64_t) pBlock[2 + i] << (8*i);
+		for (int i = 0; i < 16; i++)
+			pRGBA[i*4 + 3] = (uchar) a[(bits >> (3*i)) & 7];
+		pBlock += 8;
+	}
+	const uint16_t c0 = pBlock[0] | (pBlock[1] << 8);
+	const uint16_t c1 = pBlock[2] | (pBlock[3] << 8);
+	const uint32_t bits = pBlock[4] | (pBlock[5] << 8) | (pBlock[6] << 16) | ((uint32_t) pBlock[7] << 24);
+
+	// BC3 always uses four colors; BC1 uses three when c0 <= c1
+	const bool b3Color = (eFormat != BC3 && c0 <= c1);
+	int pal[4][3];
+	MakePalette(c0, c1, b3Color, pal);
+	for (int i = 0; i < 16; i++)
+	{
+		const int idx = (bits >> (2*i)) & 3;
+		uchar *p = pRGBA + i*4;
+		p[0] = (uchar) pal[idx][0];
+		p[1] = (uchar) pal[idx][1];
+		p[2] = (uchar) pal[idx][2];
+		if (eFormat != BC3)
+			p[3] = (b3Color && idx == 3) ? 0 : 255;
+	}
+}
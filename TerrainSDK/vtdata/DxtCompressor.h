@@ -0,0 +1,66 @@
+//
+// DxtCompressor.h
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef VTDATA_DXTCOMPRESSOR_H
+#define VTDATA_DXTCOMPRESSOR_H
+
+#include <stddef.h>
+#include "config_vtdata.h"
+
+/**
+ * Compresses images to the S3TC / DXT block formats on the CPU, so
+ * compressed textures can be made without an OpenGL context.
+ *
+ * Each 4x4 block of pixels is encoded independently.  The fast mode fits
+ * the endpoints to the bounding box of the block's colors; the high quality
+ * mode fits them to the principal axis of the colors, then refines them by
+ * least squares.  The search for the best palette entry of each pixel uses
+ * SSE2 where available.  Whole images are compressed in parallel, one row
+ * of blocks per work item.
+ *
+ * Formats:
+ *	- BC1 (DXT1): RGB, 8 bytes per block.
+ *	- BC1A (DXT1 with 1-bit alpha): pixels with alpha below 128 become fully
+ *		transparent, 8 bytes per block.  This is the format libMini expects
+ *		for compressed RGBA tiles.
+ *	- BC3 (DXT5): RGB with interpolated 8-bit alpha, 16 bytes per block.
+ *
+ \code
+	vtDxtCompressor dxt(vtDxtCompressor::BC1);
+	std::vector<uchar> out(dxt.CompressedSize(width, height));
+	dxt.Compress(rgb, width, height, 3, width*3, &out[0]);
+ \endcode
+ */
+class vtDxtCompressor
+{
+public:
+	enum Format { BC1, BC1A, BC3 };
+
+	vtDxtCompressor(Format eFormat = BC1, bool bHighQuality = false);
+
+	void SetFormat(Format eFormat) { m_eFormat = eFormat; }
+	Format GetFormat() const { return m_eFormat; }
+	void SetHighQuality(bool bHigh) { m_bHighQuality = bHigh; }
+	bool GetHighQuality() const { return m_bHighQuality; }
+
+	/// The number of bytes in each compressed 4x4 block: 8 or 16.
+	int BlockBytes() const { return (m_eFormat == BC3) ? 16 : 8; }
+	size_t CompressedSize(int iWidth, int iHeight) const;
+
+	bool Compress(const uchar *pPixels, int iWidth, int iHeight,
+		int iComponents, int iStride, uchar *pOutput,
+		bool progress_callback(int) = NULL) const;
+	void CompressBlock(const uchar *pRGBA, uchar *pOutput) const;
+
+	static void DecompressBlock(Format eFormat, const uchar *pBlock, uchar *pRGBA);
+
+protected:
+	Format m_eFormat;
+	bool m_bHighQuality;
+};
+
+#endif // VTDATA_DXTCOMPRESSOR_H
@@ -11,6 +11,7 @@
 
 #include "ElevationGrid.h"
 #include "ByteOrder.h"
+#include "Parallel.h"
 #include "vtDIB.h"
 #include "vtLog.h"
 
@@ -30,6 +31,7 @@ void vtElevationGrid::SetupMembers()
 	m_pData = NULL;
 	m_pFData = NULL;
 	m_fVMeters = 1.0f;
+	m_Layout = GRID_COLUMN_MAJOR;
 
 	for (int i = 0; i < 4; i++)
 		m_Corners[i].Set(0, 0);
@@ -108,6 +110,7 @@ bool vtElevationGrid::CopyHeaderFrom(const vtElevationGrid &rhs)
 	m_bFloatMode		= rhs.m_bFloatMode;
 	m_fVMeters			= rhs.m_fVMeters;
 	m_fVerticalScale	= rhs.m_fVerticalScale;
+	m_Layout			= rhs.m_Layout;
 
 	for (unsigned ii = 0; ii < sizeof( m_Corners ) / sizeof( *m_Corners ); ++ii)
 		m_Corners[ii] = rhs.m_Corners[ii];
@@ -127,13 +130,23 @@ bool vtElevationGrid::CopyDataFrom(const vtElevationGrid &rhs)
 
 	if (m_bFloatMode && rhs.m_pFData)
 	{
-		size_t Size = m_iSize.x * m_iSize.y * sizeof(float);
-		memcpy(m_pFData, rhs.m_pFData, Size );
+		if (m_Layout == rhs.m_Layout)
+			memcpy(m_pFData, rhs.m_pFData, DataCount() * sizeof(float));
+		else
+		{
+			rhs.VisitInStorageOrder([&](int i, int j, size_t n)
+				{ m_pFData[DataIndex(i, j)] = rhs.m_pFData[n]; });
+		}
 	}
 	else if (!m_bFloatMode && rhs.m_pData)
 	{
-		size_t Size = m_iSize.x * m_iSize.y * sizeof(short);
-		memcpy(m_pData, rhs.m_pData, Size );
+		if (m_Layout == rhs.m_Layout)
+			memcpy(m_pData, rhs.m_pData, DataCount() * sizeof(short));
+		else
+		{
+			rhs.VisitInStorageOrder([&](int i, int j, size_t n)
+				{ m_pData[DataIndex(i, j)] = rhs.m_pData[n]; });
+		}
 	}
 	else
 		return false;
@@ -197,18 +210,11 @@ void vtElevationGrid::FreeData()
  */
 void vtElevationGrid::Clear()
 {
+	const size_t count = DataCount();
 	if (m_bFloatMode)
-	{
-		for (int i = 0; i < m_iSize.x; i++)
-			for (int j = 0; j < m_iSize.y; j++)
-				m_pFData[i*m_iSize.y+j] = 0.0f;
-	}
+		std::fill(m_pFData, m_pFData + count, 0.0f);
 	else
-	{
-		for (int i = 0; i < m_iSize.x; i++)
-			for (int j = 0; j < m_iSize.y; j++)
-				m_pData[i*m_iSize.y+j] = 0;
-	}
+		std::fill(m_pData, m_pData + count, (short) 0);
 }
 
 /**
@@ -216,18 +222,50 @@ void vtElevationGrid::Clear()
  */
 void vtElevationGrid::Invalidate()
 {
+	const size_t count = DataCount();
 	if (m_bFloatMode)
+		std::fill(m_pFData, m_pFData + count, (float) INVALID_ELEVATION);
+	else
+		std::fill(m_pData, m_pData + count, (short) INVALID_ELEVATION);
+}
+
+/**
+ * Change the order in which the heixels are stored in memory.  Any data in
+ * the grid is rearranged to the new layout.
+ *
+ * \return false if there was not enough memory to rearrange the data.
+ */
+bool vtElevationGrid::SetLayout(vtGridLayout layout)
+{
+	if (layout == m_Layout)
+		return true;
+	if (!HasData())
 	{
-		for (int i = 0; i < m_iSize.x; i++)
-			for (int j = 0; j < m_iSize.y; j++)
-				m_pFData[i*m_iSize.y+j] = INVALID_ELEVATION;
+		m_Layout = layout;
+		return true;
 	}
-	else
+	// Move the data to a temporary grid, which frees it when done
+	vtElevationGrid old;
+	old.m_iSize = m_iSize;
+	old.m_bFloatMode = m_bFloatMode;
+	old.m_Layout = m_Layout;
+	std::swap(old.m_pData, m_pData);
+	std::swap(old.m_pFData, m_pFData);
+
+	const float fMin = m_fMinHeight, fMax = m_fMaxHeight;
+	m_Layout = layout;
+	if (!AllocateGrid())
 	{
-		for (int i = 0; i < m_iSize.x; i++)
-			for (int j = 0; j < m_iSize.y; j++)
-				m_pData[i*m_iSize.y+j] = INVALID_ELEVATION;
+		// Put the old data back
+		m_Layout = old.m_Layout;
+		std::swap(old.m_pData, m_pData);
+		std::swap(old.m_pFData, m_pFData);
+		return false;
 	}
+	CopyDataFrom(old);
+	m_fMinHeight = fMin;
+	m_fMaxHeight = fMax;
+	return true;
 }
 
 /**
@@ -441,15 +479,11 @@ void vtElevationGrid::Scale(float fScale, bool bDirect, bool bRecomputeExtents)
 		m_fVMeters *= fScale;
 	else
 	{
-		for (int i = 0; i < m_iSize.x; i++)
+		TransformHeixels([fScale](int i, int j, float &value)
 		{
-			for (int j = 0; j < m_iSize.y; j++)
-			{
-				const float f = GetFValue(i, j);
-				if (f != INVALID_ELEVATION)
-					SetFValue(i, j, f * fScale);
-			}
-		}
+			if (value != INVALID_ELEVATION)
+				value *= fScale;
+		});
 	}
 	if (bRecomputeExtents)
 		ComputeHeightExtents();
@@ -462,15 +496,11 @@ void vtElevationGrid::Scale(float fScale, bool bDirect, bool bRecomputeExtents)
  */
 void vtElevationGrid::VertOffset(float fAmount)
 {
-	for (int i = 0; i < m_iSize.x; i++)
+	TransformHeixels([fAmount](int i, int j, float &value)
 	{
-		for (int j = 0; j < m_iSize.y; j++)
-		{
-			const float f = GetFValue(i, j);
-			if (f != INVALID_ELEVATION)
-				SetFValue(i, j, f + fAmount);
-		}
-	}
+		if (value != INVALID_ELEVATION)
+			value += fAmount;
+	});
 	// The height extents don't need to be manually recomputed, they can simply
 	// be offset.
 	m_fMinHeight += fAmount;
@@ -489,17 +519,16 @@ void vtElevationGrid::ComputeHeightExtents()
 	if (!HasData())
 		return;
 
-	for (int i = 0; i < m_iSize.x; i++)
+	float fMin = m_fMinHeight, fMax = m_fMaxHeight;
+	ForEachHeixel([&fMin, &fMax](int i, int j, float value)
 	{
-		for (int j = 0; j < m_iSize.y; j++)
-		{
-			const float value = GetFValue(i, j);
-			if (value == INVALID_ELEVATION)
-				continue;
-			if (value > m_fMaxHeight) m_fMaxHeight = value;
-			if (value < m_fMinHeight) m_fMinHeight = value;
-		}
-	}
+		if (value == INVALID_ELEVATION)
+			return;
+		if (value > fMax) fMax = value;
+		if (value < fMin) fMin = value;
+	});
+	m_fMinHeight = fMin;
+	m_fMaxHeight = fMax;
 }
 
 /**
@@ -527,15 +556,14 @@ void vtElevationGrid::Offset(const DPoint2 &delta)
 int vtElevationGrid::ReplaceValue(float value1, float value2)
 {
 	int replaced = 0;
-	for (int i = 0; i < m_iSize.x; i++)
+	TransformHeixels([&](int i, int j, float &value)
 	{
-		for (int j = 0; j < m_iSize.y; j++)
+		if (value == value1)
 		{
-			if (GetFValue(i, j) == value1)
-				SetFValue(i, j, value2);
+			value = value2;
 			replaced++;
 		}
-	}
+	});
 	if (replaced > 0)
 		ComputeHeightExtents();
 	return replaced;
@@ -1150,6 +1178,381 @@ int vtElevationGrid::FillGapsByRegionGrowing(int radius, bool progress_callback(
 	return(count);
 }
 
+// One level of the pyramid used by FillGapsMultigrid.  Values are stored by
+//  column, like the grid.  The unknown ("free") cells satisfy
+//  num*value - (sum of neighbors) = rhs, where num is the number of
+//  neighbors; this is Laplace's equation when rhs is zero.
+struct FillLevel
+{
+	void Init(int iw, int ih)
+	{
+		w = iw; h = ih;
+		value.assign(w * h, 0.0f);
+		rhs.assign(w * h, 0.0f);
+		free.assign(w * h, 0);
+	}
+	int w, h;
+	std::vector<float> value, rhs;
+	std::vector<uchar> free;
+};
+
+static void ForColumns(int w, bool bParallel, const std::function<void(int)> &func)
+{
+	if (bParallel)
+		vtParallelFor(w, func);
+	else
+	{
+		for (int i = 0; i < w; i++)
+			func(i);
+	}
+}
+
+// Red-black Gauss-Seidel sweeps over the free cells.  The cells of each
+//  color only depend on the other color, so each can be done in parallel.
+static void RelaxLevel(FillLevel &lev, int iSweeps, bool bParallel)
+{
+	const int w = lev.w, h = lev.h;
+	for (int sweep = 0; sweep < iSweeps; sweep++)
+	{
+		for (int color = 0; color < 2; color++)
+		{
+			ForColumns(w, bParallel, [&](int i)
+			{
+				float *col = &lev.value[i * h];
+				const float *rhs = &lev.rhs[i * h];
+				const uchar *free = &lev.free[i * h];
+				const float *left = (i > 0) ? col - h : NULL;
+				const float *right = (i < w-1) ? col + h : NULL;
+				for (int j = (i + color) & 1; j < h; j += 2)
+				{
+					if (!free[j])
+						continue;
+					float sum = rhs[j];
+					int num = 0;
+					if (left) { sum += left[j]; num++; }
+					if (right) { sum += right[j]; num++; }
+					if (j > 0) { sum += col[j-1]; num++; }
+					if (j < h-1) { sum += col[j+1]; num++; }
+					if (num)
+						col[j] = sum / num;
+				}
+			});
+		}
+	}
+}
+
+// Bilinear interpolation of a coarse level at the position of fine cell (i,j)
+static float Prolong(const FillLevel &coarse, int i, int j)
+{
+	const float fx = std::min(std::max(i * 0.5f - 0.25f, 0.0f), (float) (coarse.w - 1));
+	const float fy = std::min(std::max(j * 0.5f - 0.25f, 0.0f), (float) (coarse.h - 1));
+	const int x0 = (int) fx, x1 = std::min(x0 + 1, coarse.w - 1);
+	const int y0 = (int) fy, y1 = std::min(y0 + 1, coarse.h - 1);
+	const float ax = fx - x0, ay = fy - y0;
+	const float *c0 = &coarse.value[x0 * coarse.h];
+	const float *c1 = &coarse.value[x1 * coarse.h];
+	return (c0[y0] * (1-ay) + c0[y1] * ay) * (1-ax) +
+		(c1[y0] * (1-ay) + c1[y1] * ay) * ax;
+}
+
+/**
+ * Make a starting guess for the free cells of a level: restrict the known
+ * cells to a level of half the size, guess that recursively, and
+ * interpolate it back up.
+ *
+ * \return false if the level has no known values at all.
+ */
+static bool InitialGuess(FillLevel &fine, bool bParallel)
+{
+	const int w = fine.w, h = fine.h;
+	if (w <= 2 && h <= 2)
+	{
+		// Small enough to just use the average of what is known
+		float sum = 0;
+		int num = 0;
+		for (int k = 0; k < w * h; k++)
+			if (!fine.free[k]) { sum += fine.value[k]; num++; }
+		if (!num)
+			return false;
+		for (int k = 0; k < w * h; k++)
+			if (fine.free[k])
+				fine.value[k] = sum / num;
+		return true;
+	}
+
+	// Each coarse cell is the average of the known fine cells it covers
+	FillLevel coarse;
+	coarse.Init((w + 1) / 2, (h + 1) / 2);
+	bool bAnyFree = false;
+	for (int I = 0; I < coarse.w; I++)
+	{
+		for (int J = 0; J < coarse.h; J++)
+		{
+			float sum = 0;
+			int num = 0;
+			for (int i = I*2; i < I*2+2 && i < w; i++)
+				for (int j = J*2; j < J*2+2 && j < h; j++)
+					if (!fine.free[i * h + j]) { sum += fine.value[i * h + j]; num++; }
+			const int k = I * coarse.h + J;
+			coarse.value[k] = num ? sum / num : 0.0f;
+			coarse.free[k] = (num == 0);
+			if (!num)
+				bAnyFree = true;
+		}
+	}
+	if (bAnyFree && !InitialGuess(coarse, bParallel && coarse.w > 64))
+		return false;
+
+	for (int i = 0; i < w; i++)
+		for (int j = 0; j < h; j++)
+			if (fine.free[i * h + j])
+				fine.value[i * h + j] = Prolong(coarse, i, j);
+
+	RelaxLevel(fine, 4, bParallel);
+	return true;
+}
+
+/**
+ * One multigrid V-cycle: smooth, solve for the remaining error on a level of
+ * half the size, add that correction, and smooth again.
+ */
+static void VCycle(FillLevel &fine, bool bParallel)
+{
+	const int w = fine.w, h = fine.h;
+	if (w <= 4 && h <= 4)
+	{
+		RelaxLevel(fine, 20, false);
+		return;
+	}
+	RelaxLevel(fine, 3, bParallel);
+
+	// The residual of each free cell, summed into the coarse cells.  A coarse
+	//  cell is free if any of its fine cells are.  Its stencil covers twice
+	//  the distance, so its equation is 4 times the average residual.
+	FillLevel coarse;
+	coarse.Init((w + 1) / 2, (h + 1) / 2);
+	ForColumns(coarse.w, bParallel, [&](int I)
+	{
+		for (int i = I*2; i < I*2+2 && i < w; i++)
+		{
+			const float *col = &fine.value[i * h];
+			const float *left = (i > 0) ? col - h : NULL;
+			const float *right = (i < w-1) ? col + h : NULL;
+			for (int j = 0; j < h; j++)
+			{
+				if (!fine.free[i * h + j])
+					continue;
+				float sum = fine.rhs[i * h + j];
+				int num = 0;
+				if (left) { sum += left[j]; num++; }
+				if (right) { sum += right[j]; num++; }
+				if (j > 0) { sum += col[j-1]; num++; }
+				if (j < h-1) { sum += col[j+1]; num++; }
+				coarse.rhs[I * coarse.h + j / 2] += sum - num * col[j];
+			}
+		}
+		for (int J = 0; J < coarse.h; J++)
+		{
+			bool bFree = true;
+			for (int i = I*2; i < I*2+2 && i < w; i++)
+				for (int j = J*2; j < J*2+2 && j < h; j++)
+					if (!fine.free[i * h + j])
+						bFree = false;
+			coarse.free[I * coarse.h + J] = bFree;
+		}
+	});
+	VCycle(coarse, bParallel && coarse.w > 64);
+
+	ForColumns(w, bParallel, [&](int i)
+	{
+		for (int j = 0; j < h; j++)
+			if (fine.free[i * h + j])
+				fine.value[i * h + j] += Prolong(coarse, i, j);
+	});
+	RelaxLevel(fine, 3, bParallel);
+}
+
+/**
+ * Fill the gaps (heixels of value INVALID_ELEVATION) in this grid, by
+ * interpolating smoothly from the valid values around each gap.
+ *
+ * Each connected area of unknown heixels ("void") is filled with the
+ * smoothest surface that meets the known heixels around it (a solution of
+ * Laplace's equation).  Instead of repeatedly sweeping the whole grid, as
+ * FillGaps() and FillGapsSmooth() do, this solves each void within its own
+ * bounding box, on a pyramid of coarser levels, so even a large void is
+ * filled in a handful of passes.  Small voids are filled in parallel, and
+ * the work on each large void is divided among threads.
+ *
+ * \param area Optionally, restrict the operation to a given area.
+ * \param progress_callback Provide if you want a callback on progress.
+ * \return true if successful, false if cancelled.
+ */
+bool vtElevationGrid::FillGapsMultigrid(DRECT *area, bool progress_callback(int))
+{
+	VTLOG1(" FillGapsMultigrid\n");
+
+	int xmin = 0, xmax = m_iSize.x, ymin = 0, ymax = m_iSize.y;
+	if (area)
+	{
+		// Restrict the operation to a given area.
+		DPoint2 spacing = GetSpacing();
+		xmin = (int) ((area->left - m_EarthExtents.left)/spacing.x);
+		if (xmin < 0) xmin = 0;
+		if (xmin > m_iSize.x) return true;
+
+		ymin = (int) ((area->bottom - m_EarthExtents.bottom)/spacing.y);
+		if (ymin < 0) ymin = 0;
+		if (ymin > m_iSize.y) return true;
+
+		xmax = (int) ((area->right - m_EarthExtents.left)/spacing.x);
+		if (xmax < 0) return true;
+		if (xmax > m_iSize.x) xmax = m_iSize.x;
+
+		ymax = (int) ((area->top - m_EarthExtents.bottom)/spacing.y);
+		if (ymax < 0) return true;
+		if (ymax > m_iSize.y) ymax = m_iSize.y;
+	}
+	const int aw = xmax - xmin, ah = ymax - ymin;
+	if (aw <= 0 || ah <= 0)
+		return true;
+
+	// Label each void, and find its bounding box.  Labels start at 1.
+	std::vector<int> label(aw * ah, 0);
+	std::vector<IPoint2> box_min, box_max;
+	std::vector<int> void_size;
+	std::vector<IPoint2> stack;
+	int iTotalGaps = 0;
+	for (int i = xmin; i < xmax; i++)
+	{
+		for (int j = ymin; j < ymax; j++)
+		{
+			if (label[(i-xmin) * ah + (j-ymin)] || GetFValue(i, j) != INVALID_ELEVATION)
+				continue;
+
+			const int id = (int) box_min.size() + 1;
+			IPoint2 bmin(i, j), bmax(i, j);
+			int count = 0;
+			stack.push_back(IPoint2(i, j));
+			label[(i-xmin) * ah + (j-ymin)] = id;
+			while (!stack.empty())
+			{
+				const IPoint2 p = stack.back();
+				stack.pop_back();
+				count++;
+				bmin.x = std::min(bmin.x, p.x); bmax.x = std::max(bmax.x, p.x);
+				bmin.y = std::min(bmin.y, p.y); bmax.y = std::max(bmax.y, p.y);
+
+				const IPoint2 next[4] = { IPoint2(p.x-1, p.y), IPoint2(p.x+1, p.y),
+					IPoint2(p.x, p.y-1), IPoint2(p.x, p.y+1) };
+				for (int k = 0; k < 4; k++)
+				{
+					const IPoint2 &q = next[k];
+					if (q.x < xmin || q.x >= xmax || q.y < ymin || q.y >= ymax)
+						continue;
+					int &lq = label[(q.x-xmin) * ah + (q.y-ymin)];
+					if (lq || GetFValue(q.x, q.y) != INVALID_ELEVATION)
+						continue;
+					lq = id;
+					stack.push_back(q);
+				}
+			}
+			box_min.push_back(bmin);
+			box_max.push_back(bmax);
+			void_size.push_back(count);
+			iTotalGaps += count;
+		}
+	}
+	const int iVoids = (int) box_min.size();
+	VTLOG(" %d gaps in %d voids\n", iTotalGaps, iVoids);
+	if (iVoids == 0)
+		return true;
+
+	// Whether a heixel was unknown before we started.  Voids are filled
+	//  independently, so this keeps each from seeing values written by another.
+	auto was_unknown = [&](int i, int j) -> bool
+	{
+		if (i >= xmin && i < xmax && j >= ymin && j < ymax)
+			return label[(i-xmin) * ah + (j-ymin)] != 0;
+		return GetFValue(i, j) == INVALID_ELEVATION;
+	};
+
+	// Fill one void, solving over its bounding box plus the known heixels
+	//  around it.
+	auto fill_void = [&](int v, bool bParallel)
+	{
+		const int i0 = std::max(box_min[v].x - 1, 0);
+		const int j0 = std::max(box_min[v].y - 1, 0);
+		const int i1 = std::min(box_max[v].x + 1, m_iSize.x - 1);
+		const int j1 = std::min(box_max[v].y + 1, m_iSize.y - 1);
+
+		FillLevel lev;
+		lev.Init(i1 - i0 + 1, j1 - j0 + 1);
+		for (int i = i0; i <= i1; i++)
+		{
+			for (int j = j0; j <= j1; j++)
+			{
+				const int k = (i-i0) * lev.h + (j-j0);
+				lev.free[k] = was_unknown(i, j);
+				if (!lev.free[k])
+					lev.value[k] = GetFValue(i, j);
+			}
+		}
+		if (!InitialGuess(lev, bParallel))
+			return;		// no known values nearby; leave it
+		for (int cycle = 0; cycle < 4; cycle++)
+			VCycle(lev, bParallel);
+
+		const int id = v + 1;
+		for (int i = box_min[v].x; i <= box_max[v].x; i++)
+			for (int j = box_min[v].y; j <= box_max[v].y; j++)
+				if (label[(i-xmin) * ah + (j-ymin)] == id)
+					SetFValue(i, j, lev.value[(i-i0) * lev.h + (j-j0)]);
+	};
+
+	// Large voids divide their own work among threads; small voids are
+	//  each done by one thread, all at once.
+	const int iLargeArea = 256 * 256;
+	std::vector<int> small;
+	int iDone = 0;
+	for (int v = 0; v < iVoids; v++)
+	{
+		const int box_area = (box_max[v].x - box_min[v].x + 1) * (box_max[v].y - box_min[v].y + 1);
+		if (box_area < iLargeArea)
+		{
+			small.push_back(v);
+			continue;
+		}
+		fill_void(v, true);
+		iDone += void_size[v];
+		if (progress_callback != NULL &&
+			progress_callback((int) ((double) iDone * 99 / iTotalGaps)))
+			return false;
+	}
+
+	// The small voids are filled in batches, so that progress carries on
+	//  from where the large voids left it, as one range for the whole job.
+	const int iSmall = (int) small.size();
+	const int iBatch = std::max(iSmall / 50, 1);
+	for (int first = 0; first < iSmall; first += iBatch)
+	{
+		const int count = std::min(iBatch, iSmall - first);
+		vtParallelFor(count, [&](int k)
+		{
+			fill_void(small[first + k], false);
+		});
+		for (int k = 0; k < count; k++)
+			iDone += void_size[small[first + k]];
+		if (progress_callback != NULL &&
+			progress_callback((int) ((double) iDone * 99 / iTotalGaps)))
+			return false;
+	}
+
+	// recompute what has likely changed
+	ComputeHeightExtents();
+	return true;
+}
+
 /** Set an elevation value to the grid.
  * \param i, j Column and row location in the grid.
  * \param value The value in (integer) meters.
@@ -1158,19 +1561,20 @@ void vtElevationGrid::SetValue(int i, int j, short value)
 {
 	assert(i >= 0 && i < m_iSize.x);
 	assert(j >= 0 && j < m_iSize.y);
+	const size_t n = DataIndex(i, j);
 	if (m_bFloatMode)
 	{
 		if (m_fVMeters == 1.0f || value == INVALID_ELEVATION)
-			m_pFData[i*m_iSize.y+j] = (float)value;
+			m_pFData[n] = (float)value;
 		else
-			m_pFData[i*m_iSize.y+j] = (float)value / m_fVMeters;
+			m_pFData[n] = (float)value / m_fVMeters;
 	}
 	else
 	{
 		if (m_fVMeters == 1.0f || value == INVALID_ELEVATION)
-			m_pData[i*m_iSize.y+j] = value;
+			m_pData[n] = value;
 		else
-			m_pData[i*m_iSize.y+j] = (short) ((float)value / m_fVMeters);
+			m_pData[n] = (short) ((float)value / m_fVMeters);
 	}
 }
 
@@ -1182,20 +1586,7 @@ void vtElevationGrid::SetFValue(int i, int j, float value)
 {
 	assert(i >= 0 && i < m_iSize.x);
 	assert(j >= 0 && j < m_iSize.y);
-	if (m_bFloatMode)
-	{
-		if (m_fVMeters == 1.0f || value == INVALID_ELEVATION)
-			m_pFData[i*m_iSize.y+j] = value;
-		else
-			m_pFData[i*m_iSize.y+j] = value / m_fVMeters;
-	}
-	else
-	{
-		if (m_fVMeters == 1.0f || value == INVALID_ELEVATION)
-			m_pData[i*m_iSize.y+j] = (short) value;
-		else
-			m_pData[i*m_iSize.y+j] = (short) (value / m_fVMeters);
-	}
+	MetersToRaw(DataIndex(i, j), value);
 }
 
 /** Get a value direct from the grid, in the special case
@@ -1205,7 +1596,7 @@ void vtElevationGrid::SetFValue(int i, int j, float value)
  */
 short vtElevationGrid::GetShortValue(int i, int j) const
 {
-	return m_pData[i*m_iSize.y+j];
+	return m_pData[DataIndex(i, j)];
 }
 
 /** Get an elevation value from the grid.
@@ -1214,19 +1605,85 @@ short vtElevationGrid::GetShortValue(int i, int j) const
  */
 float vtElevationGrid::GetFValue(int i, int j) const
 {
-	if (m_bFloatMode)
+	return RawToMeters(DataIndex(i, j));
+}
+
+/** Get the values of one row of the grid.
+ * \param j The row.
+ * \param values An array of at least GetDimensions().x values, which receives
+ *		the heights in meters.
+ */
+void vtElevationGrid::GetRow(int j, float *values) const
+{
+	if (m_Layout == GRID_ROW_MAJOR)
 	{
-		float value = m_pFData[i*m_iSize.y+j];
-		if (m_fVMeters == 1.0f || value == INVALID_ELEVATION)
-			return value;
-		else
-			return value * m_fVMeters;
+		const size_t n = (size_t) j * m_iSize.x;
+		for (int i = 0; i < m_iSize.x; i++)
+			values[i] = RawToMeters(n + i);
+	}
+	else
+	{
+		for (int i = 0; i < m_iSize.x; i++)
+			values[i] = RawToMeters(DataIndex(i, j));
+	}
+}
+
+/** Set the values of one row of the grid.
+ * \param j The row.
+ * \param values An array of GetDimensions().x heights in meters.
+ */
+void vtElevationGrid::SetRow(int j, const float *values)
+{
+	if (m_Layout == GRID_ROW_MAJOR)
+	{
+		const size_t n = (size_t) j * m_iSize.x;
+		for (int i = 0; i < m_iSize.x; i++)
+			MetersToRaw(n + i, values[i]);
+	}
+	else
+	{
+		for (int i = 0; i < m_iSize.x; i++)
+			MetersToRaw(DataIndex(i, j), values[i]);
+	}
+}
+
+/** Get the values of one column of the grid.
+ * \param i The column.
+ * \param values An array of at least GetDimensions().y values, which receives
+ *		the heights in meters.
+ */
+void vtElevationGrid::GetColumn(int i, float *values) const
+{
+	if (m_Layout == GRID_COLUMN_MAJOR)
+	{
+		const size_t n = (size_t) i * m_iSize.y;
+		for (int j = 0; j < m_iSize.y; j++)
+			values[j] = RawToMeters(n + j);
 	}
-	short svalue = m_pData[i*m_iSize.y+j];
-	if (m_fVMeters == 1.0f || svalue == INVALID_ELEVATION)
-		return (float) svalue;
 	else
-		return ((float)svalue * m_fVMeters);
+	{
+		for (int j = 0; j < m_iSize.y; j++)
+			values[j] = RawToMeters(DataIndex(i, j));
+	}
+}
+
+/** Set the values of one column of the grid.
+ * \param i The column.
+ * \param values An array of GetDimensions().y heights in meters.
+ */
+void vtElevationGrid::SetColumn(int i, const float *values)
+{
+	if (m_Layout == GRID_COLUMN_MAJOR)
+	{
+		const size_t n = (size_t) i * m_iSize.y;
+		for (int j = 0; j < m_iSize.y; j++)
+			MetersToRaw(n + j, values[j]);
+	}
+	else
+	{
+		for (int j = 0; j < m_iSize.y; j++)
+			MetersToRaw(DataIndex(i, j), values[j]);
+	}
 }
 
 
@@ -1266,7 +1723,7 @@ bool vtElevationGrid::AllocateGrid(vtElevError *err)
 {
 	if (m_bFloatMode)
 	{
-		const long long size = m_iSize.x * m_iSize.y * sizeof(float);
+		const long long size = DataCount() * sizeof(float);
 		m_pData = NULL;
 		m_pFData = (float *)malloc((size_t) size);
 		if (!m_pFData)
@@ -1280,7 +1737,7 @@ bool vtElevationGrid::AllocateGrid(vtElevError *err)
 	}
 	else
 	{
-		const long long size = m_iSize.x * m_iSize.y * sizeof(short);
+		const long long size = DataCount() * sizeof(short);
 		m_pData = (short *)malloc((size_t) size);
 		m_pFData = NULL;
 		if (!m_pData)
@@ -1299,18 +1756,17 @@ bool vtElevationGrid::AllocateGrid(vtElevError *err)
 
 void vtElevationGrid::FillWithSingleValue(float fValue)
 {
-	int i, j;
-	if (m_bFloatMode)
+	// Every heixel gets the same stored value, so fill the whole array
+	const size_t count = DataCount();
+	if (count > 0 && m_bFloatMode)
 	{
-		for (i = 0; i < m_iSize.x; i++)
-			for (j = 0; j < m_iSize.y; j++)
-				SetFValue(i, j, fValue);
+		SetFValue(0, 0, fValue);
+		std::fill(m_pFData, m_pFData + count, m_pFData[0]);
 	}
-	else
+	else if (count > 0)
 	{
-		for (i = 0; i < m_iSize.x; i++)
-			for (j = 0; j < m_iSize.y; j++)
-				SetValue(i, j, (short) fValue);
+		SetValue(0, 0, (short) fValue);
+		std::fill(m_pData, m_pData + count, m_pData[0]);
 	}
 	m_fMinHeight = fValue;
 	m_fMaxHeight = fValue;
@@ -1626,6 +2082,22 @@ bool vtElevationGrid::FindAltitudeAtPoint(const FPoint3 &p, float &fAltitude,
 	return true;
 }
 
+/**
+ * Find the altitude of many points at once.  The grid has no culture, so
+ * this is a simple loop which the compiler can inline.
+ */
+uint vtElevationGrid::FindAltitudesAtPoints(FPoint3 *p3, uint iCount,
+	bool bTrue, int iCultureFlags) const
+{
+	uint iFound = 0;
+	for (uint i = 0; i < iCount; i++)
+	{
+		if (vtElevationGrid::FindAltitudeAtPoint(p3[i], p3[i].y, bTrue))
+			iFound++;
+	}
+	return iFound;
+}
+
 /**
  * Return the elevation value at a given point in earth coordinates.
  *
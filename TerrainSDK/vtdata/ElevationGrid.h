@@ -8,6 +8,8 @@
 #ifndef ELEVATIONGRIDH
 #define ELEVATIONGRIDH
 
+#include <algorithm>
+
 #include "MathTypes.h"
 #include "vtCRS.h"
 #include "LocalCS.h"
@@ -16,6 +18,16 @@
 
 class GDALDataset;
 
+/**
+ * The order in which the heixels of a vtElevationGrid are stored in memory.
+ */
+enum vtGridLayout
+{
+	GRID_COLUMN_MAJOR,	///< Each column is contiguous.  The default, and the order of BT files.
+	GRID_ROW_MAJOR,		///< Each row is contiguous.
+	GRID_TILED			///< 32x32 tiles, in rows, with the heixels of each tile in Z-order.
+};
+
 /**
  * The vtElevationGrid class represents a generic grid of elevation data.
  * It supports reading and writing the data from many file formats, testing
@@ -28,6 +40,13 @@ class GDALDataset;
  *
  * To load a grid from a file, first create an empty grid, then call the
  * appropriated Load method.
+ *
+ * The heixels are stored in columns by default.  SetLayout can store them
+ * in rows instead, or in small square tiles, which keeps neighbours in both
+ * directions close in memory.  Whatever the layout, GetFValue and SetFValue
+ * work the same.  Code which visits many heixels should use the bulk
+ * methods, GetRow/SetRow, GetColumn/SetColumn, ForEachHeixel and
+ * TransformHeixels, which read the memory in order.
  */
 class vtElevationGrid : public vtHeightFieldGrid3d
 {
@@ -61,6 +80,7 @@ public:
 	int ReplaceValue(float value1, float value2);
 	bool FillGaps(DRECT *area = NULL, bool progress_callback(int) = NULL);
 	bool FillGapsSmooth(DRECT *area = NULL, bool progress_callback(int) = NULL);
+	bool FillGapsMultigrid(DRECT *area = NULL, bool progress_callback(int) = NULL);
 
 	int FillGapsByRegionGrowing(int radius_start=2, int radius_stop=5, bool progress_callback(int) = NULL);
 	int FillGapsByRegionGrowing(int radius, bool progress_callback(int) = NULL);
@@ -121,6 +141,14 @@ public:
 	float GetFValue(int i, int j) const;		// returns height value as a float
 	float GetFValueSafe(int i, int j) const;
 
+	// Bulk access to height values, in meters
+	void GetRow(int j, float *values) const;
+	void SetRow(int j, const float *values);
+	void GetColumn(int i, float *values) const;
+	void SetColumn(int i, const float *values);
+	template <class F> void ForEachHeixel(F func) const;
+	template <class F> void TransformHeixels(F func);
+
 	float GetClosestValue(const DPoint2 &p) const;
 	float GetFilteredValue(const DPoint2 &p) const;
 
@@ -136,6 +164,12 @@ public:
 	 */
 	bool  IsFloatMode()	const { return m_bFloatMode; }
 
+	bool SetLayout(vtGridLayout layout);
+	/** The order in which the heixels are stored in memory. */
+	vtGridLayout GetLayout() const { return m_Layout; }
+	size_t DataIndex(int i, int j) const;
+	size_t DataCount() const;
+
 	void FillWithSingleValue(float fValue);
 	void GetEarthPoint(int i, int j, DPoint2 &p) const;
 	void GetEarthLocation(int i, int j, DPoint3 &loc) const;
@@ -157,9 +191,9 @@ public:
 	float GetScale() const { return m_fVMeters; }
 
 	bool HasData() const { return (m_pData != NULL || m_pFData != NULL); }
-	int MemoryNeededToLoad() const { return m_iSize.x * m_iSize.x * (m_bFloatMode ? 4 : 2); }
-	int MemoryUsed() const { if (m_pData) return m_iSize.x * m_iSize.x * 2;
-						 else if (m_pFData) return m_iSize.x * m_iSize.x * 4;
+	int MemoryNeededToLoad() const { return (int) DataCount() * (m_bFloatMode ? 4 : 2); }
+	int MemoryUsed() const { if (m_pData) return (int) DataCount() * 2;
+						 else if (m_pFData) return (int) DataCount() * 4;
 						 else return 0; }
 
 	// Implement vtHeightField methods
@@ -175,13 +209,21 @@ public:
 	bool FindAltitudeAtPoint(const FPoint3 &p3, float &fAltitude,
 		bool bTrue = false, int iCultureFlags = 0,
 		FPoint3 *vNormal = NULL) const;
+	uint FindAltitudesAtPoints(FPoint3 *p3, uint iCount, bool bTrue = false,
+		int iCultureFlags = 0) const;
+	bool IsThreadSafe() const { return true; }
 
 protected:
+	float RawToMeters(size_t n) const;
+	void MetersToRaw(size_t n, float value);
+	template <class F> void VisitInStorageOrder(F func) const;
+
 	bool	m_bFloatMode;
 	short	*m_pData;
 	float	*m_pFData;
 	float	m_fVMeters;	// scale factor to convert stored heights to meters
 	float	m_fVerticalScale;
+	vtGridLayout	m_Layout;
 
 	void SetupMembers();
 	void ComputeExtentsFromCorners();
@@ -198,5 +240,134 @@ protected:
 	vtString	m_strOriginalDEMName;
 };
 
+// Spread the low 5 bits of a value to the even bits, for Z-order.
+inline size_t vtSpreadBits5(int v)
+{
+	v = (v | (v << 4)) & 0x10F;
+	v = (v | (v << 2)) & 0x133;
+	v = (v | (v << 1)) & 0x155;
+	return (size_t) v;
+}
+
+/**
+ * The position in the data array (GetData or GetFloatData) of the heixel
+ * at column i, row j, in the current layout.
+ */
+inline size_t vtElevationGrid::DataIndex(int i, int j) const
+{
+	switch (m_Layout)
+	{
+	case GRID_ROW_MAJOR:
+		return (size_t) j * m_iSize.x + i;
+	case GRID_TILED:
+		return (((size_t) (j >> 5) * ((m_iSize.x + 31) >> 5) + (i >> 5)) << 10) |
+			vtSpreadBits5(i & 31) | (vtSpreadBits5(j & 31) << 1);
+	default:
+		return (size_t) i * m_iSize.y + j;
+	}
+}
+
+/**
+ * The number of values in the data array.  This is the number of heixels,
+ * except for a tiled layout, which is padded to whole tiles.
+ */
+inline size_t vtElevationGrid::DataCount() const
+{
+	if (m_Layout == GRID_TILED)
+		return (size_t) ((m_iSize.x + 31) >> 5) * ((m_iSize.y + 31) >> 5) << 10;
+	return (size_t) m_iSize.x * m_iSize.y;
+}
+
+inline float vtElevationGrid::RawToMeters(size_t n) const
+{
+	const float value = m_bFloatMode ? m_pFData[n] : (float) m_pData[n];
+	if (m_fVMeters == 1.0f || value == INVALID_ELEVATION)
+		return value;
+	return value * m_fVMeters;
+}
+
+inline void vtElevationGrid::MetersToRaw(size_t n, float value)
+{
+	if (m_fVMeters != 1.0f && value != INVALID_ELEVATION)
+		value /= m_fVMeters;
+	if (m_bFloatMode)
+		m_pFData[n] = value;
+	else
+		m_pData[n] = (short) value;
+}
+
+// Call func(i, j, n) for each heixel, in the order they are stored, where
+// n is the heixel's position in the data array.
+template <class F>
+void vtElevationGrid::VisitInStorageOrder(F func) const
+{
+	const int w = m_iSize.x, h = m_iSize.y;
+	if (m_Layout == GRID_TILED)
+	{
+		const int tiles_x = (w + 31) >> 5, tiles_y = (h + 31) >> 5;
+		for (int ty = 0; ty < tiles_y; ty++)
+		{
+			for (int tx = 0; tx < tiles_x; tx++)
+			{
+				const size_t base = (size_t) (ty * tiles_x + tx) << 10;
+				const int jend = std::min(32, h - (ty << 5));
+				const int iend = std::min(32, w - (tx << 5));
+				for (int jj = 0; jj < jend; jj++)
+				{
+					const size_t row = base | (vtSpreadBits5(jj) << 1);
+					for (int ii = 0; ii < iend; ii++)
+						func((tx << 5) + ii, (ty << 5) + jj, row | vtSpreadBits5(ii));
+				}
+			}
+		}
+	}
+	else if (m_Layout == GRID_ROW_MAJOR)
+	{
+		size_t n = 0;
+		for (int j = 0; j < h; j++)
+			for (int i = 0; i < w; i++)
+				func(i, j, n++);
+	}
+	else
+	{
+		size_t n = 0;
+		for (int i = 0; i < w; i++)
+			for (int j = 0; j < h; j++)
+				func(i, j, n++);
+	}
+}
+
+/**
+ * Call func(i, j, value) for every heixel, with its value in meters.  The
+ * heixels are visited in the order they are stored, which is much faster
+ * than calling GetFValue for each column and row.
+ */
+template <class F>
+void vtElevationGrid::ForEachHeixel(F func) const
+{
+	VisitInStorageOrder([&](int i, int j, size_t n)
+	{
+		func(i, j, RawToMeters(n));
+	});
+}
+
+/**
+ * Call func(i, j, value) for every heixel, where value is a reference to
+ * its height in meters, which func may change.  The heixels are visited in
+ * the order they are stored.
+ */
+template <class F>
+void vtElevationGrid::TransformHeixels(F func)
+{
+	VisitInStorageOrder([&](int i, int j, size_t n)
+	{
+		float value = RawToMeters(n);
+		const float before = value;
+		func(i, j, value);
+		if (value != before)
+			MetersToRaw(n, value);
+	});
+}
+
 #endif	// ELEVATIONGRIDH
 
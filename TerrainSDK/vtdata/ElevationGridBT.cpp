@@ -230,7 +230,45 @@ bool vtElevationGrid::LoadBTData(const char *szFileName, bool progress_callback(
 	}
 #else
 	// fast way
-	if (m_bFloatMode)
+	if (m_Layout != GRID_COLUMN_MAJOR)
+	{
+		// The file is in columns; read each column and store it in the
+		//  layout of this grid.
+		std::vector<float> fcolumn(m_iSize.y);
+		std::vector<short> scolumn(m_iSize.y);
+		for (i = 0; i < m_iSize.x; i++)
+		{
+			if (progress_callback != NULL && ((i%40) == 0))
+			{
+				if (progress_callback(i * 100 / m_iSize.x))
+				{
+					// Cancel
+					SetError(err, vtElevError::CANCELLED, "Cancelled loading '%s'", szFileName);
+					gzclose(fp);
+					return false;
+				}
+			}
+			size_t nitems;
+			if (m_bFloatMode)
+				nitems = GZFRead(&fcolumn[0], DT_FLOAT, m_iSize.y, fp, BO_LITTLE_ENDIAN);
+			else
+				nitems = GZFRead(&scolumn[0], DT_SHORT, m_iSize.y, fp, BO_LITTLE_ENDIAN);
+			if (nitems != (size_t) m_iSize.y)
+			{
+				SetError(err, vtElevError::READ_DATA, "Error reading data from file '%s'", szFileName);
+				gzclose(fp);
+				return false;
+			}
+			for (int j = 0; j < m_iSize.y; j++)
+			{
+				if (m_bFloatMode)
+					m_pFData[DataIndex(i, j)] = fcolumn[j];
+				else
+					m_pData[DataIndex(i, j)] = scolumn[j];
+			}
+		}
+	}
+	else if (m_bFloatMode)
 	{
 		for (i = 0; i < m_iSize.y; i++)
 		{
@@ -361,7 +399,32 @@ bool vtElevationGrid::SaveToBT(const char *szFileName,
 		}
 #else
 		// fast way, with the assumption that the data is stored column-first in memory
-		if (m_bFloatMode)
+		if (m_Layout != GRID_COLUMN_MAJOR)
+		{
+			// Gather each column from the layout of this grid
+			std::vector<float> fcolumn(m_iSize.y);
+			std::vector<short> scolumn(m_iSize.y);
+			for (int i = 0; i < m_iSize.x; i++)
+			{
+				if (progress_callback != NULL)
+				{
+					if (progress_callback(i * 100 / m_iSize.x))
+					{ fclose(fp); return false; }
+				}
+				for (int j = 0; j < m_iSize.y; j++)
+				{
+					if (m_bFloatMode)
+						fcolumn[j] = m_pFData[DataIndex(i, j)];
+					else
+						scolumn[j] = m_pData[DataIndex(i, j)];
+				}
+				if (m_bFloatMode)
+					FWrite(&fcolumn[0], DT_FLOAT, m_iSize.y, fp, BO_LITTLE_ENDIAN);
+				else
+					FWrite(&scolumn[0], DT_SHORT, m_iSize.y, fp, BO_LITTLE_ENDIAN);
+			}
+		}
+		else if (m_bFloatMode)
 		{
 			for (int i = 0; i < w; i++)
 			{
@@ -417,7 +480,32 @@ bool vtElevationGrid::SaveToBT(const char *szFileName,
 		gzseek(fp, 256, SEEK_SET);
 
 		// fast way, with the assumption that the data is stored column-first in memory
-		if (m_bFloatMode)
+		if (m_Layout != GRID_COLUMN_MAJOR)
+		{
+			// Gather each column from the layout of this grid
+			std::vector<float> fcolumn(m_iSize.y);
+			std::vector<short> scolumn(m_iSize.y);
+			for (int i = 0; i < m_iSize.x; i++)
+			{
+				if (progress_callback != NULL)
+				{
+					if (progress_callback(i * 100 / m_iSize.x))
+					{ gzclose(fp); return false; }
+				}
+				for (int j = 0; j < m_iSize.y; j++)
+				{
+					if (m_bFloatMode)
+						fcolumn[j] = m_pFData[DataIndex(i, j)];
+					else
+						scolumn[j] = m_pData[DataIndex(i, j)];
+				}
+				if (m_bFloatMode)
+					GZFWrite(&fcolumn[0], DT_FLOAT, m_iSize.y, fp, BO_LITTLE_ENDIAN);
+				else
+					GZFWrite(&scolumn[0], DT_SHORT, m_iSize.y, fp, BO_LITTLE_ENDIAN);
+			}
+		}
+		else if (m_bFloatMode)
 		{
 			for (int i = 0; i < w; i++)
 			{
@@ -20,6 +20,7 @@ using namespace std;
 #include "ElevationGrid.h"
 #include "FilePath.h"
 #include "GDALWrapper.h"
+#include "Unarchive.h"
 #include "vtDIB.h"
 #include "vtLog.h"
 #include "vtString.h"
@@ -85,6 +86,10 @@ bool vtElevationGrid::LoadFromFile(const char *szFileName,
 		return false;
 	}
 
+	// A file inside an archive can only be read in place by GDAL
+	if (vtArchive::IsVirtualPath(szFileName))
+		return LoadWithGDAL(szFileName, progress_callback, err);
+
 	// The first character in the file is useful for telling which format
 	// the file really is.
 	FILE *fp = vtFileOpen(szFileName, "rb");
@@ -1735,9 +1740,9 @@ bool vtElevationGrid::LoadWithGDAL(const char *szFileName,
 				// check for several different commonly used values meaning
 				// "no data at this location"
 				if (fElev == -9999 || fElev == -32766 || fElev == 32767 || fElev == -32767 || fElev < -100000)
-					SetValue(i, m_iSize.y-1-j, INVALID_ELEVATION);
+					pafScanline[i] = INVALID_ELEVATION;
 				else
-					SetFValue(i, m_iSize.y-1-j, fElev * fScale);
+					pafScanline[i] = fElev * fScale;
 			}
 		}
 		else
@@ -1752,11 +1757,13 @@ bool vtElevationGrid::LoadWithGDAL(const char *szFileName,
 				// check for several different commonly used values meaning
 				// "no data at this location"
 				if (elev == -9999 || elev == -32766 || elev == 32767)
-					SetValue(i, m_iSize.y-1-j, INVALID_ELEVATION);
+					pafScanline[i] = INVALID_ELEVATION;
 				else
-					SetFValue(i, m_iSize.y-1-j, elev * fScale);
+					pafScanline[i] = elev * fScale;
 			}
 		}
+		// Store the whole row at once
+		SetRow(m_iSize.y-1-j, pafScanline);
 		if (progress_callback != NULL)
 		{
 			if (progress_callback(100*j/m_iSize.y))
@@ -2763,29 +2770,23 @@ bool vtElevationGrid::SaveToASC(const char *szFileName,
 		//  existing values are all actually integral.  It's worth taking
 		//  a second to scan, as it makes a much smaller output file.
 		bWriteIntegers = true;
-		for (i = 0; i < m_iSize.y; i++)
+		ForEachHeixel([&bWriteIntegers](int i, int j, float z)
 		{
-			for (j = 0; j < m_iSize.x; j++)
-			{
-				z = GetFValue(j, i);
-				if (z == INVALID_ELEVATION)
-					continue;
-				if ((int)z*100 != (int)(z*100))
-					bWriteIntegers= false;
-			}
-			if (!bWriteIntegers)
-				break;
-		}
+			if (z != INVALID_ELEVATION && (int)z*100 != (int)(z*100))
+				bWriteIntegers = false;
+		});
 	}
 	// Now we can write the actual data
+	std::vector<float> row(m_iSize.x);
 	for (i = 0; i < m_iSize.y; i++)
 	{
 		if (progress_callback != NULL)
 			progress_callback(i*100/m_iSize.y);
 
+		GetRow(m_iSize.y-1-i, &row[0]);
 		for (j = 0; j < m_iSize.x; j++)
 		{
-			z = GetFValue(j, m_iSize.y-1-i);
+			z = row[j];
 			if (z == INVALID_ELEVATION)
 				fprintf(fp, " %d", nodata);
 			else
@@ -2961,16 +2962,16 @@ bool vtElevationGrid::SaveToRAWINF(const char *szFileName, bool progress_callbac
 	if (!fp)
 		return false;
 	int i, j;
+	std::vector<float> row(m_iSize.x);
+	std::vector<short> out(m_iSize.x);
 	for (j = 0; j < m_iSize.y; j++)
 	{
 		if (progress_callback != NULL)
 			progress_callback(j * 100 / m_iSize.y);
+		GetRow(m_iSize.y-1-j, &row[0]);
 		for (i = 0; i < m_iSize.x; i++)
-		{
-			float val = GetFValue(i, m_iSize.y-1-j);
-			short s = (short) val;
-			fwrite(&s, 1, sizeof(short), fp);
-		}
+			out[i] = (short) row[i];
+		fwrite(&out[0], sizeof(short), m_iSize.x, fp);
 	}
 	fclose(fp);
 
@@ -3024,16 +3025,16 @@ bool vtElevationGrid::SaveToRAW_Unity(const char *szFileName, bool progress_call
 	if (!fp)
 		return false;
 	int i, j;
+	std::vector<float> row(m_iSize.x);
+	std::vector<uchar> out(m_iSize.x);
 	for (j = 0; j < m_iSize.y; j++)
 	{
 		if (progress_callback != NULL)
 			progress_callback(j * 100 / m_iSize.y);
+		GetRow(j, &row[0]);
 		for (i = 0; i < m_iSize.x; i++)
-		{
-			float val = GetFValue(i, j);
-			uchar s = (uchar) ((val - fMin) / fRange * 255);
-			fwrite(&s, 1, sizeof(uchar), fp);
-		}
+			out[i] = (uchar) ((row[i] - fMin) / fRange * 255);
+		fwrite(&out[0], sizeof(uchar), m_iSize.x, fp);
 	}
 	fclose(fp);
 	return true;
@@ -3110,12 +3111,14 @@ bool vtElevationGrid::SaveToPNG16(const char *fname)
 	short val;
 	uint8_t *adr = (uint8_t *) &val;
 	uint row, col;
+	float *values = (float *)malloc(width * sizeof(float));
 	for (row = 0; row < height; row++)
 	{
 		png_bytep pngptr = row_pointers[row];
+		GetRow(height-1-row, values);
 		for (col = 0; col < width; col++)
 		{
-			val = (short) GetFValue(col, height-1-row);
+			val = (short) values[col];
 			*pngptr++ = adr[0];
 			*pngptr++ = adr[1];
 		}
@@ -3127,6 +3130,7 @@ bool vtElevationGrid::SaveToPNG16(const char *fname)
 	/* It is REQUIRED to call this to finish writing the rest of the file */
 	png_write_end(png_ptr, info_ptr);
 
+	free(values);
 	free(image);
 	free(row_pointers);
 
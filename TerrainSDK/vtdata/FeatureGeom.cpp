@@ -5,12 +5,77 @@
 // Free for all uses, see license.txt for details.
 //
 
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
 #include "Features.h"
 #include "xmlhelper/easyxml.hpp"
+#include "Parallel.h"
 #include "PolyChecker.h"
 #include "vtLog.h"
 #include "DLG.h"
 
+// When loading from a vtShapeReader, records are decoded in parallel, in
+//  chunks of this many.
+#define SHP_CHUNK_SIZE	1024
+
+/**
+ * Helper: call a function for each of iCount records, in parallel.
+ *
+ * \return false if the progress callback cancelled, in which case some
+ *	records may not have been visited.
+ */
+static bool ForEachRecord(uint iCount, const std::function<void(uint)> &func,
+	bool progress_callback(int))
+{
+	const int chunks = (int) ((iCount + SHP_CHUNK_SIZE - 1) / SHP_CHUNK_SIZE);
+	return vtParallelFor(chunks, [&](int c)
+	{
+		const uint end = std::min(iCount, (uint) (c + 1) * SHP_CHUNK_SIZE);
+		for (uint i = (uint) c * SHP_CHUNK_SIZE; i < end; i++)
+			func(i);
+	}, progress_callback);
+}
+
+
+/**
+ * Helper: the distance from a point to the nearest place on a line, in 2D.
+ * Works with both DLine2 and DLine3.
+ */
+template <class LINE>
+static double DistanceToLine(const LINE &line, const DPoint2 &p, bool bClosed)
+{
+	const int npoints = line.GetSize();
+	if (npoints == 0)
+		return 1E9;
+	if (npoints == 1)
+		return DPoint2(line[0].x - p.x, line[0].y - p.y).Length();
+
+	double closest2 = 1E18;
+	const int nsegments = bClosed ? npoints : npoints - 1;
+	for (int i = 0; i < nsegments; i++)
+	{
+		const double x0 = line[i].x, y0 = line[i].y;
+		const int next = (i + 1 == npoints) ? 0 : i + 1;
+		const double dx = line[next].x - x0, dy = line[next].y - y0;
+		const double len2 = dx*dx + dy*dy;
+
+		// Parameter of the perpendicular foot, clamped to the segment
+		double u = 0.0;
+		if (len2 > 0.0)
+		{
+			u = ((p.x - x0) * dx + (p.y - y0) * dy) / len2;
+			if (u < 0.0) u = 0.0;
+			if (u > 1.0) u = 1.0;
+		}
+		const double ex = x0 + u * dx - p.x, ey = y0 + u * dy - p.y;
+		const double dist2 = ex*ex + ey*ey;
+		if (dist2 < closest2)
+			closest2 = dist2;
+	}
+	return sqrt(closest2);
+}
 
 /////////////////////////////////////////////////////////////////////////////
 // vtFeatureSetPoint2D
@@ -52,6 +117,7 @@ bool vtFeatureSetPoint2D::ComputeExtent(DRECT &rect) const
 
 void vtFeatureSetPoint2D::Offset(const DPoint2 &p, bool bSelectedOnly)
 {
+	FreeRTree();
 	for (uint i = 0; i < m_Point2.GetSize(); i++)
 	{
 		if (bSelectedOnly && !IsSelected(i))
@@ -62,6 +128,7 @@ void vtFeatureSetPoint2D::Offset(const DPoint2 &p, bool bSelectedOnly)
 
 bool vtFeatureSetPoint2D::TransformCoords(OCTransform *pTransform, bool progress_callback(int))
 {
+	FreeRTree();
 	uint i, bad = 0, size = m_Point2.GetSize();
 	for (i = 0; i < size; i++)
 	{
@@ -79,6 +146,7 @@ bool vtFeatureSetPoint2D::TransformCoords(OCTransform *pTransform, bool progress
 
 bool vtFeatureSetPoint2D::AppendGeometryFrom(vtFeatureSet *pFromSet)
 {
+	FreeRTree();
 	vtFeatureSetPoint2D *pFrom = dynamic_cast<vtFeatureSetPoint2D*>(pFromSet);
 	if (!pFrom)
 		return false;
@@ -97,6 +165,7 @@ int vtFeatureSetPoint2D::AddPoint(const DPoint2 &p)
 
 void vtFeatureSetPoint2D::SetPoint(uint num, const DPoint2 &p)
 {
+	FreeRTree();
 	if (m_eGeomType == wkbPoint)
 		m_Point2.SetAt(num, p);
 }
@@ -111,6 +180,10 @@ void vtFeatureSetPoint2D::GetPoint(uint num, DPoint2 &p) const
  */
 int vtFeatureSetPoint2D::FindClosestPoint(const DPoint2 &p, double epsilon, double *distance)
 {
+	// If there is a spatial index, use it
+	if (m_pRTree)
+		return FindClosestFeature(p, epsilon, distance);
+
 	uint entities = NumEntities();
 	double dist, closest = 1E9;
 	int found = -1;
@@ -201,6 +274,51 @@ void vtFeatureSetPoint2D::LoadGeomFromSHP(SHPHandle hSHP, bool progress_callback
 	}
 }
 
+bool vtFeatureSetPoint2D::LoadGeomFromReader(const vtShapeReader &reader,
+	const std::vector<uint> &records, std::vector<uint> &entity_records,
+	bool progress_callback(int))
+{
+	const int type = reader.GetShapeType();
+	if (type != SHPT_POINT && type != SHPT_POINTZ && type != SHPT_POINTM)
+		return false;
+
+	VTLOG(" vtFeatureSetPoint2D::LoadGeomFromReader\n");
+
+	const uint nElems = (uint) records.size();
+	m_Point2.SetSize(nElems);
+	const bool bDone = ForEachRecord(nElems, [&](uint i)
+	{
+		// Beware: it is possible for the shape to not actually have vertices
+		vtShapeReader::Shape shape;
+		if (reader.GetShape(records[i], shape) && shape.m_iNumPoints > 0)
+			m_Point2[i] = shape.GetPoint(0);
+		else
+			m_Point2[i].Set(0, 0);
+	}, progress_callback);
+
+	if (!bDone)
+	{
+		VTLOG("  Cancelled.\n");
+		entity_records.clear();
+		return false;
+	}
+
+	entity_records = records;
+	return true;
+}
+
+bool vtFeatureSetPoint2D::ComputeFeatureExtent(uint iEnt, DRECT &rect) const
+{
+	const DPoint2 &p = m_Point2[iEnt];
+	rect.SetRect(p.x, p.y, p.x, p.y);
+	return true;
+}
+
+double vtFeatureSetPoint2D::DistanceToFeature(uint iEnt, const DPoint2 &p) const
+{
+	return (m_Point2[iEnt] - p).Length();
+}
+
 bool vtFeatureSetPoint2D::EarthExtents(DRECT &ext) const
 {
 	ext.SetInsideOut();
@@ -257,6 +375,7 @@ bool vtFeatureSetPoint3D::ComputeExtent(DRECT &rect) const
 
 void vtFeatureSetPoint3D::Offset(const DPoint2 &p, bool bSelectedOnly)
 {
+	FreeRTree();
 	for (uint i = 0; i < m_Point3.GetSize(); i++)
 	{
 		if (bSelectedOnly && !IsSelected(i))
@@ -267,6 +386,7 @@ void vtFeatureSetPoint3D::Offset(const DPoint2 &p, bool bSelectedOnly)
 
 bool vtFeatureSetPoint3D::TransformCoords(OCTransform *pTransform, bool progress_callback(int))
 {
+	FreeRTree();
 	uint i, bad = 0, size = m_Point3.GetSize();
 	for (i = 0; i < size; i++)
 	{
@@ -284,6 +404,7 @@ bool vtFeatureSetPoint3D::TransformCoords(OCTransform *pTransform, bool progress
 
 bool vtFeatureSetPoint3D::AppendGeometryFrom(vtFeatureSet *pFromSet)
 {
+	FreeRTree();
 	vtFeatureSetPoint3D *pFrom = dynamic_cast<vtFeatureSetPoint3D*>(pFromSet);
 	if (!pFrom)
 		return false;
@@ -302,6 +423,7 @@ int vtFeatureSetPoint3D::AddPoint(const DPoint3 &p)
 
 void vtFeatureSetPoint3D::SetPoint(uint num, const DPoint3 &p)
 {
+	FreeRTree();
 	m_Point3.SetAt(num, p);
 }
 
@@ -381,6 +503,55 @@ void vtFeatureSetPoint3D::LoadGeomFromSHP(SHPHandle hSHP, bool progress_callback
 	}
 }
 
+bool vtFeatureSetPoint3D::LoadGeomFromReader(const vtShapeReader &reader,
+	const std::vector<uint> &records, std::vector<uint> &entity_records,
+	bool progress_callback(int))
+{
+	const int type = reader.GetShapeType();
+	if (type != SHPT_POINT && type != SHPT_POINTZ && type != SHPT_POINTM)
+		return false;
+
+	VTLOG(" vtFeatureSetPoint3D::LoadGeomFromReader\n");
+
+	const uint nElems = (uint) records.size();
+	m_Point3.SetSize(nElems);
+	const bool bDone = ForEachRecord(nElems, [&](uint i)
+	{
+		// Beware: it is possible for the shape to not actually have vertices
+		vtShapeReader::Shape shape;
+		if (reader.GetShape(records[i], shape) && shape.m_iNumPoints > 0)
+		{
+			const DPoint2 p = shape.GetPoint(0);
+			m_Point3[i].Set(p.x, p.y, shape.GetZ(0));
+		}
+		else
+			m_Point3[i].Set(0, 0, 0);
+	}, progress_callback);
+
+	if (!bDone)
+	{
+		VTLOG("  Cancelled.\n");
+		entity_records.clear();
+		return false;
+	}
+
+	entity_records = records;
+	return true;
+}
+
+bool vtFeatureSetPoint3D::ComputeFeatureExtent(uint iEnt, DRECT &rect) const
+{
+	const DPoint3 &p = m_Point3[iEnt];
+	rect.SetRect(p.x, p.y, p.x, p.y);
+	return true;
+}
+
+double vtFeatureSetPoint3D::DistanceToFeature(uint iEnt, const DPoint2 &p) const
+{
+	const DPoint3 &p3 = m_Point3[iEnt];
+	return DPoint2(p3.x - p.x, p3.y - p.y).Length();
+}
+
 bool vtFeatureSetPoint3D::EarthExtents(DRECT &ext) const
 {
 	ext.SetInsideOut();
@@ -400,21 +571,68 @@ bool vtFeatureSetPoint3D::EarthExtents(DRECT &ext) const
 vtFeatureSetLineString::vtFeatureSetLineString() : vtFeatureSet()
 {
 	m_eGeomType = wkbLineString;
+	m_bPacked = false;
+}
+
+/**
+ * Move all the lines into packed storage, a DLine2Store.  This uses far
+ * less memory and is faster to query, when there are many lines.
+ */
+void vtFeatureSetLineString::Pack()
+{
+	if (m_bPacked)
+		return;
+
+	uint total = 0;
+	for (uint i = 0; i < m_Line.size(); i++)
+		total += m_Line[i].GetSize();
+
+	m_Packed.Clear();
+	m_Packed.Reserve((uint) m_Line.size(), total);
+	for (uint i = 0; i < m_Line.size(); i++)
+		m_Packed.Append(DLine2View(m_Line[i]));
+
+	DLine2Array().swap(m_Line);
+	m_bPacked = true;
+}
+
+/**
+ * Move the lines out of packed storage, so that each is a DLine2 which can
+ * be modified, and free the packed copy.  This happens automatically when a
+ * modifiable line is asked for, so you don't normally need to call it.
+ * Reading through the const methods and views never unpacks.
+ */
+void vtFeatureSetLineString::FreePacked()
+{
+	if (!m_bPacked)
+		return;
+
+	const uint num = m_Packed.NumLines();
+	m_Line.resize(num);
+	for (uint i = 0; i < num; i++)
+		m_Packed.GetLine(i).ToDLine2(m_Line[i]);
+
+	m_Packed.Clear();
+	m_bPacked = false;
 }
 
 uint vtFeatureSetLineString::NumEntities() const
 {
-	return m_Line.size();
+	return m_bPacked ? m_Packed.NumLines() : (uint) m_Line.size();
 }
 
 void vtFeatureSetLineString::SetNumGeometries(int iNum)
 {
+	FreePacked();
 	m_Line.resize(iNum);
 }
 
 void vtFeatureSetLineString::Reserve(int iNum)
 {
-	m_Line.reserve(iNum);
+	if (m_bPacked)
+		m_Packed.Reserve(iNum, m_Packed.NumPoints());
+	else
+		m_Line.reserve(iNum);
 }
 
 bool vtFeatureSetLineString::ComputeExtent(DRECT &rect) const
@@ -426,34 +644,54 @@ bool vtFeatureSetLineString::ComputeExtent(DRECT &rect) const
 
 	rect.SetInsideOut();
 	for (i = 0; i < entities; i++)
-		rect.GrowToContainLine(m_Line[i]);
+		GetPolyLineView(i).GrowRect(rect);
 
 	return true;
 }
 
 void vtFeatureSetLineString::Offset(const DPoint2 &p, bool bSelectedOnly)
 {
-	for (uint i = 0; i < m_Line.size(); i++)
+	FreeRTree();
+	const uint num = NumEntities();
+	for (uint i = 0; i < num; i++)
 	{
 		if (bSelectedOnly && !IsSelected(i))
 			continue;
-		m_Line[i].Add(p);
+		if (m_bPacked)
+		{
+			DPoint2 *points = m_Packed.GetPoints(i);
+			const uint size = m_Packed.GetLine(i).GetSize();
+			for (uint j = 0; j < size; j++)
+				points[j] += p;
+		}
+		else
+			m_Line[i].Add(p);
 	}
 }
 
 bool vtFeatureSetLineString::TransformCoords(OCTransform *pTransform, bool progress_callback(int))
 {
-	uint i, j, pts, bad = 0, size = m_Line.size();
+	FreeRTree();
+	uint i, j, pts, bad = 0, size = NumEntities();
 	for (i = 0; i < size; i++)
 	{
 		if (progress_callback != NULL && (i%200)==0)
 			progress_callback(i * 99 / size);
 
-		DLine2 &dline = m_Line[i];
-		pts = dline.GetSize();
+		DPoint2 *points;
+		if (m_bPacked)
+		{
+			points = m_Packed.GetPoints(i);
+			pts = m_Packed.GetLine(i).GetSize();
+		}
+		else
+		{
+			points = m_Line[i].GetData();
+			pts = m_Line[i].GetSize();
+		}
 		for (j = 0; j < pts; j++)
 		{
-			DPoint2 &p = dline[j];
+			DPoint2 &p = points[j];
 			int success = pTransform->Transform(1, &p.x, &p.y);
 			if (success != 1)
 				bad++;
@@ -466,25 +704,45 @@ bool vtFeatureSetLineString::TransformCoords(OCTransform *pTransform, bool progr
 
 bool vtFeatureSetLineString::AppendGeometryFrom(vtFeatureSet *pFromSet)
 {
+	FreeRTree();
 	vtFeatureSetLineString *pFrom = dynamic_cast<vtFeatureSetLineString*>(pFromSet);
 	if (!pFrom)
 		return false;
 
-	for (uint i = 0; i < pFrom->NumEntities(); i++)
-		m_Line.push_back(pFrom->m_Line[i]);
+	if (m_bPacked && pFrom->m_bPacked)
+		m_Packed.Append(pFrom->m_Packed);
+	else
+	{
+		for (uint i = 0; i < pFrom->NumEntities(); i++)
+		{
+			if (m_bPacked)
+				m_Packed.Append(pFrom->GetPolyLineView(i));
+			else
+			{
+				m_Line.push_back(DLine2());
+				pFrom->GetPolyLineView(i).ToDLine2(m_Line.back());
+			}
+		}
+	}
 	return true;
 }
 
 int vtFeatureSetLineString::AddPolyLine(const DLine2 &pl)
 {
-	int rec = m_Line.size();
-	m_Line.push_back(pl);
+	int rec = NumEntities();
+	if (m_bPacked)
+		m_Packed.Append(DLine2View(pl));
+	else
+		m_Line.push_back(pl);
 	AddRecord();
 	return rec;
 }
 
 int vtFeatureSetLineString::NumTotalVertices() const
 {
+	if (m_bPacked)
+		return m_Packed.NumPoints();
+
 	int total = 0;
 	for (uint i = 0; i < m_Line.size(); i++)
 		total += m_Line[i].GetSize();
@@ -503,9 +761,19 @@ bool vtFeatureSetLineString::FindClosest(const DPoint2 &p, int &close_feature, D
 	double dist, closest_dist = 1E9;
 	int point_index;
 	DPoint2 intersection;
-	for (uint i = 0; i < m_Line.size(); i++)
+	DLine2 unpacked;
+	const uint num = NumEntities();
+	for (uint i = 0; i < num; i++)
 	{
-		if (m_Line[i].NearestSegment(p, point_index, dist, intersection))
+		// Packed lines are copied out one at a time, rather than unpacking
+		//  the whole set just to look at it.
+		const DLine2 *line = &unpacked;
+		if (m_bPacked)
+			m_Packed.GetLine(i).ToDLine2(unpacked);
+		else
+			line = &m_Line[i];
+
+		if (line->NearestSegment(p, point_index, dist, intersection))
 		{
 			if (dist < closest_dist)
 			{
@@ -524,6 +792,8 @@ bool vtFeatureSetLineString::FindClosest(const DPoint2 &p, int &close_feature, D
  */
 int vtFeatureSetLineString::FixGeometry(double dEpsilon)
 {
+	FreeRTree();
+	FreePacked();
 	int removed = 0;
 	for (uint i = 0; i < m_Line.size(); i++)
 	{
@@ -546,24 +816,25 @@ int vtFeatureSetLineString::FixGeometry(double dEpsilon)
 
 bool vtFeatureSetLineString::IsInsideRect(int iElem, const DRECT &rect)
 {
-	return rect.ContainsLine(m_Line[iElem]);
+	return GetPolyLineView(iElem).IsInsideRect(rect);
 }
 
 void vtFeatureSetLineString::CopyGeometry(uint from, uint to)
 {
 	// copy geometry
+	FreePacked();
 	m_Line[to] = m_Line[from];
 }
 
 void vtFeatureSetLineString::SaveGeomToSHP(SHPHandle hSHP, bool progress_callback(int)) const
 {
-	uint i, j, size = m_Line.size();
+	uint i, j, size = NumEntities();
 	for (i = 0; i < size; i++)
 	{
 		if (progress_callback && ((i%16)==0))
 			progress_callback(i*100/size);
 
-		const DLine2 &dl = m_Line[i];
+		const DLine2View dl = GetPolyLineView(i);
 		double* dX = new double[dl.GetSize()];
 		double* dY = new double[dl.GetSize()];
 
@@ -589,6 +860,7 @@ void vtFeatureSetLineString::SaveGeomToSHP(SHPHandle hSHP, bool progress_callbac
 void vtFeatureSetLineString::LoadGeomFromSHP(SHPHandle hSHP, bool progress_callback(int))
 {
 	VTLOG(" vtFeatureSetLineString::LoadGeomFromSHP\n");
+	FreePacked();
 
 	int nElems;
 	SHPGetInfo(hSHP, &nElems, NULL, NULL, NULL);
@@ -631,21 +903,111 @@ void vtFeatureSetLineString::LoadGeomFromSHP(SHPHandle hSHP, bool progress_callb
 	}
 }
 
-bool vtFeatureSetLineString::EarthExtents(DRECT &ext) const
+bool vtFeatureSetLineString::LoadGeomFromReader(const vtShapeReader &reader,
+	const std::vector<uint> &records, std::vector<uint> &entity_records,
+	bool progress_callback(int))
 {
-	ext.SetInsideOut();
+	const int type = reader.GetShapeType();
+	if (type != SHPT_ARC && type != SHPT_ARCZ && type != SHPT_ARCM)
+		return false;
 
-	if (m_Line.size() == 0)
+	VTLOG(" vtFeatureSetLineString::LoadGeomFromReader\n");
+
+	// Each part of a record becomes a line.  Count them first, so that all
+	//  the lines can be allocated at once, packed, and filled in any order.
+	const uint nElems = (uint) records.size();
+	std::vector<uint> first(nElems + 1), sizes;
+	first[0] = 0;
+	for (uint i = 0; i < nElems; i++)
+	{
+		vtShapeReader::Shape shape;
+		if (reader.GetShape(records[i], shape) && shape.m_iNumPoints > 0 &&
+			shape.m_iNumParts > 0)
+		{
+			for (int part = 0; part < shape.m_iNumParts; part++)
+				sizes.push_back(shape.GetPartEnd(part) - shape.GetPartStart(part));
+		}
+		else
+			sizes.push_back(0);
+		first[i+1] = (uint) sizes.size();
+	}
+	DLine2Store store;
+	store.Allocate(sizes);
+	entity_records.resize(first[nElems]);
+
+	const bool bDone = ForEachRecord(nElems, [&](uint i)
+	{
+		for (uint e = first[i]; e < first[i+1]; e++)
+			entity_records[e] = records[i];
+
+		// Beware: it is possible for the shape to not actually have vertices
+		vtShapeReader::Shape shape;
+		if (!reader.GetShape(records[i], shape) || shape.m_iNumPoints == 0)
+			return;
+
+		// Copy each part
+		for (int part = 0; part < shape.m_iNumParts; part++)
+		{
+			const int start = shape.GetPartStart(part), end = shape.GetPartEnd(part);
+			DPoint2 *points = store.GetPoints(first[i] + part);
+			for (int j = start; j < end; j++)
+				points[j - start] = shape.GetPoint(j);
+		}
+	}, progress_callback);
+
+	if (!bDone)
+	{
+		VTLOG("  Cancelled.\n");
+		entity_records.clear();
 		return false;
+	}
 
-	for (uint i = 0; i < m_Line.size(); i++)
+	if (NumEntities() == 0)
 	{
-		const DLine2 &dl = m_Line[i];
-		ext.GrowToContainLine(dl);
+		m_Line.clear();
+		m_Packed = std::move(store);
+		m_bPacked = true;
+	}
+	else if (m_bPacked)
+		m_Packed.Append(store);
+	else
+	{
+		const uint base = (uint) m_Line.size();
+		m_Line.resize(base + store.NumLines());
+		for (uint i = 0; i < store.NumLines(); i++)
+			store.GetLine(i).ToDLine2(m_Line[base + i]);
 	}
 	return true;
 }
 
+bool vtFeatureSetLineString::ComputeFeatureExtent(uint iEnt, DRECT &rect) const
+{
+	const DLine2View line = GetPolyLineView(iEnt);
+	if (line.GetSize() == 0)
+		return false;
+	rect.SetInsideOut();
+	line.GrowRect(rect);
+	return true;
+}
+
+double vtFeatureSetLineString::DistanceToFeature(uint iEnt, const DPoint2 &p) const
+{
+	return DistanceToLine(GetPolyLineView(iEnt), p, false);
+}
+
+bool vtFeatureSetLineString::EarthExtents(DRECT &ext) const
+{
+	ext.SetInsideOut();
+
+	const uint num = NumEntities();
+	if (num == 0)
+		return false;
+
+	for (uint i = 0; i < num; i++)
+		GetPolyLineView(i).GrowRect(ext);
+	return true;
+}
+
 
 /////////////////////////////////////////////////////////////////////////////
 // vtFeatureSetLineString
@@ -687,6 +1049,7 @@ bool vtFeatureSetLineString3D::ComputeExtent(DRECT &rect) const
 
 void vtFeatureSetLineString3D::Offset(const DPoint2 &p, bool bSelectedOnly)
 {
+	FreeRTree();
 	for (uint i = 0; i < m_Line.size(); i++)
 	{
 		if (bSelectedOnly && !IsSelected(i))
@@ -697,6 +1060,7 @@ void vtFeatureSetLineString3D::Offset(const DPoint2 &p, bool bSelectedOnly)
 
 bool vtFeatureSetLineString3D::TransformCoords(OCTransform *pTransform, bool progress_callback(int))
 {
+	FreeRTree();
 	uint i, j, pts, bad = 0, size = m_Line.size();
 	for (i = 0; i < size; i++)
 	{
@@ -720,6 +1084,7 @@ bool vtFeatureSetLineString3D::TransformCoords(OCTransform *pTransform, bool pro
 
 bool vtFeatureSetLineString3D::AppendGeometryFrom(vtFeatureSet *pFromSet)
 {
+	FreeRTree();
 	vtFeatureSetLineString3D *pFrom = dynamic_cast<vtFeatureSetLineString3D*>(pFromSet);
 	if (!pFrom)
 		return false;
@@ -874,6 +1239,62 @@ void vtFeatureSetLineString3D::LoadGeomFromSHP(SHPHandle hSHP, bool progress_cal
 	}
 }
 
+bool vtFeatureSetLineString3D::LoadGeomFromReader(const vtShapeReader &reader,
+	const std::vector<uint> &records, std::vector<uint> &entity_records,
+	bool progress_callback(int))
+{
+	const int type = reader.GetShapeType();
+	if (type != SHPT_ARC && type != SHPT_ARCZ && type != SHPT_ARCM)
+		return false;
+
+	VTLOG(" vtFeatureSetLineString3D::LoadGeomFromReader\n");
+
+	const uint nElems = (uint) records.size();
+	const uint base = (uint) m_Line.size();
+	m_Line.resize(base + nElems);
+	const bool bDone = ForEachRecord(nElems, [&](uint i)
+	{
+		// Beware: it is possible for the shape to not actually have vertices
+		vtShapeReader::Shape shape;
+		if (!reader.GetShape(records[i], shape) || shape.m_iNumPoints == 0)
+			return;
+
+		// Store each coordinate
+		DLine3 &dline = m_Line[base + i];
+		dline.SetSize(shape.m_iNumPoints);
+		for (int j = 0; j < shape.m_iNumPoints; j++)
+		{
+			const DPoint2 p = shape.GetPoint(j);
+			dline[j].Set(p.x, p.y, shape.GetZ(j));
+		}
+	}, progress_callback);
+
+	if (!bDone)
+	{
+		VTLOG("  Cancelled.\n");
+		entity_records.clear();
+		return false;
+	}
+
+	entity_records = records;
+	return true;
+}
+
+bool vtFeatureSetLineString3D::ComputeFeatureExtent(uint iEnt, DRECT &rect) const
+{
+	const DLine3 &line = m_Line[iEnt];
+	if (line.GetSize() == 0)
+		return false;
+	rect.SetInsideOut();
+	rect.GrowToContainLine(line);
+	return true;
+}
+
+double vtFeatureSetLineString3D::DistanceToFeature(uint iEnt, const DPoint2 &p) const
+{
+	return DistanceToLine(m_Line[iEnt], p, false);
+}
+
 bool vtFeatureSetLineString3D::EarthExtents(DRECT &ext) const
 {
 	ext.SetInsideOut();
@@ -898,21 +1319,69 @@ vtFeatureSetPolygon::vtFeatureSetPolygon() : vtFeatureSet()
 {
 	m_eGeomType = wkbPolygon;
 	m_pIndex = NULL;
+	m_bPacked = false;
+}
+
+/**
+ * Move all the polygons into packed storage, a DPolygon2Store.  This uses
+ * far less memory and is faster to query, when there are many polygons.
+ */
+void vtFeatureSetPolygon::Pack()
+{
+	if (m_bPacked)
+		return;
+
+	uint rings = 0, points = 0;
+	for (uint i = 0; i < m_Poly.size(); i++)
+	{
+		rings += (uint) m_Poly[i].size();
+		points += m_Poly[i].NumTotalVertices();
+	}
+	m_Packed.Clear();
+	m_Packed.Reserve((uint) m_Poly.size(), rings, points);
+	for (uint i = 0; i < m_Poly.size(); i++)
+		m_Packed.Append(DPolygon2View(m_Poly[i]));
+
+	DPolyArray().swap(m_Poly);
+	m_bPacked = true;
+}
+
+/**
+ * Move the polygons out of packed storage, so that each is a DPolygon2
+ * which can be modified, and free the packed copy; see
+ * vtFeatureSetLineString::FreePacked.
+ */
+void vtFeatureSetPolygon::FreePacked()
+{
+	if (!m_bPacked)
+		return;
+
+	const uint num = m_Packed.NumPolygons();
+	m_Poly.resize(num);
+	for (uint i = 0; i < num; i++)
+		m_Packed.GetPolygon(i).ToDPolygon2(m_Poly[i]);
+
+	m_Packed.Clear();
+	m_bPacked = false;
 }
 
 uint vtFeatureSetPolygon::NumEntities() const
 {
-	return m_Poly.size();
+	return m_bPacked ? m_Packed.NumPolygons() : (uint) m_Poly.size();
 }
 
 void vtFeatureSetPolygon::SetNumGeometries(int iNum)
 {
+	FreePacked();
 	m_Poly.resize(iNum);
 }
 
 void vtFeatureSetPolygon::Reserve(int iNum)
 {
-	m_Poly.reserve(iNum);
+	if (m_bPacked)
+		m_Packed.Reserve(iNum, m_Packed.NumRings(), m_Packed.NumPoints());
+	else
+		m_Poly.reserve(iNum);
 }
 
 bool vtFeatureSetPolygon::ComputeExtent(DRECT &rect) const
@@ -926,34 +1395,55 @@ bool vtFeatureSetPolygon::ComputeExtent(DRECT &rect) const
 	for (i = 0; i < entities; i++)
 	{
 		// we only test the first, outer ring since it contains the rest
-		const DPolygon2 &poly = m_Poly[i];
+		const DPolygon2View poly = GetPolygonView(i);
 		int num_rings = poly.size();
 		if (num_rings < 1)
 			continue;
-		const DLine2 &dline = poly[0];
-		rect.GrowToContainLine(dline);
+		poly[0].GrowRect(rect);
 	}
 	return true;
 }
 
 void vtFeatureSetPolygon::Offset(const DPoint2 &p, bool bSelectedOnly)
 {
-	for (uint i = 0; i < m_Poly.size(); i++)
+	FreeRTree();
+	const uint num = NumEntities();
+	for (uint i = 0; i < num; i++)
 	{
 		if (bSelectedOnly && !IsSelected(i))
 			continue;
-		m_Poly[i].Add(p);
+		if (m_bPacked)
+		{
+			uint pts;
+			DPoint2 *points = m_Packed.GetPolygonPoints(i, pts);
+			for (uint j = 0; j < pts; j++)
+				points[j] += p;
+		}
+		else
+			m_Poly[i].Add(p);
 	}
 }
 
 bool vtFeatureSetPolygon::TransformCoords(OCTransform *pTransform, bool progress_callback(int))
 {
-	uint i, j, k, pts, bad = 0, size = m_Poly.size();
+	FreeRTree();
+	uint i, j, k, pts, bad = 0, size = NumEntities();
 	for (i = 0; i < size; i++)
 	{
 		if (progress_callback != NULL && (i%200)==0)
 			progress_callback(i * 99 / size);
 
+		if (m_bPacked)
+		{
+			// All the rings of a packed polygon are contiguous
+			DPoint2 *points = m_Packed.GetPolygonPoints(i, pts);
+			for (k = 0; k < pts; k++)
+			{
+				if (pTransform->Transform(1, &points[k].x, &points[k].y) != 1)
+					bad++;
+			}
+			continue;
+		}
 		DPolygon2 &dpoly = m_Poly[i];
 		for (j = 0; j < dpoly.size(); j++)
 		{
@@ -975,19 +1465,27 @@ bool vtFeatureSetPolygon::TransformCoords(OCTransform *pTransform, bool progress
 
 bool vtFeatureSetPolygon::AppendGeometryFrom(vtFeatureSet *pFromSet)
 {
+	FreeRTree();
 	vtFeatureSetPolygon *pFrom = dynamic_cast<vtFeatureSetPolygon*>(pFromSet);
 	if (!pFrom)
 		return false;
 
-	for (uint i = 0; i < pFrom->NumEntities(); i++)
+	if (m_eGeomType != wkbPolygon && m_eGeomType != wkbMultiPolygon)
+		return true;
+
+	if (m_bPacked && pFrom->m_bPacked)
+		m_Packed.Append(pFrom->m_Packed);
+	else
 	{
-		switch (m_eGeomType) {
-		case wkbPolygon:
-		case wkbMultiPolygon:
-		m_Poly.push_back(pFrom->m_Poly[i]);
-			break;
-		default:
-			break;
+		for (uint i = 0; i < pFrom->NumEntities(); i++)
+		{
+			if (m_bPacked)
+				m_Packed.Append(pFrom->GetPolygonView(i));
+			else
+			{
+				m_Poly.push_back(DPolygon2());
+				pFrom->GetPolygonView(i).ToDPolygon2(m_Poly.back());
+			}
 		}
 	}
 	return true;
@@ -995,8 +1493,11 @@ bool vtFeatureSetPolygon::AppendGeometryFrom(vtFeatureSet *pFromSet)
 
 int vtFeatureSetPolygon::AddPolygon(const DPolygon2 &poly)
 {
-	int rec = m_Poly.size();
-	m_Poly.push_back(poly);
+	int rec = NumEntities();
+	if (m_bPacked)
+		m_Packed.Append(DPolygon2View(poly));
+	else
+		m_Poly.push_back(poly);
 	AddRecord();
 	return rec;
 }
@@ -1043,7 +1544,7 @@ void SpatialIndex::GenerateIndices(const class vtFeatureSetPolygon *feat)
 
 	for (e = 0; e < feat->NumEntities(); e++)
 	{
-		const DPolygon2 &poly = feat->GetPolygon(e);
+		const DPolygon2View poly = feat->GetPolygonView(e);
 		poly.ComputeExtents(ext);
 		x1 = (int) ((ext.left	- m_base.x) / m_step.x);
 		x2 = (int) ((ext.right	- m_base.x) / m_step.x);
@@ -1078,16 +1579,33 @@ const IntVector *SpatialIndex::GetIndexForPoint(const DPoint2 &p) const
  * The index of the polygon is return, or -1 if no polygon was found.
  */
 int vtFeatureSetPolygon::FindPolygon(const DPoint2 &p) const
+{
+	if (m_pIndex != NULL)
+		return FindPolygon(p, m_pIndex->m_iLastFound);
+
+	int iLastFound = -1;
+	return FindPolygon(p, iLastFound);
+}
+
+/**
+ * Find the first polygon in this feature set which contains the given
+ * point.  Rather than remembering the last successful result in the
+ * index, the caller keeps it in iLastFound, so several threads can search
+ * the same feature set at once.  Start with iLastFound = -1.
+ *
+ * The index of the polygon is return, or -1 if no polygon was found.
+ */
+int vtFeatureSetPolygon::FindPolygon(const DPoint2 &p, int &iLastFound) const
 {
 	uint num, i;
 
 	if (m_pIndex != NULL)
 	{
 		// use Index
-		if (m_pIndex->m_iLastFound != -1)	// try last successful result
+		if (iLastFound != -1)	// try last successful result
 		{
-			if (m_Poly[m_pIndex->m_iLastFound].ContainsPoint(p))
-				return m_pIndex->m_iLastFound;		// found
+			if (GetPolygonView(iLastFound).ContainsPoint(p))
+				return iLastFound;		// found
 		}
 		const IntVector *index = m_pIndex->GetIndexForPoint(p);
 		if (index)
@@ -1096,21 +1614,36 @@ int vtFeatureSetPolygon::FindPolygon(const DPoint2 &p) const
 			for (i = 0; i < num; i++)
 			{
 				int e = index->at(i);
-				if (m_Poly[e].ContainsPoint(p))
+				if (GetPolygonView(e).ContainsPoint(p))
 				{
-					m_pIndex->m_iLastFound = e;
+					iLastFound = e;
 					return e;		// found
 				}
 			}
-			m_pIndex->m_iLastFound = -1;
+			iLastFound = -1;
+		}
+	}
+	else if (m_pRTree != NULL)
+	{
+		// use R-tree, which gives candidates in no particular order
+		std::vector<int> candidates;
+		m_pRTree->FindContaining(p, candidates);
+		int first = -1;
+		num = candidates.size();
+		for (i = 0; i < num; i++)
+		{
+			int e = candidates[i];
+			if ((first == -1 || e < first) && GetPolygonView(e).ContainsPoint(p))
+				first = e;
 		}
+		return first;
 	}
 	else
 	{
-		num = m_Poly.size();
+		num = NumEntities();
 		for (i = 0; i < num; i++)
 		{
-			if (m_Poly[i].ContainsPoint(p))
+			if (GetPolygonView(i).ContainsPoint(p))
 				return i;		// found
 		}
 	}
@@ -1123,6 +1656,8 @@ int vtFeatureSetPolygon::FindPolygon(const DPoint2 &p) const
  */
 int vtFeatureSetPolygon::FixGeometry(double dEpsilon)
 {
+	FreeRTree();
+	FreePacked();
 	PolyChecker PolyChecker;
 
 	int removed = 0;
@@ -1187,15 +1722,18 @@ int vtFeatureSetPolygon::SelectBadFeatures(double dEpsilon)
 	DeselectAll();
 	int num_bad = 0;
 
-	int num_features = m_Poly.size();
+	int num_features = NumEntities();
 	for (int f = 0; f < num_features; f++)
 	{
-		DPolygon2 &dpoly = m_Poly[f];
+		const DPolygon2View dpoly = GetPolygonView(f);
 
 		// Concatenate all the points into a single set
-		DLine2 dline;
+		DLine2 dline, ring;
 		for (size_t r = 0; r < dpoly.size(); r++)
-			dline.Append(dpoly[r]);
+		{
+			dpoly[r].ToDLine2(ring);
+			dline.Append(ring);
+		}
 
 		bool bGood = true;
 		// A naive N^2 comparison should be fine, as the number of points won't
@@ -1242,11 +1780,14 @@ void vtFeatureSetPolygon::FreeIndex()
  */
 int vtFeatureSetPolygon::FindSimplePolygon(const DPoint2 &p) const
 {
-	int num = m_Poly.size();
+	int num = NumEntities();
 	for (int i = 0; i < num; i++)
 	{
 		// look only at first ring
-		const DLine2 &dline = (m_Poly[i])[0];
+		const DPolygon2View poly = GetPolygonView(i);
+		if (poly.size() == 0)
+			continue;
+		const DLine2View dline = poly[0];
 		if (dline.ContainsPoint(p))
 		{
 			// found
@@ -1260,23 +1801,24 @@ int vtFeatureSetPolygon::FindSimplePolygon(const DPoint2 &p) const
 bool vtFeatureSetPolygon::IsInsideRect(int iElem, const DRECT &rect)
 {
 	// only test first, exterior ring
-	const DPolygon2 &dpoly = m_Poly[iElem];
+	const DPolygon2View dpoly = GetPolygonView(iElem);
 
 	// beware null polygons
 	if (dpoly.size() == 0)
 		return false;
-	return rect.ContainsLine(dpoly[0]);
+	return dpoly[0].IsInsideRect(rect);
 }
 
 void vtFeatureSetPolygon::CopyGeometry(uint from, uint to)
 {
 	// copy geometry
+	FreePacked();
 	m_Poly[to] = m_Poly[from];
 }
 
 void vtFeatureSetPolygon::SaveGeomToSHP(SHPHandle hSHP, bool progress_callback(int)) const
 {
-	uint num_polys = m_Poly.size();
+	uint num_polys = NumEntities();
 	VTLOG("vtFeatureSetPolygon::SaveGeomToSHP, %d polygons\n", num_polys);
 
 	for (uint i = 0; i < num_polys; i++)		// for each polygon
@@ -1284,7 +1826,7 @@ void vtFeatureSetPolygon::SaveGeomToSHP(SHPHandle hSHP, bool progress_callback(i
 		if (progress_callback && ((i%16)==0))
 			progress_callback(i * 100 / num_polys);
 
-		const DPolygon2 &poly = m_Poly[i];
+		const DPolygon2View poly = GetPolygonView(i);
 
 		int parts = poly.size();
 
@@ -1322,7 +1864,7 @@ void vtFeatureSetPolygon::SaveGeomToSHP(SHPHandle hSHP, bool progress_callback(i
 			{
 				panPartStart[part] = vert;
 
-				const DLine2 &dl = poly[part];
+				const DLine2View dl = poly[part];
 				for (uint j = 0; j < dl.GetSize(); j++) //for each vertex
 				{
 					DPoint2 pt = dl[j];
@@ -1353,6 +1895,7 @@ void vtFeatureSetPolygon::SaveGeomToSHP(SHPHandle hSHP, bool progress_callback(i
 void vtFeatureSetPolygon::LoadGeomFromSHP(SHPHandle hSHP, bool progress_callback(int))
 {
 	VTLOG(" vtFeatureSetPolygon::LoadGeomFromSHP\n");
+	FreePacked();
 
 	int nElems;
 	SHPGetInfo(hSHP, &nElems, NULL, NULL, NULL);
@@ -1381,17 +1924,132 @@ void vtFeatureSetPolygon::LoadGeomFromSHP(SHPHandle hSHP, bool progress_callback
 		VTLOG("  %d of the %d entities were bad.\n", iFailed, nElems);
 }
 
+bool vtFeatureSetPolygon::LoadGeomFromReader(const vtShapeReader &reader,
+	const std::vector<uint> &records, std::vector<uint> &entity_records,
+	bool progress_callback(int))
+{
+	const int type = reader.GetShapeType();
+	if (type != SHPT_POLYGON && type != SHPT_POLYGONZ && type != SHPT_POLYGONM)
+		return false;
+
+	VTLOG(" vtFeatureSetPolygon::LoadGeomFromReader\n");
+
+	// Beware: it is possible for the shape to not actually have vertices, or
+	//  to have less than the minimum needed to define a polygon.  Ignore any
+	//  such degenerate cases.  Count the rings and points first, so that all
+	//  the polygons can be allocated at once, packed, and filled in any order.
+	const uint nElems = (uint) records.size();
+	std::vector<uint> poly_rings(nElems), ring_points;
+	int iFailed = 0;
+	for (uint i = 0; i < nElems; i++)
+	{
+		vtShapeReader::Shape shape;
+		if (!reader.GetShape(records[i], shape) || shape.m_iNumPoints < 3)
+		{
+			poly_rings[i] = 0;
+			iFailed++;
+			continue;
+		}
+		// Each part is a ring.  The first is the 'outer' ring, any subsequent
+		//  parts are 'inside' rings.  SHP files always duplicate the first
+		//  point of each ring (part) which we can ignore.
+		poly_rings[i] = shape.m_iNumParts;
+		for (int part = 0; part < shape.m_iNumParts; part++)
+		{
+			const int start = shape.GetPartStart(part);
+			const int end = std::max(start, shape.GetPartEnd(part) - 1);
+			ring_points.push_back(end - start);
+		}
+	}
+	DPolygon2Store store;
+	store.Allocate(poly_rings, ring_points);
+
+	const bool bDone = ForEachRecord(nElems, [&](uint i)
+	{
+		vtShapeReader::Shape shape;
+		if (poly_rings[i] == 0 || !reader.GetShape(records[i], shape))
+			return;
+
+		for (int part = 0; part < shape.m_iNumParts; part++)
+		{
+			const int start = shape.GetPartStart(part);
+			const int end = std::max(start, shape.GetPartEnd(part) - 1);
+			DPoint2 *points = store.GetRingPoints(i, part);
+			for (int j = start; j < end; j++)
+				points[j - start] = shape.GetPoint(j);
+		}
+	}, progress_callback);
+
+	if (!bDone)
+	{
+		VTLOG("  Cancelled.\n");
+		entity_records.clear();
+		return false;
+	}
+
+	if (iFailed > 0)
+		VTLOG("  %d of the %d entities were bad.\n", iFailed, nElems);
+
+	if (NumEntities() == 0)
+	{
+		m_Poly.clear();
+		m_Packed = std::move(store);
+		m_bPacked = true;
+	}
+	else if (m_bPacked)
+		m_Packed.Append(store);
+	else
+	{
+		const uint base = (uint) m_Poly.size();
+		m_Poly.resize(base + store.NumPolygons());
+		for (uint i = 0; i < store.NumPolygons(); i++)
+			store.GetPolygon(i).ToDPolygon2(m_Poly[base + i]);
+	}
+	entity_records = records;
+	return true;
+}
+
+bool vtFeatureSetPolygon::ComputeFeatureExtent(uint iEnt, DRECT &rect) const
+{
+	const DPolygon2View poly = GetPolygonView(iEnt);
+	if (poly.size() == 0 || poly[0].GetSize() == 0)
+		return false;
+	return poly.ComputeExtents(rect);
+}
+
+/**
+ * The distance from a point to a polygon is zero if the point is inside,
+ * otherwise the distance to the nearest edge of any ring.
+ */
+double vtFeatureSetPolygon::DistanceToFeature(uint iEnt, const DPoint2 &p) const
+{
+	const DPolygon2View poly = GetPolygonView(iEnt);
+	if (poly.ContainsPoint(p))
+		return 0.0;
+
+	double closest = 1E9;
+	for (uint r = 0; r < poly.size(); r++)
+	{
+		double dist = DistanceToLine(poly[r], p, true);
+		if (dist < closest)
+			closest = dist;
+	}
+	return closest;
+}
+
 bool vtFeatureSetPolygon::EarthExtents(DRECT &ext) const
 {
 	ext.SetInsideOut();
 
-	if (m_Poly.size() == 0)
+	const uint num = NumEntities();
+	if (num == 0)
 		return false;
 
-	for (uint i = 0; i < m_Poly.size(); i++)
+	for (uint i = 0; i < num; i++)
 	{
-		const DPolygon2 &poly = m_Poly[i];
-		ext.GrowToContainLine(poly[0]);
+		const DPolygon2View poly = GetPolygonView(i);
+		if (poly.size() > 0)
+			poly[0].GrowRect(ext);
 	}
 	return true;
 }
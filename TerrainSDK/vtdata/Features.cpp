@@ -5,6 +5,8 @@
 // Free for all uses, see license.txt for details.
 //
 
+#include <algorithm>
+
 #include "Features.h"
 #include "vtLog.h"
 #include "DxfParser.h"
@@ -17,10 +19,12 @@
 vtFeatureSet::vtFeatureSet()
 {
 	m_eGeomType = wkbNone;
+	m_pRTree = NULL;
 }
 
 vtFeatureSet::~vtFeatureSet()
 {
+	FreeRTree();
 	DeleteFields();
 
 	for (uint i = 0; i < m_Features.size(); i++)
@@ -40,6 +44,9 @@ bool vtFeatureSet::SaveToSHP(const char *filename, bool progress_callback(int))
 {
 	VTLOG1("vtFeatureSet::SaveToSHP:\n");
 
+	// Fields may still refer to the DBF file we are about to overwrite
+	LoadAllFields();
+
 	// Must use "C" locale in case we write any floating-point fields
 	ScopedLocale normal_numbers(LC_NUMERIC, "C");
 
@@ -134,33 +141,86 @@ bool vtFeatureSet::SaveToSHP(const char *filename, bool progress_callback(int))
 	return true;
 }
 
+// Helper: whether a featureset of this geometry type holds this type of shape.
+static bool HoldsShapeType(OGRwkbGeometryType eGeomType, int iShapeType)
+{
+	switch (eGeomType)
+	{
+	case wkbPoint:
+	case wkbPoint25D:
+		return (iShapeType == SHPT_POINT || iShapeType == SHPT_POINTZ || iShapeType == SHPT_POINTM);
+	case wkbLineString:
+	case wkbLineString25D:
+		return (iShapeType == SHPT_ARC || iShapeType == SHPT_ARCZ || iShapeType == SHPT_ARCM);
+	case wkbPolygon:
+		return (iShapeType == SHPT_POLYGON || iShapeType == SHPT_POLYGONZ || iShapeType == SHPT_POLYGONM);
+	default:
+		return false;
+	}
+}
+
 /**
  * Load a featureset from a SHP (ESRI Shapefile).
  *
+ * The file is memory-mapped and its records are decoded in parallel.  If
+ * that isn't possible for this file, it is read with Shapelib instead.
+ *
  * \param fname	filename in UTF-8 encoding.
  * \param progress_callback Provide a callback function if you want to receive
  *		progress indication.
+ * \param pFilter If not NULL, only load the features whose extent overlaps
+ *		this rectangle.  The filter only applies when the file can be
+ *		memory-mapped.
  *
- * \return true if successful.
+ * \return true if successful, false if the file couldn't be read or the
+ *	progress callback cancelled.
  */
-bool vtFeatureSet::LoadFromSHP(const char *fname, bool progress_callback(int))
+bool vtFeatureSet::LoadFromSHP(const char *fname, bool progress_callback(int),
+	const DRECT *pFilter)
 {
 	VTLOG(" LoadFromSHP '%s': ", fname);
 
-	// SHPOpen doesn't yet support utf-8 or wide filenames, so convert
-	vtString fname_local = UTF8ToLocal(fname);
+	// For each entity we load, the record it came from
+	std::vector<uint> entity_records;
+	bool bIdentity = true;
 
-	// Open the SHP File & Get Info from SHP:
-	SHPHandle hSHP = SHPOpen(fname_local, "rb");
-	if (hSHP == NULL)
+	vtShapeReader reader;
+	bool bRead = false;
+	if (reader.Open(fname) && HoldsShapeType(GetGeomType(), reader.GetShapeType()))
 	{
-		VTLOG("Couldn't open.\n");
-		return false;
+		std::vector<uint> records;
+		reader.FindRecords(pFilter, records);
+		VTLOG("Mapped, loading %d of %d records.\n", (int) records.size(), reader.NumRecords());
+
+		// The set can hold these shapes, so this only fails if cancelled
+		if (!LoadGeomFromReader(reader, records, entity_records, progress_callback))
+			return false;
+		bRead = true;
+
+		// Unless every record became exactly one entity, in order, the
+		//  attributes must be read through the map of entities to records.
+		bIdentity = (entity_records.size() == reader.NumRecords());
+		for (uint i = 0; bIdentity && i < entity_records.size(); i++)
+			bIdentity = (entity_records[i] == i);
 	}
+	if (!bRead)
+	{
+		// SHPOpen doesn't yet support utf-8 or wide filenames, so convert
+		vtString fname_local = UTF8ToLocal(fname);
 
-	VTLOG("Opened.\n");
-	LoadGeomFromSHP(hSHP, progress_callback);
-	SHPClose(hSHP);
+		// Open the SHP File & Get Info from SHP:
+		SHPHandle hSHP = SHPOpen(fname_local, "rb");
+		if (hSHP == NULL)
+		{
+			VTLOG("Couldn't open.\n");
+			return false;
+		}
+
+		VTLOG("Opened.\n");
+		LoadGeomFromSHP(hSHP, progress_callback);
+		SHPClose(hSHP);
+		bIdentity = true;
+	}
 
 	SetFilename(fname);
 
@@ -168,7 +228,7 @@ bool vtFeatureSet::LoadFromSHP(const char *fname, bool progress_callback(int))
 	m_crs.ReadProjFile(fname);
 
 	// Read corresponding attributes (DBF fields and records)
-	LoadDataFromDBF(fname, progress_callback);
+	LoadDataFromDBF(fname, progress_callback, bIdentity ? NULL : &entity_records);
 
 	AllocateFeatures();
 
@@ -274,7 +334,8 @@ OGRwkbGeometryType GetFeatureGeomType(const char *filename)
  *
  * \return a new vtFeatureSet if successful, otherwise NULL.
  */
-vtFeatureSet *vtFeatureLoader::LoadFromSHP(const char *filename, bool progress_callback(int))
+vtFeatureSet *vtFeatureLoader::LoadFromSHP(const char *filename, bool progress_callback(int),
+	const DRECT *pFilter)
 {
 	VTLOG(" FeatureLoader LoadFromSHP\n");
 
@@ -322,8 +383,12 @@ vtFeatureSet *vtFeatureLoader::LoadFromSHP(const char *filename, bool progress_c
 	SHPClose(hSHP);
 
 	// Read SHP header and geometry from SHP into memory
-	pSet->LoadFromSHP(filename, progress_callback);
-
+	if (!pSet->LoadFromSHP(filename, progress_callback, pFilter))
+	{
+		m_strErrorMsg = "Could not load file.";
+		delete pSet;
+		return NULL;
+	}
 	return pSet;
 }
 
@@ -910,10 +975,13 @@ bool vtFeatureSet::LoadFromOGR(OGRLayer *pLayer,
  * \param filename	Filename in UTF-8 encoding.
  * \param progress_callback Provide a callback function if you want to receive
  *		progress indication.
+ * \param pRecordMap If not NULL, the record of the file to use for each
+ *		entity.  Otherwise, records are used in order.
  *
  * \return true if successful.
  */
-bool vtFeatureSet::LoadDataFromDBF(const char *filename, bool progress_callback(int))
+bool vtFeatureSet::LoadDataFromDBF(const char *filename, bool progress_callback(int),
+	const std::vector<uint> *pRecordMap)
 {
 	// Must use "C" locale in case we read any floating-point fields
 	ScopedLocale normal_numbers(LC_NUMERIC, "C");
@@ -931,12 +999,51 @@ bool vtFeatureSet::LoadDataFromDBF(const char *filename, bool progress_callback(
 		return false;
 
 	ParseDBFFields(db);
-	ParseDBFRecords(db, progress_callback);
+
+	// Prefer to leave the values in the file until they are needed, but if
+	//  the file can't be mapped, read them all now.
+	if (!AttachDBFSource(dbfname, pRecordMap))
+		ParseDBFRecords(db, progress_callback, pRecordMap);
 	DBFClose(db);
 
 	return true;
 }
 
+/**
+ * Attach the fields to a memory-mapped view of the DBF file, so that each
+ * field reads its values from the file when it is first accessed.
+ */
+bool vtFeatureSet::AttachDBFSource(const char *dbfname, const std::vector<uint> *pRecordMap)
+{
+	std::shared_ptr<vtDBFSource> source = std::make_shared<vtDBFSource>();
+	if (!source->Open(dbfname) || source->NumFields() != NumFields())
+		return false;
+	if (pRecordMap)
+		source->SetRecordMap(*pRecordMap);
+
+	// Every field has a value for each entity, but i have seen some DBF
+	//  have more or fewer records than the SHP has entities.
+	const uint iEntities = NumEntities();
+	const uint iRecords = pRecordMap ? (uint) pRecordMap->size() : source->NumRecords();
+
+	for (uint iField = 0; iField < NumFields(); iField++)
+		m_fields[iField]->SetSource(source, iField, iEntities, iRecords);
+	return true;
+}
+
+/**
+ * Make sure that the values of all fields are in memory, and release any
+ * file they were read from.  This does not change any values.
+ */
+void vtFeatureSet::LoadAllFields() const
+{
+	for (uint iField = 0; iField < NumFields(); iField++)
+	{
+		m_fields[iField]->Load();
+		m_fields[iField]->ReleaseSource();
+	}
+}
+
 /**
  * A lightweight alternative to LoadDataFromDBF, which simply reads the
  * field descriptions from the DBF file.
@@ -978,9 +1085,11 @@ void vtFeatureSet::ParseDBFFields(DBFHandle db)
 	}
 }
 
-void vtFeatureSet::ParseDBFRecords(DBFHandle db, bool progress_callback(int))
+void vtFeatureSet::ParseDBFRecords(DBFHandle db, bool progress_callback(int),
+	const std::vector<uint> *pRecordMap)
 {
-	int iRecords = DBFGetRecordCount(db);
+	const int iFileRecords = DBFGetRecordCount(db);
+	int iRecords = pRecordMap ? (int) pRecordMap->size() : iFileRecords;
 
 	// safety check
 	// i have seen some DBF to have more records than the SHP has entities
@@ -991,6 +1100,9 @@ void vtFeatureSet::ParseDBFRecords(DBFHandle db, bool progress_callback(int))
 	{
 		if (progress_callback && ((i%16)==0))
 			progress_callback(i*100/iRecords);
+		const int rec = pRecordMap ? (int) (*pRecordMap)[i] : i;
+		if (rec >= iFileRecords)
+			continue;
 		uint iField;
 		for (iField = 0; iField < NumFields(); iField++)
 		{
@@ -998,16 +1110,20 @@ void vtFeatureSet::ParseDBFRecords(DBFHandle db, bool progress_callback(int))
 			switch (field->m_type)
 			{
 			case FT_String:
-				SetValue(i, iField, DBFReadStringAttribute(db, i, iField));
+				SetValue(i, iField, DBFReadStringAttribute(db, rec, iField));
 				break;
 			case FT_Integer:
-				SetValue(i, iField, DBFReadIntegerAttribute(db, i, iField));
+				SetValue(i, iField, DBFReadIntegerAttribute(db, rec, iField));
 				break;
 			case FT_Double:
-				SetValue(i, iField, DBFReadDoubleAttribute(db, i, iField));
+				SetValue(i, iField, DBFReadDoubleAttribute(db, rec, iField));
 				break;
 			case FT_Boolean:
-				SetValue(i, iField, DBFReadLogicalAttribute(db, i, iField));
+				{
+					const char *value = DBFReadLogicalAttribute(db, rec, iField);
+					SetValue(i, iField, value != NULL && (*value == 'T' ||
+						*value == 't' || *value == 'Y' || *value == 'y'));
+				}
 				break;
 			case FT_Short:
 			case FT_Float:
@@ -1239,6 +1355,7 @@ bool vtFeatureSet::SaveToKML(const char *filename, bool progress_callback(int))
  */
 void vtFeatureSet::SetNumEntities(int iNum)
 {
+	FreeRTree();
 	int previous = NumEntities();
 
 	// First set the number of geometries
@@ -1250,7 +1367,7 @@ void vtFeatureSet::SetNumEntities(int iNum)
 
 	// Also keep size of flag array in synch
 	m_Features.resize(iNum);
-	for (int i = 0; i < (iNum - previous); i++)
+	for (int i = previous; i < iNum; i++)
 	{
 		vtFeature *f = new vtFeature;
 		f->flags = 0;
@@ -1312,6 +1429,7 @@ bool vtFeatureSet::AppendDataFrom(vtFeatureSet *pFromSet)
 		return false;
 
 	int first_appended_ent = NumEntities();
+	FreeRTree();
 
 	// copy geometry
 	if (!AppendGeometryFrom(pFromSet))
@@ -1373,19 +1491,19 @@ void vtFeatureSet::InvertSelection()
 int vtFeatureSet::DoBoxSelect(const DRECT &rect, SelectionType st)
 {
 	int affected = 0;
-	int entities = NumEntities();
 
-	bool bIn;
+	if (st == ST_NORMAL)
+		DeselectAll();
+
+	// Only the features found inside the box are affected
+	std::vector<int> found;
+	FindInRect(rect, found);
+
 	bool bWas;
-	for (int i = 0; i < entities; i++)
+	for (uint f = 0; f < found.size(); f++)
 	{
-		bWas = (m_Features[i]->flags & FF_SELECTED);
-		if (st == ST_NORMAL)
-			Select(i, false);
-
-		bIn = IsInsideRect(i, rect);
-		if (!bIn)
-			continue;
+		const int i = found[f];
+		bWas = (m_Features[i]->flags & FF_SELECTED) != 0;
 
 		switch (st)
 		{
@@ -1410,6 +1528,75 @@ int vtFeatureSet::DoBoxSelect(const DRECT &rect, SelectionType st)
 	return affected;
 }
 
+/**
+ * Build an R-tree of the extents of all the features, to speed up spatial
+ * queries such as FindInRect and FindClosestFeature.  You don't need to call
+ * this, since those methods build the tree when needed, but it can be useful
+ * to build it ahead of time.
+ */
+void vtFeatureSet::BuildRTree()
+{
+	FreeRTree();
+
+	const uint num = NumEntities();
+	std::vector<DRECT> boxes(num);
+	for (uint i = 0; i < num; i++)
+	{
+		// Features without geometry get an empty box, which the tree skips
+		if (!ComputeFeatureExtent(i, boxes[i]))
+			boxes[i].SetInsideOut();
+	}
+	m_pRTree = new vtRTree;
+	m_pRTree->Build(boxes);
+}
+
+void vtFeatureSet::FreeRTree()
+{
+	delete m_pRTree;
+	m_pRTree = NULL;
+}
+
+/**
+ * Find all the features which are entirely inside a rectangle.  The
+ * indices of the features are appended to 'found', in ascending order.
+ */
+void vtFeatureSet::FindInRect(const DRECT &rect, std::vector<int> &found)
+{
+	if (!m_pRTree)
+		BuildRTree();
+
+	std::vector<int> candidates;
+	m_pRTree->FindOverlapping(rect, candidates);
+	std::sort(candidates.begin(), candidates.end());
+
+	for (uint i = 0; i < candidates.size(); i++)
+	{
+		if (IsInsideRect(candidates[i], rect))
+			found.push_back(candidates[i]);
+	}
+}
+
+/**
+ * Find the feature which is closest to a point.  For points, this is the
+ * distance to the point; for lines, the distance to the nearest place on
+ * the line; for polygons, zero if the point is inside, otherwise the
+ * distance to the nearest edge.
+ *
+ * \param p The point to search from.
+ * \param epsilon Features further away than this distance are ignored.
+ * \param distance If not NULL, receives the distance to the closest feature.
+ * \return The index of the closest feature, or -1 if there are none.
+ */
+int vtFeatureSet::FindClosestFeature(const DPoint2 &p, double epsilon, double *distance)
+{
+	if (!m_pRTree)
+		BuildRTree();
+
+	return m_pRTree->FindNearest(p, epsilon,
+		[this](int iItem, const DPoint2 &p2) { return DistanceToFeature(iItem, p2); },
+		distance);
+}
+
 int vtFeatureSet::SelectByCondition(int iField, int iCondition,
 								  const char *szValue)
 {
@@ -1462,6 +1649,7 @@ int vtFeatureSet::SelectByCondition(int iField, int iCondition,
 		return selected;
 	}
 	Field *field = m_fields[iField];
+	field->Load();
 	switch (field->m_type)
 	{
 	case FT_String:
@@ -1716,6 +1904,7 @@ int vtFeatureSet::AddField(const char *name, FieldType ftype, int string_length)
 
 int vtFeatureSet::AddRecord()
 {
+	FreeRTree();
 	int recs=-1;
 	for (uint i = 0; i < m_fields.GetSize(); i++)
 	{
@@ -1786,7 +1975,9 @@ void vtFeatureSet::SetValueFromString(uint iRecord, uint iField, const char *str
 int vtFeatureSet::GetIntegerValue(uint iRecord, uint iField) const
 {
 	Field *field = m_fields[iField];
-	return field->m_int[iRecord];
+	int val = 0;
+	field->GetValue(iRecord, val);
+	return val;
 }
 
 short vtFeatureSet::GetShortValue(uint iRecord, uint iField) const
@@ -1816,7 +2007,9 @@ double vtFeatureSet::GetDoubleValue(uint iRecord, uint iField) const
 bool vtFeatureSet::GetBoolValue(uint iRecord, uint iField) const
 {
 	Field *field = m_fields[iField];
-	return field->m_bool[iRecord];
+	bool val = false;
+	field->GetValue(iRecord, val);
+	return val;
 }
 
 vtFeature *vtFeatureSet::GetFirstSelectedFeature() const
@@ -1838,13 +2031,74 @@ Field::Field(const char *name, FieldType ftype)
 {
 	m_name = name;
 	m_type = ftype;
+	m_iSourceField = 0;
+	m_iSourceRecords = 0;
+	m_iSourceRows = 0;
+	m_bLoaded = true;
 }
 
 Field::~Field()
 {
 }
 
+/**
+ * Attach this field to a column of a DBF file.  Any values in memory are
+ * discarded, and the field's values will be read from the file when it is
+ * next accessed.
+ *
+ * \param source The DBF file.
+ * \param iSourceField The column of the file to read.
+ * \param iNumRecords The number of records in this field.
+ * \param iNumToRead How many of those to read from the file, which may have
+ *	fewer records than the field.  The rest are left empty.
+ */
+void Field::SetSource(const std::shared_ptr<vtDBFSource> &source, uint iSourceField,
+	uint iNumRecords, uint iNumToRead)
+{
+	Resize(0);
+	m_pSource = source;
+	m_iSourceField = iSourceField;
+	m_iSourceRecords = iNumRecords;
+	m_iSourceRows = std::min(iNumToRead, iNumRecords);
+	m_bLoaded = false;
+}
+
+/**
+ * Release this field's reference to its file, if any.  The field must be
+ * loaded first.  Once all fields have released it, the file is closed.
+ */
+void Field::ReleaseSource()
+{
+	if (m_bLoaded)
+		m_pSource.reset();
+}
+
+/**
+ * Read this field's values from its file, if they haven't been read yet.
+ * This is safe to call from several threads at once.
+ */
+void Field::Load()
+{
+	if (m_bLoaded)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_pSource->GetMutex());
+	if (m_bLoaded)
+		return;		// another thread got here first
+
+	Resize(m_iSourceRecords);
+	if (!m_pSource->ReadColumn(m_iSourceField, *this, m_iSourceRows))
+		VTLOG("Field '%s': couldn't read values from file.\n", (const char *) m_name);
+	m_bLoaded = true;
+}
+
 void Field::SetNumRecords(int iNum)
+{
+	Touch();
+	Resize(iNum);
+}
+
+void Field::Resize(int iNum)
 {
 	switch (m_type)
 	{
@@ -1860,6 +2114,7 @@ void Field::SetNumRecords(int iNum)
 
 int Field::AddRecord()
 {
+	Touch();
 	int index = 0;
 	switch (m_type)
 	{
@@ -1879,6 +2134,7 @@ int Field::AddRecord()
 
 void Field::SetValue(uint record, const char *value)
 {
+	Touch();
 	if (m_type != FT_String)
 		return;
 	m_string[record] = value;
@@ -1886,6 +2142,7 @@ void Field::SetValue(uint record, const char *value)
 
 void Field::SetValue(uint record, int value)
 {
+	Touch();
 	if (m_type == FT_Integer)
 		m_int[record] = value;
 	else if (m_type == FT_Short)
@@ -1898,6 +2155,7 @@ void Field::SetValue(uint record, int value)
 
 void Field::SetValue(uint record, double value)
 {
+	Touch();
 	if (m_type == FT_Double)
 		m_double[record] = value;
 	else if (m_type == FT_Float)
@@ -1910,6 +2168,7 @@ void Field::SetValue(uint record, double value)
 
 void Field::SetValue(uint record, bool value)
 {
+	Touch();
 	if (m_type == FT_Boolean)
 		m_bool[record] = value;
 	else if (m_type == FT_Integer)
@@ -1920,6 +2179,7 @@ void Field::SetValue(uint record, bool value)
 
 void Field::GetValue(uint record, vtString &string)
 {
+	Touch();
 	if (m_type != FT_String)
 		return;
 	string = m_string[record];
@@ -1927,6 +2187,7 @@ void Field::GetValue(uint record, vtString &string)
 
 void Field::GetValue(uint record, short &value)
 {
+	Touch();
 	if (m_type == FT_Short)
 		value = m_short[record];
 	else if (m_type == FT_Integer)
@@ -1939,6 +2200,7 @@ void Field::GetValue(uint record, short &value)
 
 void Field::GetValue(uint record, int &value)
 {
+	Touch();
 	if (m_type == FT_Integer)
 		value = m_int[record];
 	else if (m_type == FT_Short)
@@ -1951,6 +2213,7 @@ void Field::GetValue(uint record, int &value)
 
 void Field::GetValue(uint record, float &value)
 {
+	Touch();
 	if (m_type == FT_Float)
 		value = m_float[record];
 	else if (m_type == FT_Double)
@@ -1963,6 +2226,7 @@ void Field::GetValue(uint record, float &value)
 
 void Field::GetValue(uint record, double &value)
 {
+	Touch();
 	if (m_type == FT_Double)
 		value = m_double[record];
 	else if (m_type == FT_Float)
@@ -1975,6 +2239,7 @@ void Field::GetValue(uint record, double &value)
 
 void Field::GetValue(uint record, bool &value)
 {
+	Touch();
 	if (m_type == FT_Boolean)
 		value = m_bool[record];
 	else if (m_type == FT_Integer)
@@ -1985,6 +2250,7 @@ void Field::GetValue(uint record, bool &value)
 
 void Field::CopyValue(uint FromRecord, int ToRecord)
 {
+	Touch();
 	if (m_type == FT_Integer)
 		m_int[ToRecord] = m_int[FromRecord];
 	else if (m_type == FT_Short)
@@ -2005,6 +2271,7 @@ void Field::CopyValue(uint FromRecord, int ToRecord)
 
 void Field::GetValueAsString(uint iRecord, vtString &str)
 {
+	Touch();
 	switch (m_type)
 	{
 	case FT_String:
@@ -2038,6 +2305,7 @@ void Field::SetValueFromString(uint iRecord, const vtString &str)
 
 void Field::SetValueFromString(uint iRecord, const char *str)
 {
+	Touch();
 	int i;
 	double d;
 	float f;
@@ -8,10 +8,17 @@
 #ifndef VTDATA_FEATURES
 #define VTDATA_FEATURES
 
+#include <atomic>
+#include <memory>
+
 #include "MathTypes.h"
 #include "vtString.h"
 #include "vtCRS.h"
 #include "Content.h"
+#include "RTree.h"
+#include "GeomStore.h"
+#include "DBFSource.h"
+#include "ShapeReader.h"
 
 #include "shapelib/shapefil.h"
 #include "ogrsf_frmts.h"
@@ -38,8 +45,11 @@ enum FieldType
 /**
  * This class is used to store values in memory for each record.
  *
- * Someday, we could use values directly from a database files instead,
- * or even some interface for accessing very large or remote databases.
+ * The values are stored as a typed array, one per field (column).  A field
+ * which was read from a DBF file may be attached to its source instead, in
+ * which case its values are only decoded from the file when the field is
+ * first accessed.  This way, only the columns that are actually used take
+ * any time to load or memory to hold.
  */
 class Field
 {
@@ -47,6 +57,13 @@ public:
 	Field(const char *name, FieldType ftype);
 	~Field();
 
+	void SetSource(const std::shared_ptr<vtDBFSource> &source, uint iSourceField,
+		uint iNumRecords, uint iNumToRead);
+	void ReleaseSource();
+	/// True if the values are in memory, false if they are still in the file.
+	bool IsLoaded() const { return m_bLoaded; }
+	void Load();
+
 	int AddRecord();
 	void SetNumRecords(int iNum);
 
@@ -77,6 +94,17 @@ public:
 	vtArray<float> m_float;
 	vtArray<double> m_double;
 	vtStringArray m_string;
+
+protected:
+	void Touch() { if (!m_bLoaded) Load(); }
+	void Resize(int iNum);
+
+	// Where to load the values from, if they aren't loaded yet
+	std::shared_ptr<vtDBFSource> m_pSource;
+	uint m_iSourceField;
+	uint m_iSourceRecords;		// how many values the field holds
+	uint m_iSourceRows;			// how many of them to read from the file
+	std::atomic<bool> m_bLoaded;
 };
 
 // Helpers
@@ -112,8 +140,14 @@ public:
 	bool SaveToSHP(const char *filename, bool progress_callback(int)=0) const;
 	bool LoadFromOGR(OGRLayer *pLayer, bool progress_callback(int)=0);
 	virtual void LoadGeomFromSHP(SHPHandle hSHP, bool progress_callback(int)=0) = 0;
-	bool LoadFromSHP(const char *fname, bool progress_callback(int)=0);
-	bool LoadDataFromDBF(const char *filename, bool progress_callback(int)=0);
+	virtual bool LoadGeomFromReader(const vtShapeReader &reader,
+		const std::vector<uint> &records, std::vector<uint> &entity_records,
+		bool progress_callback(int)=0) = 0;
+	bool LoadFromSHP(const char *fname, bool progress_callback(int)=0,
+		const DRECT *pFilter = NULL);
+	bool LoadDataFromDBF(const char *filename, bool progress_callback(int)=0,
+		const std::vector<uint> *pRecordMap = NULL);
+	void LoadAllFields() const;
 	bool LoadFieldInfoFromDBF(const char *filename);
 	bool LoadDataFromCSV(const char *filename, bool progress_callback(int)=0);
 	bool SaveToKML(const char *filename, bool progress_callback(int)=0) const;
@@ -212,6 +246,20 @@ public:
 	vtFeature *GetFeature(uint iIndex) const { return m_Features[iIndex]; }
 	vtFeature *GetFirstSelectedFeature() const;
 
+	// Spatial queries.  These use an R-tree of the feature extents, which is
+	//  built when first needed and freed whenever the geometry is changed
+	//  through this class.  If you change geometry through a non-const
+	//  reference (e.g. GetPolygon), call FreeRTree() afterwards.
+	void BuildRTree();
+	void FreeRTree();
+	bool HasRTree() const { return m_pRTree != NULL; }
+	void FindInRect(const DRECT &rect, std::vector<int> &found);
+	int FindClosestFeature(const DPoint2 &p, double epsilon, double *distance = NULL);
+
+	// these must be implemented for each type of geometry
+	virtual bool ComputeFeatureExtent(uint iEnt, DRECT &rect) const = 0;
+	virtual double DistanceToFeature(uint iEnt, const DPoint2 &p) const = 0;
+
 protected:
 	// these must be implemented for each type of geometry
 	virtual bool IsInsideRect(int iElem, const DRECT &rect) = 0;
@@ -221,7 +269,9 @@ protected:
 
 	void CopyEntity(uint from, uint to);
 	void ParseDBFFields(DBFHandle db);
-	void ParseDBFRecords(DBFHandle db, bool progress_callback(int)=0);
+	void ParseDBFRecords(DBFHandle db, bool progress_callback(int)=0,
+		const std::vector<uint> *pRecordMap = NULL);
+	bool AttachDBFSource(const char *dbfname, const std::vector<uint> *pRecordMap);
 
 	OGRwkbGeometryType		m_eGeomType;
 
@@ -233,6 +283,9 @@ protected:
 
 	// remember the filename these feature were loaded from or saved to
 	vtString	m_strFilename;
+
+	// spatial index, or NULL if not built
+	vtRTree		*m_pRTree;
 };
 
 /**
@@ -265,7 +318,12 @@ public:
 	virtual void CopyGeometry(uint from, uint to);
 	virtual void SaveGeomToSHP(SHPHandle hSHP, bool progress_callback(int)=0) const;
 	virtual void LoadGeomFromSHP(SHPHandle hSHP, bool progress_callback(int)=0);
+	virtual bool LoadGeomFromReader(const vtShapeReader &reader,
+		const std::vector<uint> &records, std::vector<uint> &entity_records,
+		bool progress_callback(int)=0);
 	virtual bool EarthExtents(DRECT &ext) const;
+	virtual bool ComputeFeatureExtent(uint iEnt, DRECT &rect) const;
+	virtual double DistanceToFeature(uint iEnt, const DPoint2 &p) const;
 
 protected:
 	DLine2	m_Point2;	// wkbPoint
@@ -300,7 +358,12 @@ public:
 	virtual void CopyGeometry(uint from, uint to);
 	virtual void SaveGeomToSHP(SHPHandle hSHP, bool progress_callback(int)=0) const;
 	virtual void LoadGeomFromSHP(SHPHandle hSHP, bool progress_callback(int)=0);
+	virtual bool LoadGeomFromReader(const vtShapeReader &reader,
+		const std::vector<uint> &records, std::vector<uint> &entity_records,
+		bool progress_callback(int)=0);
 	virtual bool EarthExtents(DRECT &ext) const;
+	virtual bool ComputeFeatureExtent(uint iEnt, DRECT &rect) const;
+	virtual double DistanceToFeature(uint iEnt, const DPoint2 &p) const;
 
 protected:
 	DLine3	m_Point3;	// wkbPoint25D
@@ -324,9 +387,18 @@ public:
 	bool AppendGeometryFrom(vtFeatureSet *pFromSet);
 
 	int AddPolyLine(const DLine2 &pl);
-	const DLine2 &GetPolyLine(uint num) const { return m_Line[num]; }
-	DLine2 &GetPolyLine(uint num) { return m_Line[num]; }
+	DLine2View GetPolyLine(uint num) const { return GetPolyLineView(num); }
+	DLine2 &GetPolyLine(uint num) { FreePacked(); return m_Line[num]; }
+	DLine2View GetPolyLineView(uint num) const
+	{
+		return m_bPacked ? m_Packed.GetLine(num) : DLine2View(m_Line[num]);
+	}
 	int NumTotalVertices() const;
+
+	// Packed storage
+	bool IsPacked() const { return m_bPacked; }
+	void Pack();
+	void FreePacked();
 	bool FindClosest(const DPoint2 &p, int &close_feature, DPoint2 &close_point);
 
 	// Try to address some kinds of degenerate geometry that can occur in polylines
@@ -337,10 +409,20 @@ public:
 	virtual void CopyGeometry(uint from, uint to);
 	virtual void SaveGeomToSHP(SHPHandle hSHP, bool progress_callback(int)=0) const;
 	virtual void LoadGeomFromSHP(SHPHandle hSHP, bool progress_callback(int)=0);
+	virtual bool LoadGeomFromReader(const vtShapeReader &reader,
+		const std::vector<uint> &records, std::vector<uint> &entity_records,
+		bool progress_callback(int)=0);
 	virtual bool EarthExtents(DRECT &ext) const;
+	virtual bool ComputeFeatureExtent(uint iEnt, DRECT &rect) const;
+	virtual double DistanceToFeature(uint iEnt, const DPoint2 &p) const;
 
 protected:
+	// The lines are kept either in m_Line, each with its own allocation, or
+	//  all together in m_Packed.  Loading from a file gives packed lines,
+	//  which are unpacked when something asks for a modifiable DLine2.
 	DLine2Array	m_Line;		// wkbLineString
+	DLine2Store	m_Packed;
+	bool		m_bPacked;
 };
 
 /**
@@ -372,7 +454,12 @@ public:
 	virtual void CopyGeometry(uint from, uint to);
 	virtual void SaveGeomToSHP(SHPHandle hSHP, bool progress_callback(int)=0) const;
 	virtual void LoadGeomFromSHP(SHPHandle hSHP, bool progress_callback(int)=0);
+	virtual bool LoadGeomFromReader(const vtShapeReader &reader,
+		const std::vector<uint> &records, std::vector<uint> &entity_records,
+		bool progress_callback(int)=0);
 	virtual bool EarthExtents(DRECT &ext) const;
+	virtual bool ComputeFeatureExtent(uint iEnt, DRECT &rect) const;
+	virtual double DistanceToFeature(uint iEnt, const DPoint2 &p) const;
 
 protected:
 	std::vector<DLine3>	m_Line;		// wkbLineString25D
@@ -420,11 +507,16 @@ public:
 	bool AppendGeometryFrom(vtFeatureSet *pFromSet);
 
 	int AddPolygon(const DPolygon2 &poly);
-	void SetPolygon(uint num, const DPolygon2 &poly) { m_Poly[num] = poly; }
-	const DPolygon2 &GetPolygon(uint num) const { return m_Poly[num]; }
-	DPolygon2 &GetPolygon(uint num) { return m_Poly[num]; }
+	void SetPolygon(uint num, const DPolygon2 &poly) { FreePacked(); m_Poly[num] = poly; FreeRTree(); }
+	DPolygon2View GetPolygon(uint num) const { return GetPolygonView(num); }
+	DPolygon2 &GetPolygon(uint num) { FreePacked(); return m_Poly[num]; }
+	DPolygon2View GetPolygonView(uint num) const
+	{
+		return m_bPacked ? m_Packed.GetPolygon(num) : DPolygon2View(m_Poly[num]);
+	}
 	int FindSimplePolygon(const DPoint2 &p) const;
 	int FindPolygon(const DPoint2 &p) const;
+	int FindPolygon(const DPoint2 &p, int &iLastFound) const;
 
 	// Try to address some kinds of degenerate geometry that can occur in polygons
 	int FixGeometry(double dEpsilon);
@@ -434,15 +526,31 @@ public:
 	void CreateIndex(int iSize);
 	void FreeIndex();
 
+	// Packed storage
+	bool IsPacked() const { return m_bPacked; }
+	void Pack();
+	void FreePacked();
+
 	// implement necessary virtual methods
 	virtual bool IsInsideRect(int iElem, const DRECT &rect);
 	virtual void CopyGeometry(uint from, uint to);
 	virtual void SaveGeomToSHP(SHPHandle hSHP, bool progress_callback(int)=0) const;
 	virtual void LoadGeomFromSHP(SHPHandle hSHP, bool progress_callback(int)=0);
+	virtual bool LoadGeomFromReader(const vtShapeReader &reader,
+		const std::vector<uint> &records, std::vector<uint> &entity_records,
+		bool progress_callback(int)=0);
 	virtual bool EarthExtents(DRECT &ext) const;
+	virtual bool ComputeFeatureExtent(uint iEnt, DRECT &rect) const;
+	virtual double DistanceToFeature(uint iEnt, const DPoint2 &p) const;
 
 protected:
-	DPolyArray	m_Poly;		// wkbPolygon
+	// The polygons are kept either in m_Poly, with an allocation for each
+	//  ring, or all together in m_Packed.  Loading from a file gives packed
+	//  polygons, which are unpacked when something asks for a modifiable
+	//  DPolygon2.
+	DPolyArray		m_Poly;		// wkbPolygon
+	DPolygon2Store	m_Packed;
+	bool			m_bPacked;
 
 	// speed optimization
 	SpatialIndex *m_pIndex;
@@ -452,7 +560,8 @@ class vtFeatureLoader
 {
 public:
 	virtual vtFeatureSet *LoadFrom(const char *filename);
-	vtFeatureSet *LoadFromSHP(const char *filename, bool progress_callback(int) = NULL);
+	vtFeatureSet *LoadFromSHP(const char *filename, bool progress_callback(int) = NULL,
+		const DRECT *pFilter = NULL);
 	vtFeatureSet *LoadHeaderFromSHP(const char *filename);
 	vtFeatureSet *LoadWithOGR(const char *filename, bool progress_callback(int) = NULL);
 	vtFeatureSet *LoadWithOGR(OGRLayer *pLayer, bool progress_callback(int) = NULL);
@@ -0,0 +1,244 @@
+//
+// GeomStore.cpp
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include <string.h>
+
+#include "GeomStore.h"
+
+/////////////////////////////////////////////////////////////////////////////
+// DLine2View
+
+bool DLine2View::ContainsPoint(const DPoint2 &p) const
+{
+	if (m_pData != NULL && m_iSize > 0)
+		return CrossingsTest(m_pData, m_iSize, p);
+	else
+		return false;
+}
+
+/// True if all the points are inside the rectangle.
+bool DLine2View::IsInsideRect(const DRECT &rect) const
+{
+	for (uint i = 0; i < m_iSize; i++)
+	{
+		if (!rect.ContainsPoint(m_pData[i]))
+			return false;
+	}
+	return true;
+}
+
+/// Grow a rectangle to contain all the points.
+void DLine2View::GrowRect(DRECT &rect) const
+{
+	for (uint i = 0; i < m_iSize; i++)
+		rect.GrowToContainPoint(m_pData[i]);
+}
+
+double DLine2View::Area() const
+{
+	const int n = (int) m_iSize;
+	double A = 0.0;
+	for (int p=n-1,q=0; q<n; p=q++)
+		A += m_pData[p].x*m_pData[q].y - m_pData[q].x*m_pData[p].y;
+	return A*0.5;
+}
+
+double DLine2View::Length() const
+{
+	double length = 0.0;
+	for (uint i = 1; i < m_iSize; i++)
+		length += (m_pData[i] - m_pData[i-1]).Length();
+	return length;
+}
+
+void DLine2View::ToDLine2(DLine2 &line) const
+{
+	line.SetSize(m_iSize);
+	if (m_iSize > 0)
+		memcpy(line.GetData(), m_pData, m_iSize * sizeof(DPoint2));
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// DPolygon2View
+
+uint DPolygon2View::NumTotalVertices() const
+{
+	uint total = 0;
+	for (uint r = 0; r < m_iNumRings; r++)
+		total += (*this)[r].GetSize();
+	return total;
+}
+
+bool DPolygon2View::ComputeExtents(DRECT &rect) const
+{
+	if (m_iNumRings == 0)
+		return false;
+
+	rect.SetInsideOut();
+	for (uint r = 0; r < m_iNumRings; r++)
+		(*this)[r].GrowRect(rect);
+	return true;
+}
+
+/**
+ * Same test as DPolygon2::ContainsPoint: inside the outer ring, and outside
+ * all the inner rings.
+ */
+bool DPolygon2View::ContainsPoint(const DPoint2 &p) const
+{
+	if (m_iNumRings == 0)
+		return false;
+	if (!(*this)[0].ContainsPoint(p))
+		return false;
+	for (uint r = 1; r < m_iNumRings; r++)
+	{
+		if ((*this)[r].ContainsPoint(p))
+			return false;
+	}
+	return true;
+}
+
+void DPolygon2View::ToDPolygon2(DPolygon2 &poly) const
+{
+	poly.resize(m_iNumRings);
+	for (uint r = 0; r < m_iNumRings; r++)
+		(*this)[r].ToDLine2(poly[r]);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// DLine2Store
+
+void DLine2Store::Clear()
+{
+	m_Points.clear();
+	m_Start.clear();
+	m_Start.push_back(0);
+}
+
+void DLine2Store::Reserve(uint iLines, uint iPoints)
+{
+	m_Start.reserve(iLines + 1);
+	m_Points.reserve(iPoints);
+}
+
+/**
+ * Replace the contents with lines of the given sizes.  The points are
+ * uninitialized, to be filled in with GetPoints().  The lines may then be
+ * filled in any order, by several threads at once.
+ */
+void DLine2Store::Allocate(const std::vector<uint> &sizes)
+{
+	const uint num = (uint) sizes.size();
+	m_Start.resize(num + 1);
+	m_Start[0] = 0;
+	for (uint i = 0; i < num; i++)
+		m_Start[i+1] = m_Start[i] + sizes[i];
+	m_Points.resize(m_Start[num]);
+}
+
+/**
+ * Add a line to the end of the store.
+ * \return The index of the new line.
+ */
+uint DLine2Store::Append(const DLine2View &line)
+{
+	const uint index = NumLines();
+	m_Points.insert(m_Points.end(), line.GetData(), line.GetData() + line.GetSize());
+	m_Start.push_back((uint) m_Points.size());
+	return index;
+}
+
+/**
+ * Add all the lines of another store to the end of this one.
+ */
+void DLine2Store::Append(const DLine2Store &other)
+{
+	const uint base = NumPoints();
+	m_Points.insert(m_Points.end(), other.m_Points.begin(), other.m_Points.end());
+	for (uint i = 1; i < other.m_Start.size(); i++)
+		m_Start.push_back(base + other.m_Start[i]);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// DPolygon2Store
+
+void DPolygon2Store::Clear()
+{
+	m_Points.clear();
+	m_RingStart.clear();
+	m_RingStart.push_back(0);
+	m_PolyStart.clear();
+	m_PolyStart.push_back(0);
+}
+
+void DPolygon2Store::Reserve(uint iPolys, uint iRings, uint iPoints)
+{
+	m_PolyStart.reserve(iPolys + 1);
+	m_RingStart.reserve(iRings + 1);
+	m_Points.reserve(iPoints);
+}
+
+/**
+ * Replace the contents with polygons of the given sizes.  The points are
+ * uninitialized, to be filled in with GetRingPoints().  The polygons may
+ * then be filled in any order, by several threads at once.
+ *
+ * \param poly_rings The number of rings of each polygon.
+ * \param ring_points The number of points of each ring, of all the polygons
+ *		in order.
+ */
+void DPolygon2Store::Allocate(const std::vector<uint> &poly_rings,
+	const std::vector<uint> &ring_points)
+{
+	const uint polys = (uint) poly_rings.size();
+	m_PolyStart.resize(polys + 1);
+	m_PolyStart[0] = 0;
+	for (uint i = 0; i < polys; i++)
+		m_PolyStart[i+1] = m_PolyStart[i] + poly_rings[i];
+
+	const uint rings = (uint) ring_points.size();
+	m_RingStart.resize(rings + 1);
+	m_RingStart[0] = 0;
+	for (uint i = 0; i < rings; i++)
+		m_RingStart[i+1] = m_RingStart[i] + ring_points[i];
+
+	m_Points.resize(m_RingStart[rings]);
+}
+
+/**
+ * Add a polygon to the end of the store.
+ * \return The index of the new polygon.
+ */
+uint DPolygon2Store::Append(const DPolygon2View &poly)
+{
+	const uint index = NumPolygons();
+	for (uint r = 0; r < poly.size(); r++)
+	{
+		const DLine2View ring = poly[r];
+		m_Points.insert(m_Points.end(), ring.GetData(), ring.GetData() + ring.GetSize());
+		m_RingStart.push_back((uint) m_Points.size());
+	}
+	m_PolyStart.push_back(NumRings());
+	return index;
+}
+
+/**
+ * Add all the polygons of another store to the end of this one.
+ */
+void DPolygon2Store::Append(const DPolygon2Store &other)
+{
+	const uint point_base = NumPoints();
+	const uint ring_base = NumRings();
+	m_Points.insert(m_Points.end(), other.m_Points.begin(), other.m_Points.end());
+	for (uint i = 1; i < other.m_RingStart.size(); i++)
+		m_RingStart.push_back(point_base + other.m_RingStart[i]);
+	for (uint i = 1; i < other.m_PolyStart.size(); i++)
+		m_PolyStart.push_back(ring_base + other.m_PolyStart[i]);
+}
@@ -0,0 +1,167 @@
+//
+// GeomStore.h
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef VTDATA_GEOMSTORE_H
+#define VTDATA_GEOMSTORE_H
+
+#include "MathTypes.h"
+
+/**
+ * A read-only view of a series of 2D points which are stored elsewhere,
+ * either in a DLine2 or in a DLine2Store / DPolygon2Store.  It has the same
+ * read methods as DLine2 (GetSize, GetAt, operator[]), so code can work on
+ * either without copying.
+ *
+ * The view is only valid as long as the storage it refers to is unchanged.
+ */
+class DLine2View
+{
+public:
+	DLine2View() : m_pData(NULL), m_iSize(0) {}
+	DLine2View(const DPoint2 *pData, uint iSize) : m_pData(pData), m_iSize(iSize) {}
+	DLine2View(const DLine2 &line) : m_pData(line.GetData()), m_iSize(line.GetSize()) {}
+
+	uint GetSize() const { return m_iSize; }
+	bool IsEmpty() const { return m_iSize == 0; }
+	const DPoint2 *GetData() const { return m_pData; }
+	const DPoint2 &GetAt(uint i) const { return m_pData[i]; }
+	const DPoint2 &operator[](uint i) const { return m_pData[i]; }
+
+	bool ContainsPoint(const DPoint2 &p) const;
+	bool IsInsideRect(const DRECT &rect) const;
+	void GrowRect(DRECT &rect) const;
+	double Area() const;
+	double Length() const;
+	void ToDLine2(DLine2 &line) const;
+
+protected:
+	const DPoint2 *m_pData;
+	uint m_iSize;
+};
+
+/**
+ * A read-only view of a polygon, which is stored either as a DPolygon2 or
+ * in a DPolygon2Store.  Like DPolygon2, it has size() rings, and each ring
+ * is a DLine2View.
+ */
+class DPolygon2View
+{
+public:
+	DPolygon2View(const DPolygon2 &poly) :
+		m_pPoly(&poly), m_pPoints(NULL), m_pRingStart(NULL), m_iNumRings((uint) poly.size()) {}
+	DPolygon2View(const DPoint2 *pPoints, const uint *pRingStart, uint iNumRings) :
+		m_pPoly(NULL), m_pPoints(pPoints), m_pRingStart(pRingStart), m_iNumRings(iNumRings) {}
+
+	/// Number of rings.
+	uint size() const { return m_iNumRings; }
+	DLine2View operator[](uint iRing) const
+	{
+		if (m_pPoly)
+			return DLine2View((*m_pPoly)[iRing]);
+		return DLine2View(m_pPoints + m_pRingStart[iRing],
+			m_pRingStart[iRing+1] - m_pRingStart[iRing]);
+	}
+
+	uint NumTotalVertices() const;
+	bool ComputeExtents(DRECT &rect) const;
+	bool ContainsPoint(const DPoint2 &p) const;
+	void ToDPolygon2(DPolygon2 &poly) const;
+
+protected:
+	const DPolygon2 *m_pPoly;
+	const DPoint2 *m_pPoints;
+	const uint *m_pRingStart;
+	uint m_iNumRings;
+};
+
+/**
+ * Many lines, packed into a single array of points, with a table of where
+ * each line starts.  Compared with an array of DLine2, this uses one
+ * allocation instead of one per line, and is much faster to fill, copy and
+ * traverse.  Lines can be added, and their points changed in place, but
+ * their sizes can't change.
+ */
+class DLine2Store
+{
+public:
+	DLine2Store() { Clear(); }
+
+	void Clear();
+	void Reserve(uint iLines, uint iPoints);
+	void Allocate(const std::vector<uint> &sizes);
+
+	uint NumLines() const { return (uint) m_Start.size() - 1; }
+	uint NumPoints() const { return (uint) m_Points.size(); }
+
+	uint Append(const DLine2View &line);
+	void Append(const DLine2Store &other);
+
+	DLine2View GetLine(uint iLine) const
+	{
+		return DLine2View(GetPoints(iLine), m_Start[iLine+1] - m_Start[iLine]);
+	}
+	const DPoint2 *GetPoints(uint iLine) const { return m_Points.data() + m_Start[iLine]; }
+	DPoint2 *GetPoints(uint iLine) { return m_Points.data() + m_Start[iLine]; }
+
+	/// All the points of all the lines.
+	std::vector<DPoint2> &GetAllPoints() { return m_Points; }
+	const std::vector<DPoint2> &GetAllPoints() const { return m_Points; }
+
+protected:
+	std::vector<DPoint2> m_Points;
+	std::vector<uint> m_Start;		// NumLines+1 entries
+};
+
+/**
+ * Many polygons, packed into a single array of points, with a table of
+ * where each ring starts and a table of each polygon's first ring.  This is
+ * the polygon equivalent of DLine2Store.
+ */
+class DPolygon2Store
+{
+public:
+	DPolygon2Store() { Clear(); }
+
+	void Clear();
+	void Reserve(uint iPolys, uint iRings, uint iPoints);
+	void Allocate(const std::vector<uint> &poly_rings, const std::vector<uint> &ring_points);
+
+	uint NumPolygons() const { return (uint) m_PolyStart.size() - 1; }
+	uint NumRings() const { return (uint) m_RingStart.size() - 1; }
+	uint NumPoints() const { return (uint) m_Points.size(); }
+
+	uint Append(const DPolygon2View &poly);
+	void Append(const DPolygon2Store &other);
+
+	DPolygon2View GetPolygon(uint iPoly) const
+	{
+		return DPolygon2View(m_Points.data(), m_RingStart.data() + m_PolyStart[iPoly],
+			m_PolyStart[iPoly+1] - m_PolyStart[iPoly]);
+	}
+	/// The points of a whole polygon, all rings, and how many there are.
+	DPoint2 *GetPolygonPoints(uint iPoly, uint &iNumPoints)
+	{
+		const uint first = m_RingStart[m_PolyStart[iPoly]];
+		iNumPoints = m_RingStart[m_PolyStart[iPoly+1]] - first;
+		return m_Points.data() + first;
+	}
+	DPoint2 *GetRingPoints(uint iPoly, uint iRing)
+	{
+		return m_Points.data() + m_RingStart[m_PolyStart[iPoly] + iRing];
+	}
+
+	/// All the points of all the polygons.
+	std::vector<DPoint2> &GetAllPoints() { return m_Points; }
+	const std::vector<DPoint2> &GetAllPoints() const { return m_Points; }
+
+protected:
+	std::vector<DPoint2> m_Points;
+	std::vector<uint> m_RingStart;	// NumRings+1 entries, into m_Points
+	std::vector<uint> m_PolyStart;	// NumPolygons+1 entries, into m_RingStart
+};
+
+#endif // VTDATA_GEOMSTORE_H
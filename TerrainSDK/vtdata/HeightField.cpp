@@ -76,6 +76,38 @@ bool vtHeightField3d::ConvertEarthToSurfacePoint(const DPoint2 &epos,
 	return FindAltitudeAtPoint(p3, p3.y, bTrue, iCultureFlags);
 }
 
+/**
+ * Converts an array of earth coordinates to world coordinates on the surface
+ * of the heightfield.  This is faster than converting the points one at a
+ * time, since the heightfield can look them up together.
+ *
+ * \return The number of points which had an elevation.
+ */
+uint vtHeightField3d::ConvertEarthToSurfacePoints(const DPoint2 *epos,
+	FPoint3 *p3, uint iCount, int iCultureFlags, bool bTrue) const
+{
+	m_LocalCS.EarthToLocal(epos, p3, iCount);
+	return FindAltitudesAtPoints(p3, iCount, bTrue, iCultureFlags);
+}
+
+/**
+ * Finds the altitude of each point in an array, from its x and z, and sets
+ * its y.  Subclasses can override this to do the lookups more efficiently.
+ *
+ * \return The number of points which had an elevation.
+ */
+uint vtHeightField3d::FindAltitudesAtPoints(FPoint3 *p3, uint iCount,
+	bool bTrue, int iCultureFlags) const
+{
+	uint iFound = 0;
+	for (uint i = 0; i < iCount; i++)
+	{
+		if (FindAltitudeAtPoint(p3[i], p3[i].y, bTrue, iCultureFlags))
+			iFound++;
+	}
+	return iFound;
+}
+
 /**
  * Tests whether a given point is within the current terrain
  */
@@ -636,29 +668,54 @@ bool vtHeightFieldGrid3d::ColorDibFromTable(vtBitmapBase *pBM, const ColorMap *c
 {
 	VTLOG1(" ColorDibFromTable:");
 	const IPoint2 bitmap_size = pBM->GetSize();
-	int depth = pBM->GetDepth();
 
 	VTLOG(" dib size %d x %d, grid %d x %d.. ", bitmap_size.x, bitmap_size.y,
 		m_iSize.x, m_iSize.y);
 
+	bool has_invalid = ColorDibFromTable(pBM, IPoint2(0, 0),
+		IPoint2(bitmap_size.x - 1, bitmap_size.y - 1), color_map, nodata,
+		progress_callback);
+
+	VTLOG("Done.\n");
+	return has_invalid;
+}
+
+/**
+ * Color only part of a bitmap from the height data, for example after the
+ * elevation there has changed.  The part is a range of texels, from 'lo'
+ * to 'hi' inclusive, counting rows from the south (bottom) of the bitmap.
+ * It is clipped to the bitmap.
+ *
+ * \return true if any invalid elevation values were encountered.
+ */
+bool vtHeightFieldGrid3d::ColorDibFromTable(vtBitmapBase *pBM, const IPoint2 &lo,
+	const IPoint2 &hi, const ColorMap *color_map, const RGBAi &nodata,
+	bool progress_callback(int)) const
+{
+	const IPoint2 bitmap_size = pBM->GetSize();
+	int depth = pBM->GetDepth();
+
 	const bool bExact = (bitmap_size == m_iSize);
 	double ratiox = (double)(m_iSize.x - 1)/(bitmap_size.x - 1),
 		   ratioy = (double)(m_iSize.y - 1)/(bitmap_size.y - 1);
 
+	const int i0 = std::max(lo.x, 0), i1 = std::min(hi.x, bitmap_size.x - 1);
+	const int j0 = std::max(lo.y, 0), j1 = std::min(hi.y, bitmap_size.y - 1);
+
 	bool has_invalid = false;
 	const RGBi nodata_24bit(nodata.r, nodata.g, nodata.b);
 	float elev;
 
 	// now iterate over the texels
-	for (int i = 0; i < bitmap_size.x; i++)
+	for (int i = i0; i <= i1; i++)
 	{
 		if (progress_callback != NULL && (i&40) == 0)
-			progress_callback(i * 100 / bitmap_size.x);
+			progress_callback((i - i0) * 100 / (i1 - i0 + 1));
 
 		// find the corresponding location in the height grid
 		const double x = i * ratiox;
 
-		for (int j = 0; j < bitmap_size.y; j++)
+		for (int j = j0; j <= j1; j++)
 		{
 			const double y = j * ratioy;
 
@@ -682,7 +739,6 @@ bool vtHeightFieldGrid3d::ColorDibFromTable(vtBitmapBase *pBM, const ColorMap *c
 				pBM->SetPixel24(i, bitmap_size.y - 1 - j, rgb);
 		}
 	}
-	VTLOG("Done.\n");
 	return has_invalid;
 }
 
@@ -701,6 +757,21 @@ bool vtHeightFieldGrid3d::ColorDibFromTable(vtBitmapBase *pBM, const ColorMap *c
  */
 void vtHeightFieldGrid3d::ShadeDibFromElevation(vtBitmapBase *pBM, const FPoint3 &light_dir,
 	float fLightFactor, float fAmbient, float fGamma, bool bTrue, bool progress_callback(int)) const
+{
+	const IPoint2 bitmap_size = pBM->GetSize();
+	ShadeDibFromElevation(pBM, IPoint2(0, 0), IPoint2(bitmap_size.x - 1, bitmap_size.y - 1),
+		light_dir, fLightFactor, fAmbient, fGamma, bTrue, progress_callback);
+}
+
+/**
+ * Shade only part of a bitmap, for example after the elevation there has
+ * changed.  The part is a range of texels, from 'lo' to 'hi' inclusive,
+ * counting rows from the south (bottom) of the bitmap, as for
+ * ColorDibFromTable.  The other arguments are as for the full version.
+ */
+void vtHeightFieldGrid3d::ShadeDibFromElevation(vtBitmapBase *pBM, const IPoint2 &lo,
+	const IPoint2 &hi, const FPoint3 &light_dir, float fLightFactor, float fAmbient,
+	float fGamma, bool bTrue, bool progress_callback(int)) const
 {
 	// consider upward-pointing normal vector, rather than downward-pointing
 	FPoint3 light_direction = -light_dir;
@@ -717,20 +788,23 @@ void vtHeightFieldGrid3d::ShadeDibFromElevation(vtBitmapBase *pBM, const FPoint3
 	if (xOffset < 1) xOffset = 1;
 	if (yOffset < 1) yOffset = 1;
 
+	const int i0 = std::max(lo.x, 0), i1 = std::min(hi.x, bitmap_size.x - 1);
+	const int j0 = std::max(lo.y, 0), j1 = std::min(hi.y, bitmap_size.y - 1);
+
 	const int depth = pBM->GetDepth();
 
 	// Center, Left, Right, Top, Bottom
 	FPoint3 c, l, r, t, b, v3;
 
 	// iterate over the texels
-	for (int j = 0; j < bitmap_size.y; j++)
+	for (int j = j0; j <= j1; j++)
 	{
 		if (progress_callback != NULL && (j%40) == 0)
-			progress_callback(j * 100 / bitmap_size.y);
+			progress_callback((j - j0) * 100 / (j1 - j0 + 1));
 
 		// find corresponding location in terrain
 		const int y = (int) (j * ratioy);
-		for (int i = 0; i < bitmap_size.x; i++)
+		for (int i = i0; i <= i1; i++)
 		{
 			const int x = (int) (i * ratiox);
 
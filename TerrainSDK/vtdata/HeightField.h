@@ -112,10 +112,19 @@ public:
 	virtual bool CastRayToSurface(const FPoint3 &point, const FPoint3 &dir,
 		FPoint3 &result) const = 0;
 
+	/// Find the altitude of many points at once, setting the y of each.
+	virtual uint FindAltitudesAtPoints(FPoint3 *p3, uint iCount,
+		bool bTrue = false, int iCultureFlags = 0) const;
+
+	/// True if queries with no culture may run on several threads at once.
+	virtual bool IsThreadSafe() const { return false; }
+
 	int PointIsAboveTerrain(const FPoint3 &p) const;
 
 	bool ConvertEarthToSurfacePoint(const DPoint2 &epos, FPoint3 &p3,
 		int iCultureFlags = 0, bool bTrue = false) const;
+	uint ConvertEarthToSurfacePoints(const DPoint2 *epos, FPoint3 *p3,
+		uint iCount, int iCultureFlags = 0, bool bTrue = false) const;
 
 	bool ContainsWorldPoint(float x, float z) const;
 	void GetCenter(FPoint3 &center) const;
@@ -177,10 +186,16 @@ public:
 		int iGranularity, const RGBAi &nodata, bool progress_callback(int) = NULL) const;
 	bool ColorDibFromTable(vtBitmapBase *pBM, const ColorMap *color_map,
 		const RGBAi &nodata, bool progress_callback(int) = NULL) const;
+	bool ColorDibFromTable(vtBitmapBase *pBM, const IPoint2 &lo, const IPoint2 &hi,
+		const ColorMap *color_map, const RGBAi &nodata,
+		bool progress_callback(int) = NULL) const;
 
 	void ShadeDibFromElevation(vtBitmapBase *pBM, const FPoint3 &light_dir,
 		float fLightFactor, float fAmbient = 0.1f, float fGamma = 1.0f,
 		bool bTrue = false, bool progress_callback(int) = NULL) const;
+	void ShadeDibFromElevation(vtBitmapBase *pBM, const IPoint2 &lo, const IPoint2 &hi,
+		const FPoint3 &light_dir, float fLightFactor, float fAmbient = 0.1f,
+		float fGamma = 1.0f, bool bTrue = false, bool progress_callback(int) = NULL) const;
 	void ShadeQuick(vtBitmapBase *pBM, float light_factor, bool bTrue = false,
 		bool progress_callback(int) = NULL);
 	void ShadowCastDib(vtBitmapBase *pBM, const FPoint3 &ight_dir,
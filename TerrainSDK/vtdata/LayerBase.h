@@ -35,6 +35,7 @@ public:
 		m_type = type;
 		m_bVisible = true;
 		m_bModified = false;
+		m_iEditCount = 0;
 	}
 
 	// attributes
@@ -45,17 +46,25 @@ public:
 	{
 		bool bChanged = (m_bModified != bModified);
 		m_bModified = bModified;
+		if (bModified)
+			m_iEditCount++;
 		if (bChanged)
 			OnModifiedChange();
 	}
 	bool GetModified() { return m_bModified; }
 
+	/// A count of the times the layer has been marked as modified.  Unlike
+	///  the modified flag, it is not reset by saving, so anything derived
+	///  from the layer's contents can tell whether it is still up to date.
+	unsigned int GetEditCount() const { return m_iEditCount; }
+
 	virtual void OnModifiedChange() {}
 
 protected:
 	LayerType	m_type;
 	bool		m_bVisible;
 	bool		m_bModified;
+	unsigned int m_iEditCount;
 };
 
 #endif // LAYER_BASE_H
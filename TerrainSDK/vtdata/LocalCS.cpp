@@ -121,6 +121,19 @@ void LocalCS::EarthToLocal(const DRECT &earth, FRECT &world) const
 	EarthToLocal(earth.right, earth.top, world.right, world.top);
 }
 
+/**
+ * Convert an array of earth coordinates to the coordinate system of the
+ * virtual world.  Only the x and z of each world point are set.
+ */
+void LocalCS::EarthToLocal(const DPoint2 *earth, FPoint3 *world, uint iCount) const
+{
+	for (uint i = 0; i < iCount; i++)
+	{
+		world[i].x = (float) ((earth[i].x - m_EarthOrigin.x) * m_Scale.x);
+		world[i].z = (float) -((earth[i].y - m_EarthOrigin.y) * m_Scale.y);
+	}
+}
+
 /**
  * Convert a vector from the coordinate system of the virtual world (x,y,z)
  * to actual earth coodinates (map coordinates, altitude in meters)
@@ -35,6 +35,7 @@ public:
 	void EarthToLocal(const DPoint2 &earth, float &x, float &z) const;
 	void EarthToLocal(const DPoint3 &earth, FPoint3 &world) const;
 	void EarthToLocal(const DRECT &earth, FRECT &world) const;
+	void EarthToLocal(const DPoint2 *earth, FPoint3 *world, uint iCount) const;
 
 	void VectorLocalToEarth(float x, float z, DPoint2 &earth) const;
 	void VectorEarthToLocal(const DPoint2 &earth, float &x, float &z) const;
@@ -0,0 +1,150 @@
+//
+// MappedFile.cpp
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "MappedFile.h"
+#include "FilePath.h"
+#include "vtString.h"
+#include "vtLog.h"
+
+#if WIN32
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
+vtMappedFile::vtMappedFile()
+{
+	m_pData = NULL;
+	m_iSize = 0;
+	m_bMapped = false;
+#if WIN32
+	m_hFile = m_hMapping = NULL;
+#endif
+}
+
+vtMappedFile::~vtMappedFile()
+{
+	Close();
+}
+
+/**
+ * Map a file into memory.
+ *
+ * \param fname_utf8 The filename, in UTF-8.
+ * \return true if successful.  An empty file is not considered successful,
+ *		since there is nothing to map.
+ */
+bool vtMappedFile::Open(const char *fname_utf8)
+{
+	Close();
+
+	vtString fname_local = UTF8ToLocal(fname_utf8);
+
+#if WIN32
+	HANDLE hFile = CreateFileA(fname_local, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		LARGE_INTEGER size;
+		if (GetFileSizeEx(hFile, &size) && size.QuadPart > 0)
+		{
+			HANDLE hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (hMapping != NULL)
+			{
+				void *data = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+				if (data != NULL)
+				{
+					m_hFile = hFile;
+					m_hMapping = hMapping;
+					m_pData = (const uchar *) data;
+					m_iSize = (size_t) size.QuadPart;
+					m_bMapped = true;
+					return true;
+				}
+				CloseHandle(hMapping);
+			}
+		}
+		CloseHandle(hFile);
+	}
+#else
+	int fd = open(fname_local, O_RDONLY);
+	if (fd != -1)
+	{
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0)
+		{
+			void *data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+			if (data != MAP_FAILED)
+			{
+				// The mapping stays valid after the descriptor is closed
+				close(fd);
+				m_pData = (const uchar *) data;
+				m_iSize = (size_t) st.st_size;
+				m_bMapped = true;
+				return true;
+			}
+		}
+		close(fd);
+	}
+#endif
+
+	// Fall back on reading the whole file
+	FILE *fp = vtFileOpen(fname_utf8, "rb");
+	if (!fp)
+		return false;
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	if (size <= 0)
+	{
+		fclose(fp);
+		return false;
+	}
+	uchar *buf = (uchar *) malloc(size);
+	if (!buf || fread(buf, size, 1, fp) != 1)
+	{
+		free(buf);
+		fclose(fp);
+		return false;
+	}
+	fclose(fp);
+	VTLOG("vtMappedFile: couldn't map '%s', read %ld bytes instead.\n", fname_utf8, size);
+	m_pData = buf;
+	m_iSize = (size_t) size;
+	m_bMapped = false;
+	return true;
+}
+
+void vtMappedFile::Close()
+{
+	if (!m_pData)
+		return;
+
+	if (m_bMapped)
+	{
+#if WIN32
+		UnmapViewOfFile((void *) m_pData);
+		CloseHandle((HANDLE) m_hMapping);
+		CloseHandle((HANDLE) m_hFile);
+		m_hFile = m_hMapping = NULL;
+#else
+		munmap((void *) m_pData, m_iSize);
+#endif
+	}
+	else
+		free((void *) m_pData);
+
+	m_pData = NULL;
+	m_iSize = 0;
+	m_bMapped = false;
+}
@@ -0,0 +1,50 @@
+//
+// MappedFile.h
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef VTDATA_MAPPEDFILE_H
+#define VTDATA_MAPPEDFILE_H
+
+#include <stddef.h>
+#include "config_vtdata.h"
+
+/**
+ * A read-only view of a whole file, mapped into memory by the operating
+ * system.  Pages are only read from disk when they are touched, so this is
+ * an efficient way to randomly access parts of very large files.
+ *
+ * If the file can't be mapped (e.g. on a platform without memory mapping)
+ * then it is simply read into memory, so callers can always use GetData().
+ */
+class vtMappedFile
+{
+public:
+	vtMappedFile();
+	~vtMappedFile();
+
+	bool Open(const char *fname_utf8);
+	void Close();
+
+	bool IsOpen() const { return m_pData != NULL; }
+	const uchar *GetData() const { return m_pData; }
+	size_t GetSize() const { return m_iSize; }
+
+protected:
+	const uchar *m_pData;
+	size_t m_iSize;
+	bool m_bMapped;		// true if mapped, false if read into a buffer
+
+#if WIN32
+	void *m_hFile, *m_hMapping;
+#endif
+
+private:
+	// not copyable
+	vtMappedFile(const vtMappedFile &);
+	vtMappedFile &operator=(const vtMappedFile &);
+};
+
+#endif // VTDATA_MAPPEDFILE_H
@@ -5,6 +5,8 @@
 // Free for all uses, see license.txt for details.
 //
 
+#include <atomic>
+
 #include "MathTypes.h"
 #include "vtLog.h"
 
@@ -1456,18 +1458,40 @@ const FPlane::IntersectionType FPlane::ThreePlanesIntersection(const FPlane& Pla
 /////////////////////////////////////////////////////////////////////////////
 // ScopedLocale
 
-ScopedLocale::ScopedLocale(int category, const char *locale_string)
+// True while some ScopedLocale holds the locale for the whole process
+static std::atomic<bool> s_bLocaleHeld(false);
+
+ScopedLocale::ScopedLocale(int category, const char *locale_string, bool bHold)
 {
+	m_category = category;
+	m_bChanged = false;
+	m_bHolding = false;
+
+	// While the locale is held, other threads may be parsing numbers, so
+	//  it must not change under them.
+	if (s_bLocaleHeld)
+		return;
+
 	// Store and override
 	m_old_locale = setlocale(category, NULL);
 	setlocale(category, locale_string);
+	m_bChanged = true;
+
+	if (bHold)
+	{
+		s_bLocaleHeld = true;
+		m_bHolding = true;
+	}
 }
 
 ScopedLocale::~ScopedLocale()
 {
+	if (m_bHolding)
+		s_bLocaleHeld = false;
+
 	// Restore
-	if (m_old_locale.size() > 0)
-		setlocale(LC_NUMERIC, m_old_locale.c_str());
+	if (m_bChanged && m_old_locale.size() > 0)
+		setlocale(m_category, m_old_locale.c_str());
 }
 
 
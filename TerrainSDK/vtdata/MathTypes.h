@@ -1411,16 +1411,27 @@ inline RGBAi &RGBAi::operator=(const RGBAf &v)
 		ScopedLocale normal_numbers(LC_NUMERIC, "C");
 \endcode
  * The locale will be restored when the ScopedLocale object goes out of scope.
+ *
+ * The locale belongs to the whole process, and setlocale() is not
+ * thread-safe.  Code which runs loaders on several threads at once should
+ * hold the locale, on the thread which starts them, for as long as they
+ * run; while it is held, every other ScopedLocale leaves the locale alone.
+\code
+		ScopedLocale normal_numbers(LC_NUMERIC, "C", true);
+\endcode
  */
 class ScopedLocale
 {
 public:
 	/// See the C function setlocale() for an explanation of the arguments.
-	ScopedLocale(int category, const char *locale_string);
+	ScopedLocale(int category, const char *locale_string, bool bHold = false);
 	~ScopedLocale();
 
 protected:
+	int m_category;
 	std::string m_old_locale;
+	bool m_bChanged;
+	bool m_bHolding;
 };
 
 
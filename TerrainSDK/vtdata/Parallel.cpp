@@ -0,0 +1,400 @@
+//
+// Parallel.cpp
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include "Parallel.h"
+#include "vtLog.h"
+
+static int s_iNumThreads = 0;	// 0 means "use the hardware default"
+
+int vtGetNumThreads()
+{
+	if (s_iNumThreads > 0)
+		return s_iNumThreads;
+
+	int hw = (int) std::thread::hardware_concurrency();
+	return (hw > 0) ? hw : 1;
+}
+
+void vtSetNumThreads(int iThreads)
+{
+	s_iNumThreads = (iThreads > 0) ? iThreads : 0;
+}
+
+/**
+ * A job for the worker pool: a range of indices, handed out one at a time
+ * to whichever thread asks next.
+ */
+struct ParallelJob
+{
+	const std::function<void(int)> *m_pFunc;
+	int m_iCount;
+	int m_iMaxHelpers;				// how many pool threads may join in
+	std::atomic<int> m_iNext;
+	std::atomic<int> m_iDone;
+	std::atomic<int> m_iHelpers;
+	std::atomic<bool> m_bCancel;
+
+	// Do items until there are none left.  Returns false if this thread
+	//  wasn't needed.
+	bool Help()
+	{
+		if (m_iHelpers++ >= m_iMaxHelpers)
+			return false;
+		int i;
+		while (!m_bCancel && (i = m_iNext++) < m_iCount)
+		{
+			(*m_pFunc)(i);
+			m_iDone++;
+		}
+		return true;
+	}
+};
+
+// True on worker threads: the pool's own, and those of a running task
+//  graph.  Only other threads may call a progress callback.
+static thread_local bool s_bWorker = false;
+
+// True on any thread which is running a parallel loop: the pool's threads,
+//  and the thread which called vtParallelFor, for as long as the loop runs.
+//  A nested vtParallelFor then simply runs serially, instead of waiting on
+//  the pool which is already busy with the outer loop.
+static thread_local bool s_bInLoop = false;
+
+// Marks the current thread as running a parallel loop, while in scope.
+class InParallelLoop
+{
+public:
+	InParallelLoop() : m_bWas(s_bInLoop) { s_bInLoop = true; }
+	~InParallelLoop() { s_bInLoop = m_bWas; }
+protected:
+	bool m_bWas;
+};
+
+/**
+ * A set of worker threads which live for the whole run of the program, so
+ * that short parallel loops (such as per-frame work) don't pay the cost of
+ * starting threads each time.  The threads sleep until a job is posted.
+ */
+class ParallelPool
+{
+public:
+	ParallelPool() : m_pJob(NULL), m_iGeneration(0), m_iActive(0), m_bQuit(false) {}
+	~ParallelPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bQuit = true;
+		}
+		m_wake.notify_all();
+		for (size_t i = 0; i < m_threads.size(); i++)
+			m_threads[i].join();
+	}
+
+	// Only one job runs on the pool at a time.  Another thread which wants
+	//  to run a job meanwhile simply does its work serially.
+	bool TryAcquire() { return m_busy.try_lock(); }
+	void Release() { m_busy.unlock(); }
+
+	void Start(ParallelJob *job, int iHelpers)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		while ((int) m_threads.size() < iHelpers)
+			m_threads.push_back(std::thread(&ParallelPool::Worker, this));
+		m_pJob = job;
+		m_iGeneration++;
+		m_wake.notify_all();
+	}
+	void Finish()
+	{
+		// Once the job is withdrawn, no more threads can pick it up, so we
+		//  only have to wait for the ones which already have.
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_pJob = NULL;
+		m_idle.wait(lock, [this]() { return m_iActive == 0; });
+	}
+
+protected:
+	void Worker()
+	{
+		s_bWorker = true;
+		s_bInLoop = true;
+		uint seen = 0;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true)
+		{
+			m_wake.wait(lock, [&]() { return m_bQuit || m_iGeneration != seen; });
+			if (m_bQuit)
+				return;
+			seen = m_iGeneration;
+			ParallelJob *job = m_pJob;
+			if (!job)
+				continue;
+			m_iActive++;
+			lock.unlock();
+			job->Help();
+			lock.lock();
+			if (--m_iActive == 0)
+				m_idle.notify_all();
+		}
+	}
+
+	std::mutex m_busy;
+	std::mutex m_mutex;
+	std::condition_variable m_wake, m_idle;
+	std::vector<std::thread> m_threads;
+	ParallelJob *m_pJob;
+	uint m_iGeneration;
+	int m_iActive;
+	bool m_bQuit;
+};
+
+static ParallelPool s_Pool;
+
+bool vtParallelFor(int iCount, const std::function<void(int)> &func,
+	bool progress_callback(int))
+{
+	if (iCount <= 0)
+		return true;
+
+	int iThreads = vtGetNumThreads();
+	if (iThreads > iCount)
+		iThreads = iCount;
+
+	ParallelJob job;
+	job.m_pFunc = &func;
+	job.m_iCount = iCount;
+	job.m_iMaxHelpers = iThreads - 1;
+	job.m_iNext = 0;
+	job.m_iDone = 0;
+	job.m_iHelpers = 0;
+	job.m_bCancel = false;
+
+	// Progress is only reported from the thread which started the outer loop
+	if (s_bWorker)
+		progress_callback = NULL;
+
+	const bool bPool = (iThreads > 1 && !s_bInLoop && s_Pool.TryAcquire());
+	if (bPool)
+		s_Pool.Start(&job, iThreads - 1);
+	InParallelLoop in_loop;
+
+	// The calling thread works too, and reports progress between items
+	int i;
+	while (!job.m_bCancel && (i = job.m_iNext++) < iCount)
+	{
+		func(i);
+		job.m_iDone++;
+		if (progress_callback != NULL &&
+			progress_callback((int) ((int64_t) job.m_iDone * 100 / iCount)))
+			job.m_bCancel = true;
+	}
+	if (bPool)
+	{
+		s_Pool.Finish();
+		s_Pool.Release();
+	}
+	return !job.m_bCancel;
+}
+
+
+///////////////////////////////////////////////////////////////////////
+
+/**
+ * Add a task to the graph.
+ *
+ * \param szName A name for the task, used for logging.  It must stay valid
+ *	until the graph has run, so a string literal is best.
+ * \param func The work to do.
+ * \param bMainThread True if the task must run on the thread which calls Run.
+ *
+ * \return The index of the task, for AddDependency.
+ */
+int vtTaskGraph::AddTask(const char *szName, const std::function<void()> &func,
+	bool bMainThread)
+{
+	Task task;
+	task.m_szName = szName;
+	task.m_func = func;
+	task.m_bMainThread = bMainThread;
+	task.m_bDone = false;
+	m_Tasks.push_back(task);
+	return (int) m_Tasks.size() - 1;
+}
+
+/**
+ * Make one task wait until another one is done.
+ */
+void vtTaskGraph::AddDependency(int iTask, int iPrerequisite)
+{
+	m_Tasks[iTask].m_Prereqs.push_back(iPrerequisite);
+}
+
+bool vtTaskGraph::IsReady(const Task &task) const
+{
+	if (task.m_bDone)
+		return false;
+	for (size_t i = 0; i < task.m_Prereqs.size(); i++)
+	{
+		if (!m_Tasks[task.m_Prereqs[i]].m_bDone)
+			return false;
+	}
+	return true;
+}
+
+void vtTaskGraph::RunTask(Task &task)
+{
+	// clock() would count the CPU time of all threads, so use wall time
+	std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+	task.m_func();
+	std::chrono::duration<float> secs = std::chrono::steady_clock::now() - t1;
+	VTLOG(" Task '%s': %.3f seconds.\n", task.m_szName, secs.count());
+}
+
+/**
+ * Run all the tasks.  Each task starts as soon as the tasks it depends on
+ * are done, whatever else is still running.  The progress callback is
+ * called on the calling thread as tasks finish; if it returns true, no
+ * further tasks are started.
+ *
+ * \return false if the operation was cancelled, or the dependencies have a
+ *	cycle, so some tasks could never run.
+ */
+bool vtTaskGraph::Run(bool progress_callback(int))
+{
+	const int iTotal = (int) m_Tasks.size();
+	if (iTotal == 0)
+		return true;
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<int> parallel, serial;	// tasks which are ready to run
+	std::vector<bool> queued(iTotal, false);
+	int iDone = 0, iRunning = 0;
+	bool bStop = false;
+
+	// Queue everything which has become ready.  Call with the mutex held.
+	std::function<void()> queue_ready = [&]()
+	{
+		for (int i = 0; i < iTotal; i++)
+		{
+			if (!queued[i] && IsReady(m_Tasks[i]))
+			{
+				queued[i] = true;
+				(m_Tasks[i].m_bMainThread ? serial : parallel).push_back(i);
+			}
+		}
+	};
+	// Run a task without the mutex, then see what it has made ready.
+	std::function<void(std::unique_lock<std::mutex> &, int)> run = [&](std::unique_lock<std::mutex> &lock, int i)
+	{
+		iRunning++;
+		lock.unlock();
+		RunTask(m_Tasks[i]);
+		lock.lock();
+		iRunning--;
+		m_Tasks[i].m_bDone = true;
+		iDone++;
+		queue_ready();
+		changed.notify_all();
+	};
+
+	// The graph's threads take the parallel tasks as they become ready
+	std::function<void()> helper = [&]()
+	{
+		s_bWorker = true;
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			changed.wait(lock, [&]() { return bStop || !parallel.empty(); });
+			if (bStop)
+				return;
+			const int i = parallel.front();
+			parallel.pop_front();
+			run(lock, i);
+		}
+	};
+
+	int iParallel = 0;
+	for (int i = 0; i < iTotal; i++)
+		if (!m_Tasks[i].m_bMainThread && !m_Tasks[i].m_bDone)
+			iParallel++;
+	const int iHelpers = s_bInLoop ? 0 : std::min(vtGetNumThreads() - 1, iParallel);
+
+	// The graph has threads of its own, rather than holding the pool for the
+	//  whole run, so that the tasks can use the pool for their own loops.
+	std::vector<std::thread> threads;
+	for (int i = 0; i < iHelpers; i++)
+		threads.push_back(std::thread(helper));
+	const bool bHelpers = !threads.empty();
+
+	// This thread runs the main-thread tasks, as soon as each is ready.  If
+	//  there are no other threads to help, it runs the others too.
+	bool bCompleted = true;
+	std::unique_lock<std::mutex> lock(mutex);
+	queue_ready();
+	changed.notify_all();
+	int iReported = 0;
+	while (iDone < iTotal)
+	{
+		if (progress_callback != NULL && iDone != iReported)
+		{
+			iReported = iDone;
+			lock.unlock();
+			const bool bCancel = progress_callback(iDone * 100 / iTotal);
+			lock.lock();
+			if (bCancel)
+			{
+				bCompleted = false;
+				break;
+			}
+		}
+		if (!serial.empty())
+		{
+			const int i = serial.front();
+			serial.pop_front();
+			run(lock, i);
+		}
+		else if (!bHelpers && !parallel.empty())
+		{
+			const int i = parallel.front();
+			parallel.pop_front();
+			run(lock, i);
+		}
+		else if (iRunning == 0 && parallel.empty())
+		{
+			VTLOG1("vtTaskGraph: the remaining tasks depend on each other.\n");
+			bCompleted = false;
+			break;
+		}
+		else
+			changed.wait(lock);
+	}
+	if (bCompleted && progress_callback != NULL && iReported != iDone)
+	{
+		lock.unlock();
+		bCompleted = !progress_callback(100);
+		lock.lock();
+	}
+
+	// Let the graph's threads go, once they have finished what they started
+	bStop = true;
+	lock.unlock();
+	changed.notify_all();
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	return bCompleted;
+}
@@ -0,0 +1,130 @@
+//
+// Parallel.h
+//
+// Simple helpers for spreading independent work across CPU cores.
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef VTDATA_PARALLEL_H
+#define VTDATA_PARALLEL_H
+
+#include <functional>
+#include <vector>
+#include "config_vtdata.h"
+
+/**
+ * Return the number of worker threads that vtParallelFor will use.  By
+ * default this is the number of hardware threads on this machine.
+ */
+int vtGetNumThreads();
+
+/**
+ * Override the number of worker threads.  A value of 1 makes all parallel
+ * operations run serially on the calling thread, which is useful for
+ * debugging.  A value of 0 restores the default.
+ */
+void vtSetNumThreads(int iThreads);
+
+/**
+ * Call a function once for each index 0..iCount-1, spreading the calls
+ * across worker threads.  Indices are handed out dynamically, so items
+ * which take different amounts of time still balance well.  The worker
+ * threads persist between calls, so it is cheap enough to use every frame.
+ * A call made from inside another parallel loop, on any thread, simply runs
+ * serially.
+ *
+ * The calling thread does work too, and it is the only thread which calls
+ * the progress callback, so it is safe to use a GUI progress dialog.  If
+ * the callback returns true (cancel), no further items are started.
+ *
+ * \return false if the operation was cancelled.
+ */
+bool vtParallelFor(int iCount, const std::function<void(int)> &func,
+	bool progress_callback(int) = NULL);
+
+/**
+ * A set of tasks with dependencies between them, each run as soon as the
+ * tasks it depends on are done.  While it runs, the graph has its own
+ * threads, as many as vtParallelFor would use, so tasks run as many at once
+ * as there are threads.  Tasks added with bMainThread run on the thread
+ * which called Run, one at a time in the order they become ready, while
+ * other tasks carry on in the background; use these for work which isn't
+ * thread-safe, such as changing a live scene graph.
+ *
+ * A task may itself use vtParallelFor.  Those loops share the worker
+ * threads of vtParallelFor: whichever loop starts first gets them, and any
+ * other loop which starts meanwhile runs serially.
+ *
+ \code
+	vtTaskGraph graph;
+	int load = graph.AddTask("load", [&]() { ... });
+	int shade = graph.AddTask("shade", [&]() { ... });
+	int attach = graph.AddTask("attach", [&]() { ... }, true);
+	graph.AddDependency(attach, load);
+	graph.AddDependency(attach, shade);
+	graph.Run();
+ \endcode
+ */
+class vtTaskGraph
+{
+public:
+	int AddTask(const char *szName, const std::function<void()> &func,
+		bool bMainThread = false);
+	void AddDependency(int iTask, int iPrerequisite);
+	uint NumTasks() const { return (uint) m_Tasks.size(); }
+
+	bool Run(bool progress_callback(int) = NULL);
+
+protected:
+	struct Task
+	{
+		const char *m_szName;
+		std::function<void()> m_func;
+		bool m_bMainThread;
+		bool m_bDone;
+		std::vector<int> m_Prereqs;
+	};
+	bool IsReady(const Task &task) const;
+	void RunTask(Task &task);
+
+	std::vector<Task> m_Tasks;
+};
+
+/**
+ * A tiny, fast pseudo-random generator (xorshift) with explicit state.
+ * Unlike rand(), each instance has its own sequence, so parallel code can
+ * give every unit of work a repeatable seed and get the same results
+ * regardless of how many threads were used.
+ */
+class vtRandomGen
+{
+public:
+	vtRandomGen(uint seed = 1) { Seed(seed); }
+
+	void Seed(uint seed)
+	{
+		// scramble the seed so that consecutive seeds give unrelated sequences
+		m_state = seed * 2654435761u + 0x9e3779b9u;
+		if (m_state == 0)
+			m_state = 0x9e3779b9u;
+		Next();
+	}
+	uint Next()
+	{
+		m_state ^= m_state << 13;
+		m_state ^= m_state >> 17;
+		m_state ^= m_state << 5;
+		return m_state;
+	}
+	/// Return a value from 0 to x.
+	float Random(float x) { return (Next() >> 8) * (1.0f / 16777216.0f) * x; }
+	/// Return a value from -x/2 to x/2.
+	float RandomOffset(float x) { return Random(x) - (x * 0.5f); }
+
+protected:
+	uint m_state;
+};
+
+#endif // VTDATA_PARALLEL_H
@@ -0,0 +1,246 @@
+//
+// RTree.cpp
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include <algorithm>
+#include <queue>
+
+#include "RTree.h"
+
+vtRTree::vtRTree(int iNodeSize)
+{
+	m_iNodeSize = (iNodeSize < 2) ? 2 : iNodeSize;
+	m_iNumItems = 0;
+}
+
+void vtRTree::Clear()
+{
+	m_iNumItems = 0;
+	m_Extent.SetToZero();
+	m_Boxes.clear();
+	m_Index.clear();
+	m_LevelEnd.clear();
+}
+
+// Helpers for sorting items by the center of their rectangles
+struct RTreeSortX
+{
+	RTreeSortX(const std::vector<DRECT> &boxes) : m_boxes(boxes) {}
+	bool operator()(int a, int b) const
+	{
+		return (m_boxes[a].left + m_boxes[a].right) < (m_boxes[b].left + m_boxes[b].right);
+	}
+	const std::vector<DRECT> &m_boxes;
+};
+struct RTreeSortY
+{
+	RTreeSortY(const std::vector<DRECT> &boxes) : m_boxes(boxes) {}
+	bool operator()(int a, int b) const
+	{
+		return (m_boxes[a].bottom + m_boxes[a].top) < (m_boxes[b].bottom + m_boxes[b].top);
+	}
+	const std::vector<DRECT> &m_boxes;
+};
+
+/**
+ * Build the tree from a set of rectangles.  Any previous contents are
+ * discarded.
+ */
+void vtRTree::Build(const std::vector<DRECT> &boxes)
+{
+	Clear();
+
+	// Gather the valid items
+	std::vector<int> order;
+	order.reserve(boxes.size());
+	for (uint i = 0; i < boxes.size(); i++)
+	{
+		const DRECT &r = boxes[i];
+		if (r.left <= r.right && r.bottom <= r.top)
+			order.push_back(i);
+	}
+	m_iNumItems = (uint) order.size();
+	if (m_iNumItems == 0)
+		return;
+
+	// Sort-Tile-Recursive: sort by X, cut into vertical slices of whole
+	//  nodes, then sort each slice by Y.
+	const uint node_size = m_iNodeSize;
+	const uint num_leaves = (m_iNumItems + node_size - 1) / node_size;
+	const uint num_slices = (uint) ceil(sqrt((double) num_leaves));
+	const uint slice_size = ((num_leaves + num_slices - 1) / num_slices) * node_size;
+
+	std::sort(order.begin(), order.end(), RTreeSortX(boxes));
+	for (uint start = 0; start < m_iNumItems; start += slice_size)
+	{
+		uint end = std::min(start + slice_size, m_iNumItems);
+		std::sort(order.begin() + start, order.begin() + end, RTreeSortY(boxes));
+	}
+
+	// Estimate the total number of entries, to allocate only once
+	uint total = m_iNumItems, count = m_iNumItems;
+	do
+	{
+		count = (count + node_size - 1) / node_size;
+		total += count;
+	} while (count > 1);
+	m_Boxes.reserve(total);
+	m_Index.reserve(total);
+
+	// The leaf level is the items themselves
+	for (uint i = 0; i < m_iNumItems; i++)
+	{
+		m_Boxes.push_back(boxes[order[i]]);
+		m_Index.push_back(order[i]);
+	}
+	m_LevelEnd.push_back(m_iNumItems);
+
+	// Pack each level into nodes until there is a single root
+	uint level_start = 0;
+	do
+	{
+		uint level_end = (uint) m_Boxes.size();
+		for (uint child = level_start; child < level_end; child += node_size)
+		{
+			uint last = std::min(child + node_size, level_end);
+			DRECT ext = m_Boxes[child];
+			for (uint c = child + 1; c < last; c++)
+				ext.GrowToContainRect(m_Boxes[c]);
+			m_Boxes.push_back(ext);
+			m_Index.push_back(child);
+		}
+		level_start = level_end;
+		m_LevelEnd.push_back((uint) m_Boxes.size());
+	} while (m_Boxes.size() - level_start > 1);
+
+	m_Extent = m_Boxes.back();
+}
+
+uint vtRTree::LastChild(uint iEntry, uint iLevel) const
+{
+	// One past the last child of a node entry at the given level
+	return std::min(FirstChild(iEntry) + m_iNodeSize, LevelEnd(iLevel - 1));
+}
+
+/**
+ * Find all the items whose rectangles overlap the given rectangle.  The
+ * item numbers are appended to 'found'.
+ */
+void vtRTree::FindOverlapping(const DRECT &rect, std::vector<int> &found) const
+{
+	if (m_iNumItems == 0)
+		return;
+
+	// Depth-first, with an explicit stack of (entry, level)
+	std::vector<std::pair<uint,uint> > stack;
+	stack.push_back(std::make_pair((uint) m_Boxes.size() - 1, (uint) m_LevelEnd.size() - 1));
+	while (!stack.empty())
+	{
+		uint entry = stack.back().first;
+		uint level = stack.back().second;
+		stack.pop_back();
+
+		const uint first = FirstChild(entry), last = LastChild(entry, level);
+		for (uint c = first; c < last; c++)
+		{
+			if (!m_Boxes[c].OverlapsRect(rect))
+				continue;
+			if (level == 1)
+				found.push_back(m_Index[c]);
+			else
+				stack.push_back(std::make_pair(c, level - 1));
+		}
+	}
+}
+
+/**
+ * Find all the items whose rectangles contain the given point.  The item
+ * numbers are appended to 'found'.
+ */
+void vtRTree::FindContaining(const DPoint2 &p, std::vector<int> &found) const
+{
+	FindOverlapping(DRECT(p.x, p.y, p.x, p.y), found);
+}
+
+double vtRTree::DistanceToRect(const DRECT &rect, const DPoint2 &p)
+{
+	double dx = 0.0, dy = 0.0;
+	if (p.x < rect.left)
+		dx = rect.left - p.x;
+	else if (p.x > rect.right)
+		dx = p.x - rect.right;
+	if (p.y < rect.bottom)
+		dy = rect.bottom - p.y;
+	else if (p.y > rect.top)
+		dy = p.y - rect.top;
+	return sqrt(dx*dx + dy*dy);
+}
+
+// An entry waiting in the nearest-neighbor search queue.  Level 0 means
+//  that the distance is the exact distance to an item.
+struct RTreeQueueEntry
+{
+	double dist;
+	uint entry, level;
+	bool operator<(const RTreeQueueEntry &other) const
+	{
+		// std::priority_queue puts the largest first, and we want smallest
+		return dist > other.dist;
+	}
+};
+
+/**
+ * Find the item closest to a point, using a best-first search.
+ *
+ * \param p The point to search from.
+ * \param dMaxDist Ignore items further away than this distance.
+ * \param distance A function which computes the exact distance to an item.
+ * \param pDistance If not NULL, receives the distance to the found item.
+ * \return The item number, or -1 if none was found within dMaxDist.
+ */
+int vtRTree::FindNearest(const DPoint2 &p, double dMaxDist,
+	const DistanceFunc &distance, double *pDistance) const
+{
+	if (m_iNumItems == 0)
+		return -1;
+
+	std::priority_queue<RTreeQueueEntry> queue;
+	RTreeQueueEntry qe;
+	qe.dist = DistanceToRect(m_Extent, p);
+	qe.entry = (uint) m_Boxes.size() - 1;
+	qe.level = (uint) m_LevelEnd.size() - 1;
+	if (qe.dist > dMaxDist)
+		return -1;
+	queue.push(qe);
+
+	while (!queue.empty())
+	{
+		RTreeQueueEntry top = queue.top();
+		queue.pop();
+
+		if (top.level == 0)
+		{
+			// Nothing left in the queue can be closer than this
+			if (pDistance)
+				*pDistance = top.dist;
+			return m_Index[top.entry];
+		}
+		const uint first = FirstChild(top.entry), last = LastChild(top.entry, top.level);
+		for (uint c = first; c < last; c++)
+		{
+			RTreeQueueEntry child;
+			child.entry = c;
+			child.level = top.level - 1;
+			if (child.level == 0)
+				child.dist = distance(m_Index[c], p);
+			else
+				child.dist = DistanceToRect(m_Boxes[c], p);
+			if (child.dist <= dMaxDist)
+				queue.push(child);
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,75 @@
+//
+// RTree.h
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef VTDATA_RTREE_H
+#define VTDATA_RTREE_H
+
+#include <functional>
+#include "MathTypes.h"
+
+/**
+ * A static, packed R-tree of 2D rectangles.
+ *
+ * The tree is bulk-loaded in one step with the Sort-Tile-Recursive (STR)
+ * method: items are sorted into vertical slices by X, each slice is sorted
+ * by Y, and runs of items are packed into full nodes.  The whole tree is
+ * stored in a few flat arrays, so it is compact and fast to search, but it
+ * can't be edited; when the items change, simply build it again.
+ *
+ * Each item is identified by its index in the array of rectangles given
+ * to Build().  Empty (inside-out) rectangles are skipped.
+ */
+class vtRTree
+{
+public:
+	vtRTree(int iNodeSize = 16);
+
+	void Clear();
+	void Build(const std::vector<DRECT> &boxes);
+
+	/// Number of items in the tree.
+	uint NumItems() const { return m_iNumItems; }
+	bool IsEmpty() const { return m_iNumItems == 0; }
+	/// The extent of all the items in the tree.
+	const DRECT &GetExtent() const { return m_Extent; }
+
+	void FindOverlapping(const DRECT &rect, std::vector<int> &found) const;
+	void FindContaining(const DPoint2 &p, std::vector<int> &found) const;
+
+	/**
+	 * A function which gives the exact distance from a point to an item,
+	 * which must be no less than the distance to the item's rectangle.
+	 */
+	typedef std::function<double(int iItem, const DPoint2 &p)> DistanceFunc;
+
+	int FindNearest(const DPoint2 &p, double dMaxDist,
+		const DistanceFunc &distance, double *pDistance = NULL) const;
+
+	static double DistanceToRect(const DRECT &rect, const DPoint2 &p);
+
+protected:
+	uint LevelEnd(uint iLevel) const { return m_LevelEnd[iLevel]; }
+	uint FirstChild(uint iEntry) const { return (uint) m_Index[iEntry]; }
+	uint LastChild(uint iEntry, uint iLevel) const;
+
+	int m_iNodeSize;
+	uint m_iNumItems;
+	DRECT m_Extent;
+
+	// All entries, level by level: first the items (leaf level), then each
+	//  level of nodes up to the single root entry.
+	std::vector<DRECT> m_Boxes;
+
+	// For leaf entries, the item number; for node entries, the position of
+	//  the node's first child in the level below.
+	std::vector<int> m_Index;
+
+	// The position in m_Boxes just past the end of each level.
+	std::vector<uint> m_LevelEnd;
+};
+
+#endif // VTDATA_RTREE_H
@@ -0,0 +1,723 @@
+//
+// RasterAlgebra.cpp
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "RasterAlgebra.h"
+#include "ElevationGrid.h"
+#include "Parallel.h"
+#include "vtLog.h"
+
+#define INVALIDF	((float) INVALID_ELEVATION)
+
+/////////////////////////////////////////////////////////////////////////////
+// vtRasterExpr
+
+vtRasterExpr::~vtRasterExpr()
+{
+	for (size_t i = 0; i < m_Args.size(); i++)
+		delete m_Args[i];
+}
+
+vtRasterExpr *vtRasterExpr::Constant(float fValue)
+{
+	vtRasterExpr *e = new vtRasterExpr(OP_CONST);
+	e->m_fValue = fValue;
+	return e;
+}
+
+vtRasterExpr *vtRasterExpr::Input(int iInput)
+{
+	vtRasterExpr *e = new vtRasterExpr(OP_INPUT);
+	e->m_iInput = iInput;
+	return e;
+}
+
+/**
+ * The slope of an input, in degrees from horizontal.  It is computed from
+ * the neighboring heixels of the output grid, so it only depends on the
+ * output's spacing, not the input's.
+ */
+vtRasterExpr *vtRasterExpr::Slope(int iInput)
+{
+	vtRasterExpr *e = new vtRasterExpr(OP_SLOPE);
+	e->m_iInput = iInput;
+	return e;
+}
+
+vtRasterExpr *vtRasterExpr::Unary(Op op, vtRasterExpr *a)
+{
+	vtRasterExpr *e = new vtRasterExpr(op);
+	e->m_Args.push_back(a);
+	return e;
+}
+
+vtRasterExpr *vtRasterExpr::Binary(Op op, vtRasterExpr *a, vtRasterExpr *b)
+{
+	vtRasterExpr *e = new vtRasterExpr(op);
+	e->m_Args.push_back(a);
+	e->m_Args.push_back(b);
+	return e;
+}
+
+/**
+ * An operator with any number of arguments, such as OP_MIN and OP_MAX.
+ * For the other binary operators, the arguments are combined left to right.
+ */
+vtRasterExpr *vtRasterExpr::Nary(Op op, const std::vector<vtRasterExpr*> &args)
+{
+	vtRasterExpr *e = new vtRasterExpr(op);
+	e->m_Args = args;
+	return e;
+}
+
+/**
+ * Where the condition is true (non-zero), the value of a; where it is
+ * false, the value of b.
+ */
+vtRasterExpr *vtRasterExpr::If(vtRasterExpr *cond, vtRasterExpr *a, vtRasterExpr *b)
+{
+	vtRasterExpr *e = new vtRasterExpr(OP_IF);
+	e->m_Args.push_back(cond);
+	e->m_Args.push_back(a);
+	e->m_Args.push_back(b);
+	return e;
+}
+
+/** The highest input index used in this expression, or -1 if none. */
+int vtRasterExpr::HighestInput() const
+{
+	int highest = m_iInput;
+	for (size_t i = 0; i < m_Args.size(); i++)
+		highest = std::max(highest, m_Args[i]->HighestInput());
+	return highest;
+}
+
+// A recursive-descent parser for the expression syntax.
+class RasterExprParser
+{
+public:
+	RasterExprParser(const char *szExpr, int iNumInputs)
+		: m_szStart(szExpr), m_p(szExpr), m_iNumInputs(iNumInputs) {}
+
+	vtRasterExpr *ParseAll()
+	{
+		vtRasterExpr *e = ParseOr();
+		SkipSpace();
+		if (e && *m_p)
+		{
+			delete e;
+			return Fail("Unexpected '%c'", *m_p);
+		}
+		return e;
+	}
+
+	vtString m_strError;
+
+protected:
+	void SkipSpace()
+	{
+		while (isspace((unsigned char) *m_p))
+			m_p++;
+	}
+	bool Accept(const char *tok)
+	{
+		SkipSpace();
+		const size_t len = strlen(tok);
+		if (strncmp(m_p, tok, len))
+			return false;
+		m_p += len;
+		return true;
+	}
+	vtRasterExpr *Fail(const char *szFormat, char c = 0)
+	{
+		if (m_strError.IsEmpty())
+		{
+			vtString msg;
+			msg.Format(szFormat, c);
+			m_strError.Format("%s, at character %d", (const char *) msg,
+				(int) (m_p - m_szStart) + 1);
+		}
+		return NULL;
+	}
+
+	// Parse a left-associative sequence of binary operators
+	typedef vtRasterExpr *(RasterExprParser::*ParseFunc)();
+	vtRasterExpr *ParseBinary(ParseFunc next, const char **tokens,
+		const vtRasterExpr::Op *ops, int count)
+	{
+		vtRasterExpr *e = (this->*next)();
+		while (e)
+		{
+			int k;
+			for (k = 0; k < count; k++)
+				if (Accept(tokens[k]))
+					break;
+			if (k == count)
+				break;
+			vtRasterExpr *rhs = (this->*next)();
+			if (!rhs)
+			{
+				delete e;
+				return NULL;
+			}
+			e = vtRasterExpr::Binary(ops[k], e, rhs);
+		}
+		return e;
+	}
+	vtRasterExpr *ParseOr()
+	{
+		static const char *tokens[] = { "||", "|" };
+		static const vtRasterExpr::Op ops[] = { vtRasterExpr::OP_OR, vtRasterExpr::OP_OR };
+		return ParseBinary(&RasterExprParser::ParseAnd, tokens, ops, 2);
+	}
+	vtRasterExpr *ParseAnd()
+	{
+		static const char *tokens[] = { "&&", "&" };
+		static const vtRasterExpr::Op ops[] = { vtRasterExpr::OP_AND, vtRasterExpr::OP_AND };
+		return ParseBinary(&RasterExprParser::ParseCompare, tokens, ops, 2);
+	}
+	vtRasterExpr *ParseCompare()
+	{
+		// The two-character operators must be tested first
+		static const char *tokens[] = { "<=", ">=", "==", "!=", "<", ">", "=" };
+		static const vtRasterExpr::Op ops[] = { vtRasterExpr::OP_LE,
+			vtRasterExpr::OP_GE, vtRasterExpr::OP_EQ, vtRasterExpr::OP_NE,
+			vtRasterExpr::OP_LT, vtRasterExpr::OP_GT, vtRasterExpr::OP_EQ };
+		return ParseBinary(&RasterExprParser::ParseSum, tokens, ops, 7);
+	}
+	vtRasterExpr *ParseSum()
+	{
+		static const char *tokens[] = { "+", "-" };
+		static const vtRasterExpr::Op ops[] = { vtRasterExpr::OP_ADD, vtRasterExpr::OP_SUB };
+		return ParseBinary(&RasterExprParser::ParseProduct, tokens, ops, 2);
+	}
+	vtRasterExpr *ParseProduct()
+	{
+		static const char *tokens[] = { "*", "/" };
+		static const vtRasterExpr::Op ops[] = { vtRasterExpr::OP_MUL, vtRasterExpr::OP_DIV };
+		return ParseBinary(&RasterExprParser::ParseUnary, tokens, ops, 2);
+	}
+	vtRasterExpr *ParseUnary()
+	{
+		if (Accept("-"))
+		{
+			vtRasterExpr *e = ParseUnary();
+			return e ? vtRasterExpr::Unary(vtRasterExpr::OP_NEG, e) : NULL;
+		}
+		if (Accept("+"))
+			return ParseUnary();
+		return ParsePrimary();
+	}
+	bool ParseArgs(std::vector<vtRasterExpr*> &args)
+	{
+		if (!Accept("("))
+		{
+			Fail("Expected '('");
+			return false;
+		}
+		if (!Accept(")"))
+		{
+			do
+			{
+				vtRasterExpr *e = ParseOr();
+				if (!e)
+					return false;
+				args.push_back(e);
+			}
+			while (Accept(","));
+
+			if (!Accept(")"))
+			{
+				Fail("Expected ')'");
+				return false;
+			}
+		}
+		return true;
+	}
+	vtRasterExpr *ParsePrimary()
+	{
+		SkipSpace();
+		if (Accept("("))
+		{
+			vtRasterExpr *e = ParseOr();
+			if (e && !Accept(")"))
+			{
+				delete e;
+				return Fail("Expected ')'");
+			}
+			return e;
+		}
+		if (isdigit((unsigned char) *m_p) || *m_p == '.')
+		{
+			char *end;
+			const double value = strtod(m_p, &end);
+			if (end == m_p)
+				return Fail("Bad number");
+			m_p = end;
+			return vtRasterExpr::Constant((float) value);
+		}
+		if (!isalpha((unsigned char) *m_p))
+			return *m_p ? Fail("Unexpected '%c'", *m_p) : Fail("Unexpected end");
+
+		const char *name_start = m_p;
+		while (isalnum((unsigned char) *m_p) || *m_p == '_')
+			m_p++;
+		vtString name(name_start, (int) (m_p - name_start));
+
+		// A single letter is an input: A is the first
+		if (name.GetLength() == 1)
+		{
+			const int input = toupper((unsigned char) name[0]) - 'A';
+			if (input >= m_iNumInputs)
+				return Fail("There is no input '%c'", name[0]);
+			return vtRasterExpr::Input(input);
+		}
+		if (name.CompareNoCase("nodata") == 0)
+			return vtRasterExpr::Constant(INVALIDF);
+
+		std::vector<vtRasterExpr*> args;
+		if (!ParseArgs(args))
+		{
+			for (size_t i = 0; i < args.size(); i++)
+				delete args[i];
+			return NULL;
+		}
+		vtRasterExpr *e = MakeFunction(name, args);
+		if (!e)
+		{
+			for (size_t i = 0; i < args.size(); i++)
+				delete args[i];
+		}
+		return e;
+	}
+	vtRasterExpr *MakeFunction(const vtString &name, std::vector<vtRasterExpr*> &args)
+	{
+		const size_t num = args.size();
+		if (!name.CompareNoCase("min") || !name.CompareNoCase("max"))
+		{
+			if (num < 1)
+				return Fail("min and max need at least one argument");
+			return vtRasterExpr::Nary(name.CompareNoCase("min") ?
+				vtRasterExpr::OP_MAX : vtRasterExpr::OP_MIN, args);
+		}
+		if (!name.CompareNoCase("if"))
+		{
+			if (num != 3)
+				return Fail("if needs three arguments");
+			return vtRasterExpr::If(args[0], args[1], args[2]);
+		}
+		if (!name.CompareNoCase("slope"))
+		{
+			if (num != 1 || args[0]->GetOp() != vtRasterExpr::OP_INPUT)
+				return Fail("slope needs one argument, which is an input");
+			const int input = args[0]->GetInput();
+			delete args[0];
+			args.clear();
+			return vtRasterExpr::Slope(input);
+		}
+		vtRasterExpr::Op op;
+		if (!name.CompareNoCase("abs"))
+			op = vtRasterExpr::OP_ABS;
+		else if (!name.CompareNoCase("sqrt"))
+			op = vtRasterExpr::OP_SQRT;
+		else if (!name.CompareNoCase("valid"))
+			op = vtRasterExpr::OP_VALID;
+		else
+			return Fail("Unknown function");
+		if (num != 1)
+			return Fail("Expected one argument");
+		return vtRasterExpr::Unary(op, args[0]);
+	}
+
+	const char *m_szStart, *m_p;
+	int m_iNumInputs;
+};
+
+/**
+ * Parse an expression from text.
+ *
+ * The inputs are single letters, A for the first input, B for the second,
+ * and so on.  The syntax has numbers, the operators + - * / < <= > >= == !=
+ * & (and) | (or), parentheses, the value \c nodata, and the functions
+ * abs(x), sqrt(x), min(x, y, ...), max(x, y, ...), if(cond, x, y), valid(x)
+ * and slope(input).  For example:
+ \code
+	if(slope(A) > 30, 1, 0)
+	max(A, B, C) - 10
+	if(valid(A), A, B)
+ \endcode
+ *
+ * \param szExpr The text of the expression.
+ * \param iNumInputs The number of inputs which may be used.
+ * \param pError If supplied, receives a description of any error.
+ * \return The new expression, which the caller must delete, or NULL if
+ *		it could not be parsed.
+ */
+vtRasterExpr *vtRasterExpr::Parse(const char *szExpr, int iNumInputs, vtString *pError)
+{
+	RasterExprParser parser(szExpr, iNumInputs);
+	vtRasterExpr *e = parser.ParseAll();
+	if (!e && pError)
+		*pError = parser.m_strError;
+	return e;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// vtRasterAlgebra
+
+// The part of the output being computed by one task, and the input values
+//  which have been read for it.
+struct vtRasterAlgebra::Tile
+{
+	int i0, j0;		// first heixel of the tile
+	int w, h;		// size of the tile
+	std::vector<std::vector<float> > m_InputValues;
+};
+
+vtRasterAlgebra::vtRasterAlgebra()
+{
+	m_pOutput = NULL;
+	m_iTileSize = 128;
+}
+
+/**
+ * Parse an expression (see vtRasterExpr::Parse) and evaluate it.
+ */
+bool vtRasterAlgebra::Evaluate(const char *szExpr, vtElevationGrid *pOutput,
+	bool progress_callback(int))
+{
+	vtString err;
+	vtRasterExpr *expr = vtRasterExpr::Parse(szExpr, NumInputs(), &err);
+	if (!expr)
+	{
+		m_strError = err;
+		return false;
+	}
+	bool bResult = Evaluate(expr, pOutput, progress_callback);
+	delete expr;
+	return bResult;
+}
+
+/**
+ * Evaluate an expression at every heixel of a grid.
+ *
+ * \param pExpr The expression.
+ * \param pOutput A grid which has already been created with the desired
+ *		extents, size, CRS and data type.  The inputs must be in the same CRS.
+ *		Every heixel is overwritten, and the height extents are recomputed.
+ * \param progress_callback If supplied, this is called with the percentage
+ *		done; if it returns true, the operation is cancelled.
+ * \return True if successful.
+ */
+bool vtRasterAlgebra::Evaluate(const vtRasterExpr *pExpr, vtElevationGrid *pOutput,
+	bool progress_callback(int))
+{
+	m_strError = "";
+	if (!pExpr || !pOutput || !pOutput->HasData())
+	{
+		m_strError = "No expression or no output grid";
+		return false;
+	}
+	if (pExpr->HighestInput() >= (int) NumInputs())
+	{
+		m_strError.Format("The expression uses %d inputs, but there are only %d",
+			pExpr->HighestInput() + 1, NumInputs());
+		return false;
+	}
+	m_pOutput = pOutput;
+
+	// Find which inputs line up with the output
+	const DRECT &ext = pOutput->GetEarthExtents();
+	const DPoint2 &spacing = pOutput->GetSpacing();
+	bool bThreadSafe = true;
+	m_Info.resize(m_Inputs.size());
+	for (size_t k = 0; k < m_Inputs.size(); k++)
+	{
+		InputInfo &info = m_Info[k];
+		info.m_pHF = m_Inputs[k];
+		info.m_pGrid = dynamic_cast<const vtElevationGrid*>(m_Inputs[k]);
+		info.m_bAligned = false;
+		info.m_iOffsetX = info.m_iOffsetY = 0;
+		if (!info.m_pHF->IsThreadSafe())
+			bThreadSafe = false;
+
+		if (!info.m_pGrid || !info.m_pGrid->HasData())
+			continue;
+		const DRECT &in_ext = info.m_pGrid->GetEarthExtents();
+		const DPoint2 &in_spacing = info.m_pGrid->GetSpacing();
+		if (fabs(in_spacing.x - spacing.x) > spacing.x * 1E-6 ||
+			fabs(in_spacing.y - spacing.y) > spacing.y * 1E-6)
+			continue;
+		const double fx = (ext.left - in_ext.left) / spacing.x;
+		const double fy = (ext.bottom - in_ext.bottom) / spacing.y;
+		const double rx = floor(fx + 0.5), ry = floor(fy + 0.5);
+		if (fabs(fx - rx) > 1E-3 || fabs(fy - ry) > 1E-3)
+			continue;
+		info.m_bAligned = true;
+		info.m_iOffsetX = (int) rx;
+		info.m_iOffsetY = (int) ry;
+	}
+
+	// Slope needs the heixel spacing in meters
+	const vtCRS &crs = pOutput->GetCRS();
+	if (crs.GetUnits() == LU_DEGREES)
+	{
+		m_SlopeScale.x = EstimateDegreesToMeters((ext.top + ext.bottom) / 2);
+		m_SlopeScale.y = EstimateDegreesToMeters(0);
+	}
+	else
+		m_SlopeScale.x = m_SlopeScale.y = GetMetersPerUnit(crs.GetUnits());
+
+	const IPoint2 size = pOutput->GetDimensions();
+	const int tiles_x = (size.x + m_iTileSize - 1) / m_iTileSize;
+	const int tiles_y = (size.y + m_iTileSize - 1) / m_iTileSize;
+	const int iTiles = tiles_x * tiles_y;
+
+	auto do_tile = [&](int t)
+	{
+		Tile tile;
+		tile.i0 = (t % tiles_x) * m_iTileSize;
+		tile.j0 = (t / tiles_x) * m_iTileSize;
+		tile.w = std::min(m_iTileSize, size.x - tile.i0);
+		tile.h = std::min(m_iTileSize, size.y - tile.j0);
+		tile.m_InputValues.resize(m_Inputs.size());
+
+		std::vector<float> result(tile.w * tile.h);
+		EvalNode(pExpr, tile, &result[0]);
+
+		// The grid is stored by columns, so write j innermost
+		for (int x = 0; x < tile.w; x++)
+		{
+			const float *column = &result[x * tile.h];
+			for (int y = 0; y < tile.h; y++)
+				pOutput->SetFValue(tile.i0 + x, tile.j0 + y, column[y]);
+		}
+	};
+
+	bool bOK = true;
+	if (bThreadSafe)
+		bOK = vtParallelFor(iTiles, do_tile, progress_callback);
+	else
+	{
+		for (int t = 0; t < iTiles && bOK; t++)
+		{
+			if (progress_callback != NULL && progress_callback(t * 100 / iTiles))
+				bOK = false;
+			else
+				do_tile(t);
+		}
+	}
+	if (!bOK)
+	{
+		m_strError = "Cancelled";
+		return false;
+	}
+	pOutput->ComputeHeightExtents();
+	VTLOG("vtRasterAlgebra: %d x %d heixels, %d tiles, %s\n", size.x, size.y,
+		iTiles, bThreadSafe ? "parallel" : "serial");
+	return true;
+}
+
+/**
+ * Read the values of an input at the heixels of a tile, plus a border of
+ * heixels around it.  The values are stored by column, like the grid.
+ */
+void vtRasterAlgebra::FetchInput(int iInput, Tile &tile, int iBorder, float *result) const
+{
+	const InputInfo &info = m_Info[iInput];
+	const int w = tile.w + iBorder * 2, h = tile.h + iBorder * 2;
+	const int i0 = tile.i0 - iBorder, j0 = tile.j0 - iBorder;
+
+	if (info.m_bAligned)
+	{
+		const IPoint2 in_size = info.m_pGrid->GetDimensions();
+		for (int x = 0; x < w; x++)
+		{
+			const int ii = info.m_iOffsetX + i0 + x;
+			float *column = result + x * h;
+			for (int y = 0; y < h; y++)
+			{
+				const int jj = info.m_iOffsetY + j0 + y;
+				if (ii < 0 || ii >= in_size.x || jj < 0 || jj >= in_size.y)
+					column[y] = INVALIDF;
+				else
+					column[y] = info.m_pGrid->GetFValue(ii, jj);
+			}
+		}
+		return;
+	}
+
+	DPoint2 p;
+	for (int x = 0; x < w; x++)
+	{
+		float *column = result + x * h;
+		for (int y = 0; y < h; y++)
+		{
+			m_pOutput->GetEarthPoint(i0 + x, j0 + y, p);
+			if (info.m_pGrid)
+				column[y] = info.m_pGrid->GetFilteredValue(p);
+			else if (!info.m_pHF->FindAltitudeOnEarth(p, column[y], true))
+				column[y] = INVALIDF;
+		}
+	}
+}
+
+void vtRasterAlgebra::EvalNode(const vtRasterExpr *pNode, Tile &tile, float *result) const
+{
+	const int n = tile.w * tile.h;
+	const vtRasterExpr::Op op = pNode->GetOp();
+
+	switch (op)
+	{
+	case vtRasterExpr::OP_CONST:
+		std::fill(result, result + n, pNode->GetValue());
+		return;
+
+	case vtRasterExpr::OP_INPUT:
+		{
+			// Each input is read at most once per tile
+			std::vector<float> &values = tile.m_InputValues[pNode->GetInput()];
+			if (values.empty())
+			{
+				values.resize(n);
+				FetchInput(pNode->GetInput(), tile, 0, &values[0]);
+			}
+			std::copy(values.begin(), values.end(), result);
+		}
+		return;
+
+	case vtRasterExpr::OP_SLOPE:
+		{
+			const int h = tile.h + 2;
+			std::vector<float> halo((tile.w + 2) * h);
+			FetchInput(pNode->GetInput(), tile, 1, &halo[0]);
+
+			const DPoint2 &spacing = m_pOutput->GetSpacing();
+			const double dx = spacing.x * m_SlopeScale.x;
+			const double dy = spacing.y * m_SlopeScale.y;
+
+			// The rate of change between a heixel and its two neighbors, using
+			//  one side where the other is unknown.
+			auto gradient = [](float lo, float mid, float hi, double step, bool &ok)
+			{
+				const bool bLo = (lo != INVALIDF), bHi = (hi != INVALIDF);
+				if (bLo && bHi)
+					return (hi - lo) / (2 * step);
+				if (bHi)
+					return (hi - mid) / step;
+				if (bLo)
+					return (mid - lo) / step;
+				ok = false;
+				return 0.0;
+			};
+			for (int x = 0; x < tile.w; x++)
+			{
+				const float *left = &halo[x * h + 1];
+				const float *center = left + h;
+				const float *right = center + h;
+				for (int y = 0; y < tile.h; y++)
+				{
+					float &out = result[x * tile.h + y];
+					if (center[y] == INVALIDF)
+					{
+						out = INVALIDF;
+						continue;
+					}
+					bool ok = true;
+					const double gx = gradient(left[y], center[y], right[y], dx, ok);
+					const double gy = gradient(center[y-1], center[y], center[y+1], dy, ok);
+					out = ok ? (float) (atan(sqrt(gx*gx + gy*gy)) * 180.0 / PId) : INVALIDF;
+				}
+			}
+		}
+		return;
+
+	case vtRasterExpr::OP_VALID:
+		EvalNode(pNode->GetArg(0), tile, result);
+		for (int k = 0; k < n; k++)
+			result[k] = (result[k] != INVALIDF) ? 1.0f : 0.0f;
+		return;
+
+	case vtRasterExpr::OP_NEG:
+	case vtRasterExpr::OP_ABS:
+	case vtRasterExpr::OP_SQRT:
+		EvalNode(pNode->GetArg(0), tile, result);
+		for (int k = 0; k < n; k++)
+		{
+			float &v = result[k];
+			if (v == INVALIDF)
+				continue;
+			if (op == vtRasterExpr::OP_NEG)
+				v = -v;
+			else if (op == vtRasterExpr::OP_ABS)
+				v = fabsf(v);
+			else
+				v = (v < 0) ? INVALIDF : sqrtf(v);
+		}
+		return;
+
+	case vtRasterExpr::OP_IF:
+		{
+			std::vector<float> a(n), b(n);
+			EvalNode(pNode->GetArg(0), tile, result);
+			EvalNode(pNode->GetArg(1), tile, &a[0]);
+			EvalNode(pNode->GetArg(2), tile, &b[0]);
+			for (int k = 0; k < n; k++)
+			{
+				if (result[k] != INVALIDF)
+					result[k] = (result[k] != 0.0f) ? a[k] : b[k];
+			}
+		}
+		return;
+
+	default:
+		break;
+	}
+
+	// The binary and n-ary operators: combine the arguments left to right
+	EvalNode(pNode->GetArg(0), tile, result);
+	std::vector<float> rhs(n);
+	for (uint arg = 1; arg < pNode->NumArgs(); arg++)
+	{
+		EvalNode(pNode->GetArg(arg), tile, &rhs[0]);
+		for (int k = 0; k < n; k++)
+		{
+			const float a = result[k], b = rhs[k];
+			if (a == INVALIDF || b == INVALIDF)
+			{
+				result[k] = INVALIDF;
+				continue;
+			}
+			float v;
+			switch (op)
+			{
+			case vtRasterExpr::OP_ADD: v = a + b; break;
+			case vtRasterExpr::OP_SUB: v = a - b; break;
+			case vtRasterExpr::OP_MUL: v = a * b; break;
+			case vtRasterExpr::OP_DIV: v = (b == 0.0f) ? INVALIDF : a / b; break;
+			case vtRasterExpr::OP_MIN: v = std::min(a, b); break;
+			case vtRasterExpr::OP_MAX: v = std::max(a, b); break;
+			case vtRasterExpr::OP_LT: v = (a < b) ? 1.0f : 0.0f; break;
+			case vtRasterExpr::OP_LE: v = (a <= b) ? 1.0f : 0.0f; break;
+			case vtRasterExpr::OP_GT: v = (a > b) ? 1.0f : 0.0f; break;
+			case vtRasterExpr::OP_GE: v = (a >= b) ? 1.0f : 0.0f; break;
+			case vtRasterExpr::OP_EQ: v = (a == b) ? 1.0f : 0.0f; break;
+			case vtRasterExpr::OP_NE: v = (a != b) ? 1.0f : 0.0f; break;
+			case vtRasterExpr::OP_AND: v = (a != 0.0f && b != 0.0f) ? 1.0f : 0.0f; break;
+			case vtRasterExpr::OP_OR: v = (a != 0.0f || b != 0.0f) ? 1.0f : 0.0f; break;
+			default: v = INVALIDF; break;
+			}
+			result[k] = v;
+		}
+	}
+}
@@ -0,0 +1,132 @@
+//
+// RasterAlgebra.h
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef VTDATA_RASTERALGEBRA_H
+#define VTDATA_RASTERALGEBRA_H
+
+#include <vector>
+
+#include "HeightField.h"
+#include "vtString.h"
+
+class vtElevationGrid;
+
+/**
+ * A node in an expression tree for raster algebra.  Each node computes one
+ * value per heixel, from the values of its arguments at the same heixel.
+ *
+ * Any unknown (INVALID_ELEVATION) argument makes the result unknown, except
+ * for If(), which only needs the condition and the chosen branch to be
+ * known, and Valid(), which tests for unknown values.  Comparisons and the
+ * logical operators give 1 for true and 0 for false.
+ *
+ * A node owns its arguments, and deletes them when it is deleted.
+ */
+class vtRasterExpr
+{
+public:
+	enum Op {
+		OP_CONST, OP_INPUT, OP_SLOPE, OP_VALID,
+		OP_NEG, OP_ABS, OP_SQRT,
+		OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MIN, OP_MAX,
+		OP_LT, OP_LE, OP_GT, OP_GE, OP_EQ, OP_NE, OP_AND, OP_OR,
+		OP_IF
+	};
+	~vtRasterExpr();
+
+	static vtRasterExpr *Constant(float fValue);
+	static vtRasterExpr *Input(int iInput);
+	static vtRasterExpr *Slope(int iInput);
+	static vtRasterExpr *Unary(Op op, vtRasterExpr *a);
+	static vtRasterExpr *Binary(Op op, vtRasterExpr *a, vtRasterExpr *b);
+	static vtRasterExpr *Nary(Op op, const std::vector<vtRasterExpr*> &args);
+	static vtRasterExpr *If(vtRasterExpr *cond, vtRasterExpr *a, vtRasterExpr *b);
+
+	static vtRasterExpr *Parse(const char *szExpr, int iNumInputs, vtString *pError = NULL);
+
+	Op GetOp() const { return m_op; }
+	float GetValue() const { return m_fValue; }
+	int GetInput() const { return m_iInput; }
+	uint NumArgs() const { return (uint) m_Args.size(); }
+	const vtRasterExpr *GetArg(uint i) const { return m_Args[i]; }
+
+	int HighestInput() const;
+
+protected:
+	vtRasterExpr(Op op) : m_op(op), m_fValue(0), m_iInput(-1) {}
+
+	Op m_op;
+	float m_fValue;		// for OP_CONST
+	int m_iInput;		// for OP_INPUT and OP_SLOPE
+	std::vector<vtRasterExpr*> m_Args;
+};
+
+/**
+ * Evaluates a vtRasterExpr over a set of input heightfields, producing an
+ * elevation grid.
+ *
+ * The inputs are named A, B, C.. in expressions, in the order they were
+ * added.  An input which is an elevation grid with the same spacing as the
+ * output, and heixels that line up with the output, is read directly;
+ * any other input is resampled at each output heixel.
+ *
+ * The output is computed in square tiles of heixels, so each part of each
+ * input is read while it is in cache, and the tiles are computed in parallel
+ * if all the inputs are thread-safe.
+ *
+ \code
+	vtRasterAlgebra ra;
+	ra.AddInput(pGridA);
+	ra.AddInput(pGridB);
+	vtString err;
+	vtRasterExpr *expr = vtRasterExpr::Parse("if(slope(A) > 30, max(A, B), nodata)", 2, &err);
+	ra.Evaluate(expr, pOutput);
+	delete expr;
+ \endcode
+ */
+class vtRasterAlgebra
+{
+public:
+	vtRasterAlgebra();
+
+	void AddInput(const vtHeightField3d *pInput) { m_Inputs.push_back(pInput); }
+	uint NumInputs() const { return (uint) m_Inputs.size(); }
+	void ClearInputs() { m_Inputs.clear(); }
+
+	/// Set the size of the tiles, in heixels.  The default is 128.
+	void SetTileSize(int iSize) { m_iTileSize = iSize > 1 ? iSize : 2; }
+
+	bool Evaluate(const vtRasterExpr *pExpr, vtElevationGrid *pOutput,
+		bool progress_callback(int) = NULL);
+	bool Evaluate(const char *szExpr, vtElevationGrid *pOutput,
+		bool progress_callback(int) = NULL);
+
+	/// A description of the last error, if Evaluate returned false.
+	const vtString &GetError() const { return m_strError; }
+
+	struct InputInfo
+	{
+		const vtHeightField3d *m_pHF;
+		const vtElevationGrid *m_pGrid;	// if the input is a grid
+		bool m_bAligned;
+		int m_iOffsetX, m_iOffsetY;		// of the output in the input, if aligned
+	};
+	struct Tile;
+
+protected:
+	void EvalNode(const vtRasterExpr *pNode, Tile &tile, float *result) const;
+	void FetchInput(int iInput, Tile &tile, int iBorder, float *result) const;
+
+	std::vector<const vtHeightField3d*> m_Inputs;
+	std::vector<InputInfo> m_Info;
+	const vtElevationGrid *m_pOutput;
+	DPoint2 m_SlopeScale;	// meters per earth unit, for slope
+	int m_iTileSize;
+	vtString m_strError;
+};
+
+#endif // VTDATA_RASTERALGEBRA_H
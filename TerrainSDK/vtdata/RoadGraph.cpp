@@ -0,0 +1,493 @@
+//
+// RoadGraph.cpp
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+#include "RoadGraph.h"
+#include "vtLog.h"
+
+// Meters per degree of latitude; this varies by less than 1% so a constant
+//  is used, both for link lengths and for the A* heuristic.
+#define METERS_PER_LATITUDE	111132.0
+
+// An entry in the priority queue of a search: a node and its cost
+typedef std::pair<double, uint> RouteQueueEntry;
+typedef std::priority_queue<RouteQueueEntry, std::vector<RouteQueueEntry>,
+	std::greater<RouteQueueEntry> > RouteQueue;
+
+vtRoadGraph::vtRoadGraph()
+{
+	m_bGeo = false;
+	m_dMinMetersPerLon = 1.0;
+	m_fMaxSpeed = 0.0f;
+}
+
+void vtRoadGraph::Clear()
+{
+	m_NodePos.clear();
+	m_NodePtr.clear();
+	m_NodeByID.clear();
+	m_NodeByPtr.clear();
+	m_NodeTree.Clear();
+	m_Links.clear();
+	m_LinkTree.Clear();
+	for (int s = 0; s < 2; s++)
+	{
+		m_EdgeStart[s].clear();
+		m_Edges[s].clear();
+	}
+	m_fMaxSpeed = 0.0f;
+}
+
+/**
+ * A typical travel speed for a link, in km/h, from its surface, lanes and
+ * highway number.  Railroads can't be driven on, so their speed is zero.
+ */
+float vtRoadGraph::DefaultSpeed(const TLink *pLink)
+{
+	switch (pLink->m_Surface)
+	{
+	case SURFT_RAILROAD:
+		return 0.0f;
+	case SURFT_TRAIL:
+		return 5.0f;
+	case SURFT_2TRACK:
+		return 20.0f;
+	case SURFT_DIRT:
+	case SURFT_STONE:
+		return 30.0f;
+	case SURFT_GRAVEL:
+		return 40.0f;
+	default:
+		break;
+	}
+	if (pLink->m_iHwy > 0)
+		return pLink->m_iLanes >= 4 ? 100.0f : 80.0f;
+	if (pLink->m_iLanes >= 4)
+		return 65.0f;
+	return 50.0f;
+}
+
+/**
+ * Build the graph from a road map.  Any previous contents are discarded.
+ *
+ * \param map The road map.  Its nodes and links must stay unchanged while
+ *		the graph is used.
+ * \param speed A function which gives the speed of each link, in km/h.
+ * \return true if the map had any nodes.
+ */
+bool vtRoadGraph::Build(vtRoadMap &map, const SpeedFunc &speed)
+{
+	Clear();
+
+	// Number the nodes
+	for (TNode *pN = map.GetFirstNode(); pN; pN = pN->GetNext())
+	{
+		const uint index = (uint) m_NodePos.size();
+		m_NodePos.push_back(pN->Pos());
+		m_NodePtr.push_back(pN);
+		m_NodeByID.insert(std::make_pair(pN->m_id, index));
+		m_NodeByPtr[pN] = index;
+	}
+	const uint num_nodes = NumNodes();
+	if (num_nodes == 0)
+		return false;
+
+	// Number the links, and find their extents
+	std::vector<DRECT> boxes;
+	DRECT extent;
+	extent.SetInsideOut();
+	for (TLink *pL = map.GetFirstLink(); pL; pL = pL->GetNext())
+	{
+		std::unordered_map<const TNode*, uint>::const_iterator it0, it1;
+		it0 = m_NodeByPtr.find(pL->GetNode(0));
+		it1 = m_NodeByPtr.find(pL->GetNode(1));
+		if (it0 == m_NodeByPtr.end() || it1 == m_NodeByPtr.end())
+			continue;
+
+		LinkInfo info;
+		info.m_pLink = pL;
+		info.m_iNode[0] = it0->second;
+		info.m_iNode[1] = it1->second;
+		m_Links.push_back(info);
+
+		DRECT box;
+		box.SetInsideOut();
+		box.GrowToContainPoint(m_NodePos[info.m_iNode[0]]);
+		box.GrowToContainPoint(m_NodePos[info.m_iNode[1]]);
+		box.GrowToContainLine(*pL);
+		boxes.push_back(box);
+		extent.GrowToContainRect(box);
+	}
+
+	// For geographic coordinates, the length of a degree of longitude is
+	//  smallest at the latitude furthest from the equator.
+	m_bGeo = (map.GetAtCRS().IsGeographic() != 0);
+	if (m_bGeo)
+	{
+		for (uint i = 0; i < num_nodes; i++)
+			extent.GrowToContainPoint(m_NodePos[i]);
+		const double lat = std::max(fabs(extent.top), fabs(extent.bottom));
+		m_dMinMetersPerLon = MetersPerLongitude(std::min(lat, 89.0));
+	}
+
+	// Lengths and travel times
+	for (uint i = 0; i < NumLinks(); i++)
+	{
+		LinkInfo &info = m_Links[i];
+		if (info.m_pLink->GetSize() >= 2)
+			info.m_fLength = (float) LineLength(*info.m_pLink);
+		else
+			info.m_fLength = (float) Distance(m_NodePos[info.m_iNode[0]], m_NodePos[info.m_iNode[1]]);
+
+		const float kmh = speed(info.m_pLink);
+		if (kmh > 0.0f)
+		{
+			const float mps = kmh / 3.6f;
+			info.m_fTime = info.m_fLength / mps;
+			if (mps > m_fMaxSpeed)
+				m_fMaxSpeed = mps;
+		}
+		else
+			info.m_fTime = -1.0f;
+	}
+
+	// Count the edges leaving [0] and arriving [1] at each node, then fill
+	//  them in.  A link with no direction flags is taken to be two-way.
+	for (int s = 0; s < 2; s++)
+		m_EdgeStart[s].assign(num_nodes + 1, 0);
+	for (int pass = 0; pass < 2; pass++)
+	{
+		std::vector<uint> fill[2];
+		if (pass == 1)
+		{
+			for (int s = 0; s < 2; s++)
+			{
+				for (uint i = 0; i < num_nodes; i++)
+					m_EdgeStart[s][i+1] += m_EdgeStart[s][i];
+				m_Edges[s].resize(m_EdgeStart[s][num_nodes]);
+				fill[s].assign(m_EdgeStart[s].begin(), m_EdgeStart[s].end() - 1);
+			}
+		}
+		for (uint i = 0; i < NumLinks(); i++)
+		{
+			const LinkInfo &info = m_Links[i];
+			if (info.m_fTime < 0.0f)
+				continue;
+			int flags = info.m_pLink->m_iFlags & (RF_FORWARD|RF_REVERSE);
+			if (flags == 0)
+				flags = RF_FORWARD|RF_REVERSE;
+			for (int dir = 0; dir < 2; dir++)
+			{
+				if (!(flags & (dir == 0 ? RF_FORWARD : RF_REVERSE)))
+					continue;
+				const uint from = info.m_iNode[dir], to = info.m_iNode[1-dir];
+				if (pass == 0)
+				{
+					m_EdgeStart[0][from+1]++;
+					m_EdgeStart[1][to+1]++;
+					continue;
+				}
+				Edge e;
+				e.m_iLink = i;
+				e.m_fTime = info.m_fTime;
+				e.m_iNode = to;
+				m_Edges[0][fill[0][from]++] = e;
+				e.m_iNode = from;
+				m_Edges[1][fill[1][to]++] = e;
+			}
+		}
+	}
+
+	// Spatial indices
+	m_LinkTree.Build(boxes);
+	boxes.resize(num_nodes);
+	for (uint i = 0; i < num_nodes; i++)
+	{
+		const DPoint2 &p = m_NodePos[i];
+		boxes[i].SetRect(p.x, p.y, p.x, p.y);
+	}
+	m_NodeTree.Build(boxes);
+
+	VTLOG("vtRoadGraph: %d nodes, %d links, %d forward edges\n", num_nodes,
+		NumLinks(), (int) m_Edges[0].size());
+	return true;
+}
+
+/**
+ * Find a node by its ID, as read from a file.
+ * \return The node's index, or -1 if there is no such node.
+ */
+int vtRoadGraph::FindNodeByID(int id) const
+{
+	std::unordered_map<int, uint>::const_iterator it = m_NodeByID.find(id);
+	return (it == m_NodeByID.end()) ? -1 : (int) it->second;
+}
+
+/**
+ * Find the index of a node of the road map.
+ * \return The node's index, or -1 if it isn't in the graph.
+ */
+int vtRoadGraph::FindNode(const TNode *pNode) const
+{
+	std::unordered_map<const TNode*, uint>::const_iterator it = m_NodeByPtr.find(pNode);
+	return (it == m_NodeByPtr.end()) ? -1 : (int) it->second;
+}
+
+/**
+ * Find the node closest to a point.
+ *
+ * \param p The point.
+ * \param dMaxDist Ignore nodes further than this, in the units of the
+ *		road map's CRS.
+ * \return The node's index, or -1 if none was found.
+ */
+int vtRoadGraph::FindNearestNode(const DPoint2 &p, double dMaxDist) const
+{
+	return m_NodeTree.FindNearest(p, dMaxDist,
+		[this](int i, const DPoint2 &q) { return (m_NodePos[i] - q).Length(); });
+}
+
+/**
+ * Find the link closest to a point.
+ *
+ * \param p The point.
+ * \param dMaxDist Ignore links further than this, in the units of the
+ *		road map's CRS.
+ * \param pDistance If not NULL, receives the distance to the link.
+ * \return The link's index, or -1 if none was found.
+ */
+int vtRoadGraph::FindNearestLink(const DPoint2 &p, double dMaxDist, double *pDistance) const
+{
+	return m_LinkTree.FindNearest(p, dMaxDist,
+		[this](int i, const DPoint2 &q) { return m_Links[i].m_pLink->DistanceToPoint(q); },
+		pDistance);
+}
+
+/// Find all the links whose extents overlap a rectangle.
+void vtRoadGraph::FindLinks(const DRECT &rect, std::vector<int> &links) const
+{
+	links.clear();
+	m_LinkTree.FindOverlapping(rect, links);
+}
+
+/// Distance in meters between two points.
+double vtRoadGraph::Distance(const DPoint2 &p1, const DPoint2 &p2) const
+{
+	if (!m_bGeo)
+		return (p2 - p1).Length();
+	const double dx = (p2.x - p1.x) * MetersPerLongitude((p1.y + p2.y) / 2);
+	const double dy = (p2.y - p1.y) * METERS_PER_LATITUDE;
+	return sqrt(dx*dx + dy*dy);
+}
+
+/// Length of a line in meters.
+double vtRoadGraph::LineLength(const DLine2 &line) const
+{
+	double length = 0.0;
+	for (uint i = 1; i < line.GetSize(); i++)
+		length += Distance(line[i-1], line[i]);
+	return length;
+}
+
+/// A lower bound on the time to travel from a node to another, in seconds.
+double vtRoadGraph::Heuristic(uint iNode, uint iTo) const
+{
+	if (m_fMaxSpeed <= 0.0f)
+		return 0.0;
+	const DPoint2 &p1 = m_NodePos[iNode], &p2 = m_NodePos[iTo];
+	double dx = p2.x - p1.x, dy = p2.y - p1.y;
+	if (m_bGeo)
+	{
+		dx *= m_dMinMetersPerLon;
+		dy *= METERS_PER_LATITUDE;
+	}
+	return sqrt(dx*dx + dy*dy) / m_fMaxSpeed;
+}
+
+void vtRoadGraph::Search::Reset(uint iNumNodes)
+{
+	m_iStamp++;
+	for (int s = 0; s < 2; s++)
+	{
+		if (m_Reached[s].size() != iNumNodes || m_iStamp == 0)
+		{
+			m_Reached[s].assign(iNumNodes, 0);
+			m_Settled[s].assign(iNumNodes, 0);
+			m_Cost[s].resize(iNumNodes);
+			m_Prev[s].resize(iNumNodes);
+			m_Link[s].resize(iNumNodes);
+		}
+	}
+	if (m_iStamp == 0)
+		m_iStamp = 1;
+}
+
+/**
+ * Find the fastest route between two nodes.
+ *
+ * \param iFrom, iTo The start and end nodes.
+ * \param route Receives the route.
+ * \param method Which search to use.  Both find the fastest route; which
+ *		is quicker depends on the network.
+ * \return true if there is a route.
+ */
+bool vtRoadGraph::FindRoute(uint iFrom, uint iTo, Route &route, RouteMethod method) const
+{
+	Search search;
+	return FindRoute(iFrom, iTo, route, method, search);
+}
+
+/**
+ * Find the fastest route between two nodes, using the given working memory.
+ */
+bool vtRoadGraph::FindRoute(uint iFrom, uint iTo, Route &route, RouteMethod method,
+	Search &search) const
+{
+	route.m_Nodes.clear();
+	route.m_Links.clear();
+	route.m_dTime = route.m_dLength = 0.0;
+	if (iFrom >= NumNodes() || iTo >= NumNodes())
+		return false;
+
+	search.Reset(NumNodes());
+	uint meet = iTo;
+	bool found;
+	if (method == ROUTE_BIDIJKSTRA)
+		found = BiDijkstra(iFrom, iTo, search, meet);
+	else
+		found = AStar(iFrom, iTo, search);
+	if (!found)
+		return false;
+
+	// Walk back from the meeting point to the start, then forward to the end
+	for (uint n = meet; n != iFrom; n = search.m_Prev[0][n])
+	{
+		route.m_Nodes.push_back(n);
+		route.m_Links.push_back(search.m_Link[0][n]);
+	}
+	route.m_Nodes.push_back(iFrom);
+	std::reverse(route.m_Nodes.begin(), route.m_Nodes.end());
+	std::reverse(route.m_Links.begin(), route.m_Links.end());
+	if (method == ROUTE_BIDIJKSTRA)
+	{
+		for (uint n = meet; n != iTo; )
+		{
+			route.m_Links.push_back(search.m_Link[1][n]);
+			n = search.m_Prev[1][n];
+			route.m_Nodes.push_back(n);
+		}
+	}
+	for (uint i = 0; i < route.m_Links.size(); i++)
+	{
+		route.m_dTime += m_Links[route.m_Links[i]].m_fTime;
+		route.m_dLength += m_Links[route.m_Links[i]].m_fLength;
+	}
+	return true;
+}
+
+bool vtRoadGraph::AStar(uint iFrom, uint iTo, Search &search) const
+{
+	const uint stamp = search.m_iStamp;
+	std::vector<uint> &reached = search.m_Reached[0];
+	std::vector<uint> &settled = search.m_Settled[0];
+	std::vector<double> &cost = search.m_Cost[0];
+
+	RouteQueue queue;
+	reached[iFrom] = stamp;
+	cost[iFrom] = 0.0;
+	queue.push(RouteQueueEntry(Heuristic(iFrom, iTo), iFrom));
+
+	while (!queue.empty())
+	{
+		const uint u = queue.top().second;
+		queue.pop();
+		if (settled[u] == stamp)
+			continue;		// an old entry, since superseded
+		settled[u] = stamp;
+		if (u == iTo)
+			return true;
+
+		for (uint e = m_EdgeStart[0][u]; e < m_EdgeStart[0][u+1]; e++)
+		{
+			const Edge &edge = m_Edges[0][e];
+			const uint v = edge.m_iNode;
+			const double c = cost[u] + edge.m_fTime;
+			if (settled[v] == stamp || (reached[v] == stamp && c >= cost[v]))
+				continue;
+			reached[v] = stamp;
+			cost[v] = c;
+			search.m_Prev[0][v] = u;
+			search.m_Link[0][v] = edge.m_iLink;
+			queue.push(RouteQueueEntry(c + Heuristic(v, iTo), v));
+		}
+	}
+	return false;
+}
+
+bool vtRoadGraph::BiDijkstra(uint iFrom, uint iTo, Search &search, uint &iMeet) const
+{
+	const uint stamp = search.m_iStamp;
+	RouteQueue queue[2];
+	const uint start[2] = { iFrom, iTo };
+	for (int s = 0; s < 2; s++)
+	{
+		search.m_Reached[s][start[s]] = stamp;
+		search.m_Cost[s][start[s]] = 0.0;
+		queue[s].push(RouteQueueEntry(0.0, start[s]));
+	}
+	double best = -1.0;
+	if (iFrom == iTo)
+	{
+		iMeet = iFrom;
+		return true;
+	}
+
+	while (!queue[0].empty() && !queue[1].empty())
+	{
+		// Once the two frontiers together are as costly as the best route
+		//  found, there can be no better one.
+		if (best >= 0.0 && queue[0].top().first + queue[1].top().first >= best)
+			break;
+
+		// Advance the side with the smaller frontier cost
+		const int s = (queue[0].top().first <= queue[1].top().first) ? 0 : 1;
+		const int o = 1 - s;
+		const uint u = queue[s].top().second;
+		queue[s].pop();
+		if (search.m_Settled[s][u] == stamp)
+			continue;
+		search.m_Settled[s][u] = stamp;
+
+		for (uint e = m_EdgeStart[s][u]; e < m_EdgeStart[s][u+1]; e++)
+		{
+			const Edge &edge = m_Edges[s][e];
+			const uint v = edge.m_iNode;
+			const double c = search.m_Cost[s][u] + edge.m_fTime;
+			if (search.m_Reached[s][v] != stamp || c < search.m_Cost[s][v])
+			{
+				search.m_Reached[s][v] = stamp;
+				search.m_Cost[s][v] = c;
+				search.m_Prev[s][v] = u;
+				search.m_Link[s][v] = edge.m_iLink;
+				queue[s].push(RouteQueueEntry(c, v));
+			}
+			if (search.m_Reached[o][v] == stamp)
+			{
+				const double total = search.m_Cost[s][v] + search.m_Cost[o][v];
+				if (best < 0.0 || total < best)
+				{
+					best = total;
+					iMeet = v;
+				}
+			}
+		}
+	}
+	return best >= 0.0;
+}
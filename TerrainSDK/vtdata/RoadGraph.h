@@ -0,0 +1,153 @@
+//
+// RoadGraph.h
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef VTDATA_ROADGRAPH_H
+#define VTDATA_ROADGRAPH_H
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "RoadMap.h"
+#include "RTree.h"
+
+/**
+ * A compact, read-only copy of the topology of a vtRoadMap, for fast
+ * queries and routing on large networks.
+ *
+ * Nodes and links are numbered from 0, and stored in flat arrays.  The
+ * links leaving each node are stored together in one array (compressed
+ * sparse rows), once for travel forward and once in reverse, so a search
+ * touches very little memory.  Node IDs are hashed, and the links have an
+ * R-tree, so finding a node or link is fast too.
+ *
+ * The graph is built from a vtRoadMap in one step, and doesn't change.
+ * When the road map is edited, build it again.  It refers to the TNode and
+ * TLink objects of the road map, so they must not be deleted while the
+ * graph is in use.  All the query methods are const, and many threads may
+ * use the graph at once.
+ */
+class vtRoadGraph
+{
+public:
+	/// A function which gives the travel speed on a link, in km/h.  A link
+	///  with a speed of zero or less can't be travelled.
+	typedef std::function<float(const TLink *pLink)> SpeedFunc;
+
+	vtRoadGraph();
+
+	void Clear();
+	bool Build(vtRoadMap &map, const SpeedFunc &speed = DefaultSpeed);
+	static float DefaultSpeed(const TLink *pLink);
+
+	uint NumNodes() const { return (uint) m_NodePos.size(); }
+	uint NumLinks() const { return (uint) m_Links.size(); }
+
+	const DPoint2 &GetNodePos(uint iNode) const { return m_NodePos[iNode]; }
+	TNode *GetNode(uint iNode) const { return m_NodePtr[iNode]; }
+	TLink *GetLink(uint iLink) const { return m_Links[iLink].m_pLink; }
+	/// The node at one end (0 or 1) of a link.
+	uint GetLinkNode(uint iLink, int n) const { return m_Links[iLink].m_iNode[n]; }
+	/// The length of a link, in meters.
+	float GetLinkLength(uint iLink) const { return m_Links[iLink].m_fLength; }
+
+	int FindNodeByID(int id) const;
+	int FindNode(const TNode *pNode) const;
+	int FindNearestNode(const DPoint2 &p, double dMaxDist) const;
+	int FindNearestLink(const DPoint2 &p, double dMaxDist, double *pDistance = NULL) const;
+	void FindLinks(const DRECT &rect, std::vector<int> &links) const;
+
+	/// A path through the network.
+	struct Route
+	{
+		std::vector<uint> m_Nodes;	// from start to end
+		std::vector<uint> m_Links;	// one less than the nodes
+		double m_dTime;				// seconds
+		double m_dLength;			// meters
+	};
+	enum RouteMethod
+	{
+		ROUTE_ASTAR,		// A* search from the start
+		ROUTE_BIDIJKSTRA	// Dijkstra's search from both ends at once
+	};
+
+	/**
+	 * The working memory of a route search.  A caller which finds many
+	 * routes can keep one of these and pass it each time, to avoid
+	 * allocating it again.  Each thread needs its own.
+	 */
+	class Search
+	{
+	public:
+		Search() : m_iStamp(0) {}
+	protected:
+		friend class vtRoadGraph;
+		void Reset(uint iNumNodes);
+
+		// Each array is indexed by node, once for the search forward from the
+		//  start [0] and once for the search back from the end [1].  Rather
+		//  than clear them for each search, entries are marked with a stamp.
+		uint m_iStamp;
+		std::vector<uint> m_Reached[2];	// stamp if the node has been reached
+		std::vector<uint> m_Settled[2];	// stamp if the node's cost is final
+		std::vector<double> m_Cost[2];	// best cost to each node so far
+		std::vector<uint> m_Prev[2];	// the node it was reached from
+		std::vector<uint> m_Link[2];	// the link it was reached by
+	};
+
+	bool FindRoute(uint iFrom, uint iTo, Route &route,
+		RouteMethod method = ROUTE_ASTAR) const;
+	bool FindRoute(uint iFrom, uint iTo, Route &route, RouteMethod method,
+		Search &search) const;
+
+protected:
+	struct LinkInfo
+	{
+		TLink *m_pLink;
+		uint m_iNode[2];
+		float m_fLength;	// meters
+		float m_fTime;		// seconds, or negative if impassable
+	};
+	struct Edge
+	{
+		uint m_iNode;		// the node at the other end
+		uint m_iLink;
+		float m_fTime;
+	};
+
+	double Distance(const DPoint2 &p1, const DPoint2 &p2) const;
+	double LineLength(const DLine2 &line) const;
+	double Heuristic(uint iNode, uint iTo) const;
+
+	bool AStar(uint iFrom, uint iTo, Search &search) const;
+	bool BiDijkstra(uint iFrom, uint iTo, Search &search, uint &iMeet) const;
+
+	// Nodes
+	std::vector<DPoint2> m_NodePos;
+	std::vector<TNode*> m_NodePtr;
+	std::unordered_map<int, uint> m_NodeByID;
+	std::unordered_map<const TNode*, uint> m_NodeByPtr;
+	vtRTree m_NodeTree;
+
+	// Links
+	std::vector<LinkInfo> m_Links;
+	vtRTree m_LinkTree;
+
+	// Edges leaving each node [0], and arriving at each node [1], in
+	//  compressed sparse rows: the edges of node i are from m_EdgeStart[i]
+	//  to m_EdgeStart[i+1].
+	std::vector<uint> m_EdgeStart[2];
+	std::vector<Edge> m_Edges[2];
+
+	// For geographic coordinates, the scale from degrees to meters.  For the
+	//  A* heuristic, the smallest scale is used, so it never overestimates.
+	bool m_bGeo;
+	double m_dMinMetersPerLon;
+	float m_fMaxSpeed;	// meters per second
+};
+
+#endif // VTDATA_ROADGRAPH_H
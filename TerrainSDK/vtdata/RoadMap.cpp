@@ -8,9 +8,12 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
+#include <string.h>
 #include "RoadMap.h"
 #include "vtLog.h"
 #include "FilePath.h"
+#include "MappedFile.h"
+#include "Parallel.h"
 
 #define intSize 4
 #define floatSize 4
@@ -507,6 +510,8 @@ vtRoadMap::vtRoadMap()
 
 	m_pFirstLink = NULL;
 	m_pFirstNode = NULL;
+	m_dFileVersion = 0;
+	m_iEditCount = 0;
 }
 
 
@@ -532,6 +537,7 @@ void vtRoadMap::DeleteElements()
 		delete m_pFirstNode;
 		m_pFirstNode = nextN;
 	}
+	m_iEditCount++;
 }
 
 TNode *vtRoadMap::FindNodeByID(int id)
@@ -667,6 +673,7 @@ void vtRoadMap::RemoveNode(TNode *pNode)
 			else
 				m_pFirstNode = next;
 			delete pN;
+			m_iEditCount++;
 			break;
 		}
 		else
@@ -694,6 +701,7 @@ void vtRoadMap::RemoveLink(TLink *pLink)
 			else
 				m_pFirstLink = next;
 			delete pL;
+			m_iEditCount++;
 			break;
 		}
 		else
@@ -746,6 +754,13 @@ bool vtRoadMap::ReadRMF(const char *filename)
 		fclose(fp);
 		return false;
 	}
+	m_dFileVersion = version;
+	if (version >= 3.0)
+	{
+		// The binary format is read all at once
+		fclose(fp);
+		return ReadRMF3(filename);
+	}
 
 	// Erasing existing network
 	DeleteElements();
@@ -975,133 +990,276 @@ bool vtRoadMap::ReadRMF(const char *filename)
 	return true;
 }
 
+/////////////////////////////////////////////////////////////////////////////
+// RMF version 3
 //
-// returns true if operation sucessful.
+// Everything is in a few contiguous arrays, so the file can be read with no
+// parsing at all.  After the header come these sections, in order, each
+// starting on an 8-byte boundary:
 //
-bool vtRoadMap::WriteRMF(const char *filename)
+//  CRS		the WKT of the CRS, m_iWKTLength bytes
+//  Nodes	the position of each node, as two doubles
+//  Links	an RMF3Link for each link
+//  Points	the points of all the links, as two doubles
+//
+// Node and link IDs are implicit: the index in the file, plus one.  The
+// intersection type at each end is stored with the link, rather than in a
+// separate section of traffic information.
+
+struct RMF3Header
+{
+	char	m_Magic[16];	// RMFVERSION_STRING, padded with zeros
+	int		m_iNumNodes;
+	int		m_iNumLinks;
+	uint	m_iNumPoints;
+	int		m_iWKTLength;
+	double	m_Extents[4];	// left, right, bottom, top
+};
+
+struct RMF3Link
+{
+	int		m_iNode[2];		// indices of the nodes
+	uint	m_iFirstPoint;	// index into the points
+	uint	m_iNumPoints;
+	int		m_iHwy;
+	int		m_iLanes;
+	int		m_iSurface;
+	int		m_iFlags;
+	int		m_iIntersection[2];
+	float	m_fSidewalkWidth;
+	float	m_fCurbHeight;
+	float	m_fMarginWidth;
+	float	m_fLaneWidth;
+	float	m_fParkingWidth;
+	float	m_fReserved;
+};
+
+static size_t RMF3Align(size_t offset)
 {
-	int i;
+	return (offset + 7) & ~(size_t)7;
+}
 
-	TNode *curNode = GetFirstNode();
-	TLink *curLink = GetFirstLink();
-	int numNodes = NumNodes();
-	int numLinks = NumLinks();
+bool vtRoadMap::ReadRMF3(const char *filename)
+{
+	vtMappedFile file;
+	if (!file.Open(filename) || file.GetSize() < sizeof(RMF3Header))
+		return false;
 
-	// must have nodes, or saving will fail
-	if (numNodes == 0)
+	RMF3Header header;
+	memcpy(&header, file.GetData(), sizeof(header));
+	if (header.m_iNumNodes < 0 || header.m_iNumLinks < 0 || header.m_iWKTLength < 0)
 		return false;
 
-	FILE *fp = vtFileOpen(filename, "wb");
-	if (!fp)
+	// Find the sections, and check they all fit in the file
+	const size_t crs_offset = sizeof(RMF3Header);
+	const size_t node_offset = RMF3Align(crs_offset + header.m_iWKTLength);
+	const size_t link_offset = node_offset + (size_t) header.m_iNumNodes * sizeof(DPoint2);
+	const size_t point_offset = link_offset + (size_t) header.m_iNumLinks * sizeof(RMF3Link);
+	const size_t end = point_offset + (size_t) header.m_iNumPoints * sizeof(DPoint2);
+	if (end > file.GetSize())
 	{
-		// wxString str = wxString::Format("Error opening file: %s", filename);
+		VTLOG1("RMF file is truncated.\n");
 		return false;
 	}
+	const uchar *data = file.GetData();
 
-	// go through and set id numbers (1-based) for the nodes and links
-	i= 1;
-	while (curNode) {
-		curNode->m_id = i++;
-		curNode = curNode->GetNext();
+	// Projection
+	std::vector<char> wkt_buf(header.m_iWKTLength + 1, 0);
+	memcpy(wkt_buf.data(), data + crs_offset, header.m_iWKTLength);
+	char *wkt = wkt_buf.data();
+	OGRErr err = m_crs.importFromWkt(&wkt);
+	if (err != OGRERR_NONE)
+		return false;
+
+	// Erasing existing network
+	DeleteElements();
+
+	m_extents.left = header.m_Extents[0];
+	m_extents.right = header.m_Extents[1];
+	m_extents.bottom = header.m_Extents[2];
+	m_extents.top = header.m_Extents[3];
+	m_bValidExtents = true;
+
+	// Nodes
+	const int numNodes = header.m_iNumNodes, numLinks = header.m_iNumLinks;
+	std::vector<TNode*> nodes(numNodes);
+	std::vector<DPoint2> node_pos(numNodes);
+	if (numNodes)
+		memcpy(node_pos.data(), data + node_offset, numNodes * sizeof(DPoint2));
+	for (int i = 0; i < numNodes; i++)
+	{
+		nodes[i] = NewNode();
+		nodes[i]->m_id = i + 1;
+		nodes[i]->SetPos(node_pos[i]);
 	}
-	i=1;
-	while (curLink) {
-		curLink->m_id = i++;
-		curLink = curLink->GetNext();
+
+	// Links: check them all first, so we never build half a network
+	std::vector<RMF3Link> records(numLinks);
+	if (numLinks)
+		memcpy(records.data(), data + link_offset, numLinks * sizeof(RMF3Link));
+	bool bad = false;
+	for (int i = 0; i < numLinks && !bad; i++)
+	{
+		const RMF3Link &rec = records[i];
+		if (rec.m_iNode[0] < 0 || rec.m_iNode[0] >= numNodes ||
+			rec.m_iNode[1] < 0 || rec.m_iNode[1] >= numNodes ||
+			rec.m_iFirstPoint > header.m_iNumPoints ||
+			rec.m_iNumPoints > header.m_iNumPoints - rec.m_iFirstPoint)
+			bad = true;
+	}
+	if (bad)
+	{
+		VTLOG1("RMF file has bad link records.\n");
+		for (int i = 0; i < numNodes; i++)
+			delete nodes[i];
+		return false;
 	}
 
-	curNode = GetFirstNode();
-	curLink = GetFirstLink();
+	// The links and their points are independent, so fill them in parallel
+	std::vector<TLink*> links(numLinks);
+	for (int i = 0; i < numLinks; i++)
+		links[i] = NewLink();
+	const uchar *points = data + point_offset;
+	vtParallelFor(numLinks, [&](int i)
+	{
+		const RMF3Link &rec = records[i];
+		TLink *pL = links[i];
+		pL->m_id = i + 1;
+		pL->m_iHwy = (short) rec.m_iHwy;
+		pL->m_iLanes = (unsigned short) rec.m_iLanes;
+		pL->m_Surface = (SurfaceType) rec.m_iSurface;
+		pL->m_iFlags = (short) rec.m_iFlags;
+		pL->m_fSidewalkWidth = rec.m_fSidewalkWidth;
+		pL->m_fCurbHeight = rec.m_fCurbHeight;
+		pL->m_fMarginWidth = rec.m_fMarginWidth;
+		pL->m_fLaneWidth = rec.m_fLaneWidth;
+		pL->m_fParkingWidth = rec.m_fParkingWidth;
+		pL->SetSize(rec.m_iNumPoints);
+		if (rec.m_iNumPoints)
+			memcpy(pL->GetData(), points + (size_t) rec.m_iFirstPoint * sizeof(DPoint2),
+				rec.m_iNumPoints * sizeof(DPoint2));
+	});
+
+	// Connect them, in the order of the file, so that the links at each node
+	//  are in the same order as when they were written.
+	for (int i = 0; i < numLinks; i++)
+	{
+		const RMF3Link &rec = records[i];
+		TLink *pL = links[i];
+		pL->ConnectNodes(nodes[rec.m_iNode[0]], nodes[rec.m_iNode[1]]);
+		pL->SetIntersectionType(0, (IntersectionType) rec.m_iIntersection[0]);
+		pL->SetIntersectionType(1, (IntersectionType) rec.m_iIntersection[1]);
+	}
 
-	FWrite(RMFVERSION_STRING, 11);
+	// Add to our lists, backwards, so they keep the order of the file
+	for (int i = numNodes - 1; i >= 0; i--)
+		AddNode(nodes[i]);
+	for (int i = numLinks - 1; i >= 0; i--)
+		AddLink(links[i]);
+
+	VTLOG("Read %d nodes, %d links, %d points.\n", numNodes, numLinks,
+		header.m_iNumPoints);
+	return true;
+}
+
+/**
+ * Write the road map to an RMF file, of the current version (3), which is
+ * binary and very fast to read.  Older files are upgraded when saved.
+ *
+ * \return true if successful.
+ */
+bool vtRoadMap::WriteRMF(const char *filename)
+{
+	int numNodes = NumNodes();
+	int numLinks = NumLinks();
+
+	// must have nodes, or saving will fail
+	if (numNodes == 0)
+		return false;
+
+	// go through and set id numbers (1-based) for the nodes and links
+	int i = 1;
+	for (TNode *curNode = GetFirstNode(); curNode; curNode = curNode->GetNext())
+		curNode->m_id = i++;
+	i = 1;
+	for (TLink *curLink = GetFirstLink(); curLink; curLink = curLink->GetNext())
+		curLink->m_id = i++;
 
 	// Projection
 	char *wkt;
 	OGRErr err = m_crs.exportToWkt(&wkt);
 	if (err != OGRERR_NONE)
 		return false;
-	short len = (short) strlen(wkt);
-	FWrite(&len, 4);
-	FWrite(wkt, len);
+	vtString strWKT = wkt;
 	OGRFree(wkt);
 
-	// Extents
-	FWrite(&m_extents.left, doubleSize);
-	FWrite(&m_extents.right, doubleSize);
-	FWrite(&m_extents.bottom, doubleSize);
-	FWrite(&m_extents.top, doubleSize);
-	FWrite(&numNodes, intSize);  // number of nodes
-	FWrite(&numLinks, intSize);  // number of links
-	FWrite("Nodes:",7);
-	//write nodes
-	while (curNode)
+	// Gather everything into arrays
+	std::vector<DPoint2> node_pos;
+	node_pos.reserve(numNodes);
+	for (TNode *curNode = GetFirstNode(); curNode; curNode = curNode->GetNext())
+		node_pos.push_back(curNode->Pos());
+
+	std::vector<RMF3Link> records(numLinks);
+	uint numPoints = 0;
+	i = 0;
+	for (TLink *curLink = GetFirstLink(); curLink; curLink = curLink->GetNext(), i++)
 	{
-		FWrite(&(curNode->m_id), intSize);		// id
-		FWrite(&curNode->Pos().x, doubleSize);	// coordinate
-		FWrite(&curNode->Pos().y, doubleSize);
-		curNode = curNode->GetNext();
+		RMF3Link &rec = records[i];
+		memset(&rec, 0, sizeof(rec));
+		rec.m_iNode[0] = curLink->GetNode(0)->m_id - 1;
+		rec.m_iNode[1] = curLink->GetNode(1)->m_id - 1;
+		rec.m_iFirstPoint = numPoints;
+		rec.m_iNumPoints = curLink->GetSize();
+		rec.m_iHwy = curLink->m_iHwy;
+		rec.m_iLanes = curLink->m_iLanes;
+		rec.m_iSurface = curLink->m_Surface;
+		rec.m_iFlags = curLink->m_iFlags;
+		rec.m_iIntersection[0] = curLink->GetIntersectionType(0);
+		rec.m_iIntersection[1] = curLink->GetIntersectionType(1);
+		rec.m_fSidewalkWidth = curLink->m_fSidewalkWidth;
+		rec.m_fCurbHeight = curLink->m_fCurbHeight;
+		rec.m_fMarginWidth = curLink->m_fMarginWidth;
+		rec.m_fLaneWidth = curLink->m_fLaneWidth;
+		rec.m_fParkingWidth = curLink->m_fParkingWidth;
+		numPoints += rec.m_iNumPoints;
 	}
-	FWrite("Roads:",7);
-	//write links
-	while (curLink)
-	{
-		float fWidth = curLink->GetTotalWidth();
-		FWrite(&(curLink->m_id), intSize);			//id
-		FWrite(&(curLink->m_iHwy), 4);				//highway number
-		FWrite(&(fWidth), floatSize);				//width
-		FWrite(&(curLink->m_iLanes), 4);			//number of lanes
-		FWrite(&(curLink->m_Surface), 4);			//surface type
-		FWrite(&(curLink->m_iFlags), 4);			//FLAG
-		FWrite(&(curLink->m_fSidewalkWidth), floatSize);	// sidewalk width
-		FWrite(&(curLink->m_fCurbHeight), floatSize);	// curb height
-		FWrite(&(curLink->m_fMarginWidth), floatSize);	// margin width
-		FWrite(&(curLink->m_fLaneWidth), floatSize);	// lane width width
-		FWrite(&(curLink->m_fParkingWidth), floatSize);	// parking width
-
-		int size = curLink->GetSize();
-		FWrite(&size, intSize);//number of coordinates making the link
-		for (i = 0; i < size; i++)
-		{
-			//coordinates that make the link
-			FWrite(&curLink->GetAt(i).x, doubleSize);
-			FWrite(&curLink->GetAt(i).y, doubleSize);
-		}
-		//nodes (endpoints)
-		FWrite(&(curLink->GetNode(0)->m_id), intSize);	//what link is at the end point?
-		FWrite(&(curLink->GetNode(1)->m_id), intSize);
 
-		curLink = curLink->GetNext();
-	}
+	RMF3Header header;
+	memset(&header, 0, sizeof(header));
+	strcpy(header.m_Magic, RMFVERSION_STRING);
+	header.m_iNumNodes = numNodes;
+	header.m_iNumLinks = numLinks;
+	header.m_iNumPoints = numPoints;
+	header.m_iWKTLength = strWKT.GetLength();
+	header.m_Extents[0] = m_extents.left;
+	header.m_Extents[1] = m_extents.right;
+	header.m_Extents[2] = m_extents.bottom;
+	header.m_Extents[3] = m_extents.top;
 
-	int dummy = 0;
+	FILE *fp = vtFileOpen(filename, "wb");
+	if (!fp)
+		return false;
 
-	//write traffic control information
-	FWrite("Traffic:",9);
-	curNode = GetFirstNode();
-	while (curNode)
+	const char zeros[8] = { 0 };
+	const size_t crs_end = sizeof(RMF3Header) + header.m_iWKTLength;
+	bool ok = (FWrite(&header, sizeof(header)) == 1);
+	if (header.m_iWKTLength)
+		ok = ok && (FWrite((const char *) strWKT, header.m_iWKTLength) == 1);
+	if (RMF3Align(crs_end) > crs_end)
+		ok = ok && (FWrite(zeros, RMF3Align(crs_end) - crs_end) == 1);
+	ok = ok && (FWrite(node_pos.data(), numNodes * sizeof(DPoint2)) == 1);
+	if (numLinks)
+		ok = ok && (FWrite(records.data(), numLinks * sizeof(RMF3Link)) == 1);
+
+	// The points of each link, in order
+	for (TLink *curLink = GetFirstLink(); curLink && ok; curLink = curLink->GetNext())
 	{
-		// safety check
-		if (curNode->m_id < 1 || curNode->m_id > numNodes)
-			return false;
-
-		int num_links = curNode->NumLinks();
-		FWrite(&(curNode->m_id), intSize);	//node ID
-		FWrite(&(dummy), intSize); //node traffic behavior
-		FWrite(&(num_links), intSize); //node traffic behavior
-		for (i = 0; i < num_links; i++) {
-			IntersectionType type = curNode->GetIntersectType(i);
-			int lStatus = 0;
-			FWrite(&(curNode->GetLink(i)->m_id), intSize);  //link ID
-			FWrite(&type, intSize);  //get the intersection type associated with that link
-			FWrite(&lStatus,intSize);
-		}
-		curNode = curNode->GetNext();
+		if (curLink->GetSize())
+			ok = (FWrite(curLink->GetData(), curLink->GetSize() * sizeof(DPoint2)) == 1);
 	}
-
-	//EOF
-	FWrite("End RMF", 8);
 	fclose(fp);
-
-	return true;
+	if (ok)
+		m_dFileVersion = RMFVERSION_CURRENT;
+	return ok;
 }
 
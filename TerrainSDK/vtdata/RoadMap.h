@@ -10,8 +10,8 @@
 
 #include "DLG.h"
 
-#define RMFVERSION_STRING "RMFFile2.0"
-#define RMFVERSION_CURRENT 2.0
+#define RMFVERSION_STRING "RMFFile3.0"
+#define RMFVERSION_CURRENT 3.0
 #define RMFVERSION_SUPPORTED 1.7	// oldest supported version
 
 enum SurfaceType {
@@ -251,11 +251,13 @@ public:
 	{
 		pNode->SetNext(m_pFirstNode);
 		m_pFirstNode = pNode;
+		m_iEditCount++;
 	}
 	void AddLink(TLink *pLink)
 	{
 		pLink->SetNext(m_pFirstLink);
 		m_pFirstLink = pLink;
+		m_iEditCount++;
 	}
 
 	virtual TNode *AddNewNode()
@@ -279,6 +281,13 @@ public:
 		pLink->GetNode(1)->DetachLink(pLink);
 	}
 
+	/// A count of the changes to the map's nodes and links, so anything
+	///  derived from their geometry can tell whether it is still up to date.
+	///  Adding and removing counts itself; call SetEdited after moving
+	///  nodes or changing the points of links in place.
+	unsigned int GetEditCount() const { return m_iEditCount; }
+	void SetEdited() { m_iEditCount++; m_bValidExtents = false; }
+
 	TNode *FindNodeByID(int id);
 	TNode *FindNodeAtPoint(const DPoint2 &point, double epsilon);
 
@@ -287,6 +296,8 @@ public:
 
 	bool ReadRMF(const char *filename);
 	bool WriteRMF(const char *filename);
+	/// The version of the RMF file last read or written, or 0 if none.
+	double GetFileVersion() const { return m_dFileVersion; }
 
 	vtCRS &GetAtCRS() { return m_crs; }
 
@@ -298,6 +309,10 @@ protected:
 	TNode	*m_pFirstNode;
 
 	vtCRS	m_crs;
+	double	m_dFileVersion;
+	unsigned int m_iEditCount;
+
+	bool ReadRMF3(const char *filename);
 };
 
 #endif	// ROADMAPH
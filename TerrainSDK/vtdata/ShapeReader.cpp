@@ -0,0 +1,288 @@
+//
+// ShapeReader.cpp
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include <stdint.h>
+#include <string.h>
+
+#include "ShapeReader.h"
+#include "FilePath.h"
+#include "vtLog.h"
+#include "shapelib/shapefil.h"
+
+// The Shapefile format mixes big-endian and little-endian values, so read
+//  them byte by byte, which also avoids any alignment issues.
+static int GetBE32(const uchar *p)
+{
+	return (int) (((uint) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]);
+}
+static int GetLE32(const uchar *p)
+{
+	return (int) (p[0] | (p[1] << 8) | (p[2] << 16) | ((uint) p[3] << 24));
+}
+static double GetLEDouble(const uchar *p)
+{
+	uint64_t bits = 0;
+	for (int i = 7; i >= 0; i--)
+		bits = (bits << 8) | p[i];
+	double d;
+	memcpy(&d, &bits, sizeof(double));
+	return d;
+}
+
+#define SHP_HEADER_SIZE	100
+
+// Families of shape types
+static bool IsPointType(int type)
+{
+	return type == SHPT_POINT || type == SHPT_POINTZ || type == SHPT_POINTM;
+}
+static bool IsZType(int type)
+{
+	return type == SHPT_POINTZ || type == SHPT_ARCZ || type == SHPT_POLYGONZ ||
+		type == SHPT_MULTIPOINTZ || type == SHPT_MULTIPATCH;
+}
+
+vtShapeReader::vtShapeReader()
+{
+	m_iShapeType = SHPT_NULL;
+	m_Extent.SetInsideOut();
+}
+
+/**
+ * Open a Shapefile.
+ *
+ * \param fname_utf8 The filename of the .shp file, in UTF-8.
+ * \return true if successful.
+ */
+bool vtShapeReader::Open(const char *fname_utf8)
+{
+	m_Offsets.clear();
+	m_Lengths.clear();
+
+	if (!m_File.Open(fname_utf8))
+		return false;
+
+	const uchar *data = m_File.GetData();
+	if (m_File.GetSize() < SHP_HEADER_SIZE || GetBE32(data) != 9994)
+	{
+		VTLOG1("vtShapeReader: not a Shapefile.\n");
+		m_File.Close();
+		return false;
+	}
+	m_iShapeType = GetLE32(data + 32);
+	m_Extent.left = GetLEDouble(data + 36);
+	m_Extent.bottom = GetLEDouble(data + 44);
+	m_Extent.right = GetLEDouble(data + 52);
+	m_Extent.top = GetLEDouble(data + 60);
+
+	// Use the index file if there is one, since it lets us reach any record
+	//  without touching the others.  Otherwise, walk the records.
+	vtString base = fname_utf8;
+	base = base.Left(base.GetLength() - 4);
+	vtMappedFile shx;
+	if (!(shx.Open(base + ".shx") || shx.Open(base + ".SHX")) || !ReadIndex(shx))
+		ScanRecords();
+
+	return true;
+}
+
+bool vtShapeReader::ReadIndex(const vtMappedFile &shx)
+{
+	const uchar *data = shx.GetData();
+	const size_t size = shx.GetSize();
+	if (size < SHP_HEADER_SIZE || GetBE32(data) != 9994)
+		return false;
+
+	const uint num = (uint) ((size - SHP_HEADER_SIZE) / 8);
+	m_Offsets.resize(num);
+	m_Lengths.resize(num);
+	for (uint i = 0; i < num; i++)
+	{
+		// Both are in 16-bit words; the offset is that of the record header
+		const uchar *entry = data + SHP_HEADER_SIZE + i * 8;
+		m_Offsets[i] = (size_t) (uint) GetBE32(entry) * 2 + 8;
+		m_Lengths[i] = (uint) GetBE32(entry + 4) * 2;
+	}
+	return true;
+}
+
+void vtShapeReader::ScanRecords()
+{
+	const uchar *data = m_File.GetData();
+	const size_t size = m_File.GetSize();
+
+	m_Offsets.clear();
+	m_Lengths.clear();
+	size_t pos = SHP_HEADER_SIZE;
+	while (pos + 8 <= size)
+	{
+		const uint length = (uint) GetBE32(data + pos + 4) * 2;
+		m_Offsets.push_back(pos + 8);
+		m_Lengths.push_back(length);
+		pos += 8 + length;
+	}
+}
+
+/**
+ * Get the extent of one record without decoding it.
+ *
+ * \return false if the record is empty or invalid.
+ */
+bool vtShapeReader::GetRecordExtent(uint iRecord, DRECT &rect) const
+{
+	const size_t offset = m_Offsets[iRecord];
+	const uint length = m_Lengths[iRecord];
+	if (length < 4 || offset + length > m_File.GetSize())
+		return false;
+
+	const uchar *content = m_File.GetData() + offset;
+	const int type = GetLE32(content);
+	if (IsPointType(type) && length >= 20)
+	{
+		const double x = GetLEDouble(content + 4), y = GetLEDouble(content + 12);
+		rect.SetRect(x, y, x, y);
+		return true;
+	}
+	if (type != SHPT_NULL && !IsPointType(type) && length >= 36)
+	{
+		rect.left = GetLEDouble(content + 4);
+		rect.bottom = GetLEDouble(content + 12);
+		rect.right = GetLEDouble(content + 20);
+		rect.top = GetLEDouble(content + 28);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Make a list of records to load.
+ *
+ * \param pFilter If not NULL, only records whose extent overlaps this
+ *		rectangle are listed.  Otherwise, every record is listed.
+ * \param records Receives the record numbers, in increasing order.
+ */
+void vtShapeReader::FindRecords(const DRECT *pFilter, std::vector<uint> &records) const
+{
+	const uint num = NumRecords();
+	records.clear();
+	if (!pFilter)
+	{
+		records.resize(num);
+		for (uint i = 0; i < num; i++)
+			records[i] = i;
+		return;
+	}
+	DRECT rect;
+	for (uint i = 0; i < num; i++)
+	{
+		if (GetRecordExtent(i, rect) && rect.OverlapsRect(*pFilter))
+			records.push_back(i);
+	}
+}
+
+/**
+ * Decode the header of one record.
+ *
+ * \return false if the record is invalid.  A null shape is valid, and has
+ *		no parts or points.
+ */
+bool vtShapeReader::GetShape(uint iRecord, Shape &shape) const
+{
+	shape.m_iType = SHPT_NULL;
+	shape.m_iNumParts = shape.m_iNumPoints = 0;
+	shape.m_pParts = shape.m_pPoints = shape.m_pZ = NULL;
+
+	const size_t offset = m_Offsets[iRecord];
+	const uint length = m_Lengths[iRecord];
+	if (length < 4 || offset + length > m_File.GetSize())
+		return false;
+
+	const uchar *content = m_File.GetData() + offset;
+	shape.m_iType = GetLE32(content);
+	if (shape.m_iType == SHPT_NULL)
+		return true;
+
+	if (IsPointType(shape.m_iType))
+	{
+		if (length < 20)
+			return false;
+		shape.m_iNumPoints = 1;
+		shape.m_pPoints = content + 4;
+		if (IsZType(shape.m_iType) && length >= 28)
+			shape.m_pZ = content + 20;
+		return true;
+	}
+
+	// Multipoints have no parts
+	size_t pos;
+	if (shape.m_iType == SHPT_MULTIPOINT || shape.m_iType == SHPT_MULTIPOINTZ ||
+		shape.m_iType == SHPT_MULTIPOINTM)
+	{
+		if (length < 40)
+			return false;
+		shape.m_iNumPoints = GetLE32(content + 36);
+		pos = 40;
+	}
+	else
+	{
+		if (length < 44)
+			return false;
+		shape.m_iNumParts = GetLE32(content + 36);
+		shape.m_iNumPoints = GetLE32(content + 40);
+		pos = 44;
+	}
+	if (shape.m_iNumParts < 0 || shape.m_iNumPoints < 0)
+		return false;
+
+	// Parts (and for multipatches, part types), then points
+	shape.m_pParts = content + pos;
+	pos += (size_t) shape.m_iNumParts * 4;
+	if (shape.m_iType == SHPT_MULTIPATCH)
+		pos += (size_t) shape.m_iNumParts * 4;
+	shape.m_pPoints = content + pos;
+	pos += (size_t) shape.m_iNumPoints * 16;
+	if (pos > length)
+		return false;
+
+	// Z range, then Z values, if present
+	if (IsZType(shape.m_iType) && pos + 16 + (size_t) shape.m_iNumPoints * 8 <= length)
+		shape.m_pZ = content + pos + 16;
+
+	// Check the parts, so that users can trust them
+	for (int part = 0; part < shape.m_iNumParts; part++)
+	{
+		const int start = shape.GetPartStart(part);
+		if (start < 0 || start > shape.m_iNumPoints ||
+			(part > 0 && start < shape.GetPartStart(part-1)))
+			return false;
+	}
+	return true;
+}
+
+/// The index of the first point of a part.
+int vtShapeReader::Shape::GetPartStart(int iPart) const
+{
+	return GetLE32(m_pParts + iPart * 4);
+}
+
+/// One past the index of the last point of a part.
+int vtShapeReader::Shape::GetPartEnd(int iPart) const
+{
+	if (iPart + 1 < m_iNumParts)
+		return GetPartStart(iPart + 1);
+	return m_iNumPoints;
+}
+
+DPoint2 vtShapeReader::Shape::GetPoint(int i) const
+{
+	return DPoint2(GetLEDouble(m_pPoints + i * 16), GetLEDouble(m_pPoints + i * 16 + 8));
+}
+
+double vtShapeReader::Shape::GetZ(int i) const
+{
+	return m_pZ ? GetLEDouble(m_pZ + i * 8) : 0.0;
+}
@@ -0,0 +1,77 @@
+//
+// ShapeReader.h
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef VTDATA_SHAPEREADER_H
+#define VTDATA_SHAPEREADER_H
+
+#include <vector>
+
+#include "MathTypes.h"
+#include "MappedFile.h"
+
+/**
+ * Fast, read-only access to the geometry of a Shapefile (.shp).
+ *
+ * Unlike Shapelib, which reads and allocates one SHPObject at a time, this
+ * maps the whole file into memory and decodes records in place.  The
+ * records are independent, so several threads may decode them at once.
+ *
+ * The offsets of the records come from the index file (.shx), if there is
+ * one, so that any record can be reached without reading the others.
+ */
+class vtShapeReader
+{
+public:
+	vtShapeReader();
+
+	bool Open(const char *fname_utf8);
+
+	/// The type of the file, one of the SHPT_ values of Shapelib.
+	int GetShapeType() const { return m_iShapeType; }
+	/// The number of records in the file.
+	uint NumRecords() const { return (uint) m_Offsets.size(); }
+	/// The extent of all the geometry, from the file header.
+	const DRECT &GetExtent() const { return m_Extent; }
+
+	bool GetRecordExtent(uint iRecord, DRECT &rect) const;
+	void FindRecords(const DRECT *pFilter, std::vector<uint> &records) const;
+
+	/**
+	 * The geometry of one record.  This points directly into the mapped
+	 * file, so it is only valid while the reader is open.
+	 */
+	struct Shape
+	{
+		int m_iType;
+		int m_iNumParts;
+		int m_iNumPoints;
+
+		int GetPartStart(int iPart) const;
+		int GetPartEnd(int iPart) const;
+		DPoint2 GetPoint(int i) const;
+		double GetZ(int i) const;
+
+		const uchar *m_pParts;
+		const uchar *m_pPoints;
+		const uchar *m_pZ;		// NULL if there are no Z values
+	};
+	bool GetShape(uint iRecord, Shape &shape) const;
+
+protected:
+	bool ReadIndex(const vtMappedFile &shx);
+	void ScanRecords();
+
+	vtMappedFile m_File;
+	int m_iShapeType;
+	DRECT m_Extent;
+
+	// The position and length, in bytes, of each record's content
+	std::vector<size_t> m_Offsets;
+	std::vector<uint> m_Lengths;
+};
+
+#endif // VTDATA_SHAPEREADER_H
@@ -0,0 +1,401 @@
+//
+// TinFromGrid.cpp
+//
+// Build a simplified TIN from an elevation grid.
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include <float.h>
+#include <math.h>
+#include <unordered_map>
+
+#include "vtTin.h"
+#include "ElevationGrid.h"
+#include "Parallel.h"
+#include "vtLog.h"
+
+// The largest tile, in heixels.  Each tile is the root of a separate
+//  hierarchy, so bigger tiles allow fewer triangles over flat areas, but the
+//  grid is padded out to a whole number of tiles.
+#define RTIN_MAX_TILE	256
+
+/**
+ * The grid is covered by square tiles whose size is a power of two.  Each
+ * tile is a right-triangulated irregular network (RTIN): two right triangles,
+ * each recursively split in half at the middle of its long edge.  For every
+ * heixel which is the middle of a long edge, we store the largest vertical
+ * error that would result from not splitting there, including all the finer
+ * splits below it.  Extracting a mesh for a given error is then a simple
+ * walk down the hierarchy, and since both triangles which share an edge see
+ * the same error value, the result never has cracks.
+ */
+class RtinBuilder
+{
+public:
+	RtinBuilder(const vtElevationGrid *grid);
+
+	bool ComputeErrors(bool progress_callback(int));
+	int CountTriangles(float fMaxError) const;
+	void Emit(float fMaxError, vtTin *tin) const;
+
+	float GetMaxFiniteError() const { return m_fMaxFinite; }
+
+protected:
+	float Height(int x, int y) const
+	{
+		if (x >= m_iCols || y >= m_iRows)
+			return INVALID_ELEVATION;
+		return m_pGrid->GetFValue(x, y);
+	}
+	size_t Index(int x, int y) const { return (size_t) y * m_iWidth + x; }
+
+	float TriangleError(int ax, int ay, int bx, int by, int cx, int cy) const;
+	void LevelErrors(int ax, int ay, int bx, int by, int cx, int cy, int depth);
+	void TileErrors(int tile, int depth);
+	// A triangle can be split if its long edge, from a to b, spans more than
+	//  one heixel, so that the middle of the edge is a heixel.
+	static bool CanSplit(int ax, int ay, int bx, int by)
+	{
+		return std::max(abs(ax - bx), abs(ay - by)) > 1;
+	}
+	bool ShouldSplit(int ax, int ay, int bx, int by, int cx, int cy,
+		float fMaxError) const
+	{
+		return (CanSplit(ax, ay, bx, by) &&
+			m_Errors[Index((ax + bx) >> 1, (ay + by) >> 1)] > fMaxError);
+	}
+	bool IsValidTri(int ax, int ay, int bx, int by, int cx, int cy) const
+	{
+		return (Height(ax, ay) != INVALID_ELEVATION &&
+			Height(bx, by) != INVALID_ELEVATION &&
+			Height(cx, cy) != INVALID_ELEVATION);
+	}
+	int Count(int ax, int ay, int bx, int by, int cx, int cy, float fMaxError) const;
+	void Collect(int ax, int ay, int bx, int by, int cx, int cy, float fMaxError,
+		std::vector<int> &tris) const;
+
+	const vtElevationGrid *m_pGrid;
+	int m_iCols, m_iRows;
+	int m_iTile;				// tile size, a power of two
+	int m_iLevels;				// levels of triangles which can be split
+	int m_iTilesX, m_iTilesY;
+	int m_iWidth, m_iHeight;	// padded size in heixels
+	std::vector<float> m_Errors;
+	float m_fMaxFinite;
+};
+
+RtinBuilder::RtinBuilder(const vtElevationGrid *grid)
+{
+	m_pGrid = grid;
+	grid->GetDimensions(m_iCols, m_iRows);
+
+	const int iLargest = std::max(m_iCols, m_iRows) - 1;
+	m_iTile = 1;
+	m_iLevels = 0;
+	while (m_iTile < RTIN_MAX_TILE && m_iTile < iLargest)
+	{
+		m_iTile *= 2;
+		m_iLevels += 2;
+	}
+	m_iTilesX = std::max(1, (m_iCols - 1 + m_iTile - 1) / m_iTile);
+	m_iTilesY = std::max(1, (m_iRows - 1 + m_iTile - 1) / m_iTile);
+	m_iWidth = m_iTilesX * m_iTile + 1;
+	m_iHeight = m_iTilesY * m_iTile + 1;
+	m_fMaxFinite = 0.0f;
+}
+
+// The largest difference between the plane of a triangle and the heixels
+//  which it covers.
+float RtinBuilder::TriangleError(int ax, int ay, int bx, int by, int cx, int cy) const
+{
+	const float ha = Height(ax, ay);
+	const float hb = Height(bx, by);
+	const float hc = Height(cx, cy);
+	const int area2 = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+
+	const int xmin = std::min(ax, std::min(bx, cx));
+	const int xmax = std::max(ax, std::max(bx, cx));
+	const int ymin = std::min(ay, std::min(by, cy));
+	const int ymax = std::max(ay, std::max(by, cy));
+
+	int iValid = 0, iInvalid = 0;
+	float error = 0.0f;
+	for (int y = ymin; y <= ymax; y++)
+	{
+		for (int x = xmin; x <= xmax; x++)
+		{
+			// Barycentric coordinates, scaled by twice the area
+			const int w0 = (bx - x) * (cy - y) - (by - y) * (cx - x);
+			const int w1 = (cx - x) * (ay - y) - (cy - y) * (ax - x);
+			const int w2 = area2 - w0 - w1;
+			if (area2 > 0 ? (w0 < 0 || w1 < 0 || w2 < 0) : (w0 > 0 || w1 > 0 || w2 > 0))
+				continue;
+
+			const float h = Height(x, y);
+			if (h == INVALID_ELEVATION)
+			{
+				iInvalid++;
+				continue;
+			}
+			iValid++;
+			if (ha == INVALID_ELEVATION || hb == INVALID_ELEVATION || hc == INVALID_ELEVATION)
+				continue;
+			const float plane = (w0 * ha + w1 * hb + w2 * hc) / area2;
+			error = std::max(error, fabsf(plane - h));
+		}
+	}
+	// Where valid data meets the unknown, we must always split, so that the
+	//  edge of the data is followed exactly.
+	if (iValid != 0 && iInvalid != 0)
+		return FLT_MAX;
+	return error;
+}
+
+// Compute the error at the middle of the long edge of each triangle which is
+//  'depth' levels below the given one.
+void RtinBuilder::LevelErrors(int ax, int ay, int bx, int by, int cx, int cy, int depth)
+{
+	const int mx = (ax + bx) >> 1;
+	const int my = (ay + by) >> 1;
+	if (depth > 0)
+	{
+		LevelErrors(cx, cy, ax, ay, mx, my, depth - 1);
+		LevelErrors(bx, by, cx, cy, mx, my, depth - 1);
+		return;
+	}
+	const float error = TriangleError(ax, ay, bx, by, cx, cy);
+
+	// Include the errors of the two halves, if they can be split in turn;
+	//  their long edges are the short edges of this triangle.
+	float &result = m_Errors[Index(mx, my)];
+	result = std::max(result, error);
+	if (CanSplit(ax, ay, cx, cy))
+	{
+		result = std::max(result, m_Errors[Index((ax + cx) >> 1, (ay + cy) >> 1)]);
+		result = std::max(result, m_Errors[Index((bx + cx) >> 1, (by + cy) >> 1)]);
+	}
+}
+
+void RtinBuilder::TileErrors(int tile, int depth)
+{
+	const int x0 = (tile % m_iTilesX) * m_iTile;
+	const int y0 = (tile / m_iTilesX) * m_iTile;
+	const int x1 = x0 + m_iTile;
+	const int y1 = y0 + m_iTile;
+	LevelErrors(x0, y0, x1, y1, x1, y0, depth);
+	LevelErrors(x1, y1, x0, y0, x0, y1, depth);
+}
+
+bool RtinBuilder::ComputeErrors(bool progress_callback(int))
+{
+	m_Errors.assign((size_t) m_iWidth * m_iHeight, 0.0f);
+
+	// Tiles next to each other share the heixels along their edge, so the
+	//  tiles are done in two passes, like the squares of a checkerboard.
+	std::vector<int> parity[2];
+	for (int j = 0; j < m_iTilesY; j++)
+		for (int i = 0; i < m_iTilesX; i++)
+			parity[(i + j) & 1].push_back(j * m_iTilesX + i);
+
+	// Each level depends on the errors of the finer levels below it.
+	for (int depth = m_iLevels - 1; depth >= 0; depth--)
+	{
+		for (int p = 0; p < 2; p++)
+		{
+			const std::vector<int> &tiles = parity[p];
+			vtParallelFor((int) tiles.size(), [&](int i)
+			{
+				TileErrors(tiles[i], depth);
+			});
+		}
+		if (progress_callback != NULL &&
+			progress_callback((m_iLevels - depth) * 100 / m_iLevels))
+			return false;
+	}
+
+	m_fMaxFinite = 0.0f;
+	for (size_t i = 0; i < m_Errors.size(); i++)
+	{
+		if (m_Errors[i] != FLT_MAX && m_Errors[i] > m_fMaxFinite)
+			m_fMaxFinite = m_Errors[i];
+	}
+	return true;
+}
+
+int RtinBuilder::Count(int ax, int ay, int bx, int by, int cx, int cy,
+	float fMaxError) const
+{
+	if (ShouldSplit(ax, ay, bx, by, cx, cy, fMaxError))
+	{
+		const int mx = (ax + bx) >> 1;
+		const int my = (ay + by) >> 1;
+		return Count(cx, cy, ax, ay, mx, my, fMaxError) +
+			Count(bx, by, cx, cy, mx, my, fMaxError);
+	}
+	return IsValidTri(ax, ay, bx, by, cx, cy) ? 1 : 0;
+}
+
+int RtinBuilder::CountTriangles(float fMaxError) const
+{
+	const int iTiles = m_iTilesX * m_iTilesY;
+	std::vector<int> counts(iTiles);
+	vtParallelFor(iTiles, [&](int tile)
+	{
+		const int x0 = (tile % m_iTilesX) * m_iTile;
+		const int y0 = (tile / m_iTilesX) * m_iTile;
+		const int x1 = x0 + m_iTile;
+		const int y1 = y0 + m_iTile;
+		counts[tile] = Count(x0, y0, x1, y1, x1, y0, fMaxError) +
+			Count(x1, y1, x0, y0, x0, y1, fMaxError);
+	});
+	int total = 0;
+	for (int i = 0; i < iTiles; i++)
+		total += counts[i];
+	return total;
+}
+
+void RtinBuilder::Collect(int ax, int ay, int bx, int by, int cx, int cy,
+	float fMaxError, std::vector<int> &tris) const
+{
+	if (ShouldSplit(ax, ay, bx, by, cx, cy, fMaxError))
+	{
+		const int mx = (ax + bx) >> 1;
+		const int my = (ay + by) >> 1;
+		Collect(cx, cy, ax, ay, mx, my, fMaxError, tris);
+		Collect(bx, by, cx, cy, mx, my, fMaxError, tris);
+		return;
+	}
+	if (!IsValidTri(ax, ay, bx, by, cx, cy))
+		return;
+
+	// Keep the triangles counter-clockwise, as seen from above
+	const int cross = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+	tris.push_back(ax);
+	tris.push_back(ay);
+	if (cross > 0)
+	{
+		tris.push_back(bx); tris.push_back(by);
+		tris.push_back(cx); tris.push_back(cy);
+	}
+	else
+	{
+		tris.push_back(cx); tris.push_back(cy);
+		tris.push_back(bx); tris.push_back(by);
+	}
+}
+
+void RtinBuilder::Emit(float fMaxError, vtTin *tin) const
+{
+	// Walk each tile on its own thread, then add the triangles in tile order
+	//  so the result doesn't depend on the number of threads.
+	const int iTiles = m_iTilesX * m_iTilesY;
+	std::vector<std::vector<int> > tile_tris(iTiles);
+	vtParallelFor(iTiles, [&](int tile)
+	{
+		const int x0 = (tile % m_iTilesX) * m_iTile;
+		const int y0 = (tile / m_iTilesX) * m_iTile;
+		const int x1 = x0 + m_iTile;
+		const int y1 = y0 + m_iTile;
+		Collect(x0, y0, x1, y1, x1, y0, fMaxError, tile_tris[tile]);
+		Collect(x1, y1, x0, y0, x0, y1, fMaxError, tile_tris[tile]);
+	});
+
+	std::unordered_map<size_t, int> vert_index;
+	DPoint2 p;
+	int v[3];
+	for (int tile = 0; tile < iTiles; tile++)
+	{
+		const std::vector<int> &tris = tile_tris[tile];
+		for (size_t i = 0; i < tris.size(); i += 6)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				const int x = tris[i + k*2];
+				const int y = tris[i + k*2 + 1];
+				auto it = vert_index.find(Index(x, y));
+				if (it != vert_index.end())
+					v[k] = it->second;
+				else
+				{
+					v[k] = tin->NumVerts();
+					vert_index[Index(x, y)] = v[k];
+					m_pGrid->GetEarthPoint(x, y, p);
+					tin->AddVert(p, Height(x, y));
+				}
+			}
+			tin->AddTri(v[0], v[1], v[2]);
+		}
+		// Free each tile's list as soon as it's used
+		std::vector<int>().swap(tile_tris[tile]);
+	}
+}
+
+
+/**
+ * Create this TIN from an elevation grid, using as few triangles as
+ * possible to represent the grid within a given vertical error.  The
+ * vertices are a subset of the grid's heixels, and areas of unknown
+ * elevation are left out.
+ *
+ * The time taken is nearly linear in the size of the grid, and the memory
+ * needed is one float per heixel, plus the result.
+ *
+ * \param grid The elevation grid.
+ * \param fMaxError The largest allowed vertical difference, in meters,
+ *		between the TIN and any heixel.  Pass 0 for a TIN which matches
+ *		every heixel exactly, which still merges flat and planar areas.
+ * \param iMaxTriangles If greater than zero, the error is increased as
+ *		needed so that the TIN has no more than this many triangles.
+ * \param progress_callback If supplied, this function will be called back
+ *		with a value of 0 to 100 as the operation progresses.
+ *
+ * \return true if successful.
+ */
+bool vtTin::CreateFromGrid(const vtElevationGrid *grid, float fMaxError,
+	int iMaxTriangles, bool progress_callback(int))
+{
+	FreeData();
+	m_crs = grid->GetCRS();
+
+	int cols, rows;
+	grid->GetDimensions(cols, rows);
+	if (cols < 2 || rows < 2)
+		return false;
+
+	RtinBuilder builder(grid);
+	if (!builder.ComputeErrors(progress_callback))
+		return false;
+
+	if (fMaxError < 0.0f)
+		fMaxError = 0.0f;
+	if (iMaxTriangles > 0 && builder.CountTriangles(fMaxError) > iMaxTriangles)
+	{
+		// The number of triangles only falls as the error grows, so search
+		//  for the smallest error which fits the budget.
+		float lo = fMaxError, hi = builder.GetMaxFiniteError();
+		if (builder.CountTriangles(hi) > iMaxTriangles)
+		{
+			VTLOG("CreateFromGrid: can't fit in %d triangles, using the fewest.\n",
+				iMaxTriangles);
+			lo = hi;
+		}
+		for (int iter = 0; iter < 32 && hi - lo > hi * 1E-4f; iter++)
+		{
+			const float mid = (lo + hi) / 2;
+			if (builder.CountTriangles(mid) > iMaxTriangles)
+				lo = mid;
+			else
+				hi = mid;
+		}
+		fMaxError = hi;
+	}
+	builder.Emit(fMaxError, this);
+
+	VTLOG("CreateFromGrid: %d x %d grid, max error %g, %d verts, %d tris\n",
+		cols, rows, fMaxError, NumVerts(), NumTris());
+
+	ComputeExtents();
+	return (NumTris() > 0);
+}
@@ -253,3 +253,285 @@ int ExpandZip(const char *archive_fname, const char *prepend_path,
 	return uz.Extract(true, true, prepend_path, progress_callback);
 }
 
+
+
+/////////////////////////////////////////////////////////////////////////////
+// vtArchive
+
+#define GNU_LONGNAME	'L'		/* next block(s) hold the name of the next file */
+#define COPY_BUFSIZE	65536
+
+// Like getoct, but for sizes which may not fit in an int.
+static int64_t getoct64(const char *p, int width)
+{
+	int64_t result = 0;
+	while (width--)
+	{
+		const char c = *p++;
+		if (c == ' ')
+			continue;
+		if (c < '0' || c > '7')
+			break;
+		result = result * 8 + (c - '0');
+	}
+	return result;
+}
+
+// A tar header block is valid if its checksum matches.
+static bool tar_header_valid(const union tar_buffer &buffer)
+{
+	int64_t sum = 0;
+	for (int i = 0; i < BLOCKSIZE; i++)
+	{
+		if (i >= 148 && i < 156)
+			sum += ' ';		// the checksum field counts as spaces
+		else
+			sum += (uchar) buffer.buffer[i];
+	}
+	return sum == getoct64(buffer.header.chksum, 8);
+}
+
+// Skip forward in a gz stream.  gzseek takes a z_off_t, which may be only
+//  32 bits, so large distances are skipped in pieces.
+static bool gz_skip(gzFile in, int64_t amount)
+{
+	const int64_t step = 1 << 30;
+	while (amount > 0)
+	{
+		const int64_t n = (amount > step) ? step : amount;
+		if (gzseek(in, (z_off_t) n, SEEK_CUR) == -1)
+			return false;
+		amount -= n;
+	}
+	return true;
+}
+
+vtArchive::vtArchive()
+{
+	m_bOpen = false;
+	m_bZip = false;
+}
+
+/**
+ * Returns true if the filename looks like an archive which vtArchive can
+ * open: .zip, .tar, .tgz or .tar.gz.
+ */
+bool vtArchive::IsArchiveName(const char *szFileName)
+{
+	vtString fname = szFileName;
+	const int len = fname.GetLength();
+	return (len > 4 && (!fname.Right(4).CompareNoCase(".zip") ||
+						!fname.Right(4).CompareNoCase(".tar") ||
+						!fname.Right(4).CompareNoCase(".tgz"))) ||
+		   (len > 7 && !fname.Right(7).CompareNoCase(".tar.gz"));
+}
+
+/**
+ * Returns true if the path names a file inside an archive, as returned by
+ * GetVirtualPath.  Such a path can only be opened with GDAL or OGR.
+ */
+bool vtArchive::IsVirtualPath(const char *szPath)
+{
+	return !strncmp(szPath, "/vsizip/", 8) || !strncmp(szPath, "/vsitar/", 8);
+}
+
+/**
+ * Open an archive, and read its index.
+ *
+ * \param szArchiveName The archive filename, in UTF-8.  It is a zip if it
+ *		ends in .zip, otherwise a tar, which may be gzipped.
+ * \return true if the archive could be read.
+ */
+bool vtArchive::Open(const char *szArchiveName)
+{
+	Close();
+	m_strFileName = szArchiveName;
+	const int len = m_strFileName.GetLength();
+	m_bZip = (len > 4 && !m_strFileName.Right(4).CompareNoCase(".zip"));
+
+	if (m_bZip)
+		m_bOpen = IndexZip();
+	else
+		m_bOpen = IndexTar();
+	if (!m_bOpen)
+		m_Entries.clear();
+	return m_bOpen;
+}
+
+void vtArchive::Close()
+{
+	m_Entries.clear();
+	m_bOpen = false;
+}
+
+bool vtArchive::IndexTar()
+{
+	gzFile in = vtGZOpen(m_strFileName, "rb");
+	if (in == NULL)
+		return false;
+
+	union tar_buffer buffer;
+	int64_t pos = 0;
+	vtString long_name;
+	bool bValid = true;
+	while (1)
+	{
+		if (gzread(in, &buffer, BLOCKSIZE) != BLOCKSIZE)
+			break;
+		pos += BLOCKSIZE;
+
+		// the end-of-tar block
+		if (buffer.header.name[0] == 0)
+			break;
+		if (!tar_header_valid(buffer))
+		{
+			// Not a tar at all, if it's the first block
+			bValid = (pos > BLOCKSIZE);
+			break;
+		}
+		const int64_t size = getoct64(buffer.header.size, 12);
+		const int64_t padded = (size + BLOCKSIZE - 1) / BLOCKSIZE * BLOCKSIZE;
+
+		if (buffer.header.typeflag == GNU_LONGNAME)
+		{
+			std::vector<char> name((size_t) padded + 1, 0);
+			if (gzread(in, &name[0], (unsigned) padded) != (int) padded)
+				break;
+			pos += padded;
+			long_name = &name[0];
+			continue;
+		}
+
+		vtArchiveEntry entry;
+		if (long_name != "")
+			entry.m_strName = long_name;
+		else
+		{
+			vtString name(buffer.header.name, (int) strnlen(buffer.header.name, 100));
+			if (!strncmp(buffer.header.magic, "ustar", 5) && buffer.header.prefix[0])
+				name = vtString(buffer.header.prefix, (int) strnlen(buffer.header.prefix, 155)) + "/" + name;
+			entry.m_strName = name;
+		}
+		long_name = "";
+		entry.m_iSize = size;
+		entry.m_iOffset = pos;
+		entry.m_bDirectory = (buffer.header.typeflag == DIRTYPE);
+
+		if (entry.m_bDirectory || buffer.header.typeflag == REGTYPE ||
+			buffer.header.typeflag == AREGTYPE)
+			m_Entries.push_back(entry);
+
+		// Skip over the data, without decompressing it into memory
+		if (!gz_skip(in, padded))
+			break;
+		pos += padded;
+	}
+	gzclose(in);
+	return bValid;
+}
+
+bool vtArchive::IndexZip()
+{
+	// vtUnzip doesn't handle utf8 paths, so convert to local
+	vtUnzip uz;
+	if (!uz.Open(UTF8ToLocal(m_strFileName)))
+		return false;
+
+	char name[1024];
+	unz_file_info info;
+	for (bool ok = uz.GoToFirstFile(); ok; ok = uz.GoToNextFile())
+	{
+		if (!uz.GetCurrentFileInfo(&info, name, sizeof(name)))
+			return false;
+		vtArchiveEntry entry;
+		entry.m_strName = name;
+		entry.m_iSize = info.uncompressed_size;
+		entry.m_iOffset = unzGetOffset(uz.m_handle);
+		const int len = entry.m_strName.GetLength();
+		entry.m_bDirectory = (len > 0 && (name[len-1] == '/' || name[len-1] == '\\'));
+		m_Entries.push_back(entry);
+	}
+	return true;
+}
+
+/**
+ * Find a file in the archive by name, ignoring case.  The name can be the
+ * full path within the archive, or just the filename.
+ *
+ * \return The index of the entry, or -1 if there is none.
+ */
+int vtArchive::FindEntry(const char *szName) const
+{
+	for (uint i = 0; i < m_Entries.size(); i++)
+		if (!m_Entries[i].m_strName.CompareNoCase(szName))
+			return i;
+	for (uint i = 0; i < m_Entries.size(); i++)
+		if (!m_Entries[i].m_bDirectory && !vtString(StartOfFilename(m_Entries[i].m_strName)).CompareNoCase(szName))
+			return i;
+	return -1;
+}
+
+/**
+ * Write one file in the archive to disk.  The data is copied through a
+ * small buffer, so even a very large file is never all in memory.
+ *
+ * \param i The index of the entry.
+ * \param szDestName The filename to write, in UTF-8.
+ */
+bool vtArchive::ExtractEntry(uint i, const char *szDestName) const
+{
+	if (!m_bOpen || i >= m_Entries.size() || m_Entries[i].m_bDirectory)
+		return false;
+	const vtArchiveEntry &entry = m_Entries[i];
+
+	FILE *out = vtFileOpen(szDestName, "wb");
+	if (!out)
+		return false;
+
+	std::vector<char> buf(COPY_BUFSIZE);
+	bool bOK;
+	if (m_bZip)
+	{
+		vtUnzip uz;
+		bOK = uz.Open(UTF8ToLocal(m_strFileName)) &&
+			unzSetOffset(uz.m_handle, (uLong) entry.m_iOffset) == UNZ_OK &&
+			uz.OpenCurrentFile();
+		if (bOK)
+		{
+			bOK = uz.ExtractCurrentFile(out, &buf[0], buf.size());
+			uz.CloseCurrentFile();
+		}
+	}
+	else
+	{
+		gzFile in = vtGZOpen(m_strFileName, "rb");
+		bOK = (in != NULL && gz_skip(in, entry.m_iOffset));
+		int64_t remaining = entry.m_iSize;
+		while (bOK && remaining > 0)
+		{
+			const int want = (remaining > COPY_BUFSIZE) ? COPY_BUFSIZE : (int) remaining;
+			const int got = gzread(in, &buf[0], want);
+			bOK = (got == want && fwrite(&buf[0], 1, got, out) == (size_t) got);
+			remaining -= got;
+		}
+		if (in)
+			gzclose(in);
+	}
+	fclose(out);
+	if (!bOK)
+		vtDeleteFile(szDestName);
+	return bOK;
+}
+
+/**
+ * A path for a file in the archive which GDAL and OGR can open directly,
+ * such as "/vsizip/C:/data/dem.zip/n45w122.tif".
+ */
+vtString vtArchive::GetVirtualPath(uint i) const
+{
+	vtString path = m_bZip ? "/vsizip/" : "/vsitar/";
+	path += m_strFileName;
+	path += "/";
+	path += m_Entries[i].m_strName;
+	return path;
+}
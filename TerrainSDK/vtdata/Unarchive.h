@@ -5,9 +5,67 @@
 #ifndef UNARCHIVE_H
 #define UNARCHIVE_H
 
+#include <stdint.h>
+#include <vector>
+
+#include "config_vtdata.h"
+#include "vtString.h"
+
 int ExpandTGZ(const char *archive_fname, const char *prepend_path);
 int ExpandZip(const char *archive_fname, const char *prepend_path,
 			  bool progress_callback(int) = NULL);
 
-#endif
+/**
+ * One file or directory in a vtArchive.
+ */
+struct vtArchiveEntry
+{
+	vtString m_strName;		///< Path within the archive, with '/' separators.
+	int64_t m_iSize;		///< Uncompressed size, in bytes.
+	int64_t m_iOffset;		///< Start of the data in a tar, or of the entry in a zip.
+	bool m_bDirectory;
+};
+
+/**
+ * Read-only access to the files inside a .zip, .tar, .tar.gz or .tgz
+ * archive, without expanding it to a temporary directory.
+ *
+ * Open reads only the index of the archive.  Each file can then be written
+ * to disk by itself with ExtractEntry, without expanding the rest.
+ *
+ * GetVirtualPath gives a name for a file which GDAL and OGR can open in
+ * place (with their /vsizip/ and /vsitar/ filesystems), so any loader which
+ * goes through GDAL can read straight from the archive.
+ */
+class vtArchive
+{
+public:
+	vtArchive();
+
+	bool Open(const char *szArchiveName);
+	void Close();
+	bool IsOpen() const { return m_bOpen; }
+	bool IsZip() const { return m_bZip; }
+	const vtString &GetFileName() const { return m_strFileName; }
+
+	uint NumEntries() const { return (uint) m_Entries.size(); }
+	const vtArchiveEntry &GetEntry(uint i) const { return m_Entries[i]; }
+	int FindEntry(const char *szName) const;
 
+	bool ExtractEntry(uint i, const char *szDestName) const;
+	vtString GetVirtualPath(uint i) const;
+
+	static bool IsArchiveName(const char *szFileName);
+	static bool IsVirtualPath(const char *szPath);
+
+protected:
+	bool IndexTar();
+	bool IndexZip();
+
+	vtString m_strFileName;		// UTF-8
+	bool m_bOpen;
+	bool m_bZip;
+	std::vector<vtArchiveEntry> m_Entries;
+};
+
+#endif
@@ -37,15 +37,6 @@
 #define SUPPORT_QUIKGRID	0
 #endif
 
-// Use the 'squish' texture compression library,
-//
-// The library is free (MIT license) and available from:
-// http://sjbrown.co.uk/?code=squish
-//
-#ifndef SUPPORT_SQUISH
-#define SUPPORT_SQUISH	0
-#endif
-
 // Set to 1 if your C++ compiler supports wide strings (std::wstring)
 //
 // Apparently, there is some environment on the Macintosh without this.
@@ -1417,6 +1417,24 @@ bool vtTin::FindAltitudeAtPoint(const FPoint3 &p3, float &fAltitude,
 		return FindAltitudeOnEarth(DPoint2(earth.x, earth.y), fAltitude, bTrue);
 }
 
+uint vtTin::FindAltitudesAtPoints(FPoint3 *p3, uint iCount, bool bTrue,
+	int iCultureFlags) const
+{
+	// A subclass may know about culture, so let it test each point
+	if (iCultureFlags != 0)
+		return vtHeightField3d::FindAltitudesAtPoints(p3, iCount, bTrue, iCultureFlags);
+
+	uint iFound = 0;
+	DPoint3 earth;
+	for (uint i = 0; i < iCount; i++)
+	{
+		m_LocalCS.LocalToEarth(p3[i], earth);
+		if (FindAltitudeOnEarth(DPoint2(earth.x, earth.y), p3[i].y, bTrue))
+			iFound++;
+	}
+	return iFound;
+}
+
 FPoint3 vtTin::GetTriangleNormal(int iTriangle) const
 {
 	FPoint3 wp0, wp1, wp2;
@@ -13,6 +13,8 @@
 #include "HeightField.h"
 #include "vtString.h"
 
+class vtElevationGrid;
+
 // a type useful for the Merge algorithm
 typedef std::vector<int> Bin;
 
@@ -70,6 +72,9 @@ public:
 	void RemVert(int v);
 	void RemTri(int t);
 
+	bool CreateFromGrid(const vtElevationGrid *grid, float fMaxError,
+		int iMaxTriangles = 0, bool progress_callback(int) = NULL);
+
 	// Native file I/O.
 	bool Read(const char *fname, bool progress_callback(int) = NULL);
 	bool ReadHeader(const char *fname);
@@ -108,6 +113,9 @@ public:
 		bool bTrue = false) const;
 	virtual bool FindAltitudeAtPoint(const FPoint3 &p3, float &fAltitude,
 		bool bTrue = false, int iCultureFlags=0, FPoint3 *vNormal = NULL) const;
+	virtual uint FindAltitudesAtPoints(FPoint3 *p3, uint iCount,
+		bool bTrue = false, int iCultureFlags = 0) const;
+	virtual bool IsThreadSafe() const { return true; }
 
 	// This method tells you the height, and also which triangle intersected.
 	bool FindTriangleOnEarth(const DPoint2 &p, float &fAltitude,
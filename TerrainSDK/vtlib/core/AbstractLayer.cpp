@@ -416,7 +416,7 @@ void vtAbstractLayer::CreateObjectGeometry(uint iIndex)
 	}
 	else if (m_pSetLS2)
 	{
-		const DLine2 &dline = m_pSetLS2->GetPolyLine(iIndex);
+		DLine2View dline = m_pSetLS2->GetPolyLineView(iIndex);
 		for (uint j = 0; j < dline.GetSize(); j++)
 		{
 			// preserve 3D point's elevation: don't drape
@@ -495,8 +495,7 @@ void vtAbstractLayer::CreateLineGeometry(uint iIndex)
 	int iEstimatedVerts = 0;
 	if (m_pSetLS2)
 	{
-		const DLine2 &dline = m_pSetLS2->GetPolyLine(iIndex);
-		iEstimatedVerts = dline.GetSize();
+		iEstimatedVerts = m_pSetLS2->GetPolyLineView(iIndex).GetSize();
 	}
 	else if (m_pSetLS3)
 	{
@@ -505,11 +504,10 @@ void vtAbstractLayer::CreateLineGeometry(uint iIndex)
 	}
 	else if (m_pSetPoly)
 	{
-		const DPolygon2 &dpoly = m_pSetPoly->GetPolygon(iIndex);
+		DPolygon2View dpoly = m_pSetPoly->GetPolygonView(iIndex);
 		for (uint k = 0; k < dpoly.size(); k++)
 		{
-			const DLine2 &dline = dpoly[k];
-			iEstimatedVerts += dline.GetSize();
+			iEstimatedVerts += dpoly[k].GetSize();
 			iEstimatedVerts ++;		// close polygon
 		}
 	}
@@ -530,17 +528,13 @@ void vtAbstractLayer::CreateLineGeometry(uint iIndex)
 	uint size;
 	if (m_pSetLS2)
 	{
-		const DLine2 &dline = m_pSetLS2->GetPolyLine(iIndex);
+		// Read through a view, so that the set isn't unpacked
+		DLine2 dline;
+		m_pSetLS2->GetPolyLineView(iIndex).ToDLine2(dline);
 
 		if (m_pOCTransform.get())
-		{
-			// Make a copy and transform it
-			DLine2 copy = dline;
-			TransformInPlace(m_pOCTransform.get(), copy);
-			mf.AddSurfaceLineToMesh(m_pHeightField, copy, m_fSpacing, fHeight, bTessellate, bCurve, true);
-		}
-		else
-			mf.AddSurfaceLineToMesh(m_pHeightField, dline, m_fSpacing, fHeight, bTessellate, bCurve, true);
+			TransformInPlace(m_pOCTransform.get(), dline);
+		mf.AddSurfaceLineToMesh(m_pHeightField, dline, m_fSpacing, fHeight, bTessellate, bCurve, true);
 	}
 	else if (m_pSetLS3)
 	{
@@ -560,14 +554,12 @@ void vtAbstractLayer::CreateLineGeometry(uint iIndex)
 	}
 	else if (m_pSetPoly)
 	{
-		const DPolygon2 &dpoly = m_pSetPoly->GetPolygon(iIndex);
+		DPolygon2View dpoly = m_pSetPoly->GetPolygonView(iIndex);
 		for (uint k = 0; k < dpoly.size(); k++)
 		{
-			// This would be the efficient way
-//				const DLine2 &dline = dpoly[k];
-
-			// but we must copy each polyline in order to close it
-			DLine2 dline = dpoly[k];
+			// We must copy each polyline in order to close it
+			DLine2 dline;
+			dpoly[k].ToDLine2(dline);
 			dline.Append(dline[0]);
 
 			if (m_pOCTransform.get())
@@ -684,8 +676,9 @@ void vtAbstractLayer::CreateFeatureLabel(uint iIndex)
 	}
 	else if (m_pSetPoly)
 	{
-		const DPolygon2 &dp = m_pSetPoly->GetPolygon(iIndex);
-		p2 = dp[0].Centroid();
+		DLine2 outer;
+		m_pSetPoly->GetPolygonView(iIndex)[0].ToDLine2(outer);
+		p2 = outer.Centroid();
 	}
 
 	// Don't drape on culture, but do use true elevation
@@ -841,6 +834,22 @@ void vtAbstractLayer::RefreshFeature(uint iIndex)
 	}
 }
 
+/**
+ * Rebuild the visuals of some features, after the elevation under them has
+ * changed.  Visuals which are made from all the features at once can only
+ * be rebuilt all together.
+ */
+void vtAbstractLayer::RedrapeFeatures(const std::vector<uint> &indices)
+{
+	if (CreateAtOnce())
+	{
+		RefreshFeatureVisuals();
+		return;
+	}
+	for (uint i = 0; i < indices.size(); i++)
+		RefreshFeature(indices[i]);
+}
+
 void vtAbstractLayer::UpdateVisualSelection()
 {
 	// use SetMeshMatIndex to make the meshes of selected features yellow
@@ -897,6 +906,10 @@ void vtAbstractLayer::EditBegin()
 
 void vtAbstractLayer::EditEnd()
 {
+	// Geometry may have been changed, so the spatial index is stale
+	if (m_pSet)
+		m_pSet->FreeRTree();
+
 	if (m_bNeedRebuild)
 	{
 		m_bNeedRebuild = false;
@@ -904,6 +917,22 @@ void vtAbstractLayer::EditEnd()
 	}
 }
 
+/**
+ * Find the feature closest to a given point, for picking.  This uses the
+ * spatial index of the featureset, so it is fast even for large layers.
+ *
+ * \param epos The point, in the CRS of the featureset.
+ * \param epsilon Maximum distance to look, in the same units.
+ * \param distance If not NULL, receives the distance to the feature.
+ * \return The index of the feature, or -1 if none was found.
+ */
+int vtAbstractLayer::PickFeature(const DPoint2 &epos, double epsilon, double *distance)
+{
+	if (!m_pSet)
+		return -1;
+	return m_pSet->FindClosestFeature(epos, epsilon, distance);
+}
+
 vtVisual *vtAbstractLayer::GetViz(vtFeature *feat)
 {
 #if 0
@@ -113,6 +113,7 @@ public:
 	// When the underlying feature changes, we need to rebuild the visual
 	void RefreshFeatureVisuals(bool progress_callback(int) = NULL);
 	void RefreshFeature(uint iIndex);
+	void RedrapeFeatures(const std::vector<uint> &indices);
 	void UpdateVisualSelection();
 	void Reload();
 
@@ -122,6 +123,8 @@ public:
 	void EditEnd();
 	void DeleteFeature(vtFeature *f);
 
+	int PickFeature(const DPoint2 &epos, double epsilon, double *distance = NULL);
+
 protected:
 	void CreateGeomGroup();
 	void CreateLabelGroup();
@@ -463,7 +463,7 @@ bool vtAnimPath::CreateFromLineString(const vtCRS &crs,
 	if (pSetLS2)
 	{
 		DPoint2 current, previous(1E9,1E9);
-		const DLine2 &dline2 = pSetLS2->GetPolyLine(i);
+		const DLine2View dline2 = pSetLS2->GetPolyLineView(i);
 		for (j = 0; j < dline2.GetSize(); j++)
 		{
 			current = dline2[j];
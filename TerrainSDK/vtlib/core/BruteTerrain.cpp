@@ -143,12 +143,22 @@ void BruteTerrain::RenderPass()
 //
 float BruteTerrain::GetElevation(int iX, int iZ, bool bTrue) const
 {
+	// The array holds true elevation, as in MAKE_XYZ1_TRUE
 	float f = m_pData[offset(iX,iZ)];
-	if (bTrue)
-		f /= m_fZScale;
+	if (!bTrue)
+		f *= m_fZScale;
 	return f;
 }
 
+void BruteTerrain::SetElevation(int iX, int iZ, float fValue, bool bTrue)
+{
+	if (iX < 0 || iX > m_iSize.x-1 || iZ < 0 || iZ > m_iSize.y-1)
+		return;
+	if (!bTrue)
+		fValue /= m_fZScale;
+	m_pData[offset(iX,iZ)] = fValue;
+}
+
 void BruteTerrain::GetWorldLocation(int iX, int iZ, FPoint3 &p, bool bTrue) const
 {
 	if (bTrue)
@@ -0,0 +1,196 @@
+//
+// CultureIndex.cpp
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include "vtlib/vtlib.h"
+#include "vtdata/vtLog.h"
+
+#include "AbstractLayer.h"
+#include "CultureIndex.h"
+#include "Roads.h"
+
+#include <algorithm>
+
+bool vtCultureItem::operator<(const vtCultureItem &other) const
+{
+	if (m_eKind != other.m_eKind)
+		return m_eKind < other.m_eKind;
+	if (m_pLayer != other.m_pLayer)
+		return m_pLayer < other.m_pLayer;
+	if (m_pLink != other.m_pLink)
+		return m_pLink < other.m_pLink;
+	return m_iIndex < other.m_iIndex;
+}
+
+bool vtCultureItem::operator==(const vtCultureItem &other) const
+{
+	return m_eKind == other.m_eKind && m_pLayer == other.m_pLayer &&
+		m_pLink == other.m_pLink && m_iIndex == other.m_iIndex;
+}
+
+
+///////////////////////////////////////////////////////////////////////
+
+vtCultureIndex::vtCultureIndex()
+{
+	m_bBuilt = false;
+}
+
+void vtCultureIndex::Clear()
+{
+	m_bBuilt = false;
+	m_Stamps.clear();
+	m_Items.clear();
+	m_Tree.Clear();
+}
+
+/**
+ * Index all the structures, plants, features and road links of a terrain.
+ * Any previous contents are discarded.
+ */
+void vtCultureIndex::Build(const LayerSet &layers, vtRoadMap3d *pRoads)
+{
+	Clear();
+
+	std::vector<DRECT> boxes;
+	vtCultureItem item;
+	item.m_pLink = NULL;
+	DRECT rect;
+
+	for (uint i = 0; i < layers.size(); i++)
+	{
+		vtLayer *lay = layers[i].get();
+		item.m_pLayer = lay;
+
+		vtStructureLayer *slay = dynamic_cast<vtStructureLayer*>(lay);
+		if (slay)
+		{
+			item.m_eKind = vtCultureItem::STRUCTURE;
+			for (uint j = 0; j < slay->size(); j++)
+			{
+				if (!slay->at(j)->GetExtents(rect))
+					continue;
+				item.m_iIndex = j;
+				m_Items.push_back(item);
+				boxes.push_back(rect);
+			}
+		}
+		vtFeatureSet *fset = NULL;
+		vtVegLayer *vlay = dynamic_cast<vtVegLayer*>(lay);
+		if (vlay)
+		{
+			item.m_eKind = vtCultureItem::PLANT;
+			fset = vlay;
+		}
+		vtAbstractLayer *alay = dynamic_cast<vtAbstractLayer*>(lay);
+		if (alay)
+		{
+			item.m_eKind = vtCultureItem::FEATURE;
+			fset = alay->GetFeatureSet();
+		}
+		if (fset)
+		{
+			for (uint j = 0; j < fset->NumEntities(); j++)
+			{
+				if (!fset->ComputeFeatureExtent(j, rect))
+					continue;
+				item.m_iIndex = j;
+				m_Items.push_back(item);
+				boxes.push_back(rect);
+			}
+		}
+	}
+	if (pRoads)
+	{
+		item.m_eKind = vtCultureItem::ROAD_LINK;
+		item.m_pLayer = NULL;
+		item.m_iIndex = 0;
+		for (LinkGeom *pL = pRoads->GetFirstLink(); pL; pL = pL->GetNext())
+		{
+			if (pL->GetSize() == 0)
+				continue;
+			rect.SetInsideOut();
+			rect.GrowToContainLine(*pL);
+			item.m_pLink = pL;
+			m_Items.push_back(item);
+			boxes.push_back(rect);
+		}
+	}
+	m_Tree.Build(boxes);
+	MakeStamps(layers, pRoads, m_Stamps);
+	m_bBuilt = true;
+
+	VTLOG("Culture index: %d items\n", NumItems());
+}
+
+/**
+ * Return true if the index was built from these layers and road map, and
+ * none of them have been edited since.
+ */
+bool vtCultureIndex::IsCurrent(const LayerSet &layers, vtRoadMap3d *pRoads) const
+{
+	if (!m_bBuilt)
+		return false;
+	std::vector<Stamp> stamps;
+	MakeStamps(layers, pRoads, stamps);
+	return stamps == m_Stamps;
+}
+
+/**
+ * Find all the culture whose extents overlap an area.  The items are
+ * appended to 'found' in the order they were indexed.
+ */
+void vtCultureIndex::FindOverlapping(const DRECT &area,
+	std::vector<vtCultureItem> &found) const
+{
+	DRECT rect = area;
+	rect.Sort();
+
+	std::vector<int> hits;
+	m_Tree.FindOverlapping(rect, hits);
+	std::sort(hits.begin(), hits.end());
+	for (uint i = 0; i < hits.size(); i++)
+		found.push_back(m_Items[hits[i]]);
+}
+
+/**
+ * Append all the culture in the index to 'found'.
+ */
+void vtCultureIndex::GetAll(std::vector<vtCultureItem> &found) const
+{
+	found.insert(found.end(), m_Items.begin(), m_Items.end());
+}
+
+void vtCultureIndex::MakeStamps(const LayerSet &layers, vtRoadMap3d *pRoads,
+	std::vector<Stamp> &stamps)
+{
+	Stamp stamp;
+	for (uint i = 0; i < layers.size(); i++)
+	{
+		vtLayer *lay = layers[i].get();
+		stamp.m_pSource = lay;
+		stamp.m_iCount = 0;
+		stamp.m_iEdits = lay->GetEditCount();
+
+		vtStructureLayer *slay = dynamic_cast<vtStructureLayer*>(lay);
+		if (slay)
+			stamp.m_iCount = (uint) slay->size();
+		vtVegLayer *vlay = dynamic_cast<vtVegLayer*>(lay);
+		if (vlay)
+			stamp.m_iCount = vlay->NumEntities();
+		vtAbstractLayer *alay = dynamic_cast<vtAbstractLayer*>(lay);
+		if (alay && alay->GetFeatureSet())
+			stamp.m_iCount = alay->GetFeatureSet()->NumEntities();
+		stamps.push_back(stamp);
+	}
+	if (pRoads)
+	{
+		stamp.m_pSource = pRoads;
+		stamp.m_iCount = pRoads->NumLinks();
+		stamp.m_iEdits = pRoads->GetEditCount();
+		stamps.push_back(stamp);
+	}
+}
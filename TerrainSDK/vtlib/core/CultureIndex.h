@@ -0,0 +1,86 @@
+//
+// CultureIndex.h
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef VTLIB_CULTUREINDEXH
+#define VTLIB_CULTUREINDEXH
+
+#include "vtdata/RTree.h"
+#include "TerrainLayers.h"
+
+class LinkGeom;
+class vtRoadMap3d;
+
+/** \addtogroup terrain */
+/*@{*/
+
+/**
+ * One piece of culture on a terrain, as found by vtCultureIndex.
+ */
+struct vtCultureItem
+{
+	enum Kind { STRUCTURE, PLANT, FEATURE, ROAD_LINK };
+
+	Kind m_eKind;
+	vtLayer *m_pLayer;	///< The layer of a structure, plant or feature.
+	LinkGeom *m_pLink;	///< The link, for a ROAD_LINK.
+	uint m_iIndex;		///< The structure, plant or feature in its layer.
+
+	bool operator<(const vtCultureItem &other) const;
+	bool operator==(const vtCultureItem &other) const;
+};
+
+/**
+ * A spatial index of the culture on a terrain: structures, plants, the
+ * features of abstract layers, and road links, by their extents in earth
+ * coordinates.  It tells the terrain which culture stands on an area, so
+ * that after the elevation there changes, only that culture is draped again.
+ *
+ * The index is a snapshot of the layers.  Anything which edits a layer
+ * marks it as modified (vtLayerBase::SetModified), and likewise a change to
+ * the roads counts as an edit of the road map (vtRoadMap::GetEditCount).
+ * IsCurrent notices these, so the owner knows to build the index again.
+ */
+class vtCultureIndex
+{
+public:
+	vtCultureIndex();
+
+	void Clear();
+	void Build(const LayerSet &layers, vtRoadMap3d *pRoads);
+	bool IsCurrent(const LayerSet &layers, vtRoadMap3d *pRoads) const;
+
+	void FindOverlapping(const DRECT &area, std::vector<vtCultureItem> &found) const;
+	void GetAll(std::vector<vtCultureItem> &found) const;
+
+	/// Number of items in the index.
+	uint NumItems() const { return (uint) m_Items.size(); }
+
+protected:
+	// What the index was built from, to tell when it is stale
+	struct Stamp
+	{
+		const void *m_pSource;
+		uint m_iCount;
+		uint m_iEdits;
+		bool operator==(const Stamp &other) const
+		{
+			return m_pSource == other.m_pSource && m_iCount == other.m_iCount &&
+				m_iEdits == other.m_iEdits;
+		}
+	};
+	static void MakeStamps(const LayerSet &layers, vtRoadMap3d *pRoads,
+		std::vector<Stamp> &stamps);
+
+	bool m_bBuilt;
+	std::vector<Stamp> m_Stamps;
+	std::vector<vtCultureItem> m_Items;
+	vtRTree m_Tree;
+};
+
+/*@}*/	// Group terrain
+
+#endif // VTLIB_CULTUREINDEXH
@@ -10,6 +10,7 @@
 
 #include "vtlib/vtlib.h"
 #include "DynTerrain.h"
+#include "Profiler.h"
 
 vtDynTerrainGeom::vtDynTerrainGeom() : vtDynGeom(), vtHeightFieldGrid3d()
 {
@@ -100,6 +101,19 @@ bool vtDynTerrainGeom::FindAltitudeOnEarth(const DPoint2 &p, float &fAltitude, b
 	return true;
 }
 
+uint vtDynTerrainGeom::FindAltitudesAtPoints(FPoint3 *p3, uint iCount,
+	bool bTrue, int iCultureFlags) const
+{
+	// Call our own method directly, avoiding a virtual call per point
+	uint iFound = 0;
+	for (uint i = 0; i < iCount; i++)
+	{
+		if (vtDynTerrainGeom::FindAltitudeAtPoint(p3[i], p3[i].y, bTrue, iCultureFlags))
+			iFound++;
+	}
+	return iFound;
+}
+
 bool vtDynTerrainGeom::FindAltitudeAtPoint(const FPoint3 &p, float &fAltitude,
 						bool bTrue, int iCultureFlags, FPoint3 *vNormal) const
 {
@@ -252,6 +266,121 @@ int vtDynTerrainGeom::NumDrawnTriangles() const
 	return m_iDrawnTriangles;
 }
 
+/**
+ * Shape the terrain with a brush, changing the elevation of the heixels under
+ * it.  Only those heixels are touched, and afterwards UpdateRegion is called
+ * so that the CLOD implementation can bring its level of detail information
+ * up to date for just that part of the grid.  This is cheap enough to do
+ * every frame while the user drags the brush.
+ *
+ * \param brush The brush to apply.
+ * \param lo, hi Receive the range of heixels which changed, inclusive.
+ * \param pCopy If given, a copy of the elevation grid which this terrain was
+ *		made from.  The heixels which change are given the same new values.
+ * \return true if any elevation changed.
+ */
+bool vtDynTerrainGeom::ApplyBrush(const vtTerrainBrush &brush, IPoint2 &lo, IPoint2 &hi,
+	vtElevationGrid *pCopy)
+{
+	if (brush.m_dRadius <= 0)
+		return false;
+
+	// Find the heixels under the brush
+	const DPoint2 spacing = GetSpacing();
+	const int x0 = std::max(0, (int) floor((brush.m_Center.x - brush.m_dRadius - m_EarthExtents.left) / spacing.x));
+	const int x1 = std::min(m_iSize.x-1, (int) ceil((brush.m_Center.x + brush.m_dRadius - m_EarthExtents.left) / spacing.x));
+	const int y0 = std::max(0, (int) floor((brush.m_Center.y - brush.m_dRadius - m_EarthExtents.bottom) / spacing.y));
+	const int y1 = std::min(m_iSize.y-1, (int) ceil((brush.m_Center.y + brush.m_dRadius - m_EarthExtents.bottom) / spacing.y));
+	if (x0 > x1 || y0 > y1)
+		return false;
+
+	// Take a copy of the heixels first, with a border of one for smoothing,
+	//  so that the result doesn't depend on the order they are changed in.
+	const int bx0 = std::max(0, x0-1), bx1 = std::min(m_iSize.x-1, x1+1);
+	const int by0 = std::max(0, y0-1), by1 = std::min(m_iSize.y-1, y1+1);
+	const int bw = bx1 - bx0 + 1;
+	std::vector<float> before(bw * (by1 - by0 + 1));
+	for (int j = by0; j <= by1; j++)
+		for (int i = bx0; i <= bx1; i++)
+			before[(j - by0) * bw + (i - bx0)] = GetElevation(i, j, true);
+
+	const double r2 = brush.m_dRadius * brush.m_dRadius;
+	lo.Set(x1, y1);
+	hi.Set(x0, y0);
+	bool bChanged = false;
+	for (int j = y0; j <= y1; j++)
+	{
+		const double dy = m_EarthExtents.bottom + j * spacing.y - brush.m_Center.y;
+		for (int i = x0; i <= x1; i++)
+		{
+			const double dx = m_EarthExtents.left + i * spacing.x - brush.m_Center.x;
+			const double d2 = dx*dx + dy*dy;
+			if (d2 >= r2)
+				continue;
+			const float value = before[(j - by0) * bw + (i - bx0)];
+			if (value == INVALID_ELEVATION)
+				continue;
+
+			// smooth falloff from 1 at the center to 0 at the radius
+			const double f = 1.0 - d2 / r2;
+			const float weight = (float) (f * f);
+
+			float result = value;
+			switch (brush.m_eMode)
+			{
+			case vtTerrainBrush::RAISE:
+				result = value + brush.m_fStrength * weight;
+				break;
+			case vtTerrainBrush::LOWER:
+				result = value - brush.m_fStrength * weight;
+				break;
+			case vtTerrainBrush::SMOOTH:
+				{
+					float sum = 0;
+					int count = 0;
+					for (int nj = std::max(by0, j-1); nj <= std::min(by1, j+1); nj++)
+						for (int ni = std::max(bx0, i-1); ni <= std::min(bx1, i+1); ni++)
+						{
+							const float n = before[(nj - by0) * bw + (ni - bx0)];
+							if (n != INVALID_ELEVATION)
+							{
+								sum += n;
+								count++;
+							}
+						}
+					result = value + (sum / count - value) * brush.m_fStrength * weight;
+				}
+				break;
+			case vtTerrainBrush::FLATTEN:
+				result = value + (brush.m_fHeight - value) * brush.m_fStrength * weight;
+				break;
+			}
+			if (result == value)
+				continue;
+
+			SetElevation(i, j, result, true);
+			if (pCopy)
+				pCopy->SetFValue(i, j, result);
+			if (result < m_fMinHeight) m_fMinHeight = result;
+			if (result > m_fMaxHeight) m_fMaxHeight = result;
+			if (i < lo.x) lo.x = i;
+			if (j < lo.y) lo.y = j;
+			if (i > hi.x) hi.x = i;
+			if (j > hi.y) hi.y = j;
+			bChanged = true;
+		}
+	}
+	if (!bChanged)
+		return false;
+
+	// The height range may have grown
+	m_pDynMesh->dirtyBound();
+
+	UpdateRegion(lo, hi);
+	return true;
+}
+
+
 ///////////////////////////////////////////////////////////////////////
 //
 // Overrides for vtDynGeom
@@ -280,6 +409,7 @@ void vtDynTerrainGeom::DoCull(const vtCamera *pCam)
 #endif
 	if (m_bCulleveryframe || m_bCullonce || bCullThisFrame)
 	{
+		VTPROFILE_ZONE("Terrain cull");
 		DoCulling(pCam);
 		m_bCullonce = false;
 	}
@@ -318,5 +448,7 @@ void vtDynTerrainGeom::PreRender() const
 
 void vtDynTerrainGeom::PostRender() const
 {
+	if (m_iDrawnTriangles > 0)
+		VTPROFILE_COUNT("Terrain triangles", m_iDrawnTriangles);
 }
 
@@ -27,6 +27,26 @@ enum DTErr
 	DTErr_NOMEM
 };
 
+/**
+ * A brush for shaping a dynamic terrain interactively; see
+ * vtDynTerrainGeom::ApplyBrush.  The effect is strongest at the center of
+ * the brush and falls off smoothly to nothing at its radius.
+ */
+struct vtTerrainBrush
+{
+	enum Mode { RAISE, LOWER, SMOOTH, FLATTEN };
+
+	vtTerrainBrush() : m_eMode(RAISE), m_dRadius(0), m_fStrength(1), m_fHeight(0) {}
+
+	Mode m_eMode;
+	DPoint2 m_Center;	///< Center of the brush, in earth coordinates.
+	double m_dRadius;	///< Radius of the brush, in earth units.
+	/** For RAISE and LOWER, the change in elevation (meters) at the center.
+		For SMOOTH and FLATTEN, how far (0-1) to move toward the target. */
+	float m_fStrength;
+	float m_fHeight;	///< For FLATTEN, the elevation (meters) to flatten to.
+};
+
 /**
  * This class provides a framework for implementing any kind of dynamic
  * geometry for a heightfield terrain grid.  It is the parent class which
@@ -64,10 +84,18 @@ public:
 	bool FindAltitudeAtPoint(const FPoint3 &p3, float &fAltitude,
 		bool bTrue = false, int iCultureFlags = 0,
 		FPoint3 *vNormal = NULL) const;
+	uint FindAltitudesAtPoints(FPoint3 *p3, uint iCount, bool bTrue = false,
+		int iCultureFlags = 0) const;
+	bool IsThreadSafe() const { return true; }
 
 	// overridables
 	virtual void DoCulling(const vtCamera *pCam) = 0;
 	virtual void SetElevation(int i, int j, float fValue, bool bTrue = false) {}
+	virtual void UpdateRegion(const IPoint2 &lo, const IPoint2 &hi) {}
+
+	// editing
+	bool ApplyBrush(const vtTerrainBrush &brush, IPoint2 &lo, IPoint2 &hi,
+		vtElevationGrid *pCopy = NULL);
 
 	// control
 	void SetCull(bool bOnOff);
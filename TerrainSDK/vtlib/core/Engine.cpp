@@ -6,14 +6,24 @@
 //
 
 #include "vtlib/vtlib.h"
+#include "vtdata/Parallel.h"
+#include "vtdata/vtLog.h"
 #include "Engine.h"
 #include "Event.h"
+#include "Profiler.h"
 
 #include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+uint vtEngine::s_iTreeVersion = 0;
 
 vtEngine::vtEngine() : vtEnabledBase()
 {
 	m_pWindow = NULL;
+	m_bThreadSafe = false;
+	m_fEvalTime = 0.0f;
+	m_fAvgEvalTime = 0.0f;
 }
 
 osg::Referenced *vtEngine::GetTarget(uint which)
@@ -42,6 +52,22 @@ void vtEngine::RemoveChild(vtEngine *pEngine)
 		if (m_Children[i] == pEngine)
 			m_Children.erase(m_Children.begin()+i);
 	}
+	s_iTreeVersion++;
+}
+
+void vtEngine::AddDependency(vtEngine *pEngine)
+{
+	m_Dependencies.push_back(pEngine);
+	s_iTreeVersion++;
+}
+
+void vtEngine::RemoveDependency(vtEngine *pEngine)
+{
+	std::vector<vtEngine*>::iterator it = std::find(m_Dependencies.begin(),
+		m_Dependencies.end(), pEngine);
+	if (it != m_Dependencies.end())
+		m_Dependencies.erase(it);
+	s_iTreeVersion++;
 }
 
 void vtEngine::AddChildrenToList(vtEngineArray &list, bool bEnabledOnly)
@@ -53,6 +79,242 @@ void vtEngine::AddChildrenToList(vtEngineArray &list, bool bEnabledOnly)
 		GetChild(i)->AddChildrenToList(list, bEnabledOnly);
 }
 
+
+//////////////////////////////////////////////////////////////////////
+// vtEngineScheduler
+//
+
+vtEngineScheduler::vtEngineScheduler()
+{
+	m_pRoot = NULL;
+	m_iVersion = 0;
+	m_bParallel = true;
+	m_bTiming = false;
+	m_fEvalTime = 0.0f;
+	m_StageStart.push_back(0);
+}
+
+static void FlattenEngines(vtEngine *pEngine, int iParent,
+	std::vector<vtEngine*> &engines, std::vector<int> &parents)
+{
+	const int index = (int) engines.size();
+	engines.push_back(pEngine);
+	parents.push_back(iParent);
+	for (uint i = 0; i < pEngine->NumChildren(); i++)
+		FlattenEngines(pEngine->GetChild(i), index, engines, parents);
+}
+
+/**
+ * Flatten the engine tree, and work out which engines can be evaluated at
+ * the same time.  Each engine is given a stage, which is one more than the
+ * latest stage of the engines it must follow.
+ */
+void vtEngineScheduler::Rebuild(vtEngine *pRoot)
+{
+	m_pRoot = pRoot;
+	m_iVersion = vtEngine::GetTreeVersion();
+
+	m_Engines.clear();
+	m_Parent.clear();
+	FlattenEngines(pRoot, -1, m_Engines, m_Parent);
+	const int n = (int) m_Engines.size();
+
+	std::unordered_map<vtEngine*, int> index;
+	for (int i = 0; i < n; i++)
+		index[m_Engines[i]] = i;
+
+	// The engines which each engine must precede
+	std::vector<std::vector<int> > next(n);
+	std::vector<int> waiting(n, 0);
+	int iPrevSerial = -1;
+	for (int i = 0; i < n; i++)
+	{
+		vtEngine *pEng = m_Engines[i];
+		if (m_Parent[i] >= 0)
+		{
+			next[m_Parent[i]].push_back(i);
+			waiting[i]++;
+		}
+		for (uint d = 0; d < pEng->NumDependencies(); d++)
+		{
+			std::unordered_map<vtEngine*, int>::iterator it =
+				index.find(pEng->GetDependency(d));
+			if (it != index.end() && it->second != i)
+			{
+				next[it->second].push_back(i);
+				waiting[i]++;
+			}
+		}
+		// Engines which aren't thread-safe keep their original order
+		if (!pEng->GetThreadSafe())
+		{
+			if (iPrevSerial >= 0)
+			{
+				next[iPrevSerial].push_back(i);
+				waiting[i]++;
+			}
+			iPrevSerial = i;
+		}
+	}
+
+	// Visit the engines in dependency order, finding each one's stage
+	std::vector<int> stage(n, 0);
+	std::vector<int> ready;
+	for (int i = 0; i < n; i++)
+		if (waiting[i] == 0)
+			ready.push_back(i);
+	int iNumStages = 0, iVisited = 0;
+	for (size_t r = 0; r < ready.size(); r++)
+	{
+		const int i = ready[r];
+		iVisited++;
+		iNumStages = std::max(iNumStages, stage[i] + 1);
+		for (size_t k = 0; k < next[i].size(); k++)
+		{
+			const int j = next[i][k];
+			stage[j] = std::max(stage[j], stage[i] + 1);
+			if (--waiting[j] == 0)
+				ready.push_back(j);
+		}
+	}
+	if (iVisited < n)
+	{
+		// A cycle of dependencies.  Evaluate those engines last, one at a
+		//  time, in tree order.
+		VTLOG("Engine dependencies have a cycle: %d engines affected.\n", n - iVisited);
+		for (int i = 0; i < n; i++)
+			if (waiting[i] > 0)
+				stage[i] = iNumStages++;
+	}
+
+	// Group by stage, thread-safe engines first, keeping tree order
+	m_Order.clear();
+	m_StageStart.clear();
+	m_StageSerial.clear();
+	std::vector<std::vector<int> > safe(iNumStages), serial(iNumStages);
+	for (int i = 0; i < n; i++)
+	{
+		if (m_Engines[i]->GetThreadSafe() && waiting[i] == 0)
+			safe[stage[i]].push_back(i);
+		else
+			serial[stage[i]].push_back(i);
+	}
+	for (int s = 0; s < iNumStages; s++)
+	{
+		m_StageStart.push_back((int) m_Order.size());
+		m_Order.insert(m_Order.end(), safe[s].begin(), safe[s].end());
+		m_StageSerial.push_back((int) m_Order.size());
+		m_Order.insert(m_Order.end(), serial[s].begin(), serial[s].end());
+	}
+	m_StageStart.push_back((int) m_Order.size());
+
+	VTLOG("Engine scheduler: %d engines in %d stages.\n", n, iNumStages);
+}
+
+void vtEngineScheduler::EvalEngine(vtEngine *pEngine)
+{
+	if (!m_bTiming)
+	{
+		pEngine->Eval();
+		return;
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	pEngine->Eval();
+	const float seconds = std::chrono::duration<float>(
+		std::chrono::steady_clock::now() - start).count();
+
+	pEngine->m_fEvalTime = seconds;
+	pEngine->m_fAvgEvalTime = pEngine->m_fAvgEvalTime * 0.9f + seconds * 0.1f;
+}
+
+/**
+ * Evaluate all the enabled engines of an engine tree.  An engine is skipped
+ * if it, or any engine above it in the tree, is disabled.
+ */
+void vtEngineScheduler::Eval(vtEngine *pRoot)
+{
+	if (!pRoot)
+		return;
+	if (pRoot != m_pRoot || m_iVersion != vtEngine::GetTreeVersion())
+		Rebuild(pRoot);
+
+	std::chrono::steady_clock::time_point start;
+	if (m_bTiming)
+		start = std::chrono::steady_clock::now();
+
+	const int n = (int) m_Engines.size();
+	m_Enabled.resize(n);
+	int iEvaluated = 0;
+	for (int i = 0; i < n; i++)
+	{
+		m_Enabled[i] = m_Engines[i]->GetEnabled() &&
+			(m_Parent[i] < 0 || m_Enabled[m_Parent[i]]);
+		iEvaluated += m_Enabled[i];
+	}
+	VTPROFILE_COUNT("Engines evaluated", iEvaluated);
+
+	for (uint s = 0; s < NumStages(); s++)
+	{
+		m_Batch.clear();
+		for (int k = m_StageStart[s]; k < m_StageSerial[s]; k++)
+		{
+			if (m_Enabled[m_Order[k]])
+				m_Batch.push_back(m_Engines[m_Order[k]]);
+		}
+		if (m_bParallel && m_Batch.size() > 1)
+		{
+			vtParallelFor((int) m_Batch.size(), [this](int i)
+			{
+				EvalEngine(m_Batch[i]);
+			});
+		}
+		else
+		{
+			for (size_t b = 0; b < m_Batch.size(); b++)
+				EvalEngine(m_Batch[b]);
+		}
+
+		for (int k = m_StageSerial[s]; k < m_StageStart[s+1]; k++)
+		{
+			if (m_Enabled[m_Order[k]])
+				EvalEngine(m_Engines[m_Order[k]]);
+		}
+	}
+
+	if (m_bTiming)
+	{
+		m_fEvalTime = std::chrono::duration<float>(
+			std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+static bool SlowerEngine(vtEngine *a, vtEngine *b)
+{
+	return a->GetAverageEvalTime() > b->GetAverageEvalTime();
+}
+
+/**
+ * Write the engines which take the most time to the log.  Timing must be
+ * turned on with SetTiming.
+ */
+void vtEngineScheduler::LogTimes(uint iHowMany) const
+{
+	std::vector<vtEngine*> sorted = m_Engines;
+	std::sort(sorted.begin(), sorted.end(), SlowerEngine);
+	if (iHowMany > sorted.size())
+		iHowMany = (uint) sorted.size();
+
+	VTLOG("Engines: %d in %d stages, last frame %.3f ms\n", NumEngines(),
+		NumStages(), m_fEvalTime * 1000);
+	for (uint i = 0; i < iHowMany; i++)
+	{
+		vtEngine *pEng = sorted[i];
+		VTLOG("  %8.3f ms avg, %8.3f ms last, %s '%s'\n",
+			pEng->GetAverageEvalTime() * 1000, pEng->GetEvalTime() * 1000,
+			pEng->GetThreadSafe() ? "parallel" : "serial  ", pEng->getName());
+	}
+}
+
 void vtEngine::OnMouse(vtMouseEvent &event)
 {
 }
@@ -92,18 +92,53 @@ public:
 	vtWindow *GetWindow() { return m_pWindow; }
 
 	// Engine tree methods
-	void AddChild(vtEngine *pEngine) { m_Children.push_back(pEngine); }
+	void AddChild(vtEngine *pEngine) { m_Children.push_back(pEngine); s_iTreeVersion++; }
 	void RemoveChild(vtEngine *pEngine);
 	vtEngine *GetChild(uint i) { return m_Children[i].get(); }
 	uint NumChildren() { return m_Children.size(); }
 
 	void AddChildrenToList(class vtEngineArray &list, bool bEnabledOnly);
 
+	/**
+	 * Declare that this engine's Eval() may run on another thread, at the
+	 * same time as other thread-safe engines.  Such an engine must only
+	 * change its own targets, which no other engine changes.  By default,
+	 * engines are not thread-safe, and they are evaluated one at a time in
+	 * the order of the engine tree.
+	 */
+	void SetThreadSafe(bool bSafe) { m_bThreadSafe = bSafe; s_iTreeVersion++; }
+	bool GetThreadSafe() const { return m_bThreadSafe; }
+
+	/**
+	 * Declare that this engine must be evaluated after another engine.  An
+	 * engine is always evaluated after its parent in the engine tree.
+	 */
+	void AddDependency(vtEngine *pEngine);
+	void RemoveDependency(vtEngine *pEngine);
+	vtEngine *GetDependency(uint i) { return m_Dependencies[i]; }
+	uint NumDependencies() { return m_Dependencies.size(); }
+
+	/// The time taken by the last Eval() of this engine, in seconds.
+	float GetEvalTime() const { return m_fEvalTime; }
+	/// The average time taken by Eval() over recent frames, in seconds.
+	float GetAverageEvalTime() const { return m_fAvgEvalTime; }
+
+	/// A number which changes whenever any engine tree is changed.
+	static uint GetTreeVersion() { return s_iTreeVersion; }
+
 protected:
+	friend class vtEngineScheduler;
+
 	std::vector<ReferencePtr> m_Targets;
 	std::vector<vtEnginePtr> m_Children;
+	std::vector<vtEngine*> m_Dependencies;
 	vtString		 m_strName;
 	vtWindow		*m_pWindow;
+	bool			 m_bThreadSafe;
+	float			 m_fEvalTime;
+	float			 m_fAvgEvalTime;
+
+	static uint s_iTreeVersion;
 
 protected:
 	~vtEngine() {}
@@ -120,6 +155,70 @@ public:
 	}
 };
 
+/**
+ * Evaluates the engines of an engine tree each frame.  The tree is
+ * flattened into a list once, and kept until the tree changes.
+ *
+ * Engines which declare themselves thread-safe (vtEngine::SetThreadSafe)
+ * are evaluated in parallel, once everything they depend on has been
+ * evaluated: their parent, and any engines given to
+ * vtEngine::AddDependency.  Other engines are evaluated one at a time, in
+ * the order of the tree, just as if there was no scheduler.
+ *
+ * Optionally, the time taken by each engine is measured, see
+ * vtEngine::GetEvalTime.
+ */
+class vtEngineScheduler
+{
+public:
+	vtEngineScheduler();
+
+	void Eval(vtEngine *pRoot);
+	void Invalidate() { m_pRoot = NULL; }
+
+	/// Set whether thread-safe engines are run in parallel (default true).
+	void SetParallel(bool bOn) { m_bParallel = bOn; }
+	bool GetParallel() const { return m_bParallel; }
+
+	/// Set whether to measure the time taken by each engine (default false).
+	void SetTiming(bool bOn) { m_bTiming = bOn; }
+	bool GetTiming() const { return m_bTiming; }
+
+	uint NumEngines() const { return (uint) m_Engines.size(); }
+	vtEngine *GetEngine(uint i) const { return m_Engines[i]; }
+	/// The number of steps which the engines are evaluated in.
+	uint NumStages() const { return (uint) m_StageStart.size() - 1; }
+	/// The total time taken by the last Eval(), in seconds.
+	float GetEvalTime() const { return m_fEvalTime; }
+
+	void LogTimes(uint iHowMany = 10) const;
+
+protected:
+	void Rebuild(vtEngine *pRoot);
+	void EvalEngine(vtEngine *pEngine);
+
+	vtEngine *m_pRoot;
+	uint m_iVersion;
+	bool m_bParallel;
+	bool m_bTiming;
+	float m_fEvalTime;
+
+	// The whole tree, in tree order, with the index of each engine's parent
+	std::vector<vtEngine*> m_Engines;
+	std::vector<int> m_Parent;
+
+	// The engines, grouped into stages which must run one after another.
+	//  Stage i is m_Order[m_StageStart[i]] to m_Order[m_StageStart[i+1]-1],
+	//  with the thread-safe engines first, then at most one other engine.
+	std::vector<int> m_Order;
+	std::vector<int> m_StageStart;
+	std::vector<int> m_StageSerial;		// first non-thread-safe entry
+
+	// Per-frame working memory
+	std::vector<char> m_Enabled;
+	std::vector<vtEngine*> m_Batch;
+};
+
 
 /**
  * This simple engine extends the base class vtEngine with the ability to
@@ -606,9 +606,10 @@ void vtIcoGlobe::BuildSphericalLines(GlobeLayer *glay, float fSize)
 	glay->addChild(geode);
 
 	vtGeomFactory mf(geode, osg::PrimitiveSet::LINE_STRIP, 0, 30000, m_yellow);
+	DLine2 line;
 	for (i = 0; i < size; i++)
 	{
-		const DLine2 &line = pSetLS->GetPolyLine(i);
+		pSetLS->GetPolyLineView(i).ToDLine2(line);
 		AddSurfaceLineToMesh(&mf, line);
 	}
 }
@@ -630,12 +631,13 @@ void vtIcoGlobe::BuildSphericalPolygons(GlobeLayer *glay, float fSize)
 	glay->addChild(geode);
 
 	vtGeomFactory mf(geode, osg::PrimitiveSet::LINE_STRIP, 0, 30000, m_yellow);
+	DLine2 line;
 	for (i = 0; i < size; i++)
 	{
-		const DPolygon2 &poly = pSetPoly->GetPolygon(i);
+		const DPolygon2View poly = pSetPoly->GetPolygonView(i);
 		for (uint ring = 0; ring < poly.size(); ring++)
 		{
-			const DLine2 &line = poly[ring];
+			poly[ring].ToDLine2(line);
 			AddSurfaceLineToMesh(&mf, line);
 		}
 	}
@@ -89,7 +89,7 @@ int vtMaterialDescriptorArray3d::CreateSelfColoredMaterial(vtMaterialDescriptor
 	vtMaterial *pMat = MakeMaterial(descriptor, color);
 
 	vtString path = FindFileOnPaths(vtGetDataPath(), descriptor->GetTextureFilename());
-	pMat->SetTexture2D(osgDB::readImageFile((const char *)path));
+	pMat->SetTexture2D(LoadOsgImage(path));
 	pMat->SetClamp(false);	// material needs to repeat
 
 	if (descriptor->GetBlending())
@@ -120,7 +120,7 @@ int vtMaterialDescriptorArray3d::CreateColorableTextureMaterial(vtMaterialDescri
 		VTLOG("\n\tMissing texture: %s\n", (const char *) texture_filename);
 		return -1;
 	}
-	ImagePtr img = osgDB::readImageFile((const char *)path);
+	ImagePtr img = LoadOsgImage(path);
 	if (!img.valid())
 		return -1;
 
@@ -229,7 +229,7 @@ osg::StateSet *MakeTextureStatesetForPlantBillboard(const char *fname)
 	osg::Texture2D *tex = new osg::Texture2D;
 	tex->setWrap( osg::Texture2D::WRAP_S, osg::Texture2D::CLAMP );
 	tex->setWrap( osg::Texture2D::WRAP_T, osg::Texture2D::CLAMP );
-	tex->setImage(osgDB::readImageFile(fname));
+	tex->setImage(LoadOsgImage(fname));
 
 	osg::StateSet *dstate = new osg::StateSet;
 	dstate->setTextureAttributeAndModes(0, tex, osg::StateAttribute::ON );
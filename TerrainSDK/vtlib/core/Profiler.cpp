@@ -0,0 +1,372 @@
+//
+// Profiler.cpp
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include "vtlib/vtlib.h"
+#include "vtdata/FilePath.h"
+#include "vtdata/vtLog.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+#define DEFAULT_HISTORY	300
+
+vtProfiler &vtGetProfiler()
+{
+	static vtProfiler s_Profiler;
+	return s_Profiler;
+}
+
+vtProfiler::vtProfiler()
+{
+	m_bEnabled = true;
+	m_iNumZones = 0;
+	m_iNumCounters = 0;
+	m_bInFrame = false;
+	m_iFrameNumber = 0;
+	for (int i = 0; i < VTPROF_MAX_ZONES; i++)
+	{
+		m_ZoneNanos[i] = 0;
+		m_ZoneCalls[i] = 0;
+	}
+	for (int i = 0; i < VTPROF_MAX_COUNTERS; i++)
+		m_Counts[i] = 0;
+	m_History.resize(DEFAULT_HISTORY);
+	m_iNext = 0;
+	m_iFrames = 0;
+}
+
+/**
+ * Get the number of a zone, adding it if there is no zone with that name.
+ * \return The zone number, or -1 if there are too many zones.
+ */
+int vtProfiler::RegisterZone(const char *szName)
+{
+	std::lock_guard<std::mutex> lock(m_NameMutex);
+	for (uint i = 0; i < m_iNumZones; i++)
+		if (m_ZoneNames[i] == szName)
+			return i;
+	if (m_iNumZones == VTPROF_MAX_ZONES)
+	{
+		VTLOG("Profiler: too many zones, ignoring '%s'\n", szName);
+		return -1;
+	}
+	m_ZoneNames[m_iNumZones] = szName;
+	return m_iNumZones++;
+}
+
+/**
+ * Get the number of a counter, adding it if there is no counter with that
+ * name.
+ * \return The counter number, or -1 if there are too many counters.
+ */
+int vtProfiler::RegisterCounter(const char *szName)
+{
+	std::lock_guard<std::mutex> lock(m_NameMutex);
+	for (uint i = 0; i < m_iNumCounters; i++)
+		if (m_CounterNames[i] == szName)
+			return i;
+	if (m_iNumCounters == VTPROF_MAX_COUNTERS)
+	{
+		VTLOG("Profiler: too many counters, ignoring '%s'\n", szName);
+		return -1;
+	}
+	m_CounterNames[m_iNumCounters] = szName;
+	return m_iNumCounters++;
+}
+
+int vtProfiler::FindZone(const char *szName) const
+{
+	for (uint i = 0; i < m_iNumZones; i++)
+		if (m_ZoneNames[i] == szName)
+			return i;
+	return -1;
+}
+
+int vtProfiler::FindCounter(const char *szName) const
+{
+	for (uint i = 0; i < m_iNumCounters; i++)
+		if (m_CounterNames[i] == szName)
+			return i;
+	return -1;
+}
+
+/**
+ * Set how many frames of history are kept.  This clears the history.
+ */
+void vtProfiler::SetHistoryLength(uint iFrames)
+{
+	std::lock_guard<std::mutex> lock(m_HistoryMutex);
+	m_History.clear();
+	m_History.resize(std::max(iFrames, 1u));
+	m_iNext = 0;
+	m_iFrames = 0;
+}
+
+void vtProfiler::ClearHistory()
+{
+	std::lock_guard<std::mutex> lock(m_HistoryMutex);
+	m_iNext = 0;
+	m_iFrames = 0;
+}
+
+void vtProfiler::BeginFrame()
+{
+	for (uint i = 0; i < m_iNumZones; i++)
+	{
+		m_ZoneNanos[i] = 0;
+		m_ZoneCalls[i] = 0;
+	}
+	for (uint i = 0; i < m_iNumCounters; i++)
+		m_Counts[i] = 0;
+	m_FrameStart = std::chrono::steady_clock::now();
+	m_bInFrame = true;
+}
+
+void vtProfiler::EndFrame()
+{
+	if (!m_bInFrame)
+		return;
+	m_bInFrame = false;
+	if (!m_bEnabled)
+		return;
+
+	const double dTime = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - m_FrameStart).count();
+
+	std::lock_guard<std::mutex> lock(m_HistoryMutex);
+	FrameRecord &rec = m_History[m_iNext];
+	rec.m_iFrame = m_iFrameNumber++;
+	rec.m_dTime = dTime;
+	for (int i = 0; i < VTPROF_MAX_ZONES; i++)
+	{
+		rec.m_ZoneNanos[i] = m_ZoneNanos[i];
+		rec.m_ZoneCalls[i] = m_ZoneCalls[i];
+	}
+	for (int i = 0; i < VTPROF_MAX_COUNTERS; i++)
+		rec.m_Counts[i] = m_Counts[i];
+
+	m_iNext = (m_iNext + 1) % m_History.size();
+	if (m_iFrames < m_History.size())
+		m_iFrames++;
+}
+
+const vtProfiler::FrameRecord &vtProfiler::GetRecord(uint iAgo) const
+{
+	const uint len = (uint) m_History.size();
+	return m_History[(m_iNext + len - 1 - (iAgo % len)) % len];
+}
+
+// The time of a zone, or of the whole frame if the zone is -1
+double vtProfiler::RecordValue(const FrameRecord &rec, int iZone) const
+{
+	if (iZone < 0)
+		return rec.m_dTime;
+	return rec.m_ZoneNanos[iZone] * 1E-9;
+}
+
+uint vtProfiler::GetFrameNumber(uint iAgo) const
+{
+	std::lock_guard<std::mutex> lock(m_HistoryMutex);
+	return (iAgo < m_iFrames) ? GetRecord(iAgo).m_iFrame : 0;
+}
+
+double vtProfiler::GetFrameTime(uint iAgo) const
+{
+	std::lock_guard<std::mutex> lock(m_HistoryMutex);
+	return (iAgo < m_iFrames) ? GetRecord(iAgo).m_dTime : 0.0;
+}
+
+double vtProfiler::GetZoneTime(uint iAgo, int iZone) const
+{
+	std::lock_guard<std::mutex> lock(m_HistoryMutex);
+	if (iAgo >= m_iFrames || iZone < 0 || iZone >= (int) m_iNumZones)
+		return 0.0;
+	return RecordValue(GetRecord(iAgo), iZone);
+}
+
+int vtProfiler::GetZoneCalls(uint iAgo, int iZone) const
+{
+	std::lock_guard<std::mutex> lock(m_HistoryMutex);
+	if (iAgo >= m_iFrames || iZone < 0 || iZone >= (int) m_iNumZones)
+		return 0;
+	return GetRecord(iAgo).m_ZoneCalls[iZone];
+}
+
+int64_t vtProfiler::GetCount(uint iAgo, int iCounter) const
+{
+	std::lock_guard<std::mutex> lock(m_HistoryMutex);
+	if (iAgo >= m_iFrames || iCounter < 0 || iCounter >= (int) m_iNumCounters)
+		return 0;
+	return GetRecord(iAgo).m_Counts[iCounter];
+}
+
+/**
+ * Summarize the time taken by a zone over all the recorded frames.
+ *
+ * \param iZone The zone, or -1 for the whole frame.
+ * \param stats The results, in seconds.
+ * \return false if there are no frames recorded.
+ */
+bool vtProfiler::GetZoneStats(int iZone, Stats &stats) const
+{
+	std::vector<double> values;
+	{
+		std::lock_guard<std::mutex> lock(m_HistoryMutex);
+		for (uint i = 0; i < m_iFrames; i++)
+			values.push_back(RecordValue(GetRecord(i), iZone));
+	}
+	if (values.empty())
+		return false;
+
+	std::sort(values.begin(), values.end());
+	const size_t n = values.size();
+	double sum = 0.0;
+	for (size_t i = 0; i < n; i++)
+		sum += values[i];
+
+	stats.m_dMin = values[0];
+	stats.m_dMax = values[n-1];
+	stats.m_dMean = sum / n;
+	stats.m_dMedian = values[n / 2];
+	stats.m_dP95 = values[std::min(n - 1, (size_t) (n * 0.95))];
+	stats.m_dP99 = values[std::min(n - 1, (size_t) (n * 0.99))];
+	return true;
+}
+
+/**
+ * Count how many of the recorded frames had a zone take each amount of
+ * time.  Bucket 0 counts times less than dFirst, and each following bucket
+ * is twice as wide as the one before; the last bucket also counts anything
+ * longer.
+ *
+ * \param iZone The zone, or -1 for the whole frame.
+ * \param buckets Receives the counts.
+ * \param dFirst The top of the first bucket, in seconds.
+ * \param iBuckets The number of buckets.
+ */
+void vtProfiler::GetZoneHistogram(int iZone, std::vector<uint> &buckets,
+	double dFirst, uint iBuckets) const
+{
+	buckets.assign(iBuckets, 0);
+	if (iBuckets == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_HistoryMutex);
+	for (uint i = 0; i < m_iFrames; i++)
+	{
+		const double value = RecordValue(GetRecord(i), iZone);
+		uint b = 0;
+		for (double top = dFirst; value >= top && b < iBuckets - 1; top *= 2)
+			b++;
+		buckets[b]++;
+	}
+}
+
+// A name as a JSON string, with quotes, backslashes and control
+//  characters escaped.
+static vtString JSONString(const char *name)
+{
+	vtString str = "\"";
+	for (const char *p = name; *p; p++)
+	{
+		if (*p == '"' || *p == '\\')
+		{
+			str += '\\';
+			str += *p;
+		}
+		else if ((uchar) *p < 0x20)
+		{
+			vtString code;
+			code.Format("\\u%04x", (uchar) *p);
+			str += code;
+		}
+		else
+			str += *p;
+	}
+	str += "\"";
+	return str;
+}
+
+/**
+ * Write the recorded frames to a JSON file, oldest first.  Times are in
+ * milliseconds.
+ */
+bool vtProfiler::WriteJSON(const char *fname) const
+{
+	FILE *fp = vtFileOpen(fname, "wb");
+	if (!fp)
+		return false;
+
+	// Numbers must be written with '.' whatever the user's locale
+	ScopedLocale normal_numbers(LC_NUMERIC, "C");
+
+	const uint zones = m_iNumZones, counters = m_iNumCounters;
+	fprintf(fp, "{\n  \"zones\": [");
+	for (uint z = 0; z < zones; z++)
+		fprintf(fp, "%s%s", z ? ", " : "", (const char *) JSONString(m_ZoneNames[z]));
+	fprintf(fp, "],\n  \"counters\": [");
+	for (uint c = 0; c < counters; c++)
+		fprintf(fp, "%s%s", c ? ", " : "", (const char *) JSONString(m_CounterNames[c]));
+	fprintf(fp, "],\n  \"frames\": [\n");
+
+	std::lock_guard<std::mutex> lock(m_HistoryMutex);
+	for (int i = (int) m_iFrames - 1; i >= 0; i--)
+	{
+		const FrameRecord &rec = GetRecord(i);
+		fprintf(fp, "    { \"frame\": %u, \"ms\": %.4f, \"zones\": [", rec.m_iFrame,
+			rec.m_dTime * 1000);
+		for (uint z = 0; z < zones; z++)
+			fprintf(fp, "%s%.4f", z ? ", " : "", rec.m_ZoneNanos[z] * 1E-6);
+		fprintf(fp, "], \"calls\": [");
+		for (uint z = 0; z < zones; z++)
+			fprintf(fp, "%s%d", z ? ", " : "", rec.m_ZoneCalls[z]);
+		fprintf(fp, "], \"counters\": [");
+		for (uint c = 0; c < counters; c++)
+			fprintf(fp, "%s%lld", c ? ", " : "", (long long) rec.m_Counts[c]);
+		fprintf(fp, "] }%s\n", i ? "," : "");
+	}
+	fprintf(fp, "  ]\n}\n");
+	fclose(fp);
+	return true;
+}
+
+/**
+ * Write the recorded frames to a CSV file, oldest first, one row per frame.
+ * Times are in milliseconds.
+ */
+bool vtProfiler::WriteCSV(const char *fname) const
+{
+	FILE *fp = vtFileOpen(fname, "wb");
+	if (!fp)
+		return false;
+
+	// Numbers must be written with '.' whatever the user's locale
+	ScopedLocale normal_numbers(LC_NUMERIC, "C");
+
+	const uint zones = m_iNumZones, counters = m_iNumCounters;
+	fprintf(fp, "frame,frame_ms");
+	for (uint z = 0; z < zones; z++)
+		fprintf(fp, ",%s ms", (const char *) m_ZoneNames[z]);
+	for (uint c = 0; c < counters; c++)
+		fprintf(fp, ",%s", (const char *) m_CounterNames[c]);
+	fprintf(fp, "\n");
+
+	std::lock_guard<std::mutex> lock(m_HistoryMutex);
+	for (int i = (int) m_iFrames - 1; i >= 0; i--)
+	{
+		const FrameRecord &rec = GetRecord(i);
+		fprintf(fp, "%u,%.4f", rec.m_iFrame, rec.m_dTime * 1000);
+		for (uint z = 0; z < zones; z++)
+			fprintf(fp, ",%.4f", rec.m_ZoneNanos[z] * 1E-6);
+		for (uint c = 0; c < counters; c++)
+			fprintf(fp, ",%lld", (long long) rec.m_Counts[c]);
+		fprintf(fp, "\n");
+	}
+	fclose(fp);
+	return true;
+}
+
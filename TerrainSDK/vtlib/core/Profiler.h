@@ -0,0 +1,199 @@
+//
+// Profiler.h
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+#include "vtdata/vtString.h"
+
+#define VTPROF_MAX_ZONES	64
+#define VTPROF_MAX_COUNTERS	64
+
+/** \addtogroup eng */
+/*@{*/
+
+/**
+ * A lightweight profiler which records where the time goes in each frame.
+ *
+ * A zone is a named part of the code, such as "Engines" or "Terrain cull".
+ * Each time a zone runs, its time is added to the current frame.  Zones may
+ * nest, and may run on any thread.  A counter is a named number, such as the
+ * number of triangles drawn, which is either added to during the frame or
+ * simply set.
+ *
+ * The scene marks the start and end of each frame.  The results of the last
+ * N frames are kept in a ring buffer, where they can be queried, summarized
+ * or written to a JSON or CSV file, for example for automated performance
+ * tests.
+ *
+ * The cost is two clock reads per zone, so it is always on unless it is
+ * explicitly turned off with SetEnabled(false).
+ *
+ * Most code uses the macros rather than calling this class directly:
+ \code
+ void vtSomething::Update()
+ {
+	VTPROFILE_ZONE("Something update");
+	...
+	VTPROFILE_COUNT("Something items", iItems);
+ }
+ \endcode
+ */
+class vtProfiler
+{
+public:
+	vtProfiler();
+
+	int RegisterZone(const char *szName);
+	int RegisterCounter(const char *szName);
+	uint NumZones() const { return m_iNumZones; }
+	uint NumCounters() const { return m_iNumCounters; }
+	const char *GetZoneName(int iZone) const { return m_ZoneNames[iZone]; }
+	const char *GetCounterName(int iCounter) const { return m_CounterNames[iCounter]; }
+	int FindZone(const char *szName) const;
+	int FindCounter(const char *szName) const;
+
+	void SetEnabled(bool bOn) { m_bEnabled = bOn; }
+	bool GetEnabled() const { return m_bEnabled; }
+	void SetHistoryLength(uint iFrames);
+	uint GetHistoryLength() const { return (uint) m_History.size(); }
+
+	void BeginFrame();
+	void EndFrame();
+
+	/// Add time to a zone in the current frame.  Safe to call from any thread.
+	void AddZoneTime(int iZone, int64_t iNanoseconds)
+	{
+		if (iZone < 0) return;
+		m_ZoneNanos[iZone] += iNanoseconds;
+		m_ZoneCalls[iZone]++;
+	}
+	/// Add to a counter in the current frame.  Safe to call from any thread.
+	void AddCount(int iCounter, int64_t iAmount = 1)
+	{
+		if (iCounter >= 0) m_Counts[iCounter] += iAmount;
+	}
+	/// Set a counter for the current frame.  Safe to call from any thread.
+	void SetCount(int iCounter, int64_t iValue)
+	{
+		if (iCounter >= 0) m_Counts[iCounter] = iValue;
+	}
+
+	// Queries.  Frame 0 is the most recently finished frame, 1 the one
+	//  before, and so on.  Times are in seconds.
+	uint NumFrames() const { return m_iFrames; }
+	uint GetFrameNumber(uint iAgo) const;
+	double GetFrameTime(uint iAgo) const;
+	double GetZoneTime(uint iAgo, int iZone) const;
+	int GetZoneCalls(uint iAgo, int iZone) const;
+	int64_t GetCount(uint iAgo, int iCounter) const;
+
+	/// A summary of a zone's time over the recorded frames.
+	struct Stats
+	{
+		double m_dMin, m_dMax, m_dMean;
+		double m_dMedian, m_dP95, m_dP99;
+	};
+	bool GetZoneStats(int iZone, Stats &stats) const;
+	void GetZoneHistogram(int iZone, std::vector<uint> &buckets,
+		double dFirst = 0.0005, uint iBuckets = 12) const;
+
+	bool WriteJSON(const char *fname) const;
+	bool WriteCSV(const char *fname) const;
+	void ClearHistory();
+
+protected:
+	struct FrameRecord
+	{
+		uint m_iFrame;
+		double m_dTime;
+		int64_t m_ZoneNanos[VTPROF_MAX_ZONES];
+		int m_ZoneCalls[VTPROF_MAX_ZONES];
+		int64_t m_Counts[VTPROF_MAX_COUNTERS];
+	};
+	const FrameRecord &GetRecord(uint iAgo) const;
+	double RecordValue(const FrameRecord &rec, int iZone) const;
+
+	std::atomic<bool> m_bEnabled;
+
+	// Names are only ever added, so they can be read without locking
+	mutable std::mutex m_NameMutex;
+	vtString m_ZoneNames[VTPROF_MAX_ZONES];
+	vtString m_CounterNames[VTPROF_MAX_COUNTERS];
+	std::atomic<uint> m_iNumZones;
+	std::atomic<uint> m_iNumCounters;
+
+	// The frame in progress
+	std::chrono::steady_clock::time_point m_FrameStart;
+	bool m_bInFrame;
+	uint m_iFrameNumber;
+	std::atomic<int64_t> m_ZoneNanos[VTPROF_MAX_ZONES];
+	std::atomic<int> m_ZoneCalls[VTPROF_MAX_ZONES];
+	std::atomic<int64_t> m_Counts[VTPROF_MAX_COUNTERS];
+
+	// Finished frames
+	mutable std::mutex m_HistoryMutex;
+	std::vector<FrameRecord> m_History;
+	uint m_iNext;
+	uint m_iFrames;
+};
+
+/// The profiler which vtlib uses.
+vtProfiler &vtGetProfiler();
+
+/**
+ * Measures the time from its construction to the end of the enclosing
+ * block, and adds it to a zone of the profiler.
+ */
+class vtProfileScope
+{
+public:
+	vtProfileScope(int iZone)
+	{
+		m_iZone = vtGetProfiler().GetEnabled() ? iZone : -1;
+		if (m_iZone >= 0)
+			m_Start = std::chrono::steady_clock::now();
+	}
+	~vtProfileScope()
+	{
+		if (m_iZone >= 0)
+		{
+			vtGetProfiler().AddZoneTime(m_iZone,
+				std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - m_Start).count());
+		}
+	}
+protected:
+	int m_iZone;
+	std::chrono::steady_clock::time_point m_Start;
+};
+
+#define VTPROF_CONCAT2(a, b) a##b
+#define VTPROF_CONCAT(a, b) VTPROF_CONCAT2(a, b)
+
+/// Time the rest of the enclosing block as a zone with the given name.
+#define VTPROFILE_ZONE(name) \
+	static const int VTPROF_CONCAT(vtprof_zone_, __LINE__) = vtGetProfiler().RegisterZone(name); \
+	vtProfileScope VTPROF_CONCAT(vtprof_scope_, __LINE__)(VTPROF_CONCAT(vtprof_zone_, __LINE__))
+
+/// Add an amount to the counter with the given name, for this frame.
+#define VTPROFILE_COUNT(name, amount) do { \
+	static const int vtprof_counter = vtGetProfiler().RegisterCounter(name); \
+	vtGetProfiler().AddCount(vtprof_counter, amount); } while (0)
+
+/// Set the counter with the given name, for this frame.
+#define VTPROFILE_SET(name, value) do { \
+	static const int vtprof_counter = vtGetProfiler().RegisterCounter(name); \
+	vtGetProfiler().SetCount(vtprof_counter, value); } while (0)
+
+/*@}*/	// Group eng
+
@@ -10,6 +10,9 @@
 #include "vtlib/vtlib.h"
 #include "vtdata/vtLog.h"
 #include "vtdata/DataPath.h"
+#include "vtdata/Parallel.h"
+
+#include <set>
 
 #include "Light.h"
 #include "Roads.h"
@@ -70,6 +73,8 @@ FPoint3 CreateUnitLinkVector(FPoint3 p1, FPoint3 p2)
 NodeGeom::NodeGeom()
 {
 	m_iVerts = 0;
+	m_pMesh = NULL;
+	m_pGeode = NULL;
 }
 
 NodeGeom::~NodeGeom()
@@ -337,6 +342,8 @@ RoadBuildInfo::RoadBuildInfo(int iCoords)
 
 LinkGeom::LinkGeom()
 {
+	m_pMesh = NULL;
+	m_pGeode = NULL;
 }
 
 LinkGeom::~LinkGeom()
@@ -442,6 +449,20 @@ void LinkGeom::AddRoadStrip(vtMesh *pMesh, RoadBuildInfo &bi,
 }
 
 void LinkGeom::GenerateGeometry(vtRoadMap3d *rmgeom)
+{
+	if (GetSize() < 2)	// safety check
+		return;
+
+	RoadBuildInfo bi(GetSize());
+	SetupBuildInfo(bi);
+	GenerateGeometry(rmgeom, bi);
+}
+
+/**
+ * Create the mesh for this link, from a RoadBuildInfo which has already been
+ * filled in by SetupBuildInfo.
+ */
+void LinkGeom::GenerateGeometry(vtRoadMap3d *rmgeom, RoadBuildInfo &bi)
 {
 	if (GetSize() < 2)	// safety check
 		return;
@@ -484,9 +505,6 @@ void LinkGeom::GenerateGeometry(vtRoadMap3d *rmgeom)
 	vtMesh *pMesh = new vtMesh(osg::PrimitiveSet::TRIANGLE_STRIP, VT_TexCoords | VT_Normals,
 		total_vertices);
 
-	RoadBuildInfo bi(GetSize());
-	SetupBuildInfo(bi);
-
 	const float center_width = m_iLanes * m_fLaneWidth;
 	float offset = -(center_width / 2);
 	if (m_iFlags & RF_MARGIN)
@@ -643,7 +661,8 @@ void LinkGeom::GenerateGeometry(vtRoadMap3d *rmgeom)
 	}
 
 	assert(total_vertices == bi.verts);
-	rmgeom->AddMeshToGrid(pMesh, rmgeom->m_vt[m_vti].m_idx);
+	m_pGeode = rmgeom->AddMeshToGrid(pMesh, rmgeom->m_vt[m_vti].m_idx);
+	m_pMesh = pMesh;
 }
 
 
@@ -730,7 +749,7 @@ void vtRoadMap3d::ComputeIntersectionVertices()
 
 int clusters_used = 0;	// for statistical purposes
 
-void vtRoadMap3d::AddMeshToGrid(vtMesh *pMesh, int iMatIdx)
+vtGeode *vtRoadMap3d::AddMeshToGrid(vtMesh *pMesh, int iMatIdx)
 {
 	// which cluster does it belong to?
 	int a, b;
@@ -780,6 +799,7 @@ void vtRoadMap3d::AddMeshToGrid(vtMesh *pMesh, int iMatIdx)
 		clusters_used++;
 	}
 	pGeode->AddMesh(pMesh, iMatIdx);
+	return pGeode;
 }
 
 
@@ -814,11 +834,12 @@ vtTransform *vtRoadMap3d::GenerateGeometry(bool do_texture,
 	m_pGroup->addChild(pGeode);
 #endif
 
-	vtMesh *pMesh;
 	int count = 0, total = NumLinks() + NumNodes();
+
+	// Decide which links to construct
+	std::vector<LinkGeom*> links;
 	for (LinkGeom *pL = GetFirstLink(); pL; pL = pL->GetNext())
 	{
-		// Decide whether to construct this link
 		bool include = false;
 		if (bHwy && bPaved && bDirt)
 			include = true;
@@ -832,8 +853,23 @@ vtTransform *vtRoadMap3d::GenerateGeometry(bool do_texture,
 			if (bDirt && bIsDirt)
 				include = true;
 		}
-		if (include)
-			pL->GenerateGeometry(this);
+		if (include && pL->GetSize() >= 2)
+			links.push_back(pL);
+	}
+
+	// The shape of each link's surface only depends on its own centerline and
+	//  the node vertices, so it can be worked out on all threads at once.
+	//  The meshes themselves must be created on this thread.
+	std::vector<RoadBuildInfo*> infos(links.size());
+	vtParallelFor((int) links.size(), [&](int i)
+	{
+		infos[i] = new RoadBuildInfo(links[i]->GetSize());
+		links[i]->SetupBuildInfo(*infos[i]);
+	});
+	for (size_t i = 0; i < links.size(); i++)
+	{
+		links[i]->GenerateGeometry(this, *infos[i]);
+		delete infos[i];
 		count++;
 		if (progress_callback != NULL)
 			progress_callback(count * 100 / total);
@@ -841,28 +877,7 @@ vtTransform *vtRoadMap3d::GenerateGeometry(bool do_texture,
 	count = 0;
 	for (NodeGeom *pN = GetFirstNode(); pN; pN = pN->GetNext())
 	{
-		// What material to use?  We used to simply use "pavement", but that is
-		// bad when they are e.g. trail or stone.  Now, we will try to guess
-		// what to use by looking at the links here.
-		int node_vti = VTI_PAVEMENT;
-		for (int i = 0; i < pN->NumLinks(); i++)
-		{
-			LinkGeom *pL = pN->GetLink(i);
-			switch (pL->m_vti)
-			{
-			case VTI_RAIL:
-			case VTI_4WD:
-			case VTI_TRAIL:
-			case VTI_GRAVEL:
-			case VTI_STONE:
-				node_vti = pL->m_vti;
-			}
-		}
-		VirtualTexture &vt = m_vt[node_vti];
-
-		pMesh = pN->GenerateGeometry(vt);
-		if (pMesh)
-			AddMeshToGrid(pMesh, vt.m_idx);
+		_GenerateNodeGeometry(pN);
 		count++;
 		if (progress_callback != NULL)
 			progress_callback(count * 100 / total);
@@ -872,6 +887,32 @@ vtTransform *vtRoadMap3d::GenerateGeometry(bool do_texture,
 	return m_pTransform;
 }
 
+void vtRoadMap3d::_GenerateNodeGeometry(NodeGeom *pN)
+{
+	// What material to use?  We used to simply use "pavement", but that is
+	// bad when they are e.g. trail or stone.  Now, we will try to guess
+	// what to use by looking at the links here.
+	int node_vti = VTI_PAVEMENT;
+	for (int i = 0; i < pN->NumLinks(); i++)
+	{
+		LinkGeom *pL = pN->GetLink(i);
+		switch (pL->m_vti)
+		{
+		case VTI_RAIL:
+		case VTI_4WD:
+		case VTI_TRAIL:
+		case VTI_GRAVEL:
+		case VTI_STONE:
+			node_vti = pL->m_vti;
+		}
+	}
+	VirtualTexture &vt = m_vt[node_vti];
+
+	pN->m_pMesh = pN->GenerateGeometry(vt);
+	if (pN->m_pMesh)
+		pN->m_pGeode = AddMeshToGrid(pN->m_pMesh, vt.m_idx);
+}
+
 int vtRoadMap3d::_CreateMaterial(const char *texture_filename, bool bTransparency)
 {
 	vtString fname = "GeoTypical/";
@@ -1132,7 +1173,6 @@ float vtRoadMap3d::GetLodDistance()
 
 void vtRoadMap3d::DrapeOnTerrain(vtHeightField3d *pHeightField)
 {
-	FPoint3 p;
 	NodeGeom *pN;
 
 #if 0
@@ -1168,9 +1208,21 @@ void vtRoadMap3d::DrapeOnTerrain(vtHeightField3d *pHeightField)
 		}
 	}
 #endif
+	// Drape all the nodes in one batch
+	std::vector<DPoint2> node_pos;
+	std::vector<FPoint3> node_p3;
+	node_pos.reserve(NumNodes());
 	for (pN = GetFirstNode(); pN; pN = pN->GetNext())
+		node_pos.push_back(pN->Pos());
+	node_p3.resize(node_pos.size());
+	if (!node_pos.empty())
+		pHeightField->ConvertEarthToSurfacePoints(&node_pos[0], &node_p3[0],
+			(uint) node_pos.size());
+
+	int n = 0;
+	for (pN = GetFirstNode(); pN; pN = pN->GetNext(), n++)
 	{
-		pHeightField->ConvertEarthToSurfacePoint(pN->Pos(), pN->m_p3);
+		pN->m_p3 = node_p3[n];
 #if 0
 		if (pN->NumLinks() > 0)
 		{
@@ -1179,16 +1231,88 @@ void vtRoadMap3d::DrapeOnTerrain(vtHeightField3d *pHeightField)
 		}
 #endif
 	}
+
+	// Each link is draped independently, so if the heightfield allows it,
+	//  they can all be done at once.
+	std::vector<LinkGeom*> links;
+	links.reserve(NumLinks());
 	for (LinkGeom *pL = GetFirstLink(); pL; pL = pL->GetNext())
+		links.push_back(pL);
+
+	auto drape_link = [&](int i)
 	{
-		pL->m_centerline.SetSize(pL->GetSize());
-		for (uint j = 0; j < pL->GetSize(); j++)
-		{
-			pHeightField->ConvertEarthToSurfacePoint(pL->GetAt(j), p);
-			pL->m_centerline[j] = p;
-		}
+		LinkGeom *pL = links[i];
+		const uint size = pL->GetSize();
+		pL->m_centerline.SetSize(size);
+		if (size > 0)
+			pHeightField->ConvertEarthToSurfacePoints(pL->GetData(),
+				pL->m_centerline.GetData(), size);
+
 		// ignore width from file - imply from properties
 		pL->EstimateWidth();
+	};
+	if (pHeightField->IsThreadSafe())
+		vtParallelFor((int) links.size(), drape_link);
+	else
+	{
+		for (int i = 0; i < (int) links.size(); i++)
+			drape_link(i);
 	}
 }
 
+
+/**
+ * Drape some of the links on the terrain again, after the elevation under
+ * them has changed, and rebuild their geometry.  The nodes at the ends of
+ * the links are draped too.  Since the shape of an intersection depends on
+ * all the links which meet there, the other links at those nodes are
+ * rebuilt as well, but the rest of the road map is left alone.
+ */
+void vtRoadMap3d::RedrapeLinks(vtHeightField3d *pHeightField,
+	const std::vector<LinkGeom*> &links)
+{
+	std::set<NodeGeom*> nodes;
+	for (size_t i = 0; i < links.size(); i++)
+	{
+		LinkGeom *pL = links[i];
+		const uint size = pL->GetSize();
+		pL->m_centerline.SetSize(size);
+		if (size > 0)
+			pHeightField->ConvertEarthToSurfacePoints(pL->GetData(),
+				pL->m_centerline.GetData(), size);
+		nodes.insert(pL->GetNode(0));
+		nodes.insert(pL->GetNode(1));
+	}
+	nodes.erase((NodeGeom*) NULL);
+
+	std::set<LinkGeom*> rebuild(links.begin(), links.end());
+	for (std::set<NodeGeom*>::iterator it = nodes.begin(); it != nodes.end(); ++it)
+	{
+		NodeGeom *pN = *it;
+		pHeightField->ConvertEarthToSurfacePoint(pN->Pos(), pN->m_p3);
+		pN->ComputeIntersectionVertices();
+		for (int i = 0; i < pN->NumLinks(); i++)
+			rebuild.insert(pN->GetLink(i));
+	}
+
+	// Only replace geometry which was built in the first place; links which
+	//  GenerateGeometry left out stay out.
+	for (std::set<LinkGeom*>::iterator it = rebuild.begin(); it != rebuild.end(); ++it)
+	{
+		LinkGeom *pL = *it;
+		if (!pL->m_pMesh)
+			continue;
+		pL->m_pGeode->RemoveMesh(pL->m_pMesh);
+		pL->m_pMesh = NULL;
+		pL->GenerateGeometry(this);
+	}
+	for (std::set<NodeGeom*>::iterator it = nodes.begin(); it != nodes.end(); ++it)
+	{
+		NodeGeom *pN = *it;
+		if (!pN->m_pMesh)
+			continue;
+		pN->m_pGeode->RemoveMesh(pN->m_pMesh);
+		pN->m_pMesh = NULL;
+		_GenerateNodeGeometry(pN);
+	}
+}
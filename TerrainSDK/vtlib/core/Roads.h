@@ -94,6 +94,9 @@ public:
 	int m_iVerts;
 	FLine3 m_v;		// vertices of the polygon
 	FPoint3 m_p3;
+
+	vtMesh *m_pMesh;	// the intersection's mesh, if it has one
+	vtGeode *m_pGeode;	// the geode in the LOD grid which holds it
 };
 
 //
@@ -140,6 +143,7 @@ public:
 					float u1, float u2, float uv_scale,
 					normal_direction nd);
 	void GenerateGeometry(class vtRoadMap3d *rmgeom);
+	void GenerateGeometry(class vtRoadMap3d *rmgeom, RoadBuildInfo &bi);
 
 	NodeGeom *GetNode(int n) { return (NodeGeom *)m_pNode[n]; }
 	LinkGeom *GetNext() { return (LinkGeom *)m_pNext; }
@@ -147,6 +151,9 @@ public:
 	int m_vti;
 	FLine3 m_centerline;
 
+	vtMesh *m_pMesh;	// the link's mesh, if it was built
+	vtGeode *m_pGeode;	// the geode in the LOD grid which holds it
+
 	/* Lanes lines, which define the centerline of each trafficable lane,
 	 * are created by vtRoadMap3d for traffic simulation/visualization
 	 * purposes.
@@ -183,8 +190,9 @@ public:
 	}
 
 	void DrapeOnTerrain(vtHeightField3d *pHeightField);
+	void RedrapeLinks(vtHeightField3d *pHeightField, const std::vector<LinkGeom*> &links);
 	void ComputeIntersectionVertices();
-	void AddMeshToGrid(vtMesh *pMesh, int iMatIdx);
+	vtGeode *AddMeshToGrid(vtMesh *pMesh, int iMatIdx);
 	vtTransform *GenerateGeometry(bool do_texture, bool bHwy, bool bPaved,
 		bool bDirt, bool progress_callback(int) = NULL);
 	void GenerateSigns(vtLodGrid *pLodGrid);
@@ -213,6 +221,7 @@ protected:
 	int _CreateMaterial(const char *texture_filename, bool bTransparency);
 	void _CreateMaterials(bool do_texture);
 	void _GatherExtents();
+	void _GenerateNodeGeometry(NodeGeom *pN);
 
 	vtTransform	*m_pTransform;	// For elevating the roads above the terrain.
 	vtGroup		*m_pGroup;
@@ -126,6 +126,7 @@ SMTerrain::SMTerrain() : vtDynTerrainGeom()
 	m_TriPool = NULL;
 	m_HypoLength = NULL;
 	m_pBlockArray = NULL;
+	m_bPartialUpdate = false;
 }
 
 SMTerrain::~SMTerrain()
@@ -338,6 +339,17 @@ int stat_total = 0, stat_256 = 0;
 //
 MathType SMTerrain::ComputeTriangleVariance(int num, int v0, int v1, int va, int level)
 {
+	// When only part of the grid has changed, a triangle which doesn't touch
+	//  that part still has the right variance, and so do all its children.
+	if (m_bPartialUpdate && !TouchesUpdateRegion(v0, v1, va))
+	{
+#if USE_FP8
+		return DecodeFP8(m_pVariance[num]);
+#else
+		return m_pVariance[num];
+#endif
+	}
+
 	// find the center vertex
 	// whether the array is 0-base or 1-base, this works:
 	int vc = (v0 + v1) >> 1;
@@ -386,6 +398,41 @@ MathType SMTerrain::ComputeTriangleVariance(int num, int v0, int v1, int va, int
 	return variance;
 }
 
+//
+// Does the bounding box of this triangle touch the heixels being updated?
+//  Every vertex of its children lies within the triangle, so if it doesn't,
+//  nothing below it does either.
+//
+bool SMTerrain::TouchesUpdateRegion(int v0, int v1, int va) const
+{
+	const int x0 = v0 % m_iDim, y0 = v0 / m_iDim;
+	const int x1 = v1 % m_iDim, y1 = v1 / m_iDim;
+	const int xa = va % m_iDim, ya = va / m_iDim;
+
+	if (std::max(std::max(x0, x1), xa) < m_UpdateLo.x) return false;
+	if (std::min(std::min(x0, x1), xa) > m_UpdateHi.x) return false;
+	if (std::max(std::max(y0, y1), ya) < m_UpdateLo.y) return false;
+	if (std::min(std::min(y0, y1), ya) > m_UpdateHi.y) return false;
+	return true;
+}
+
+/**
+ * Bring the variance tree up to date after the elevation of some heixels
+ * has changed.  Only the triangles which touch those heixels are visited,
+ * so a small edit costs a few thousand triangles rather than the whole tree.
+ */
+void SMTerrain::UpdateRegion(const IPoint2 &lo, const IPoint2 &hi)
+{
+	if (!m_pVariance)
+		return;
+
+	m_UpdateLo = lo;
+	m_UpdateHi = hi;
+	m_bPartialUpdate = true;
+	ComputeVariances();
+	m_bPartialUpdate = false;
+}
+
 
 //
 // Allocate memory for a new binary tree triangle
@@ -1065,6 +1112,27 @@ void SMTerrain::GetWorldLocation(int iX, int iZ, FPoint3 &p, bool bTrue) const
 		p.Set(MAKE_XYZ2(iX, iZ));
 }
 
+/**
+ * Set the elevation of a heixel.  Call UpdateRegion afterwards so that the
+ * level of detail takes the change into account.
+ */
+void SMTerrain::SetElevation(int iX, int iZ, float fValue, bool bTrue)
+{
+	if (iX < 0 || iX > m_iSize.x-1 || iZ < 0 || iZ > m_iSize.y-1)
+		return;
+
+	float packed;
+	if (bTrue)
+		packed = PACK_SCALE * fValue;
+	else
+		packed = fValue / m_fZScale;
+#if INTEGER_HEIGHT
+	if (packed < SHRT_MIN) packed = SHRT_MIN;
+	if (packed > SHRT_MAX) packed = SHRT_MAX;
+#endif
+	m_pData[offset(iX,iZ)] = (HeightType) packed;
+}
+
 void SMTerrain::SetVerticalExag(float fExag)
 {
 	m_fZScale = fExag / PACK_SCALE;
@@ -136,6 +136,8 @@ public:
 	void DoCulling(const vtCamera *pCam);
 	float GetElevation(int iX, int iZ, bool bTrue = false) const;
 	void GetWorldLocation(int iX, int iZ, FPoint3 &p, bool bTrue = false) const;
+	void SetElevation(int iX, int iZ, float fValue, bool bTrue = false);
+	void UpdateRegion(const IPoint2 &lo, const IPoint2 &hi);
 	void SetVerticalExag(float fExag);
 	float GetVerticalExag() const;
 
@@ -147,6 +149,7 @@ protected:
 	void AllocatePool();
 	void ComputeVariances();
 	MathType ComputeTriangleVariance(int num, int v0, int v1, int va, int level);
+	bool TouchesUpdateRegion(int v0, int v1, int va) const;
 	void SetupBlocks();
 
 	// per-frame
@@ -192,6 +195,10 @@ private:
 
 	float m_fQualityConstant;
 
+	// while updating part of the variance tree, the heixels which changed
+	bool m_bPartialUpdate;
+	IPoint2 m_UpdateLo, m_UpdateHi;
+
 	BlockPtr *m_pBlockArray;
 	int m_iBlockN;
 	int m_iBlockLevel;
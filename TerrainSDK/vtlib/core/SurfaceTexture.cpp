@@ -11,6 +11,10 @@
 #include "vtdata/FilePath.h"
 #include "vtdata/vtLog.h"
 
+// Lighting used to prelight the texture
+static const float PRELIGHT_AMBIENT = 0.25f;
+static const float PRELIGHT_GAMMA = 0.80f;
+
 
 ///////////////////
 
@@ -18,6 +22,7 @@ SurfaceTexture::SurfaceTexture()
 {
 	m_pMaterials = new vtMaterialArray;
 	m_pColorMap = NULL;
+	m_bCompression = false;
 }
 
 SurfaceTexture::~SurfaceTexture()
@@ -29,6 +34,7 @@ bool SurfaceTexture::MakeTexture(const TParams &options, const vtHeightFieldGrid
 	bool bTextureCompression, bool progress_callback(int))
 {
 	const TextureEnum eTex = options.GetTextureEnum();
+	m_bCompression = bTextureCompression;
 
 	VTLOG("LoadTexture(%d)\n", eTex);
 
@@ -55,19 +61,50 @@ bool SurfaceTexture::MakeTexture(const TParams &options, const vtHeightFieldGrid
 	const bool bBothSides = options.GetValueBool(STR_SHOW_UNDERSIDE);
 	const float ambient = 0.0f, diffuse = 1.0f, emmisive = 0.0f;
 
+	// The image is compressed by UpdateMaterial, once it is final
 	int idx = m_pMaterials->AddTextureMaterial(m_pTextureImage,
 		!bBothSides,	// culling
 		false,			// lighting
 		bTransp,		// transparency blending
 		false,			// additive
 		ambient, diffuse,
-		1.0, 0.0,		// alpha, emissive
-		bTextureCompression);
+		1.0, 0.0);		// alpha, emissive
 	if (bMipmap)
 		m_pMaterials->at(idx)->SetMipMap(bMipmap);
 	return true;
 }
 
+/**
+ * Give the current texture image to the surface material; call this after
+ * making or shading the texture.  If texture compression was requested, the
+ * image is first compressed on the CPU (see CompressImageDXT), with mipmaps
+ * if the material uses them, so the driver is given ready-made DXT blocks.
+ */
+void SurfaceTexture::UpdateMaterial()
+{
+	if (m_pMaterials->empty() || !m_pTextureImage.valid())
+		return;
+	vtMaterial *mat = m_pMaterials->at(0);
+	if (mat->GetTextureImage() == NULL)
+		return;
+
+	const bool bMipmap = mat->GetMipMap();
+	osg::Image *image = m_pTextureImage.get();
+	osg::Image *compressed = NULL;
+	if (m_bCompression)
+	{
+		clock_t c1 = clock();
+		compressed = CompressImageDXT(image, bMipmap);
+		if (compressed)
+			VTLOG("  Compressed texture: %.3f seconds.\n", (float)(clock() - c1) / CLOCKS_PER_SEC);
+	}
+
+	// If we couldn't compress it, the driver still can
+	mat->SetTexture2D(compressed ? compressed : image, 0, m_bCompression && !compressed);
+	mat->SetMipMap(bMipmap);
+	mat->ModifiedTexture();
+}
+
 void SurfaceTexture::LoadSingleTexture(const TParams &options)
 {
 	// look for texture
@@ -153,8 +190,8 @@ void SurfaceTexture::ShadeTexture(const TParams &options, const vtHeightFieldGri
 	clock_t c1 = clock();
 
 	float shade_factor = options.GetValueFloat(STR_PRELIGHTFACTOR);
-	float ambient = 0.25f;
-	float gamma = 0.80f;
+	float ambient = PRELIGHT_AMBIENT;
+	float gamma = PRELIGHT_GAMMA;
 	if (options.GetValueBool(STR_CAST_SHADOWS))
 	{
 		// A more accurate shading, still a little experimental
@@ -169,6 +206,83 @@ void SurfaceTexture::ShadeTexture(const TParams &options, const vtHeightFieldGri
 	VTLOG("%.3f seconds.\n", (float)(clock() - c1) / CLOCKS_PER_SEC);
 }
 
+/**
+ * After the elevation of part of the grid has changed, color and shade that
+ * part of the texture again, and send it to the card.  The part is given as
+ * a range of heixels, 'lo' to 'hi' inclusive.
+ *
+ * Cast shadows may fall far from the change, so with STR_CAST_SHADOWS the
+ * whole texture is shaded again.  A texture which was compressed is replaced
+ * by the uncompressed image, since compressing it again would take far too
+ * long to do while editing.
+ */
+void SurfaceTexture::UpdateRegion(const TParams &options, const vtHeightFieldGrid3d *pHFGrid,
+	const FPoint3 &light_dir, const IPoint2 &lo, const IPoint2 &hi)
+{
+	if (!pHFGrid || !m_pUnshadedImage.valid() || !m_pTextureImage.valid())
+		return;
+	if (m_pMaterials->empty())
+		return;
+
+	const bool bPrelight = options.GetValueBool(STR_PRELIGHT);
+	if (!bPrelight && options.GetTextureEnum() != TE_DERIVED)
+		return;	// the texture doesn't depend on elevation
+
+	// Find the texels over those heixels.  Shading looks at the neighbors
+	//  of each heixel, so the texels a step further away change too.
+	const IPoint2 size(m_pUnshadedImage->s(), m_pUnshadedImage->t());
+	int cols, rows;
+	pHFGrid->GetDimensions(cols, rows);
+	const double ratiox = (double)(cols - 1) / (size.x - 1),
+				 ratioy = (double)(rows - 1) / (size.y - 1);
+	const int xOffset = std::max(1, (int) ratiox);
+	const int yOffset = std::max(1, (int) ratioy);
+	const IPoint2 t0(std::max(0, (int) floor((lo.x - xOffset) / ratiox)),
+					 std::max(0, (int) floor((lo.y - yOffset) / ratioy)));
+	const IPoint2 t1(std::min(size.x - 1, (int) ceil((hi.x + xOffset) / ratiox)),
+					 std::min(size.y - 1, (int) ceil((hi.y + yOffset) / ratioy)));
+	if (t0.x > t1.x || t0.y > t1.y)
+		return;
+
+	if (options.GetTextureEnum() == TE_DERIVED && m_pColorMap)
+	{
+		vtImageWrapper wrap(m_pUnshadedImage);
+		pHFGrid->ColorDibFromTable(&wrap, t0, t1, m_pColorMap, RGBi(255,0,0));
+	}
+	if (bPrelight && options.GetValueBool(STR_CAST_SHADOWS))
+	{
+		CopyFromUnshaded(options);
+		ShadeTexture(options, pHFGrid, light_dir);
+	}
+	else if (bPrelight)
+	{
+		// Copy the unshaded texels, then shade them.  OSG rows count from
+		//  the bottom of the image, the same as texel rows.
+		if (m_pTextureImage != m_pUnshadedImage)
+		{
+			const int bytes = (t1.x - t0.x + 1) * m_pUnshadedImage->getPixelSizeInBits() / 8;
+			for (int j = t0.y; j <= t1.y; j++)
+				memcpy(m_pTextureImage->data(t0.x, j), m_pUnshadedImage->data(t0.x, j), bytes);
+		}
+		ScopedLocale normal_numbers(LC_NUMERIC, "C");
+		vtImageWrapper wrapper(m_pTextureImage);
+		pHFGrid->ShadeDibFromElevation(&wrapper, t0, t1, light_dir,
+			options.GetValueFloat(STR_PRELIGHTFACTOR), PRELIGHT_AMBIENT,
+			PRELIGHT_GAMMA, true);
+	}
+
+	vtMaterial *mat = m_pMaterials->at(0);
+	if (mat->GetTextureImage() == m_pTextureImage.get())
+		m_pTextureImage->dirty();
+	else
+	{
+		const bool bMipmap = mat->GetMipMap();
+		mat->SetTexture2D(m_pTextureImage.get(), 0, false);
+		mat->SetMipMap(bMipmap);
+		mat->ModifiedTexture();
+	}
+}
+
 /**
   Load the colormap from the options, or (if that fails) make a default colormap.
  */
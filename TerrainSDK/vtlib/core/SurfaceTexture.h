@@ -22,9 +22,12 @@ public:
 
 	void ShadeTexture(const TParams &options, const vtHeightFieldGrid3d *pHFGrid,
 		const FPoint3 &light_dir, bool progress_callback(int) = NULL);
+	void UpdateRegion(const TParams &options, const vtHeightFieldGrid3d *pHFGrid,
+		const FPoint3 &light_dir, const IPoint2 &lo, const IPoint2 &hi);
 
 	void MakeColorMap(const vtTagArray &options);
 	void CopyFromUnshaded(const TParams &options);
+	void UpdateMaterial();
 
 	ImagePtr		m_pUnshadedImage;
 	ImagePtr		m_pTextureImage;
@@ -32,6 +35,8 @@ public:
 	ColorMap		*m_pColorMap;
 
 protected:
+	bool			m_bCompression;
+
 	void LoadSingleTexture(const TParams &options);
 	void MakeDerivedTexture(const TParams &options, const vtHeightFieldGrid3d *pHFGrid,
 		bool progress_callback(int));
@@ -12,6 +12,7 @@
 #include "vtdata/vtLog.h"
 #include "vtdata/CubicSpline.h"
 #include "vtdata/DataPath.h"
+#include "vtdata/Parallel.h"
 
 #include "Terrain.h"
 
@@ -20,6 +21,7 @@
 #include "ImageSprite.h"
 #include "Light.h"
 #include "PagedLodGrid.h"
+#include "Profiler.h"
 #include "vtTin3d.h"
 
 #include "SMTerrain.h"
@@ -40,6 +42,7 @@
 vtTerrain::vtTerrain()
 {
 	m_bIsCreated = false;
+	m_iCreateStep = 0;
 
 	m_ocean_color.Set(40.0f/255, 75.0f/255, 124.0f/255);	// unshaded color
 	m_fog_color.Set(1.0f, 1.0f, 1.0f);
@@ -63,6 +66,8 @@ vtTerrain::vtTerrain()
 
 	m_pOceanGeom = NULL;
 	m_pRoadGroup = NULL;
+	m_bPreloaded = false;
+	m_bContentLoaded = false;
 
 	// vegetation
 	m_pVegGroup = NULL;
@@ -89,6 +94,8 @@ vtTerrain::vtTerrain()
 
 	m_pExternalHeightField = NULL;
 	m_bTextureCompression = false;
+
+	m_iRedrapeBatch = 100;
 }
 
 vtTerrain::~vtTerrain()
@@ -235,29 +242,47 @@ void vtTerrain::SetTin(vtTin3d *pTin)
 
 ///////////////////////////////////////////////////////////////////////
 
-void vtTerrain::_CreateRoads()
+/**
+ * Read the terrain's road file, if it has one.  This doesn't touch the
+ * scene graph, so it can run on a worker thread.
+ */
+vtRoadMap3d *vtTerrain::_LoadRoads()
 {
-	// for GetValueFloat below
-	ScopedLocale normal_numbers(LC_NUMERIC, "C");
-
 	vtString road_fname = "RoadData/";
 	road_fname += m_Params.GetValueString(STR_ROADFILE);
 	vtString road_path = FindFileOnPaths(vtGetDataPath(), road_fname);
 	if (road_path == "")
-		return;
-
-	VTLOG("Creating Roads: ");
-	m_pRoadMap = new vtRoadMap3d;
+		return NULL;
 
-	VTLOG("  Reading from file '%s'\n", (const char *) road_path);
-	bool success = m_pRoadMap->ReadRMF(road_path);
-	if (!success)
+	VTLOG("Reading roads from file '%s'\n", (const char *) road_path);
+	vtRoadMap3dPtr roads = new vtRoadMap3d;
+	if (!roads->ReadRMF(road_path))
 	{
 		VTLOG("	read failed.\n");
-		m_pRoadMap = NULL;
-		return;
+		return NULL;
 	}
 
+	//some nodes may not have any roads attached to them.  delete them.
+	roads->RemoveUnusedNodes();
+
+	roads->DetermineSurfaceAppearance();
+	return roads.release();
+}
+
+void vtTerrain::_CreateRoads()
+{
+	// for GetValueFloat below
+	ScopedLocale normal_numbers(LC_NUMERIC, "C");
+
+	VTLOG1("Creating Roads\n");
+	if (m_bPreloaded)
+		m_pRoadMap = m_pPreloadedRoads;
+	else
+		m_pRoadMap = _LoadRoads();
+	m_pPreloadedRoads = NULL;
+	if (!m_pRoadMap.valid())
+		return;
+
 	// Sanity checks: The roads might be off our terrain completely, either
 	//  from mismatched data or perhaps a wrong CRS.
 	const DRECT &terrain_extents = GetHeightField()->GetEarthExtents();
@@ -269,11 +294,6 @@ void vtTerrain::_CreateRoads()
 		return;
 	}
 
-	//some nodes may not have any roads attached to them.  delete them.
-	m_pRoadMap->RemoveUnusedNodes();
-
-	m_pRoadMap->DetermineSurfaceAppearance();
-
 	m_pRoadMap->SetHeightOffGround(m_Params.GetValueFloat(STR_ROADHEIGHT));
 	m_pRoadMap->DrapeOnTerrain(m_pHeightField);
 	m_pRoadMap->ComputeIntersectionVertices();
@@ -379,9 +399,7 @@ void vtTerrain::ReshadeTexture(vtTransform *pSunLight, bool progress_callback(in
 	m_Texture.ShadeTexture(m_Params, GetHeightFieldGrid3d(), pSunLight->GetDirection(), progress_callback);
 
 	// Make sure OSG knows that the texture has changed
-	vtMaterial *mat = m_Texture.m_pMaterials->at(0);
-	mat->SetTexture2D(m_Texture.m_pTextureImage);
-	mat->ModifiedTexture();
+	m_Texture.UpdateMaterial();
 }
 
 /**
@@ -397,9 +415,7 @@ void vtTerrain::RecreateTexture(vtTransform *pSunLight, bool progress_callback(i
 		m_progress_callback);
 
 	// Make sure OSG knows that the texture has changed
-	vtMaterial *mat = m_Texture.m_pMaterials->at(0);
-	mat->SetTexture2D(m_Texture.m_pTextureImage);
-	mat->ModifiedTexture();
+	m_Texture.UpdateMaterial();
 }
 
 /**
@@ -1114,30 +1130,23 @@ void vtTerrain::_CreateVegetation()
 		const vtTagArray &tags = m_Params.m_Layers[i];
 
 		VTLOG(" Layer %d: Vegetation\n", i);
-		vtString fname = tags.GetValueString("Filename");
-
-		// Read the VF file
-		vtString plants_fname = "PlantData/";
-		plants_fname += fname;
-
-		VTLOG("\tLooking for plants file: %s\n", (const char *) plants_fname);
-
-		vtString plants_path = FindFileOnPaths(vtGetDataPath(), plants_fname);
-		if (plants_path == "")
-		{
-			VTLOG1("\tNot found.\n");
+		vtVegLayer *v_layer;
+		if (m_bPreloaded)
+			v_layer = dynamic_cast<vtVegLayer*>(m_PreloadedLayers[i].get());
+		else
+			v_layer = _LoadVegLayer(tags);
+		if (!v_layer)
 			continue;
-		}
-		VTLOG("\tFound: %s\n", (const char *) plants_path);
 
-		vtVegLayer *v_layer = LoadVegetation(plants_path);
-		if (v_layer)
-		{
-			// If the user wants it to start hidden, hide it
-			bool bVisible;
-			if (tags.GetValueBool("visible", bVisible))
-				v_layer->SetEnabled(bVisible);
-		}
+		// The plants go on the heightfield the terrain has now
+		m_Layers.push_back(v_layer);
+		v_layer->SetHeightField(m_pHeightField);
+		_CreatePlantGeometry(v_layer);
+
+		// If the user wants it to start hidden, hide it
+		bool bVisible;
+		if (tags.GetValueBool("visible", bVisible))
+			v_layer->SetEnabled(bVisible);
 	}
 	VTLOG(" Vegetation: %.3f seconds.\n", (float)(clock() - r1) / CLOCKS_PER_SEC);
 }
@@ -1177,32 +1186,68 @@ void vtTerrain::_SetupStructGrid(float fLODDistance)
 	m_pTerrainGroup->addChild(m_pStructGrid);
 }
 
-void vtTerrain::_CreateStructures()
+/**
+ * Read the terrain-specific content file, if there is one.
+ *
+ * \return false if the file could not be parsed.
+ */
+bool vtTerrain::_LoadContent()
 {
-	// Read terrain-specific content file
 	vtString con_file = m_Params.GetValueString(STR_CONTENT_FILE);
-	if (con_file != "")
+	if (con_file == "")
+		return true;
+
+	VTLOG(" Looking for terrain-specific content file: '%s'\n", (const char *) con_file);
+	vtString fname = FindFileOnPaths(vtGetDataPath(), con_file);
+	if (fname == "")
 	{
-		VTLOG(" Looking for terrain-specific content file: '%s'\n", (const char *) con_file);
-		vtString fname = FindFileOnPaths(vtGetDataPath(), con_file);
-		if (fname != "")
-		{
-			VTLOG("  Found.\n");
-			try
-			{
-				m_Content.ReadXML(fname);
-			}
-			catch (xh_io_exception &ex)
-			{
-				// display (or a least log) error message here
-				VTLOG("  XML error:");
-				VTLOG(ex.getFormattedMessage().c_str());
-				return;
-			}
-		}
-		else
-			VTLOG("  Not found.\n");
+		VTLOG("  Not found.\n");
+		return true;
+	}
+	VTLOG("  Found.\n");
+	try
+	{
+		m_Content.ReadXML(fname);
+	}
+	catch (xh_io_exception &ex)
+	{
+		// display (or a least log) error message here
+		VTLOG("  XML error:");
+		VTLOG(ex.getFormattedMessage().c_str());
+		return false;
 	}
+	return true;
+}
+
+/**
+ * Read the structures file of a structure layer into a new layer, which is
+ * not yet added to the terrain.  This doesn't touch the scene graph, so it
+ * can run on a worker thread.
+ */
+vtStructureLayer *vtTerrain::_LoadStructureLayer(const vtTagArray &tags,
+	bool progress_callback(int))
+{
+	osg::ref_ptr<vtStructureLayer> st_layer = new vtStructureLayer;
+
+	// These structures will use the heightfield and CRS of this terrain
+	st_layer->SetTerrain(this);
+	st_layer->m_crs = m_crs;
+
+	st_layer->SetProps(tags);
+	if (!st_layer->Load(progress_callback))
+	{
+		VTLOG("\tCouldn't load structures.\n");
+		return NULL;
+	}
+	return st_layer.release();
+}
+
+void vtTerrain::_CreateStructures()
+{
+	// Read terrain-specific content file
+	const bool bContent = m_bPreloaded ? m_bContentLoaded : _LoadContent();
+	if (!bContent)
+		return;
 
 	// Always create a LOD grid for structures, as the user might create some
 	// The LOD distances are in meters
@@ -1220,14 +1265,13 @@ void vtTerrain::_CreateStructures()
 
 		VTLOG(" Layer %d: Structure\n", i);
 
-		vtStructureLayer *st_layer = NewStructureLayer();
-		st_layer->SetProps(m_Params.m_Layers[i]);
-		if (!st_layer->Load(m_progress_callback))
-		{
-			VTLOG("\tCouldn't load structures.\n");
-			// Removing the layer deletes it, by dereference.
-			m_Layers.Remove(st_layer);
-		}
+		vtLayer *st_layer;
+		if (m_bPreloaded)
+			st_layer = m_PreloadedLayers[i].get();
+		else
+			st_layer = _LoadStructureLayer(m_Params.m_Layers[i], m_progress_callback);
+		if (st_layer)
+			m_Layers.push_back(st_layer);
 	}
 	for (uint i = 0; i < m_Layers.size(); i++)
 	{
@@ -1252,10 +1296,14 @@ void vtTerrain::_CreateAbstractLayersFromParams()
 	}
 }
 
-bool vtTerrain::_CreateAbstractLayerFromParams(int index)
+/**
+ * Read the features of an abstract layer into a new layer, which is not yet
+ * added to the terrain.  This doesn't touch the scene graph, so it can run
+ * on a worker thread.
+ */
+vtAbstractLayer *vtTerrain::_LoadAbstractLayer(const vtTagArray &lay,
+	bool progress_callback(int))
 {
-	const vtTagArray &lay = m_Params.m_Layers[index];
-
 	// Show the tags
 	for (uint j = 0; j < lay.NumTags(); j++)
 	{
@@ -1263,22 +1311,30 @@ bool vtTerrain::_CreateAbstractLayerFromParams(int index)
 		VTLOG("   Tag '%s': '%s'\n", (const char *)tag->name, (const char *)tag->value);
 	}
 
-	vtAbstractLayer *ab_layer = new vtAbstractLayer;
+	osg::ref_ptr<vtAbstractLayer> ab_layer = new vtAbstractLayer;
 
 	// Copy all the properties from params to the new layer
 	VTLOG1("  Setting layer properties.\n");
 	ab_layer->SetProps(lay);
+
+	if (!ab_layer->Load(GetCRS(), NULL, progress_callback))
+		return NULL;
+	return ab_layer.release();
+}
+
+bool vtTerrain::_CreateAbstractLayerFromParams(int index)
+{
+	vtAbstractLayer *ab_layer;
+	if (m_bPreloaded)
+		ab_layer = dynamic_cast<vtAbstractLayer*>(m_PreloadedLayers[index].get());
+	else
+		ab_layer = _LoadAbstractLayer(m_Params.m_Layers[index], m_progress_callback);
+	if (!ab_layer)
+		return false;
 	m_Layers.push_back(ab_layer);
 
 	// Abstract geometry goes into the scale features group, so it will be
 	//  scaled up/down with the vertical exaggeration.
-	bool success = ab_layer->Load(GetCRS(), NULL, m_progress_callback);
-	if (!success)
-	{
-		m_Layers.Remove(ab_layer);
-		return false;
-	}
-
 	CreateAbstractLayerVisuals(ab_layer);
 	return true;
 }
@@ -1859,23 +1915,44 @@ bool vtTerrain::CreateStep3(vtTransform *pSunLight, vtLightSource *pLightSource)
 	if (m_Params.GetValueBool(STR_SUPPRESS))
 		return true;
 
-	int type = m_Params.GetValueInt(STR_SURFACE_TYPE);
-	if (type == 0)		// Single grid
-	{
-		// measure total texture processing time
-		clock_t c1 = clock();
+	bool bMade = _MakeSurfaceTexture(pSunLight->GetDirection(), m_progress_callback);
+	_ApplySurfaceTexture(bMade);
+	return true;
+}
 
-		bool success = m_Texture.MakeTexture(m_Params, GetHeightFieldGrid3d(),
-			m_bTextureCompression, m_progress_callback);
+/**
+ * Make and shade the single texture of a grid terrain.  This only makes the
+ * image and its material, so it can run on a worker thread.
+ *
+ * \return true if a texture was made.
+ */
+bool vtTerrain::_MakeSurfaceTexture(const FPoint3 &light_dir, bool progress_callback(int))
+{
+	if (m_Params.GetValueInt(STR_SURFACE_TYPE) != 0)		// Single grid
+		return false;
 
-		if (success)
-		{
-			m_Texture.ShadeTexture(m_Params, GetHeightFieldGrid3d(), pSunLight->GetDirection(),
-				m_progress_callback);
+	bool success = m_Texture.MakeTexture(m_Params, GetHeightFieldGrid3d(),
+		m_bTextureCompression, progress_callback);
+	if (success)
+	{
+		m_Texture.ShadeTexture(m_Params, GetHeightFieldGrid3d(), light_dir,
+			progress_callback);
+	}
+	return success;
+}
 
-			// The terrain's base texture will always use unit 0
-			m_TextureUnits.ReserveTextureUnit();
-		}
+/**
+ * Put the surface texture, or the TIN's materials, in use on the terrain.
+ */
+void vtTerrain::_ApplySurfaceTexture(bool bMade)
+{
+	int type = m_Params.GetValueInt(STR_SURFACE_TYPE);
+	if (type == 0 && bMade)		// Single grid
+	{
+		m_Texture.UpdateMaterial();
+
+		// The terrain's base texture will always use unit 0
+		m_TextureUnits.ReserveTextureUnit();
 	}
 	if (type == 1)	// TIN
 	{
@@ -1888,7 +1965,6 @@ bool vtTerrain::CreateStep3(vtTransform *pSunLight, vtLightSource *pLightSource)
 				m_TextureUnits.ReserveTextureUnit();
 		}
 	}
-	return true;
 }
 
 /**
@@ -2135,6 +2211,131 @@ void vtTerrain::CreateStep12()
 	}
 }
 
+/**
+ * Does the work of CreateStep3 through CreateStep12, as a graph of tasks
+ * which run at the same time where they can.  Call it after CreateStep2,
+ * instead of calling the rest of the steps yourself.
+ *
+ * Once the elevation is loaded, the surface texture is made and shaded, and
+ * the structure, road, vegetation and abstract layer files are read, all in
+ * parallel on worker threads.  The steps which build geometry and add it to
+ * the scene graph then run in their usual order on the calling thread,
+ * each as soon as what it needs has been read.
+ *
+ * \param pSunLight, pLightSource As for CreateStep3.
+ * \param progress_callback Called on this thread as the tasks finish; use
+ *	GetCreateStep to tell which step has been reached.  If not given, the
+ *	terrain's own progress callback (see SetProgressCallback) is used.
+ *
+ * \return false if the terrain surface could not be created, or the
+ *	progress callback cancelled it.
+ */
+bool vtTerrain::CreateParallel(vtTransform *pSunLight, vtLightSource *pLightSource,
+	bool progress_callback(int))
+{
+	VTLOG1("CreateParallel\n");
+
+	// The numeric locale belongs to the whole process, so set it once here
+	//  and hold it, so that the loaders' own ScopedLocales leave it alone
+	//  rather than change it under each other.
+	ScopedLocale normal_numbers(LC_NUMERIC, "C", true);
+
+	const FPoint3 light_dir = pSunLight->GetDirection();
+	const bool bSurface = !m_Params.GetValueBool(STR_SUPPRESS);
+	const uint iLayers = m_Params.NumLayers();
+
+	m_iCreateStep = 2;
+	m_bPreloaded = true;
+	m_bContentLoaded = false;
+	m_PreloadedLayers.clear();
+	m_PreloadedLayers.resize(iLayers);
+	m_pPreloadedRoads = NULL;
+
+	bool bTexture = false;
+	bool bOK = true;
+	vtTaskGraph graph;
+
+	// Reading ahead, on worker threads.  These only read files (or the
+	//  elevation), each into its own place.
+	const int texture = graph.AddTask("Texture", [&]()
+	{
+		if (bSurface)
+			bTexture = _MakeSurfaceTexture(light_dir, NULL);
+	});
+	const int structures = graph.AddTask("Read structures", [&]()
+	{
+		m_bContentLoaded = _LoadContent();
+		for (uint i = 0; i < iLayers; i++)
+			if (m_Params.GetLayerType(i) == LT_STRUCTURE)
+				m_PreloadedLayers[i] = _LoadStructureLayer(m_Params.m_Layers[i], NULL);
+	});
+	const int roads = graph.AddTask("Read roads", [&]()
+	{
+		if (m_Params.GetValueBool(STR_ROADS))
+			m_pPreloadedRoads = _LoadRoads();
+	});
+	const int vegetation = graph.AddTask("Read vegetation", [&]()
+	{
+		for (uint i = 0; i < iLayers; i++)
+			if (m_Params.GetLayerType(i) == LT_VEG)
+				m_PreloadedLayers[i] = _LoadVegLayer(m_Params.m_Layers[i]);
+	});
+	const int abstracts = graph.AddTask("Read abstract layers", [&]()
+	{
+		for (uint i = 0; i < iLayers; i++)
+			if (m_Params.GetLayerType(i) == LT_RAW)
+				m_PreloadedLayers[i] = _LoadAbstractLayer(m_Params.m_Layers[i], NULL);
+	});
+
+	// Building, on this thread, in the usual order.
+	const int step3 = graph.AddTask("Step3", [&]()
+	{
+		VTLOG1("Step3\n");
+		m_pLightSource = pLightSource;
+		if (bSurface)
+			_ApplySurfaceTexture(bTexture);
+		m_iCreateStep = 3;
+	}, true);
+	const int step4 = graph.AddTask("Step4", [&]() { bOK = CreateStep4(); m_iCreateStep = 4; }, true);
+	const int step5 = graph.AddTask("Step5", [&]() { bOK = bOK && CreateStep5(); m_iCreateStep = 5; }, true);
+	const int step6 = graph.AddTask("Step6", [&]() { if (bOK) CreateStep6(); m_iCreateStep = 6; }, true);
+	const int step7 = graph.AddTask("Step7", [&]() { if (bOK) CreateStep7(); m_iCreateStep = 7; }, true);
+	const int step8 = graph.AddTask("Step8", [&]() { if (bOK) CreateStep8(); m_iCreateStep = 8; }, true);
+	const int step9 = graph.AddTask("Step9", [&]() { if (bOK) CreateStep9(); m_iCreateStep = 9; }, true);
+	const int step10 = graph.AddTask("Step10", [&]() { if (bOK) CreateStep10(); m_iCreateStep = 10; }, true);
+	const int step11 = graph.AddTask("Step11", [&]() { if (bOK) CreateStep11(); m_iCreateStep = 11; }, true);
+	const int step12 = graph.AddTask("Step12", [&]() { if (bOK) CreateStep12(); m_iCreateStep = 12; }, true);
+
+	graph.AddDependency(step3, texture);
+	graph.AddDependency(step4, step3);
+	graph.AddDependency(step5, step4);
+	graph.AddDependency(step6, step5);
+	graph.AddDependency(step6, structures);
+	graph.AddDependency(step7, step6);
+	graph.AddDependency(step7, roads);
+	graph.AddDependency(step8, step7);
+	graph.AddDependency(step8, vegetation);
+	graph.AddDependency(step9, step8);
+	graph.AddDependency(step10, step9);
+	graph.AddDependency(step10, abstracts);
+	graph.AddDependency(step11, step10);
+	graph.AddDependency(step12, step11);
+
+	if (!graph.Run(progress_callback ? progress_callback : m_progress_callback))
+	{
+		if (bOK)
+			m_strErrorMsg = "Cancelled.";
+		bOK = false;
+	}
+
+	// Anything which was read but not used, for example because the
+	//  surface failed, is released here.
+	m_bPreloaded = false;
+	m_PreloadedLayers.clear();
+	m_pPreloadedRoads = NULL;
+	return bOK;
+}
+
 void vtTerrain::SetProgressCallback(ProgFuncPtrType progress_callback)
 {
 	m_progress_callback = progress_callback;
@@ -2551,6 +2752,45 @@ vtVegLayer *vtTerrain::NewVegLayer()
 vtVegLayer *vtTerrain::LoadVegetation(const vtString &fname)
 {
 	vtVegLayer *v_layer = NewVegLayer();
+	if (!_ReadVegetation(v_layer, fname))
+		return NULL;
+	_CreatePlantGeometry(v_layer);
+	return v_layer;
+}
+
+/**
+ * Read the plants file of a vegetation layer (from the terrain parameters)
+ * into a new layer, which is not yet added to the terrain.  This doesn't
+ * touch the scene graph, so it can run on a worker thread.
+ */
+vtVegLayer *vtTerrain::_LoadVegLayer(const vtTagArray &tags)
+{
+	vtString fname = tags.GetValueString("Filename");
+
+	// Read the VF file
+	vtString plants_fname = "PlantData/";
+	plants_fname += fname;
+
+	VTLOG("\tLooking for plants file: %s\n", (const char *) plants_fname);
+
+	vtString plants_path = FindFileOnPaths(vtGetDataPath(), plants_fname);
+	if (plants_path == "")
+	{
+		VTLOG1("\tNot found.\n");
+		return NULL;
+	}
+	VTLOG("\tFound: %s\n", (const char *) plants_path);
+
+	osg::ref_ptr<vtVegLayer> v_layer = new vtVegLayer;
+	v_layer->SetSpeciesList(m_pSpeciesList);
+	v_layer->SetCRS(m_crs);
+	if (!_ReadVegetation(v_layer.get(), plants_path))
+		return NULL;
+	return v_layer.release();
+}
+
+bool vtTerrain::_ReadVegetation(vtVegLayer *v_layer, const vtString &fname)
+{
 	bool success;
 	if (!fname.Right(3).CompareNoCase("shp"))
 		success = v_layer->ReadSHP(fname);
@@ -2562,11 +2802,12 @@ vtVegLayer *vtTerrain::LoadVegetation(const vtString &fname)
 		v_layer->SetFilename(fname);
 	}
 	else
-	{
 		VTLOG1("\tCouldn't load plants file.\n");
-		return NULL;
-	}
+	return success;
+}
 
+void vtTerrain::_CreatePlantGeometry(vtVegLayer *v_layer)
+{
 	// Create the 3d plants
 	VTLOG1(" Creating Plant geometry..\n");
 	if (m_Params.GetValueBool(STR_TREES_USE_SHADERS))
@@ -2593,7 +2834,6 @@ vtVegLayer *vtTerrain::LoadVegetation(const vtString &fname)
 				AddNodeToVegGrid(pTrans);
 		}
 	}
-	return v_layer;
 }
 
 /**
@@ -2785,12 +3025,16 @@ int vtTerrain::DoStructurePaging()
 	if (!m_pPagedStructGrid)
 		return 0;
 
+	VTPROFILE_ZONE("Structure paging");
+
 	vtCamera *cam = vtGetScene()->GetCamera();
 	FPoint3 CamPos = cam->GetTrans();
 
 	m_pPagedStructGrid->DoPaging(CamPos, m_iPagingStructureMax,
 		m_fPagingStructureDist);
-	return m_pPagedStructGrid->GetQueueSize();
+	const int iQueued = m_pPagedStructGrid->GetQueueSize();
+	VTPROFILE_SET("Structures queued", iQueued);
+	return iQueued;
 }
 
 void vtTerrain::SetStructurePageOutDistance(float f)
@@ -3231,29 +3475,193 @@ void vtTerrain::UpdateElevation()
 }
 
 /**
- * Drape all the culture on the terrain again, to keep them on the surface
- * in the case when the elevation values have changed.
+ * Shape the terrain interactively with a brush.  Only the part of the
+ * terrain under the brush is updated: the elevation and level of detail of
+ * the dynamic terrain (see vtDynTerrainGeom::ApplyBrush), the ground texture
+ * there, and the culture standing on it, which is re-draped over the
+ * following frames.  This is fast enough to call every frame while the
+ * user drags the brush.
+ *
+ * If a copy of the original elevation grid was preserved, it is changed too.
  *
- * \param area You can speed up this function by passing the area to re-drape
- *		in.  Otherwise, simply pass an empty area, and all culture will be
- *		re-draped.
+ * \param brush The brush to apply.
+ * \param pSunLight The sunlight, to shade the changed part of the texture.
+ * \return true if the terrain changed.
+ */
+bool vtTerrain::ApplyBrush(const vtTerrainBrush &brush, vtTransform *pSunLight)
+{
+	vtDynTerrainGeom *dyn = GetDynTerrain();
+	if (!dyn)
+		return false;
+
+	IPoint2 lo, hi;
+	if (!dyn->ApplyBrush(brush, lo, hi, m_pElevGrid.get()))
+		return false;
+
+	if (pSunLight)
+		m_Texture.UpdateRegion(m_Params, dyn, pSunLight->GetDirection(), lo, hi);
+
+	RedrapeCulture(lo, hi);
+	return true;
+}
+
+// Drapes a batch of culture each frame, for vtTerrain::RedrapeCulture.
+class RedrapeEngine : public vtEngine
+{
+public:
+	RedrapeEngine(vtTerrain *pTerr) { m_pTerrain = pTerr; }
+	void Eval() { m_pTerrain->RedrapeStep(); }
+
+	vtTerrain *m_pTerrain;
+};
+
+/**
+ * Drape the culture on an area of the terrain again, to keep it on the
+ * surface after the elevation values there have changed.
+ *
+ * Only the culture which overlaps the area is touched: structures, plants,
+ * the features of abstract layers, and road links.  It is found with a
+ * spatial index of all the culture, which is built the first time it is
+ * needed, and again after any layer is edited.  The draping itself is spread
+ * over the following frames, a batch each frame (see SetRedrapeBatchSize);
+ * call FlushRedrape to finish it at once.
+ *
+ * \param area The area which changed, in earth coordinates.  Since the
+ *		surface is interpolated between heixels, this should reach one grid
+ *		spacing past the heixels which changed.  If you pass an empty area,
+ *		all the culture will be re-draped.
  */
 void vtTerrain::RedrapeCulture(const DRECT &area)
 {
-	// Tell the terrain to re-drape all its structure instances.
-	for (uint i = 0; i < m_Layers.size(); i++)
+	_UpdateCultureIndex();
+	m_RedrapeAreas.push_back(area);
+	_QueueRedrape(area);
+
+	if (!m_pEngineGroup)
 	{
-		vtStructureLayer *slay = dynamic_cast<vtStructureLayer *>(m_Layers[i].get());
-		if (slay)
+		FlushRedrape();
+		return;
+	}
+	if (!m_pRedrapeEngine)
+	{
+		m_pRedrapeEngine = new RedrapeEngine(this);
+		m_pRedrapeEngine->setName("Redrape");
+		AddEngine(m_pRedrapeEngine.get());
+	}
+}
+
+/**
+ * Drape the culture again on the area of some heixels of the dynamic
+ * terrain which changed.  This is the same as RedrapeCulture(const DRECT &),
+ * with the area reaching one grid spacing past the heixels.
+ *
+ * \param lo, hi The first and last column and row which changed.
+ */
+void vtTerrain::RedrapeCulture(const IPoint2 &lo, const IPoint2 &hi)
+{
+	vtDynTerrainGeom *dyn = GetDynTerrain();
+	if (!dyn)
+		return;
+
+	// The surface is interpolated between heixels, so it changed up to one
+	//  grid spacing past the heixels which changed.
+	const DRECT ext = dyn->GetEarthExtents();
+	const DPoint2 spacing = dyn->GetSpacing();
+	DRECT area(ext.left + (lo.x - 1) * spacing.x, ext.bottom + (hi.y + 1) * spacing.y,
+		ext.left + (hi.x + 1) * spacing.x, ext.bottom + (lo.y - 1) * spacing.y);
+	RedrapeCulture(area);
+}
+
+/**
+ * Drape the next batch of culture waiting from RedrapeCulture.  This is
+ * called each frame while the terrain is active.
+ *
+ * \return The number of items still waiting.
+ */
+int vtTerrain::RedrapeStep()
+{
+	if (m_RedrapeQueue.empty())
+		return 0;
+
+	_UpdateCultureIndex();
+
+	std::vector<vtCultureItem> batch;
+	while (!m_RedrapeQueue.empty() && (int) batch.size() < m_iRedrapeBatch)
+	{
+		batch.push_back(m_RedrapeQueue.front());
+		m_RedrapeQueued.erase(m_RedrapeQueue.front());
+		m_RedrapeQueue.pop_front();
+	}
+	_RedrapeItems(batch);
+
+	if (m_RedrapeQueue.empty())
+		m_RedrapeAreas.clear();
+	return (int) m_RedrapeQueue.size();
+}
+
+/**
+ * Drape all the culture waiting from RedrapeCulture now, rather than a batch
+ * at a time.
+ */
+void vtTerrain::FlushRedrape()
+{
+	if (m_RedrapeQueue.empty())
+		return;
+	_UpdateCultureIndex();
+
+	std::vector<vtCultureItem> items(m_RedrapeQueue.begin(), m_RedrapeQueue.end());
+	m_RedrapeQueue.clear();
+	m_RedrapeQueued.clear();
+	m_RedrapeAreas.clear();
+	_RedrapeItems(items);
+}
+
+// Make sure the culture index matches the layers.  If it has to be rebuilt,
+//  the culture waiting to be draped is found again, since the layers may
+//  have changed under it.
+void vtTerrain::_UpdateCultureIndex()
+{
+	if (m_CultureIndex.IsCurrent(m_Layers, m_pRoadMap.get()))
+		return;
+
+	m_CultureIndex.Build(m_Layers, m_pRoadMap.get());
+
+	m_RedrapeQueue.clear();
+	m_RedrapeQueued.clear();
+	for (uint i = 0; i < m_RedrapeAreas.size(); i++)
+		_QueueRedrape(m_RedrapeAreas[i]);
+}
+
+void vtTerrain::_QueueRedrape(const DRECT &area)
+{
+	std::vector<vtCultureItem> found;
+	if (area.IsEmpty())
+		m_CultureIndex.GetAll(found);
+	else
+		m_CultureIndex.FindOverlapping(area, found);
+
+	for (uint i = 0; i < found.size(); i++)
+	{
+		if (m_RedrapeQueued.insert(found[i]).second)
+			m_RedrapeQueue.push_back(found[i]);
+	}
+}
+
+void vtTerrain::_RedrapeItems(const std::vector<vtCultureItem> &items)
+{
+	// Features and road links are draped together, after the rest
+	std::map<vtAbstractLayer*, std::vector<uint> > features;
+	std::vector<LinkGeom*> links;
+
+	for (uint i = 0; i < items.size(); i++)
+	{
+		const vtCultureItem &item = items[i];
+		switch (item.m_eKind)
 		{
-			for (uint j = 0; j < slay->size(); j++)
+		case vtCultureItem::STRUCTURE:
 			{
-				vtStructure *st = slay->at(j);
-				vtStructure3d *s3 = slay->GetStructure3d(j);
-
-				// If we were given an area, omit structures outside it
-				if (!area.IsEmpty() && !st->IsContainedBy(area))
-					continue;
+				vtStructureLayer *slay = dynamic_cast<vtStructureLayer*>(item.m_pLayer);
+				vtStructure3d *s3 = slay->GetStructure3d(item.m_iIndex);
 
 				// A fence might need re-draping, so we have to rebuild geometry
 				vtFence3d *f3 = dynamic_cast<vtFence3d*>(s3);
@@ -3269,18 +3677,31 @@ void vtTerrain::RedrapeCulture(const DRECT &area)
 				vtStructInstance3d *si = dynamic_cast<vtStructInstance3d*>(s3);
 				if (si)
 					si->UpdateTransform(m_pHeightField);
-
 			}
-		}
-		vtVegLayer *vlay = dynamic_cast<vtVegLayer *>(m_Layers[i].get());
-		if (vlay)
-		{
-			for (uint i = 0; i < vlay->NumEntities(); i++)
+			break;
+		case vtCultureItem::PLANT:
 			{
-				vlay->UpdateTransform(i);
+				vtVegLayer *vlay = dynamic_cast<vtVegLayer*>(item.m_pLayer);
+				vlay->UpdateTransform(item.m_iIndex);
 			}
+			break;
+		case vtCultureItem::FEATURE:
+			{
+				vtAbstractLayer *alay = dynamic_cast<vtAbstractLayer*>(item.m_pLayer);
+				features[alay].push_back(item.m_iIndex);
+			}
+			break;
+		case vtCultureItem::ROAD_LINK:
+			links.push_back(item.m_pLink);
+			break;
 		}
 	}
-	// What else?  Abstract Layers. Roads, perhaps.
+	for (std::map<vtAbstractLayer*, std::vector<uint> >::iterator it = features.begin();
+		it != features.end(); ++it)
+	{
+		it->first->RedrapeFeatures(it->second);
+	}
+	if (!links.empty() && m_pRoadMap.valid())
+		m_pRoadMap->RedrapeLinks(m_pHeightField, links);
 }
 
@@ -13,6 +13,7 @@
 #include "AbstractLayer.h"
 #include "AnimPath.h"	// for vtAnimContainer
 #include "Content3d.h"
+#include "CultureIndex.h"
 #include "DynTerrain.h"
 #include "GeomUtil.h"	// for MeshFactory
 #include "Location.h"
@@ -25,7 +26,9 @@
 #include "UtilityMap3d.h"
 #include "vtTin3d.h"
 
+#include <deque>
 #include <memory>
+#include <set>
 
 // Try to reduce compile-time dependencies with these forward declarations
 class vtDIB;
@@ -159,6 +162,10 @@ public:
 	void CreateStep10();
 	void CreateStep11();
 	void CreateStep12();
+	bool CreateParallel(vtTransform *pSunLight, vtLightSource *pLightSource,
+		bool progress_callback(int) = NULL);
+	/// The last of CreateStep3 to CreateStep12 which CreateParallel has finished.
+	int GetCreateStep() const { return m_iCreateStep; }
 	vtString GetLastError() { return m_strErrorMsg; }
 
 	void SetProgressCallback(ProgFuncPtrType progress_callback = NULL);
@@ -358,7 +365,16 @@ public:
 	// Dynamic elevation
 	vtElevationGrid	*GetInitialGrid() { return m_pElevGrid.get(); }
 	void UpdateElevation();
+	bool ApplyBrush(const vtTerrainBrush &brush, vtTransform *pSunLight);
 	void RedrapeCulture(const DRECT &area);
+	void RedrapeCulture(const IPoint2 &lo, const IPoint2 &hi);
+	int RedrapeStep();
+	void FlushRedrape();
+	/// Return true if some culture is still waiting to be draped again.
+	bool IsRedrapePending() const { return !m_RedrapeQueue.empty(); }
+	/// Set how many pieces of culture RedrapeStep drapes in each frame.
+	void SetRedrapeBatchSize(int iItems) { m_iRedrapeBatch = iItems; }
+	int GetRedrapeBatchSize() const { return m_iRedrapeBatch; }
 
 	// Texture
 	void ReshadeTexture(vtTransform *pSunLight, bool progress_callback(int) = NULL);
@@ -385,6 +401,15 @@ protected:
 	void _CreateVegetation();
 	void _CreateStructures();
 	void _CreateRoads();
+	bool _MakeSurfaceTexture(const FPoint3 &light_dir, bool progress_callback(int));
+	void _ApplySurfaceTexture(bool bMade);
+	bool _LoadContent();
+	vtStructureLayer *_LoadStructureLayer(const vtTagArray &tags, bool progress_callback(int));
+	vtRoadMap3d *_LoadRoads();
+	vtVegLayer *_LoadVegLayer(const vtTagArray &tags);
+	vtAbstractLayer *_LoadAbstractLayer(const vtTagArray &tags, bool progress_callback(int));
+	bool _ReadVegetation(vtVegLayer *v_layer, const vtString &fname);
+	void _CreatePlantGeometry(vtVegLayer *v_layer);
 	void _SetupVegGrid(float fLODDistance);
 	void _SetupStructGrid(float fLODDistance);
 	void _CreateAbstractLayersFromParams();
@@ -398,6 +423,10 @@ protected:
 	void MakeWaterMaterial();
 	void CreateWaterHeightfield(const vtString &fname);
 
+	void _UpdateCultureIndex();
+	void _QueueRedrape(const DRECT &area);
+	void _RedrapeItems(const std::vector<vtCultureItem> &items);
+
 	void _ComputeCenterLocation();
 	void GetTerrainBounds();
 	void EnforcePageOut();
@@ -469,6 +498,14 @@ protected:
 	vtTransform		*m_pRoadGroup;
 	vtRoadMap3dPtr	m_pRoadMap;
 
+	// Culture which CreateParallel has read ahead of time, waiting for the
+	//  creation steps to add it to the terrain.  The layers are indexed as
+	//  the layers in m_Params, with NULL for any which didn't load.
+	bool			m_bPreloaded;
+	bool			m_bContentLoaded;
+	LayerSet		m_PreloadedLayers;
+	vtRoadMap3dPtr	m_pPreloadedRoads;
+
 	// plants
 	vtSpeciesList3d	*m_pSpeciesList;
 	vtGroup			*m_pVegGroup;
@@ -493,6 +530,15 @@ protected:
 	// contain the engines specific to this terrain
 	vtEnginePtr		m_pEngineGroup;
 
+	// Culture waiting to be draped again, a batch each frame.  The areas are
+	//  kept until it is all done, in case the index must be rebuilt.
+	vtCultureIndex	m_CultureIndex;
+	std::deque<vtCultureItem> m_RedrapeQueue;
+	std::set<vtCultureItem> m_RedrapeQueued;
+	std::vector<DRECT> m_RedrapeAreas;
+	int				m_iRedrapeBatch;
+	vtEnginePtr		m_pRedrapeEngine;
+
 	// only used during initialization
 	auto_ptr<vtElevationGrid>	m_pElevGrid;
 
@@ -508,6 +554,7 @@ protected:
 
 	vtCRS	m_crs;
 	bool			m_bIsCreated;
+	int				m_iCreateStep;
 };
 
 /*@}*/	// Group terrain
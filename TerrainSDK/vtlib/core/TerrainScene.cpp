@@ -8,6 +8,7 @@
 #include "vtlib/vtlib.h"
 #include "vtdata/vtLog.h"
 #include "vtdata/DataPath.h"
+#include "vtlib/vtosg/AssetCache.h"
 #include "TerrainScene.h"
 #include "Light.h"
 #include "SkyDome.h"
@@ -109,6 +110,11 @@ void vtTerrainScene::CleanupScene()
 
 	// let go of anything left at the top of the scene graph
 	m_pTop = NULL;
+
+	// The terrains' models and textures are no longer in use
+	vtAssetCache &cache = vtGetAssetCache();
+	cache.LogStats();
+	cache.Trim();
 }
 
 void vtTerrainScene::_CreateSky()
@@ -239,23 +245,10 @@ vtGroup *vtTerrainScene::BuildTerrain(vtTerrain *pTerrain)
 	DPoint2 geo = pTerrain->GetCenterGeoLocation();
 	m_pSkyDome->SetGeoLocation(geo);
 
-	if (!pTerrain->CreateStep3(m_pSunLight, m_pLightSource))
-		return NULL;
-
-	if (!pTerrain->CreateStep4())
+	// The rest of the steps, with the independent parts run in parallel
+	if (!pTerrain->CreateParallel(m_pSunLight, m_pLightSource))
 		return NULL;
 
-	if (!pTerrain->CreateStep5())
-		return NULL;
-
-	pTerrain->CreateStep6();
-	pTerrain->CreateStep7();
-	pTerrain->CreateStep8();
-	pTerrain->CreateStep9();
-	pTerrain->CreateStep10();
-	pTerrain->CreateStep11();
-	pTerrain->CreateStep12();
-
 	return pTerrain->GetTopGroup();
 }
 
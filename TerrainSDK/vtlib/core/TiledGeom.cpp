@@ -10,6 +10,7 @@
 #include "vtdata/vtLog.h"
 #include "vtdata/TripDub.h"
 #include "TiledGeom.h"
+#include "Profiler.h"
 
 #include <mini/mini.h>
 #include <mini/miniload.h>
@@ -156,6 +157,7 @@ TiledDatasetDescription::TiledDatasetDescription()
 	earthextents.SetToZero();
 	minheight = maxheight = INVALID_ELEVATION;
 	bJPEG = false;
+	eCompression = TILECOMP_NONE;
 }
 
 bool TiledDatasetDescription::Read(const char *dataset_fname)
@@ -217,6 +219,8 @@ bool TiledDatasetDescription::Read(const char *dataset_fname)
 			if (*(buf+7) == 'J')
 				bJPEG = true;
 		}
+		if (!strncmp(buf, "Compression", 11))
+			eCompression = TileCompressionFromName(buf + 12);
 	}
 	fclose(fp);
 	return true;
@@ -501,6 +505,9 @@ bool vtTiledGeom::ReadTileList(const char *dataset_fname_elev,
 		m_elev_info.minheight = -8192;
 		m_elev_info.maxheight = 8192;
 	}
+	if (m_elev_info.eCompression != TILECOMP_NONE)
+		VTLOG("Elevation tiles are compressed (%s); decoded by the conversion hook.\n",
+			TileCompressionName(m_elev_info.eCompression));
 
 	// We assume that the CRS and extents of the two datasets are the same,
 	//  so simply take them from the elevation dataset.
@@ -1008,6 +1015,8 @@ void vtTiledGeom::DoCalcBoundBox(FBox3 &box)
 
 void vtTiledGeom::DoCull(const vtCamera *pCam)
 {
+	VTPROFILE_ZONE("Tiled terrain cull");
+
 	// Grab necessary values from the VTP Scene framework, store for later
 	m_eyepos_ogl = pCam->GetTrans();
 	m_window_size = vtGetScene()->GetWindowSize();
@@ -33,6 +33,7 @@ public:
 	vtCRS crs;
 	LODMap lodmap;
 	bool bJPEG;
+	vtTileCompression eCompression;	// for elevation tilesets only
 };
 
 // Simple cache of tiles loaded from disk
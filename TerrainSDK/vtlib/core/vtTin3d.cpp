@@ -122,7 +122,7 @@ void vtTin3d::MakeMaterialsFromOptions(const vtTagArray &options, bool bTextureC
 		vtString fname = "Geotypical/";
 		fname += geotypical_name;
 		vtString path = FindFileOnPaths(vtGetDataPath(), fname);
-		image = osgDB::readImageFile((const char *) path);
+		image = LoadOsgImage(path);
 	}
 	MakeMaterials(cmap, image, fScale, fOpacity, bTextureCompression);
 }
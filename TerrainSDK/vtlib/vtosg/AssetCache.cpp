@@ -0,0 +1,359 @@
+//
+// AssetCache.cpp
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include "vtlib/vtlib.h"
+#include "AssetCache.h"
+#include "vtdata/vtLog.h"
+
+#include <set>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Texture>
+
+// By default, keep up to 256 MB of assets which nothing is using
+static const size_t DEFAULT_BUDGET = 256 * 1024 * 1024;
+
+//
+// This visitor adds up the size of the vertex data, primitives and texture
+//  images in a node tree.  Shared images are only counted once.
+//
+class AssetSizeVisitor : public osg::NodeVisitor
+{
+public:
+	AssetSizeVisitor() : NodeVisitor(NodeVisitor::TRAVERSE_ALL_CHILDREN), m_iBytes(0) {}
+
+	virtual void apply(osg::Node &node)
+	{
+		AddStateSet(node.getStateSet());
+		traverse(node);
+	}
+	virtual void apply(osg::Geode &geode)
+	{
+		AddStateSet(geode.getStateSet());
+		for (uint i = 0; i < geode.getNumDrawables(); i++)
+		{
+			osg::Drawable *drawable = geode.getDrawable(i);
+			AddStateSet(drawable->getStateSet());
+			osg::Geometry *geom = drawable->asGeometry();
+			if (!geom)
+				continue;
+			AddArray(geom->getVertexArray());
+			AddArray(geom->getNormalArray());
+			AddArray(geom->getColorArray());
+			AddArray(geom->getSecondaryColorArray());
+			AddArray(geom->getFogCoordArray());
+			for (uint j = 0; j < geom->getNumTexCoordArrays(); j++)
+				AddArray(geom->getTexCoordArray(j));
+			for (uint j = 0; j < geom->getNumVertexAttribArrays(); j++)
+				AddArray(geom->getVertexAttribArray(j));
+			for (uint j = 0; j < geom->getNumPrimitiveSets(); j++)
+				m_iBytes += geom->getPrimitiveSet(j)->getTotalDataSize();
+		}
+		traverse(geode);
+	}
+	void AddArray(const osg::Array *array)
+	{
+		if (array)
+			m_iBytes += array->getTotalDataSize();
+	}
+	void AddStateSet(const osg::StateSet *ss)
+	{
+		if (!ss)
+			return;
+		const uint units = (uint) ss->getTextureAttributeList().size();
+		for (uint unit = 0; unit < units; unit++)
+		{
+			const osg::Texture *tex = dynamic_cast<const osg::Texture *>(
+				ss->getTextureAttribute(unit, osg::StateAttribute::TEXTURE));
+			if (!tex)
+				continue;
+			for (uint i = 0; i < tex->getNumImages(); i++)
+			{
+				const osg::Image *image = tex->getImage(i);
+				if (image && m_Images.insert(image).second)
+					m_iBytes += vtAssetCache::EstimateBytes(image);
+			}
+		}
+	}
+	size_t m_iBytes;
+	std::set<const osg::Image *> m_Images;
+};
+
+
+///////////////////////////////////////////////////////////////////////
+
+vtAssetCache::vtAssetCache()
+{
+	m_iBytes = 0;
+	m_iBudget = DEFAULT_BUDGET;
+	m_iHits = m_iMisses = m_iEvictions = 0;
+}
+
+vtAssetCache::~vtAssetCache()
+{
+	for (EntryList::iterator it = m_Entries.begin(); it != m_Entries.end(); ++it)
+		it->m_pObject->unref();
+}
+
+/**
+ * Look for a model which was loaded from this path.  This counts as a hit
+ * or a miss in the statistics.
+ *
+ * \return The model, or NULL if it isn't in the cache.  The reference is
+ *	taken before the cache lets go of its lock, so the model can't be evicted
+ *	by another thread before you use it.
+ */
+osg::ref_ptr<osg::Node> vtAssetCache::FindModel(const char *szPath, bool bDisableMipmaps)
+{
+	osg::ref_ptr<osg::Object> obj = Find(MakeKey(bDisableMipmaps ? "model-nomip" : "model", szPath));
+	return dynamic_cast<osg::Node *>(obj.get());
+}
+
+/**
+ * Put a model in the cache, replacing any which was loaded from the same path.
+ */
+void vtAssetCache::AddModel(const char *szPath, bool bDisableMipmaps, osg::Node *pNode)
+{
+	Add(MakeKey(bDisableMipmaps ? "model-nomip" : "model", szPath), pNode, EstimateBytes(pNode));
+}
+
+/**
+ * Look for an image which was loaded from this path.  This counts as a hit
+ * or a miss in the statistics.
+ *
+ * \return The image, or NULL if it isn't in the cache; see FindModel.
+ */
+osg::ref_ptr<osg::Image> vtAssetCache::FindImage(const char *szPath)
+{
+	osg::ref_ptr<osg::Object> obj = Find(MakeKey("image", szPath));
+	return dynamic_cast<osg::Image *>(obj.get());
+}
+
+/**
+ * Put an image in the cache; see AddModel.
+ */
+void vtAssetCache::AddImage(const char *szPath, osg::Image *pImage)
+{
+	Add(MakeKey("image", szPath), pImage, EstimateBytes(pImage));
+}
+
+/**
+ * Forget anything which was loaded from this path, for example because the
+ * file has changed on disk.  Anything still using the old asset keeps it.
+ */
+void vtAssetCache::Remove(const char *szPath)
+{
+	const char *kinds[3] = { "model", "model-nomip", "image" };
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (int i = 0; i < 3; i++)
+	{
+		std::map<vtString, EntryList::iterator>::iterator found =
+			m_Index.find(MakeKey(kinds[i], szPath));
+		if (found != m_Index.end())
+			Erase(found->second);
+	}
+}
+
+/**
+ * Set the memory, in bytes, which the cache may use for assets that nothing
+ * else is using.  Unused assets over the budget are dropped right away.
+ * Assets in use always stay, even if they alone are over the budget.
+ */
+void vtAssetCache::SetMemoryBudget(size_t iBytes)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_iBudget = iBytes;
+	TrimToBudget(false);
+}
+
+size_t vtAssetCache::GetMemoryBudget() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_iBudget;
+}
+
+/**
+ * Drop unused assets until the cache is within its budget.  This happens
+ * by itself when assets are added; call it after releasing a lot of assets
+ * (for example, after unloading a terrain) to free their memory sooner.
+ */
+void vtAssetCache::Trim()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	TrimToBudget(false);
+}
+
+/**
+ * Drop all assets which nothing else is using, regardless of the budget.
+ */
+void vtAssetCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	EntryList::iterator it = m_Entries.begin();
+	while (it != m_Entries.end())
+	{
+		EntryList::iterator next = it;
+		++next;
+		if (it->m_pObject->referenceCount() == 1)
+			Erase(it);
+		it = next;
+	}
+}
+
+vtAssetCacheStats vtAssetCache::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	vtAssetCacheStats stats;
+	stats.m_iHits = m_iHits;
+	stats.m_iMisses = m_iMisses;
+	stats.m_iEvictions = m_iEvictions;
+	stats.m_iBytes = m_iBytes;
+	stats.m_iBudget = m_iBudget;
+	stats.m_iEntries = (uint) m_Entries.size();
+	stats.m_iInUse = 0;
+	for (EntryList::const_iterator it = m_Entries.begin(); it != m_Entries.end(); ++it)
+	{
+		if (it->m_pObject->referenceCount() > 1)
+			stats.m_iInUse++;
+	}
+	return stats;
+}
+
+/**
+ * Set the hit, miss and eviction counts back to zero.
+ */
+void vtAssetCache::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_iHits = m_iMisses = m_iEvictions = 0;
+}
+
+void vtAssetCache::LogStats() const
+{
+	vtAssetCacheStats stats = GetStats();
+	VTLOG("Asset cache: %d assets (%d in use), %.1f of %.1f MB, %d hits, %d misses, %d evicted\n",
+		stats.m_iEntries, stats.m_iInUse,
+		stats.m_iBytes / (1024.0 * 1024.0), stats.m_iBudget / (1024.0 * 1024.0),
+		(int) stats.m_iHits, (int) stats.m_iMisses, (int) stats.m_iEvictions);
+}
+
+/**
+ * An estimate of the memory used by a model: its vertex data, primitives and
+ * texture images.
+ */
+size_t vtAssetCache::EstimateBytes(const osg::Node *pNode)
+{
+	if (!pNode)
+		return 0;
+	AssetSizeVisitor visitor;
+	const_cast<osg::Node *>(pNode)->accept(visitor);
+	return visitor.m_iBytes;
+}
+
+/**
+ * The memory used by an image, including any mipmaps.
+ */
+size_t vtAssetCache::EstimateBytes(const osg::Image *pImage)
+{
+	if (!pImage)
+		return 0;
+	return pImage->getTotalSizeInBytesIncludingMipmaps();
+}
+
+// The same file must always give the same key, however the path was written.
+vtString vtAssetCache::MakeKey(const char *szKind, const char *szPath)
+{
+	vtString key = szKind;
+	key += ':';
+	key += szPath;
+	key.Replace('\\', '/');
+#if WIN32
+	// Windows filenames are not case sensitive
+	key.MakeLower();
+#endif
+	return key;
+}
+
+// The reference is taken while the mutex is held, so that another thread's
+//  Add or Trim can't drop the asset between the lookup and the caller's use.
+osg::ref_ptr<osg::Object> vtAssetCache::Find(const vtString &strKey)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	std::map<vtString, EntryList::iterator>::iterator found = m_Index.find(strKey);
+	if (found == m_Index.end())
+	{
+		m_iMisses++;
+		return NULL;
+	}
+	m_iHits++;
+
+	// Move it to the front, as the most recently used
+	m_Entries.splice(m_Entries.begin(), m_Entries, found->second);
+	return found->second->m_pObject;
+}
+
+void vtAssetCache::Add(const vtString &strKey, osg::Object *pObject, size_t iBytes)
+{
+	if (!pObject)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	std::map<vtString, EntryList::iterator>::iterator found = m_Index.find(strKey);
+	if (found != m_Index.end())
+		Erase(found->second);
+
+	Entry entry;
+	entry.m_strKey = strKey;
+	entry.m_pObject = pObject;
+	entry.m_iBytes = iBytes;
+	pObject->ref();
+	m_Entries.push_front(entry);
+	m_Index[strKey] = m_Entries.begin();
+	m_iBytes += iBytes;
+
+	// The caller may not hold a reference yet, so keep the new asset
+	TrimToBudget(true);
+}
+
+void vtAssetCache::Erase(EntryList::iterator it)
+{
+	m_iBytes -= it->m_iBytes;
+	m_Index.erase(it->m_strKey);
+	// unref last, in case this was the only reference
+	osg::Object *obj = it->m_pObject;
+	m_Entries.erase(it);
+	obj->unref();
+}
+
+// Must be called with the mutex held.
+void vtAssetCache::TrimToBudget(bool bKeepNewest)
+{
+	EntryList::iterator it = m_Entries.end();
+	while (m_iBytes > m_iBudget && it != m_Entries.begin())
+	{
+		--it;
+		if (bKeepNewest && it == m_Entries.begin())
+			break;
+		// Only drop assets which nothing else holds
+		if (it->m_pObject->referenceCount() == 1)
+		{
+			EntryList::iterator victim = it++;
+			Erase(victim);
+			m_iEvictions++;
+		}
+	}
+}
+
+/**
+ * The process-wide asset cache.
+ */
+vtAssetCache &vtGetAssetCache()
+{
+	static vtAssetCache s_cache;
+	return s_cache;
+}
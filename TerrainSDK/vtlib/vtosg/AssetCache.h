@@ -0,0 +1,105 @@
+//
+// AssetCache.h
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#ifndef VTOSG_ASSETCACHEH
+#define VTOSG_ASSETCACHEH
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+
+#include <osg/ref_ptr>
+#include "vtdata/vtString.h"
+
+namespace osg { class Object; class Node; class Image; }
+
+/** \addtogroup sg */
+/*@{*/
+
+/**
+ * Counts of what the asset cache has done, from vtAssetCache::GetStats.
+ */
+struct vtAssetCacheStats
+{
+	uint64_t m_iHits;		///< Lookups which found a loaded asset.
+	uint64_t m_iMisses;		///< Lookups which had to load from disk.
+	uint64_t m_iEvictions;	///< Assets dropped to stay within the budget.
+	size_t m_iBytes;		///< Estimated memory used by all cached assets.
+	size_t m_iBudget;		///< The memory budget; see SetMemoryBudget.
+	uint m_iEntries;		///< Number of cached assets.
+	uint m_iInUse;			///< Number of those which are referenced outside the cache.
+};
+
+/**
+ * A process-wide cache of loaded models and images, keyed by their resolved
+ * path, so that many terrains (or many structures and plants) which use the
+ * same file share a single copy of it in memory.  vtLoadModel and
+ * LoadOsgImage go through the cache; get it with vtGetAssetCache().
+ *
+ * Assets are OSG objects, which are already reference counted, so the cache
+ * holds one reference to each.  An asset is in use while anything else also
+ * holds a reference to it, and in-use assets are never evicted.  When the
+ * estimated size of all cached assets goes over the memory budget, unused
+ * assets are dropped, least recently used first.
+ *
+ * The cache is safe to use from several threads.  Loading is done outside
+ * the lock, so two threads which miss on the same file at once will both
+ * load it, and the last one added is kept.
+ */
+class vtAssetCache
+{
+public:
+	vtAssetCache();
+	~vtAssetCache();
+
+	osg::ref_ptr<osg::Node> FindModel(const char *szPath, bool bDisableMipmaps = false);
+	void AddModel(const char *szPath, bool bDisableMipmaps, osg::Node *pNode);
+	osg::ref_ptr<osg::Image> FindImage(const char *szPath);
+	void AddImage(const char *szPath, osg::Image *pImage);
+	void Remove(const char *szPath);
+
+	void SetMemoryBudget(size_t iBytes);
+	size_t GetMemoryBudget() const;
+	void Trim();
+	void Clear();
+
+	vtAssetCacheStats GetStats() const;
+	void ResetStats();
+	void LogStats() const;
+
+	static size_t EstimateBytes(const osg::Node *pNode);
+	static size_t EstimateBytes(const osg::Image *pImage);
+
+protected:
+	struct Entry
+	{
+		vtString m_strKey;
+		osg::Object *m_pObject;		// we hold one reference
+		size_t m_iBytes;
+	};
+	typedef std::list<Entry> EntryList;
+
+	static vtString MakeKey(const char *szKind, const char *szPath);
+	osg::ref_ptr<osg::Object> Find(const vtString &strKey);
+	void Add(const vtString &strKey, osg::Object *pObject, size_t iBytes);
+	void Erase(EntryList::iterator it);
+	void TrimToBudget(bool bKeepNewest);
+
+	mutable std::mutex m_Mutex;
+	EntryList m_Entries;		// most recently used first
+	std::map<vtString, EntryList::iterator> m_Index;
+	size_t m_iBytes;
+	size_t m_iBudget;
+	uint64_t m_iHits, m_iMisses, m_iEvictions;
+};
+
+vtAssetCache &vtGetAssetCache();
+
+/*@}*/	// Group sg
+
+#endif // VTOSG_ASSETCACHEH
@@ -7,9 +7,11 @@
 
 #include "vtlib/vtlib.h"
 #include "vtdata/vtString.h"
+#include "vtdata/DxtCompressor.h"
 #include "vtdata/vtLog.h"
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
+#include <osg/Texture>
 #include "gdal_priv.h"
 #include "vtdata/vtCRS.h"
 #include "vtdata/GDALWrapper.h"
@@ -515,6 +517,94 @@ void Set16BitInternal(osg::Image *image, bool bFlag)
 		image->setInternalTextureFormat(pixf);
 }
 
+// Average each 2x2 square of pixels, repeating the last row or column of an
+//  odd-sized image.
+static void HalveImage(const uchar *src, int w, int h, int stride, int comp,
+	std::vector<uchar> &dst, int nw, int nh)
+{
+	dst.resize(nw * nh * comp);
+	uchar *out = &dst[0];
+	for (int y = 0; y < nh; y++)
+	{
+		const uchar *row0 = src + (2*y < h ? 2*y : h-1) * stride;
+		const uchar *row1 = src + (2*y+1 < h ? 2*y+1 : h-1) * stride;
+		for (int x = 0; x < nw; x++)
+		{
+			const int x0 = (2*x < w ? 2*x : w-1) * comp;
+			const int x1 = (2*x+1 < w ? 2*x+1 : w-1) * comp;
+			for (int c = 0; c < comp; c++)
+				*out++ = (uchar) ((row0[x0+c] + row0[x1+c] + row1[x0+c] + row1[x1+c] + 2) >> 2);
+		}
+	}
+}
+
+/**
+ * Make a copy of an image, compressed on the CPU: DXT1 for RGB, or DXT5 for
+ * RGBA.  Give the result to a texture instead of asking the driver to
+ * compress, which is slow and varies in quality.
+ *
+ * \param image The image to compress, which is not changed.
+ * \param bMipmaps If true, the result also holds all the mipmap levels,
+ *		each made by averaging the level above, since a driver cannot make
+ *		mipmaps from an already-compressed image.
+ *
+ * \return The new image, or NULL if the image is not 8-bit RGB or RGBA.
+ */
+osg::Image *CompressImageDXT(const osg::Image *image, bool bMipmaps)
+{
+	const GLenum pixf = image->getPixelFormat();
+	if (image->data() == NULL || image->getDataType() != GL_UNSIGNED_BYTE ||
+		(pixf != GL_RGB && pixf != GL_RGBA))
+		return NULL;
+
+	const int comp = (pixf == GL_RGBA) ? 4 : 3;
+	const GLenum format = (comp == 4) ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT :
+		GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	vtDxtCompressor dxt(comp == 4 ? vtDxtCompressor::BC3 : vtDxtCompressor::BC1);
+
+	// The size of each level, down to 1x1
+	std::vector<IPoint2> sizes;
+	size_t total = 0;
+	IPoint2 size(image->s(), image->t());
+	while (true)
+	{
+		sizes.push_back(size);
+		total += dxt.CompressedSize(size.x, size.y);
+		if (!bMipmaps || (size.x == 1 && size.y == 1))
+			break;
+		size.x = size.x > 1 ? size.x / 2 : 1;
+		size.y = size.y > 1 ? size.y / 2 : 1;
+	}
+
+	uchar *data = new uchar[total];
+	osg::Image::MipmapDataType offsets;
+	std::vector<uchar> level, next;
+	const uchar *src = image->data();
+	int stride = image->getRowSizeInBytes();
+	size_t offset = 0;
+	for (size_t i = 0; i < sizes.size(); i++)
+	{
+		if (i > 0)
+		{
+			HalveImage(src, sizes[i-1].x, sizes[i-1].y, stride, comp, next,
+				sizes[i].x, sizes[i].y);
+			level.swap(next);
+			src = &level[0];
+			stride = sizes[i].x * comp;
+			offsets.push_back((uint) offset);
+		}
+		dxt.Compress(src, sizes[i].x, sizes[i].y, comp, stride, data + offset);
+		offset += dxt.CompressedSize(sizes[i].x, sizes[i].y);
+	}
+
+	osg::Image *result = new osg::Image;
+	result->setImage(sizes[0].x, sizes[0].y, 1, format, format, GL_UNSIGNED_BYTE,
+		data, osg::Image::USE_NEW_DELETE);
+	if (bMipmaps)
+		result->setMipmapLevels(offsets);
+	return result;
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // vtImageGeo class
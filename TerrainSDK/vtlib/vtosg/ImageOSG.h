@@ -104,6 +104,7 @@ uint GetWidth(const osg::Image *image);
 uint GetHeight(const osg::Image *image);
 uint GetDepth(const osg::Image *image);
 void Set16BitInternal(osg::Image *image, bool bFlag);
+osg::Image *CompressImageDXT(const osg::Image *image, bool bMipmaps);
 
 
 class vtImageGeo : public vtImage
@@ -6,6 +6,7 @@
 //
 
 #include "vtlib/vtlib.h"
+#include "AssetCache.h"
 #include <osg/PolygonMode>
 #include <osg/Texture1D>
 
@@ -506,17 +507,33 @@ int vtMaterialArray::AddTextureMaterial(osg::Image *pImage,
 
 /**
  * Load an image.
+ *
+ * \param fname The filename to load from.
+ * \param bAllowCache Default is true, to share the image with anything else
+ *	which loads the same file (see vtAssetCache), so it must not be modified.
+ *	Pass false to get a new copy of the image, which you may modify.
  */
-osg::Image *LoadOsgImage(const char *fname)
+osg::Image *LoadOsgImage(const char *fname, bool bAllowCache)
 {
 	// safety checks
 	if (fname == NULL || *fname == 0)
 		return NULL;
 
+	vtAssetCache &cache = vtGetAssetCache();
+	if (bAllowCache)
+	{
+		// Hand our reference to the caller, without deleting the image
+		osg::ref_ptr<osg::Image> cached = cache.FindImage(fname);
+		if (cached.valid())
+			return cached.release();
+	}
+
 	osg::Image *image = osgDB::readImageFile(fname);
 	if (!image)
 		return NULL;
 
+	if (bAllowCache)
+		cache.AddImage(fname, image);
 	return image;
 }
 
@@ -133,7 +133,7 @@ public:
 typedef osg::ref_ptr<vtMaterialArray> vtMaterialArrayPtr;
 
 /// Convenience method.
-osg::Image *LoadOsgImage(const char *fname);
+osg::Image *LoadOsgImage(const char *fname, bool bAllowCache = true);
 
 /*@}*/	// Group sg
 
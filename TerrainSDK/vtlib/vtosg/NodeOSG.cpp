@@ -10,6 +10,7 @@
 #include "vtlib/vtlib.h"
 #include "vtdata/vtLog.h"
 #include "vtdata/vtString.h"
+#include "AssetCache.h"
 
 #if VTLISPSM
 #include "LightSpacePerspectiveShadowTechnique.h"
@@ -770,11 +771,12 @@ bool g_bDisableMipmaps = false;		// global
  * with vtTerrain::AddNode().
  *
  * \param filename The filename to load from.
- * \param bAllowCache Default is true, to allow OSG to cache models.
- *	This means that if you load from the same filename more than once, you
- *  will get the same model again instantly.  If you don't want this, for
- *	example if the model has changed on disk and you want to force loading,
- *	pass false.
+ * \param bAllowCache Default is true, to allow models to be cached (see
+ *	vtAssetCache).  This means that if you load from the same filename more
+ *	than once, you will get the same model again instantly.  If you don't
+ *	want this, for example if the model has changed on disk and you want to
+ *	force loading, pass false; the newly loaded model then replaces the
+ *	cached one.
  * \param bDisableMipmaps Pass true to turn off mipmapping in the texture maps
  *	in the loaded model.  Default is false (enable mipmapping).
  *
@@ -790,6 +792,16 @@ osg::Node *vtLoadModel(const char *filename, bool bAllowCache, bool bDisableMipm
 	vtString fname = filename;
 	fname.Replace('\\', '/');
 
+	const bool bNoMipmaps = bDisableMipmaps || g_bDisableMipmaps;
+	vtAssetCache &cache = vtGetAssetCache();
+	if (bAllowCache)
+	{
+		// Hand our reference to the caller, without deleting the model
+		osg::ref_ptr<osg::Node> cached = cache.FindModel(fname, bNoMipmaps);
+		if (cached.valid())
+			return cached.release();
+	}
+
 #define HINT osgDB::ReaderWriter::Options::CacheHintOptions
 	// In case of reloading a previously loaded model, we must empty
 	//  our own cache as well as disable OSG's cache.
@@ -841,7 +853,7 @@ osg::Node *vtLoadModel(const char *filename, bool bAllowCache, bool bDisableMipm
 
 	// If the user wants to, we can disable mipmaps at this point, using
 	//  another visitor.
-	if (bDisableMipmaps || g_bDisableMipmaps)
+	if (bNoMipmaps)
 	{
 		MipmapVisitor visitor;
 		node->accept(visitor);
@@ -908,6 +920,9 @@ osg::Node *vtLoadModel(const char *filename, bool bAllowCache, bool bDisableMipm
 	// Use the filename as the node's name
 	node->setName(fname);
 
+	// Share it with anyone else who loads the same file
+	cache.AddModel(fname, bNoMipmaps, node.get());
+
 	// We are holding a ref_ptr to the object (with refcount=1) so we can't just
 	//  return node.get(), because node will go out of scope, decrement the count
 	//  and delete the object.  Instead, use release(), which will decrease the
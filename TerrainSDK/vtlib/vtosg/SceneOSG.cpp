@@ -22,6 +22,7 @@
 
 #include <iostream>			// For redirecting OSG's stdout messages
 #include "vtdata/vtLog.h"	// to the VTP log.
+#include "vtlib/core/Profiler.h"
 
 /** A way to catch OSG messages */
 class OsgMsgTrap : public std::streambuf
@@ -330,16 +331,10 @@ IPoint2 vtScene::GetWindowSize(vtWindow *pWindow)
 	return pWindow->GetSize();
 }
 
-void vtScene::DoEngines(vtEngine *eng)
+void vtScene::DoEngines(vtEngineScheduler &sched, vtEngine *eng)
 {
 	// Evaluate Engines
-	vtEngineArray list(eng);
-	for (uint i = 0; i < list.size(); i++)
-	{
-		vtEngine *pEng = list[i];
-		if (pEng->GetEnabled())
-			pEng->Eval();
-	}
+	sched.Eval(eng);
 }
 
 // (for backward compatibility only)
@@ -402,13 +397,15 @@ void vtScene::UpdateBegin()
 void vtScene::UpdateEngines()
 {
 	if (!m_bInitialized) return;
-	DoEngines(m_pRootEngine);
+	VTPROFILE_ZONE("Engines");
+	DoEngines(m_EngineScheduler, m_pRootEngine);
 }
 
 void vtScene::PostDrawEngines()
 {
 	if (!m_bInitialized) return;
-	DoEngines(m_pRootEnginePostDraw);
+	VTPROFILE_ZONE("Post-draw engines");
+	DoEngines(m_PostDrawScheduler, m_pRootEnginePostDraw);
 }
 
 void vtScene::UpdateWindow(vtWindow *pWindow)
@@ -468,6 +465,7 @@ void vtScene::UpdateWindow(vtWindow *pWindow)
 	m_pOsgViewer->getCamera()->setCullMaskLeft(0x3);
 	m_pOsgViewer->getCamera()->setCullMaskRight(0x3);
 
+	VTPROFILE_ZONE("Cull and draw");
 	m_pOsgViewer->frame();
 }
 
@@ -499,12 +497,17 @@ void vtScene::ComputeViewMatrix(FMatrix4 &mat)
 
 void vtScene::DoUpdate()
 {
+	vtProfiler &prof = vtGetProfiler();
+	prof.BeginFrame();
+
 	UpdateBegin();
 	UpdateEngines();
 	UpdateWindow(GetWindow(0));
 
 	// Some engines need to run after the cull-draw phase
 	PostDrawEngines();
+
+	prof.EndFrame();
 }
 
 void vtScene::SetRoot(vtGroup *pRoot)
@@ -108,13 +108,13 @@ public:
 	void WorldToScreen(const FPoint3 &point, IPoint2 &result);
 
 	/// Set the top engine in the Engine graph
-	void SetRootEngine(vtEngine *ptr) { m_pRootEngine = ptr; }
+	void SetRootEngine(vtEngine *ptr) { m_pRootEngine = ptr; m_EngineScheduler.Invalidate(); }
 
 	/// Get the top engine in the Engine graph
 	vtEngine *GetRootEngine() { return m_pRootEngine.get(); }
 
 	/// Set the top engine in the Engine graph
-	void SetPostDrawEngine(vtEngine *ptr) { m_pRootEnginePostDraw = ptr; }
+	void SetPostDrawEngine(vtEngine *ptr) { m_pRootEnginePostDraw = ptr; m_PostDrawScheduler.Invalidate(); }
 
 	/// Get the top engine in the Engine graph
 	vtEngine *GetPostDrawEngine() { return m_pRootEnginePostDraw; }
@@ -122,6 +122,9 @@ public:
 	/// Add an Engine to the scene. (for backward compatibility only)
 	void AddEngine(vtEngine *ptr);
 
+	/// The scheduler which evaluates the engines each frame.
+	vtEngineScheduler &GetEngineScheduler() { return m_EngineScheduler; }
+
 	/// Inform all engines in the scene that a target no longer exists
 	void TargetRemoved(osg::Referenced *tar);
 
@@ -184,13 +187,15 @@ public:
 #endif
 
 protected:
-	void DoEngines(vtEngine *eng);
+	void DoEngines(vtEngineScheduler &sched, vtEngine *eng);
 
 	vtArray<vtWindow*> m_Windows;
 	vtCamera	*m_pCamera;
 	vtGroup		*m_pRoot;
 	vtEnginePtr	m_pRootEngine;
 	vtEngine	*m_pRootEnginePostDraw;
+	vtEngineScheduler	m_EngineScheduler;
+	vtEngineScheduler	m_PostDrawScheduler;
 	bool		*m_piKeyState;
 	vtHUD		*m_pHUD;
 
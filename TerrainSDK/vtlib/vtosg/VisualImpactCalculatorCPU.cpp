@@ -0,0 +1,401 @@
+//
+// VisualImpactCalculatorCPU.cpp
+//
+// Calculates the same visual impact factor as CVisualImpactCalculatorOSG,
+// but by casting rays on the CPU against the heightfield and the bounding
+// boxes of the contributing geometry, so it needs no graphics context and
+// can run on a headless machine.
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#include "vtlib/vtlib.h"
+#include "VisualImpactCalculatorCPU.h"
+#include "vtdata/HeightField.h"
+#include "vtdata/Parallel.h"
+#include "vtdata/vtLog.h"
+#include <osg/Geode>
+#include <osg/Transform>
+#include <gdal_priv.h>
+
+#include <algorithm>
+
+// These match CVisualImpactCalculatorOSG, so the two give the same results
+static const int VISUAL_IMPACT_RESOLUTION = 256;
+static const float HUMAN_FOV_DEGREES = 120;
+static const float HUMAN_FOV_SOLID_ANGLE = PIf;	// 2pi(1 - cos(120/2))
+static const float NEAR_DISTANCE = 10.0f;
+static const float FAR_DISTANCE = 40000.0f;
+
+// The solid angle of the rectangle from the center of a plane 1 unit in
+//  front of the eye to the point (x, y) on that plane.
+static double RectSolidAngle(double x, double y)
+{
+	return atan(x * y / sqrt(1.0 + x*x + y*y));
+}
+
+/**
+ * Collects the world-space bounding box of each drawable below a node.
+ */
+class BoxCollector : public osg::NodeVisitor
+{
+public:
+	BoxCollector(const osg::Matrix &parent, std::vector<FBox3> &boxes) :
+		osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
+		m_Parent(parent), m_Boxes(boxes) {}
+
+	virtual void apply(osg::Geode &geode)
+	{
+		const osg::Matrix mat = osg::computeLocalToWorld(getNodePath()) * m_Parent;
+		for (uint i = 0; i < geode.getNumDrawables(); i++)
+		{
+			const osg::BoundingBox bb = geode.getDrawable(i)->getBoundingBox();
+			if (!bb.valid())
+				continue;
+			FBox3 box;
+			box.InsideOut();
+			for (int c = 0; c < 8; c++)
+				box.GrowToContainPoint(s2v(bb.corner(c) * mat));
+			m_Boxes.push_back(box);
+		}
+	}
+
+protected:
+	osg::Matrix m_Parent;
+	std::vector<FBox3> &m_Boxes;
+};
+
+
+CVisualImpactCalculatorCPU::CVisualImpactCalculatorCPU()
+{
+	m_pHeightField = NULL;
+	m_Target.Set(0, 0, 0);
+
+	// The view is square, so the half-size is the same in each direction
+	m_fHalfSize = tanf(HUMAN_FOV_DEGREES / 2 * PIf / 180.0f);
+
+	const int res = VISUAL_IMPACT_RESOLUTION;
+	const double step = 2.0 * m_fHalfSize / res;
+	m_PixelSolidAngle.resize(res * res);
+	for (int y = 0; y < res; y++)
+	{
+		const double y1 = -m_fHalfSize + y * step, y2 = y1 + step;
+		for (int x = 0; x < res; x++)
+		{
+			const double x1 = -m_fHalfSize + x * step, x2 = x1 + step;
+			m_PixelSolidAngle[y * res + x] = (float) (RectSolidAngle(x2, y2) -
+				RectSolidAngle(x1, y2) - RectSolidAngle(x2, y1) + RectSolidAngle(x1, y1));
+		}
+	}
+}
+
+void CVisualImpactCalculatorCPU::AddVisualImpactContributor(osg::Node *pOsgNode)
+{
+	if (NULL != pOsgNode)
+		m_VisualImpactContributors.insert(pOsgNode);
+}
+
+void CVisualImpactCalculatorCPU::RemoveVisualImpactContributor(osg::Node *pOsgNode)
+{
+	if (NULL != pOsgNode)
+		m_VisualImpactContributors.erase(pOsgNode);
+}
+
+/**
+ * Add a contributor which is just a box, in world coordinates.  This is
+ * useful when there is no scene graph, for example to assess a proposed
+ * building from its dimensions alone.
+ */
+void CVisualImpactCalculatorCPU::AddVisualImpactContributor(const FBox3 &box)
+{
+	m_ExtraBoxes.push_back(box);
+}
+
+void CVisualImpactCalculatorCPU::ClearVisualImpactContributors()
+{
+	m_VisualImpactContributors.clear();
+	m_ExtraBoxes.clear();
+}
+
+void CVisualImpactCalculatorCPU::SetVisualImpactTarget(const FPoint3 Target)
+{
+	m_Target = Target;
+}
+
+const FPoint3& CVisualImpactCalculatorCPU::GetVisualImpactTarget() const
+{
+	return m_Target;
+}
+
+/**
+ * Calculate the visual impact factor of the contributors, as seen from a
+ * given point and direction.
+ *
+ * \return The percentage of the field of view covered by the contributors.
+ */
+float CVisualImpactCalculatorCPU::Calculate(const FPoint3 &Eye,
+	const FPoint3 &Direction, const FPoint3 &Up)
+{
+	GatherBoxes();
+	return InnerImplementation(Eye, Direction, Up, true);
+}
+
+/**
+ * Calculate the visual impact factor as seen by a camera, in the way that
+ * CVisualImpactCalculatorOSG::Calculate uses the current view.
+ */
+float CVisualImpactCalculatorCPU::Calculate(vtCamera *pCamera)
+{
+	return Calculate(pCamera->GetTrans(), pCamera->GetDirection());
+}
+
+/**
+ * Calculate the visual impact factor as seen from a point, looking at the
+ * target.
+ */
+float CVisualImpactCalculatorCPU::CalculateFrom(const FPoint3 &Eye)
+{
+	return Calculate(Eye, m_Target - Eye);
+}
+
+/**
+ * Calculate the visual impact factor as seen from a regular grid of points
+ * on the ground, looking at the target, and write it to a raster band.
+ * The grid covers the earth extents of the heightfield, with the first row
+ * of the band at the top (north), as CVisualImpactCalculatorOSG::Plot does.
+ * The points are calculated in parallel, and the band is written one row at
+ * a time.
+ *
+ * \param pRasterBand The band to receive the results, as 32-bit floats.
+ * \param fScaleFactor Not used.  The OSG calculator doesn't apply it either.
+ * \param dXSampleInterval, dYSampleInterval The spacing of the grid, in
+ *		earth coordinates.
+ * \param progress_callback If supplied, this is called with the percentage
+ *		done; if it returns true, the plot is cancelled.
+ * \return true if successful.
+ */
+bool CVisualImpactCalculatorCPU::Plot(GDALRasterBand *pRasterBand, float fScaleFactor,
+	double dXSampleInterval, double dYSampleInterval, bool progress_callback(int))
+{
+	if (!m_pHeightField)
+	{
+		VTLOG1("CVisualImpactCalculatorCPU::Plot - No heightfield\n");
+		return false;
+	}
+	const DRECT EarthExtents = m_pHeightField->GetEarthExtents();
+	const int iXsize = (int)((EarthExtents.right - EarthExtents.left)/dXSampleInterval);
+	const int iYsize = (int)((EarthExtents.top - EarthExtents.bottom)/dYSampleInterval);
+	if (iXsize < 1 || iYsize < 1)
+		return false;
+
+	GatherBoxes();
+
+	const bool bParallel = m_pHeightField->IsThreadSafe();
+	std::vector<float> Row(iXsize);
+	for (int iCurrentY = 0; iCurrentY < iYsize; iCurrentY++)
+	{
+		const double y = EarthExtents.bottom + iCurrentY * dYSampleInterval;
+		auto sample = [&](int iCurrentX)
+		{
+			const DPoint2 CurrentCamera(EarthExtents.left + iCurrentX * dXSampleInterval, y);
+			FPoint3 Eye;
+			m_pHeightField->ConvertEarthToSurfacePoint(CurrentCamera, Eye);
+			Row[iCurrentX] = InnerImplementation(Eye, m_Target - Eye,
+				FPoint3(0, 1, 0), false);
+		};
+		if (bParallel)
+			vtParallelFor(iXsize, sample);
+		else
+		{
+			for (int i = 0; i < iXsize; i++)
+				sample(i);
+		}
+
+		if (pRasterBand->RasterIO(GF_Write, 0, iYsize - iCurrentY - 1, iXsize, 1,
+			&Row[0], iXsize, 1, GDT_Float32, 0, 0) != CE_None)
+		{
+			VTLOG1("CVisualImpactCalculatorCPU::Plot - Couldn't write raster\n");
+			return false;
+		}
+		if (progress_callback != NULL && progress_callback(100 * (iCurrentY + 1) / iYsize))
+		{
+			VTLOG1("CVisualImpactCalculatorCPU::Plot - Cancelled by user\n");
+			return false;
+		}
+	}
+	return true;
+}
+
+void CVisualImpactCalculatorCPU::GatherBoxes()
+{
+	m_Boxes = m_ExtraBoxes;
+	for (VisualImpactContributors::iterator itr = m_VisualImpactContributors.begin();
+		itr != m_VisualImpactContributors.end(); itr++)
+	{
+		osg::Node *node = *itr;
+
+		// The transforms above the contributor, if it is in a scene graph
+		osg::Matrix parent;
+		if (node->getNumParents() > 0)
+		{
+			osg::MatrixList mats = node->getParent(0)->getWorldMatrices();
+			if (!mats.empty())
+				parent = mats[0];
+		}
+		BoxCollector collector(parent, m_Boxes);
+		node->accept(collector);
+	}
+}
+
+float CVisualImpactCalculatorCPU::InnerImplementation(const FPoint3 &Eye,
+	const FPoint3 &Direction, const FPoint3 &Up, bool bParallel) const
+{
+	if (m_Boxes.empty() || Direction.LengthSquared() == 0.0f)
+		return 0.0f;
+
+	// The camera axes, as osg::Matrix::makeLookAt makes them
+	FPoint3 f = Direction;
+	f.Normalize();
+	FPoint3 s = f.Cross(Up);
+	if (s.LengthSquared() < 1E-12f)
+		s = f.Cross(FPoint3(1, 0, 0));
+	s.Normalize();
+	const FPoint3 u = s.Cross(f);
+
+	// Only the pixels which the boxes cover on screen need rays
+	const int res = VISUAL_IMPACT_RESOLUTION;
+	const float scale = res / (2 * m_fHalfSize);
+	int x0 = res, x1 = -1, y0 = res, y1 = -1;
+	for (size_t b = 0; b < m_Boxes.size(); b++)
+	{
+		const FBox3 &box = m_Boxes[b];
+		float sx0 = 1E10f, sx1 = -1E10f, sy0 = 1E10f, sy1 = -1E10f;
+		int behind = 0;
+		for (int c = 0; c < 8; c++)
+		{
+			const FPoint3 corner((c & 1) ? box.max.x : box.min.x,
+				(c & 2) ? box.max.y : box.min.y, (c & 4) ? box.max.z : box.min.z);
+			const FPoint3 v = corner - Eye;
+			const float depth = v.Dot(f);
+			if (depth < NEAR_DISTANCE)
+			{
+				behind++;
+				continue;
+			}
+			const float px = v.Dot(s) / depth, py = v.Dot(u) / depth;
+			sx0 = std::min(sx0, px); sx1 = std::max(sx1, px);
+			sy0 = std::min(sy0, py); sy1 = std::max(sy1, py);
+		}
+		if (behind == 8)
+			continue;
+		if (behind > 0)
+		{
+			// Crosses the near plane; it could cover any part of the view
+			x0 = y0 = 0;
+			x1 = y1 = res - 1;
+			break;
+		}
+		x0 = std::min(x0, std::max(0, (int) floorf((sx0 + m_fHalfSize) * scale)));
+		x1 = std::max(x1, std::min(res - 1, (int) floorf((sx1 + m_fHalfSize) * scale)));
+		y0 = std::min(y0, std::max(0, (int) floorf((sy0 + m_fHalfSize) * scale)));
+		y1 = std::max(y1, std::min(res - 1, (int) floorf((sy1 + m_fHalfSize) * scale)));
+	}
+	if (x1 < x0 || y1 < y0)
+		return 0.0f;
+
+	const float step = 2 * m_fHalfSize / res;
+	std::vector<double> RowSum(y1 - y0 + 1, 0.0);
+	auto row = [&](int r)
+	{
+		const int y = y0 + r;
+		const float py = -m_fHalfSize + (y + 0.5f) * step;
+		double sum = 0.0;
+		for (int x = x0; x <= x1; x++)
+		{
+			const float px = -m_fHalfSize + (x + 0.5f) * step;
+			const FPoint3 Ray = f + s * px + u * py;
+			if (PixelImpact(Eye, Ray, NEAR_DISTANCE) > 0.0f)
+				sum += m_PixelSolidAngle[y * res + x];
+		}
+		RowSum[r] = sum;
+	};
+	const int rows = y1 - y0 + 1;
+	if (bParallel && m_pHeightField && m_pHeightField->IsThreadSafe())
+		vtParallelFor(rows, row);
+	else
+	{
+		for (int r = 0; r < rows; r++)
+			row(r);
+	}
+
+	double fSolidAngle = 0.0;
+	for (int r = 0; r < rows; r++)
+		fSolidAngle += RowSum[r];
+	return (float) (100 * fSolidAngle / HUMAN_FOV_SOLID_ANGLE);
+}
+
+/**
+ * Cast one ray.  The ray has a length of 1 along the view direction, so the
+ * distance along it is the depth.  \return 1 if the nearest contributor it
+ * meets, between the near and far planes, is not hidden by the ground.
+ */
+float CVisualImpactCalculatorCPU::PixelImpact(const FPoint3 &Eye, const FPoint3 &Ray,
+	float fNearDist) const
+{
+	float tBest = FAR_DISTANCE;
+	bool bHit = false;
+	for (size_t b = 0; b < m_Boxes.size(); b++)
+	{
+		// Slab test
+		const FBox3 &box = m_Boxes[b];
+		float tmin = fNearDist, tmax = tBest;
+		int axis;
+		for (axis = 0; axis < 3; axis++)
+		{
+			const float o = Eye[axis], d = Ray[axis];
+			const float lo = box.min[axis], hi = box.max[axis];
+			if (fabsf(d) < 1E-9f)
+			{
+				if (o < lo || o > hi)
+					break;
+				continue;
+			}
+			float t0 = (lo - o) / d, t1 = (hi - o) / d;
+			if (t0 > t1)
+				std::swap(t0, t1);
+			tmin = std::max(tmin, t0);
+			tmax = std::min(tmax, t1);
+			if (tmin > tmax)
+				break;
+		}
+		if (axis == 3)
+		{
+			tBest = tmin;
+			bHit = true;
+		}
+	}
+	if (!bHit)
+		return 0.0f;
+	if (!m_pHeightField)
+		return 1.0f;
+	return IsVisible(Eye + Ray * fNearDist, Eye + Ray * tBest) ? 1.0f : 0.0f;
+}
+
+// True if the ground doesn't come between two points
+bool CVisualImpactCalculatorCPU::IsVisible(const FPoint3 &From, const FPoint3 &To) const
+{
+	const vtHeightFieldGrid3d *pGrid = dynamic_cast<const vtHeightFieldGrid3d*>(m_pHeightField);
+	if (pGrid)
+		return pGrid->LineOfSight(From, To);
+
+	FPoint3 dir = To - From;
+	const float dist = dir.Length();
+	if (dist == 0.0f)
+		return true;
+	dir /= dist;
+	FPoint3 ground;
+	if (!m_pHeightField->CastRayToSurface(From, dir, ground))
+		return true;
+	return (ground - From).Length() >= dist;
+}
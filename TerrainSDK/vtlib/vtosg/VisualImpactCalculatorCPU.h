@@ -0,0 +1,79 @@
+//
+// VisualImpactCalculatorCPU.h
+//
+// Calculates the same visual impact factor as CVisualImpactCalculatorOSG,
+// but by casting rays on the CPU against the heightfield and the bounding
+// boxes of the contributing geometry, so it needs no graphics context and
+// can run on a headless machine.
+//
+// Copyright (c) 2016 Virtual Terrain Project
+// Free for all uses, see license.txt for details.
+//
+
+#pragma once
+
+#include <set>
+#include <vector>
+
+class GDALRasterBand;
+class vtHeightField3d;
+
+/**
+ * Calculates the visual impact of a set of geometry, as the percentage of a
+ * human field of view (120 degrees, a solid angle of pi) which it covers
+ * when seen from a given point.
+ *
+ * The view is divided into the same 256x256 grid of pixels that
+ * CVisualImpactCalculatorOSG renders.  A ray is cast through each pixel; if
+ * it reaches a contributor before the ground, the solid angle of that pixel
+ * is added.  Contributors are represented by the bounding boxes of their
+ * drawables, which is close for buildings and other blocky structures.
+ * Other geometry in the scene does not hide the contributors.
+ *
+ * The rays are cast on several threads when the heightfield allows it
+ * (see vtHeightField3d::IsThreadSafe).
+ */
+class CVisualImpactCalculatorCPU
+{
+public:
+	CVisualImpactCalculatorCPU();
+
+	void SetHeightField(vtHeightField3d *pHeightField) { m_pHeightField = pHeightField; }
+	vtHeightField3d *GetHeightField() const { return m_pHeightField; }
+
+	void AddVisualImpactContributor(osg::Node *pOsgNode);
+	void RemoveVisualImpactContributor(osg::Node *pOsgNode);
+	void AddVisualImpactContributor(const FBox3 &box);
+	void ClearVisualImpactContributors();
+	void SetVisualImpactTarget(const FPoint3 Target);
+	const FPoint3& GetVisualImpactTarget() const;
+
+	float Calculate(const FPoint3 &Eye, const FPoint3 &Direction,
+		const FPoint3 &Up = FPoint3(0, 1, 0));
+	float Calculate(vtCamera *pCamera);
+	float CalculateFrom(const FPoint3 &Eye);
+	bool Plot(GDALRasterBand *pRasterBand, float fScaleFactor, double dXSampleInterval,
+		double dYSampleInterval, bool progress_callback(int) = NULL);
+
+protected:
+	void GatherBoxes();
+	float InnerImplementation(const FPoint3 &Eye, const FPoint3 &Direction,
+		const FPoint3 &Up, bool bParallel) const;
+	float PixelImpact(const FPoint3 &Eye, const FPoint3 &Ray, float fNearDist) const;
+	bool IsVisible(const FPoint3 &From, const FPoint3 &To) const;
+
+	vtHeightField3d *m_pHeightField;
+	FPoint3 m_Target;
+
+	typedef std::set<osg::Node*> VisualImpactContributors;
+	VisualImpactContributors m_VisualImpactContributors;
+	std::vector<FBox3> m_ExtraBoxes;
+
+	// Gathered from the contributors at the start of each calculation
+	std::vector<FBox3> m_Boxes;
+
+	// The solid angle of each pixel, which only depends on the projection
+	std::vector<float> m_PixelSolidAngle;
+	// The extent of the view on a plane 1 unit in front of the eye
+	float m_fHalfSize;
+};
@@ -377,7 +377,7 @@ void DistanceDlg::OnLoadPath( wxCommandEvent &event )
 			fclose(fp);
 			vtFeatureSetLineString fs;
 			if (fs.LoadFromSHP(vs))
-				line = fs.GetPolyLine(0);
+				fs.GetPolyLineView(0).ToDLine2(line);
 		}
 		else
 		{